@@ -98,6 +98,7 @@ function gen-ethtool() {
 	gen HAVE_ETHTOOL_RXFH_RXFHPARAMS if method get_rxfh of ethtool_ops matches 'struct ethtool_rxfh_param \\*' in "$eth"
 	gen HAVE_ETHTOOL_GET_TS_INFO if method get_ts_info of ethtool_ops matches 'struct kernel_ethtool_ts_info \\*' in "$eth"
 	gen HAVE_ETHTOOL_KEEE if struct ethtool_keee in "$eth"
+	gen HAVE_ETHTOOL_MODULE_EEPROM_BY_PAGE if method get_module_eeprom_by_page of ethtool_ops in "$eth"
 	gen NEED_ETHTOOL_SPRINTF if fun ethtool_sprintf absent in "$eth"
 	gen HAVE_ETHTOOL_FLOW_RSS if macro FLOW_RSS in "$ueth"
 }
@@ -108,6 +109,7 @@ function gen-filter() {
 	gen HAVE_XSK_BUFF_DMA_SYNC_FOR_CPU if fun xsk_buff_dma_sync_for_cpu in include/net/xdp_sock_drv.h include/net/xdp_sock.h
 	gen HAVE_XSK_BUFF_DMA_SYNC_FOR_CPU_2_PARAMS if fun xsk_buff_dma_sync_for_cpu matches 'struct xsk_buff_pool \\*' in include/net/xdp_sock_drv.h include/net/xdp_sock.h
 	gen NEED_NO_NETDEV_PROG_XDP_WARN_ACTION if fun bpf_warn_invalid_xdp_action lacks 'struct net_device \\*' in "$fh"
+	gen HAVE_TC_MQPRIO_QOPT_OFFLOAD if struct tc_mqprio_qopt_offload in include/net/pkt_cls.h include/net/pkt_sched.h
 }
 
 function gen-flow-dissector() {
@@ -144,6 +146,7 @@ function gen-netdevice() {
 	gen HAVE_NDO_ETH_IOCTL if fun ndo_eth_ioctl in "$ndh"
 	gen HAVE_NDO_FDB_ADD_VID    if method ndo_fdb_del of net_device_ops matches 'u16 vid' in "$ndh"
 	gen HAVE_NDO_FDB_DEL_EXTACK if method ndo_fdb_del of net_device_ops matches ext_ack in "$ndh"
+	gen HAVE_DEV_SET_THREADED if fun dev_set_threaded in "$ndh"
 	gen HAVE_NDO_GET_DEVLINK_PORT if method ndo_get_devlink_port of net_device_ops in "$ndh"
 	gen HAVE_NDO_UDP_TUNNEL_CALLBACK if method ndo_udp_tunnel_add of net_device_ops in "$ndh"
 	gen HAVE_NETIF_SET_TSO_MAX if fun netif_set_tso_max_size in "$ndh"
@@ -756,6 +756,44 @@ static inline void
 ptp_read_system_postts(struct ptp_system_timestamp *sts) { }
 #endif /* NEED_PTP_SYSTEM_PRETS */
 
+/*
+ * NEED_SCHED_SET_FIFO_LOW
+ *
+ * Upstream commit 7318d4cc14c8 ("sched: Provide sched_set_fifo()") adds
+ * sched_set_fifo(), sched_set_fifo_low() and sched_set_normal() and
+ * unexports sched_setscheduler(); older kernels still export
+ * sched_setscheduler_nocheck().
+ */
+#ifdef NEED_SCHED_SET_FIFO_LOW
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4,11,0))
+#include <uapi/linux/sched/types.h>
+#endif
+static inline void _kc_sched_set_fifo(struct task_struct *p)
+{
+	struct sched_param sp = { .sched_priority = MAX_RT_PRIO / 2 };
+
+	WARN_ON_ONCE(sched_setscheduler_nocheck(p, SCHED_FIFO, &sp) != 0);
+}
+#define sched_set_fifo _kc_sched_set_fifo
+
+static inline void _kc_sched_set_fifo_low(struct task_struct *p)
+{
+	struct sched_param sp = { .sched_priority = 1 };
+
+	WARN_ON_ONCE(sched_setscheduler_nocheck(p, SCHED_FIFO, &sp) != 0);
+}
+#define sched_set_fifo_low _kc_sched_set_fifo_low
+
+static inline void _kc_sched_set_normal(struct task_struct *p, int nice)
+{
+	struct sched_param sp = { .sched_priority = 0 };
+
+	sched_setscheduler_nocheck(p, SCHED_NORMAL, &sp);
+	set_user_nice(p, nice);
+}
+#define sched_set_normal _kc_sched_set_normal
+#endif /* NEED_SCHED_SET_FIFO_LOW */
+
 #ifdef NEED_PTP_CLASSIFY_RAW
 /* NEED_PTP_CLASSIFY_RAW
  *
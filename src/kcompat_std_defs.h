@@ -143,6 +143,11 @@
 #define HAVE_XSK_UNALIGNED_CHUNK_PLACEMENT
 #endif /* 5.4.0 */
 
+/*****************************************************************************/
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5,6,0))
+#define NEED_DEVLINK_FLASH_UPDATE_STATUS_NOTIFY
+#endif /* 5.6.0 */
+
 /*****************************************************************************/
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5,7,0))
 #define NEED_DEVLINK_REGION_CREATE_OPS
@@ -163,6 +168,7 @@
 #define NEED_DEVLINK_PORT_ATTRS_SET_STRUCT
 #define HAVE_XDP_QUERY_PROG
 #define NEED_INDIRECT_CALL_3_AND_4
+#define NEED_SCHED_SET_FIFO_LOW
 #else /* >= 5.9.0 */
 #define HAVE_TASKLET_SETUP
 #endif /* 5.9.0 */
@@ -216,6 +222,7 @@
 
 /*****************************************************************************/
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5,15,0))
+#define NEED_DEVLINK_ALLOC_SETS_DEV
 #else /* >= 5.15.0 */
 #define HAVE_DEVICE_IN_MDEV_PARENT_OPS
 #define NEED_PCI_IOV_VF_ID
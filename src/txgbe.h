@@ -38,6 +38,8 @@
 #endif
 
 #include "txgbe_dcb.h"
+#include "txgbe_hic.h"
+#include "txgbe_ring.h"
 
 #include "kcompat.h"
 #ifdef HAVE_XDP_BUFF_RXQ
@@ -65,6 +67,9 @@
 #include <linux/clocksource.h>
 #include <linux/net_tstamp.h>
 #include <linux/ptp_clock_kernel.h>
+#ifdef HAVE_KTHREAD_DELAYED_API
+#include <linux/kthread.h>
+#endif
 #endif /* HAVE_PTP_1588_CLOCK */
 
 /* Ether Types */
@@ -80,6 +85,8 @@ extern int txgbe_force_irq_affinity;
 extern int txgbe_port_affinity_spread;
 extern int txgbe_port_affinity_stride;
 extern int txgbe_tx_wthresh_safe;
+extern int txgbe_vf_mbx_rate;
+extern int txgbe_sfp_dom_interval;
 
 #ifndef XDP_PACKET_HEADROOM
 #define XDP_PACKET_HEADROOM 256
@@ -198,9 +205,19 @@ enum txgbe_tx_flags {
 #define TXGBE_TX_FLAGS_VLAN_SHIFT       16
 
 #define TXGBE_MAX_RX_DESC_POLL          10
+/* batched queue enables are polled every 100-200us for up to ~10ms */
+#define TXGBE_RING_ENABLE_POLL          100
+/* a flushed Tx queue is polled every 1-2ms for up to ~20ms to stop */
+#define TXGBE_TX_FLUSH_POLL             20
+/* a Tx queue hanging again this soon after a restart gets a full reset */
+#define TXGBE_TX_RESTART_WINDOW         (30 * HZ)
 
 #define TXGBE_MAX_VF_MC_ENTRIES         30
 #define TXGBE_MAX_VF_FUNCTIONS          64
+#define TXGBE_MBX_HIST_BUCKETS          16 /* log2 us, last is open */
+#define TXGBE_PTP_TX_HIST_BUCKETS       16 /* log2 us, last is open */
+#define TXGBE_VF_MBX_WINDOW             max_t(unsigned long, HZ / 10, 1)
+#define TXGBE_DEFAULT_VF_MBX_RATE       2000 /* messages/s per VF */
 #define MAX_EMULATION_MAC_ADDRS         16
 #define TXGBE_MAX_PF_MACVLANS           15
 #define TXGBE_VF_DEVICE_ID		0x1000
@@ -239,6 +256,12 @@ struct vf_data_storage {
 	u8 trusted;
 	int xcast_mode;
 	unsigned int vf_api;
+	/* mailbox dispatch, see txgbe_msg_task() */
+	unsigned long mbx_window;       /* jiffies the rate window opened */
+	u32 mbx_window_msgs;
+	u32 mbx_msgs;
+	u32 mbx_throttled;
+	u32 mbx_max_service_us;
 };
 
 struct vf_macvlans {
@@ -249,6 +272,13 @@ struct vf_macvlans {
 	u8 vf_macvlan[ETH_ALEN];
 };
 
+/* netdev features that are backed by hardware RSC */
+#ifdef NETIF_F_GRO_HW
+#define TXGBE_NETIF_F_RSC       (NETIF_F_LRO | NETIF_F_GRO_HW)
+#else
+#define TXGBE_NETIF_F_RSC       NETIF_F_LRO
+#endif
+
 #ifndef TXGBE_NO_LRO
 #define TXGBE_LRO_MAX           32      /*Maximum number of LRO descriptors*/
 #define TXGBE_LRO_GLOBAL        10
@@ -354,19 +384,30 @@ struct txgbe_tx_queue_stats {
 	u64 restart_queue;
 	u64 tx_busy;
 	u64 tx_done_old;
+	u64 paced_stops;        /* queue stopped while rate limited */
+	u64 atr_added;          /* ATR signature filters written */
+	u64 atr_suppressed;     /* not written, flow is in atr_cache */
+	u64 atr_failed;         /* FDIR command did not complete */
 };
 
 struct txgbe_rx_queue_stats {
 	u64 rsc_count;
 	u64 rsc_flush;
+	u64 rsc_gro_hw;
 	u64 non_eop_descs;
 	u64 alloc_rx_page_failed;
 	u64 alloc_rx_buff_failed;
 	u64 csum_good_cnt;
 	u64 csum_err;
+	/* fill level, see txgbe_rx_pressure() */
+	u16 fill_hwm;		/* highest since the threshold was set */
+	u16 fill_intvl;		/* highest since the last stats update */
+	u64 pressure_events;	/* times the threshold was crossed */
+	u64 drop_intervals;	/* stats updates with drops while over it */
 };
 
 #define TXGBE_TS_HDR_LEN 8
+#define TXGBE_ATR_CACHE_SIZE 64 /* per Tx ring, a power of 2 */
 enum txgbe_ring_state_t {
 #ifndef CONFIG_TXGBE_DISABLE_PACKET_SPLIT
 	__TXGBE_RX_3K_BUFFER,
@@ -382,9 +423,9 @@ enum txgbe_ring_state_t {
 #if IS_ENABLED(CONFIG_FCOE)
 	__TXGBE_RX_FCOE,
 #endif
-#ifdef HAVE_AF_XDP_ZC_SUPPORT
 	__TXGBE_TX_DISABLED,
-#endif
+	__TXGBE_TX_RESTART_REQ,
+	__TXGBE_RX_PRESSURE,
 };
 
 struct txgbe_fwd_adapter {
@@ -446,6 +487,7 @@ struct txgbe_ring {
 	u8 __iomem *tail;
 	dma_addr_t dma;                 /* phys. address of descriptor ring */
 	unsigned int size;              /* length in bytes */
+	int numa_node;                  /* node desc/buffer_info live on */
 
 	u16 count;                      /* amount of descriptors */
 
@@ -462,6 +504,7 @@ struct txgbe_ring {
 	unsigned long last_rx_timestamp;
 
 #endif
+	unsigned long last_tx_restart;	/* jiffies, see txgbe_tx_hang_restart */
 	u16 rx_buf_len;
 	union {
 #ifndef CONFIG_TXGBE_DISABLE_PACKET_SPLIs
@@ -483,6 +526,12 @@ struct txgbe_ring {
 #endif /* HAVE_XDP_SUPPORT */
 
 	u8 dcb_tc;
+	u32 tx_maxrate;         /* Mbps programmed in the Tx pacer, 0 = off */
+	/* signature hashes of the flows ATR last wrote for this Tx ring,
+	 * with the adapter's atr_gen of the slot in the upper 32 bits
+	 */
+	u64 atr_cache[TXGBE_ATR_CACHE_SIZE];
+	u16 pressure_thresh;    /* Rx fill level in descriptors, 0 = off */
 	struct txgbe_queue_stats stats;
 #ifdef HAVE_NDO_GET_STATS64
 	struct u64_stats_sync syncp;
@@ -664,6 +713,26 @@ struct txgbe_ring_container {
 				 ? 8 : 1)
 #define MAX_TX_PACKET_BUFFERS   MAX_RX_PACKET_BUFFERS
 
+/* context a vector was polled in, see txgbe_poll() */
+enum txgbe_poll_ctx {
+	TXGBE_POLL_SOFTIRQ = 0,
+	TXGBE_POLL_THREAD,      /* threaded NAPI */
+	TXGBE_POLL_BUSY,        /* busy polling or netpoll from a task */
+	TXGBE_POLL_CTX_NUM
+};
+
+/* scheduling of a NAPI thread, see txgbe_napi_thread_apply() */
+enum txgbe_napi_sched {
+	TXGBE_NAPI_SCHED_KEEP = 0,      /* left as created */
+	TXGBE_NAPI_SCHED_NORMAL,        /* SCHED_NORMAL at napi_nice */
+	TXGBE_NAPI_SCHED_FIFO_LOW,      /* SCHED_FIFO, lowest priority */
+	TXGBE_NAPI_SCHED_FIFO,          /* SCHED_FIFO, default RT priority */
+};
+
+/* vector packing thresholds in packets/s, see txgbe_vpack_subtask() */
+#define TXGBE_VPACK_LOW_DEFAULT		1000
+#define TXGBE_VPACK_HIGH_DEFAULT	20000
+
 /* MAX_MSIX_Q_VECTORS of these are allocated,
  * but we only use one per queue-specific vector.
  */
@@ -683,10 +752,33 @@ struct txgbe_q_vector {
 #ifdef HAVE_IRQ_AFFINITY_HINT
 	cpumask_t affinity_mask;
 #endif
+#ifdef HAVE_IRQ_AFFINITY_NOTIFY
+	struct irq_affinity_notify affinity_notify;
+#endif
 #ifndef TXGBE_NO_LRO
 	struct txgbe_lro_list lrolist;   /* LRO list for queue vector*/
 #endif
-	int numa_node;
+	int numa_node;  /* node of the IRQ affinity, NUMA_NO_NODE if mixed */
+	u32 affinity_moves;     /* IRQ affinity changes seen by the notifier */
+	/* vector packing, see txgbe_vpack_subtask(): the vector whose
+	 * interrupt this one's queues are mapped to while folded, and the
+	 * number of vectors folded onto this one
+	 */
+	struct txgbe_q_vector *vpack_host;
+	u16 vpack_guests;
+	u32 vpack_rate;         /* packets/s over the last interval */
+	u32 vpack_load;         /* with the rates of the folded vectors */
+	u64 vpack_pkts;         /* ring packet count at the last sample */
+	/* threaded NAPI: the thread the CPU and scheduling settings were
+	 * last applied to, NULL to apply them again
+	 */
+	struct task_struct *napi_thread_applied;
+#ifndef HAVE_DEV_SET_THREADED
+	struct task_struct *poll_thread;        /* see txgbe_napi_thread() */
+	unsigned long poll_thread_sched;        /* bit 0: a poll was requested */
+#endif
+	u64 polls[TXGBE_POLL_CTX_NUM];
+	u64 poll_ns[TXGBE_POLL_CTX_NUM];
 	struct rcu_head rcu;    /* to avoid race with update stats on free */
 	char name[IFNAMSIZ + 17];
 	bool netpoll_rx;
@@ -845,8 +937,14 @@ struct txgbe_mac_addr {
 	u8 addr[ETH_ALEN];
 	u16 state; /* bitmask */
 	u64 pools;
+	struct hlist_node hnode;        /* adapter->mac_hash, while IN_USE */
+	u8 refs[TXGBE_MAX_VMDQ_INDICES]; /* users of the address per pool */
 };
 
+/* RAR entries tracked by adapter->mac_table, see TXGBE_SP_RAR_ENTRIES */
+#define TXGBE_MAX_MAC_FILTERS           128
+#define TXGBE_MAC_HASH_BITS             6
+
 #define TXGBE_MAC_STATE_DEFAULT         0x1
 #define TXGBE_MAC_STATE_MODIFIED        0x2
 #define TXGBE_MAC_STATE_IN_USE          0x4
@@ -974,6 +1072,73 @@ enum txgbe_isb_idx {
 	TXGBE_ISB_MAX
 };
 
+/* SFP module EEPROM cache, filled on insertion (txgbe_module.c) */
+#define TXGBE_MODULE_PAGE_LEN           256
+#define TXGBE_MODULE_DOM_OFFSET         96  /* A2: real-time diagnostics */
+#define TXGBE_MODULE_DOM_LEN            24  /* values, status and flags */
+#define TXGBE_DEFAULT_SFP_DOM_INTERVAL  2000 /* ms */
+
+struct txgbe_module_cache {
+	struct mutex lock;
+	u8 a0[TXGBE_MODULE_PAGE_LEN];
+	u8 a2[TXGBE_MODULE_PAGE_LEN];
+	bool valid;
+	bool has_a2;                    /* SFF-8472 DDM without page swap */
+	unsigned long dom_updated;      /* jiffies of the last DOM read */
+
+	u32 fills;
+	u32 fill_errors;
+	u32 dom_refreshes;
+	u32 dom_errors;
+	u32 hits;                       /* ethtool reads served from memory */
+	u32 last_fill_us;
+	u32 last_dom_us;
+};
+
+/* link and module events, timestamped for debugfs <pci>/link */
+#define TXGBE_LINK_LOG_LEN              32
+
+enum txgbe_link_ev {
+	TXGBE_LINK_EV_LSC = 0,          /* MAC link up/down interrupt */
+	TXGBE_LINK_EV_MODULE,           /* SFP+ module present GPIO */
+	TXGBE_LINK_EV_GPIO,             /* other link GPIO (LOS, ext PHY) */
+	TXGBE_LINK_EV_SFP_POLL,         /* copper SFP PHY status changed */
+	TXGBE_LINK_EV_CARRIER_UP,
+	TXGBE_LINK_EV_CARRIER_DOWN,
+};
+
+struct txgbe_link_log {
+	spinlock_t lock;                /* also taken in the misc interrupt */
+	struct {
+		u64 ns;                 /* ktime_get_ns() */
+		enum txgbe_link_ev type;
+	} ev[TXGBE_LINK_LOG_LEN];
+	u32 head;                       /* events logged so far */
+	u64 pending_ns;                 /* first event since carrier went down */
+	u32 last_up_us;                 /* pending_ns to carrier up */
+	u32 max_up_us;
+	u32 reruns;                     /* service passes repeated for an event */
+};
+
+/* PCIe error recovery phases, for debugfs <pci>/recovery */
+enum txgbe_recovery_phase {
+	TXGBE_RECOVERY_DETECTED = 0,    /* error seen, timeline starts */
+	TXGBE_RECOVERY_QUIESCED,        /* traffic stopped, device disabled */
+	TXGBE_RECOVERY_BUS_RESET,       /* secondary bus reset released */
+	TXGBE_RECOVERY_LINK_UP,         /* DLL link active, if reported */
+	TXGBE_RECOVERY_DEV_READY,       /* config space answers again */
+	TXGBE_RECOVERY_SLOT_RESET,      /* device re-enabled and reset */
+	TXGBE_RECOVERY_RESUMED,         /* queues and filters restored */
+	TXGBE_RECOVERY_PHASES,
+};
+
+struct txgbe_recovery_log {
+	u64 start_ns;                   /* ktime_get_ns() at DETECTED */
+	u64 phase_ns[TXGBE_RECOVERY_PHASES]; /* since start, 0 = not reached */
+	u32 count;                      /* recoveries started */
+	bool active;
+};
+
 /* board specific private data structure */
 struct txgbe_adapter {
 #if defined(NETIF_F_HW_VLAN_TX) || defined(NETIF_F_HW_VLAN_CTAG_TX) ||\
@@ -1035,6 +1200,13 @@ struct txgbe_adapter {
 	u64 restart_queue;
 	u64 lsc_int;
 	u32 tx_timeout_count;
+	/* Tx hang recovery: hangs seen, single queue restarts, restarts
+	 * that did not bring the queue back (tx_timeout_count counts the
+	 * full resets)
+	 */
+	u32 tx_hang_count;
+	u32 tx_queue_restarts;
+	u32 tx_queue_restart_failed;
 
 	/* RX */
 	struct txgbe_ring *rx_ring[MAX_RX_QUEUES];
@@ -1045,6 +1217,7 @@ struct txgbe_adapter {
 	u64 hw_rx_no_dma_resources;
 	u64 rsc_total_count;
 	u64 rsc_total_flush;
+	u64 rsc_total_gro_hw;
 	u64 non_eop_descs;
 	u32 alloc_rx_page_failed;
 	u32 alloc_rx_buff_failed;
@@ -1084,6 +1257,11 @@ struct txgbe_adapter {
 
 	/* structs defined in txgbe_hw.h */
 	struct txgbe_hw hw;
+	struct txgbe_hic hic;           /* host interface command engine */
+	struct mutex flash_lock;        /* ethtool -f and devlink flash */
+#if IS_ENABLED(CONFIG_NET_DEVLINK)
+	struct devlink *devlink;
+#endif
 	u16 msg_enable;
 	struct txgbe_hw_stats stats;
 #ifndef TXGBE_NO_LLI
@@ -1095,6 +1273,32 @@ struct txgbe_adapter {
 
 	u32 *config_space;
 	u64 tx_busy;
+	u64 tx_paced_stops;
+	/* Rx ring pressure: threshold in percent of the ring, and the stats
+	 * updates that saw Rx drops, in total and with no ring over it
+	 */
+	u32 rx_pressure_pct;
+	u64 rx_pressure_events;
+	u64 rx_drop_intervals;
+	u64 rx_drop_unattributed;
+	/* vector packing: packets/s below which a vector is folded and at
+	 * which a host vector unfolds, and the number of host vectors
+	 */
+	u32 vpack_low;
+	u32 vpack_high;
+	u32 vpack_hosts;
+	u64 vpack_folds;
+	u64 vpack_unfolds;
+	unsigned long vpack_time;
+	/* NAPI thread scheduling per vector, see txgbe_set_napi_sched() */
+	u8 napi_sched[MAX_MSIX_Q_VECTORS];
+	s8 napi_nice[MAX_MSIX_Q_VECTORS];
+	bool napi_poll_stats;   /* poll time per context, see txgbe_poll() */
+	/* Tx rate limits in Mbps: per queue from ndo_set_tx_maxrate and
+	 * per traffic class from mqprio channel mode
+	 */
+	u32 tx_maxrate[MAX_TX_QUEUES];
+	u32 tc_maxrate[TXGBE_DCB_MAX_TRAFFIC_CLASS];
 	unsigned int tx_ring_count;
 	unsigned int xdp_ring_count;
 	unsigned int rx_ring_count;
@@ -1107,6 +1311,13 @@ struct txgbe_adapter {
 	struct timer_list service_timer;
 	struct work_struct service_task;
 	struct work_struct sfp_sta_task;
+	struct txgbe_module_cache module;
+	struct txgbe_link_log link_log;
+	struct txgbe_recovery_log recovery_log;
+
+	/* probe/open step timing, see txgbe_bringup_step() */
+	u64 bringup_start_ns;
+	u64 bringup_last_ns;
 #ifdef POLL_LINK_STATUS
 	struct timer_list link_check_timer;
 #endif
@@ -1116,6 +1327,16 @@ struct txgbe_adapter {
 	int fdir_filter_count;
 	u32 fdir_pballoc;
 	u32 atr_sample_rate;
+	/* adaptive ATR sampling, see txgbe_atr_adapt_subtask() */
+	u32 atr_backoff;	/* rings sample 1 in atr_sample_rate << this */
+	u16 atr_gen[TXGBE_ATR_CACHE_SIZE]; /* bumped on every ATR write */
+	u32 fdir_free_max;	/* most free filters seen, i.e. the table size */
+	u64 fdir_last_match;
+	u64 fdir_last_miss;
+	unsigned long atr_adapt_time;
+	u64 atr_added;
+	u64 atr_suppressed;
+	u64 atr_failed;
 	spinlock_t fdir_perfect_lock;
 
 	struct txgbe_etype_filter_info etype_filter_info;
@@ -1145,18 +1366,29 @@ struct txgbe_adapter {
 #ifdef HAVE_PTP_1588_CLOCK
 	struct ptp_clock *ptp_clock;
 	struct ptp_clock_info ptp_caps;
-	struct work_struct ptp_tx_work;
-	struct sk_buff *ptp_tx_skb;
+#ifdef HAVE_KTHREAD_DELAYED_API
+	struct kthread_worker *ptp_kworker;
+	struct kthread_delayed_work ptp_tx_work;
+#else
+	struct delayed_work ptp_tx_work;
+#endif
+	struct sk_buff *ptp_tx_skb;     /* owned by whoever xchg()s it out */
 	struct hwtstamp_config tstamp_config;
 	unsigned long ptp_tx_start;
+	u64 ptp_tx_done_ns;             /* Tx descriptor written back */
 	unsigned long last_overflow_check;
 	unsigned long last_rx_ptp_check;
-	spinlock_t tmreg_lock;
+	spinlock_t tmreg_lock;          /* timecounter writers */
+	seqcount_t tmreg_seq;           /* lock-free timecounter readers */
 	struct cyclecounter hw_cc;
 	struct timecounter hw_tc;
 	u32 base_incval;
 	u32 tx_hwtstamp_timeouts;
 	u32 tx_hwtstamp_skipped;
+	u32 tx_hwtstamp_irq;            /* delivered from the misc interrupt */
+	u32 tx_hwtstamp_clean;          /* delivered from Tx completion */
+	u32 tx_hwtstamp_polled;         /* delivered by the PTP worker */
+	u32 ptp_tx_hist[TXGBE_PTP_TX_HIST_BUCKETS];
 	u32 rx_hwtstamp_cleared;
 	void (*ptp_setup_sdp) (struct txgbe_adapter *);
 #endif /* HAVE_PTP_1588_CLOCK */
@@ -1165,6 +1397,11 @@ struct txgbe_adapter {
 	unsigned int num_vfs;
 	unsigned int max_vfs;
 	struct vf_data_storage *vfinfo;
+	struct delayed_work mbx_task;   /* VF mailbox dispatch */
+	atomic64_t mbx_irq_ns;          /* first unserviced mailbox interrupt */
+	u64 vf_mbx_deferred;            /* VFs with a throttled request */
+	u32 mbx_queue_hist[TXGBE_MBX_HIST_BUCKETS];
+	u32 mbx_service_hist[TXGBE_MBX_HIST_BUCKETS];
 	struct vf_macvlans vf_mvs;
 	struct vf_macvlans *mv_list;
 #ifdef CONFIG_PCI_IOV
@@ -1172,6 +1409,11 @@ struct txgbe_adapter {
 	u32 vferr_refcount;
 #endif
 	struct txgbe_mac_addr *mac_table;
+	/* mac_table index: address lookup, free and not yet written entries */
+	DECLARE_HASHTABLE(mac_hash, TXGBE_MAC_HASH_BITS);
+	DECLARE_BITMAP(mac_used, TXGBE_MAX_MAC_FILTERS);
+	DECLARE_BITMAP(mac_dirty, TXGBE_MAX_MAC_FILTERS);
+	u32 uc_uta_count;       /* unicast addresses only in the UTA hash */
 #if defined(HAVE_UDP_ENC_RX_OFFLOAD) || defined(HAVE_VXLAN_RX_OFFLOAD)
 	__le16 vxlan_port;
 #endif /* HAVE_UDP_ENC_RX_OFFLAD || HAVE_VXLAN_RX_OFFLOAD */
@@ -1219,6 +1461,9 @@ struct txgbe_adapter {
 
 	u64 eth_priv_flags;
 #define TXGBE_ETH_PRIV_FLAG_LLDP		BIT(0)
+#define TXGBE_ETH_PRIV_FLAG_FLOW_AFFINITY	BIT(1)
+#define TXGBE_ETH_PRIV_FLAG_VECTOR_PACKING	BIT(2)
+#define TXGBE_ETH_PRIV_FLAG_NAPI_THREADED	BIT(3)
 
 #ifdef HAVE_AF_XDP_ZC_SUPPORT
 	/* AF_XDP zero-copy */
@@ -1270,6 +1515,7 @@ enum txgbe_state_t {
 	__TXGBE_REMOVING,
 	__TXGBE_SERVICE_SCHED,
 	__TXGBE_SERVICE_INITED,
+	__TXGBE_SERVICE_RERUN,
 	__TXGBE_IN_SFP_INIT,
 #ifdef HAVE_PTP_1588_CLOCK
 	__TXGBE_PTP_RUNNING,
@@ -1348,6 +1594,15 @@ void txgbe_configure_rx_ring(struct txgbe_adapter *,
 void txgbe_configure_tx_ring(struct txgbe_adapter *,
 				    struct txgbe_ring *);
 void txgbe_update_stats(struct txgbe_adapter *adapter);
+void txgbe_set_rx_pressure(struct txgbe_adapter *adapter, u32 pct);
+void txgbe_set_vpack(struct txgbe_adapter *adapter, u32 low, u32 high,
+		     u32 hosts);
+int txgbe_set_napi_threaded(struct txgbe_adapter *adapter, bool threaded);
+#ifndef HAVE_DEV_SET_THREADED
+bool txgbe_qv_thread_schedule(struct txgbe_q_vector *q_vector);
+#endif
+void txgbe_set_napi_sched(struct txgbe_adapter *adapter, int v_idx,
+			  u8 sched, s8 nice);
 int txgbe_init_interrupt_scheme(struct txgbe_adapter *adapter);
 void txgbe_reset_interrupt_capability(struct txgbe_adapter *adapter);
 void txgbe_set_interrupt_capability(struct txgbe_adapter *adapter);
@@ -1358,7 +1613,6 @@ netdev_tx_t txgbe_xmit_frame_ring(struct sk_buff *,
 					 struct txgbe_ring *);
 void txgbe_unmap_and_free_tx_resource(struct txgbe_ring *,
 					     struct txgbe_tx_buffer *);
-void txgbe_alloc_rx_buffers(struct txgbe_ring *, u16);
 void txgbe_configure_rscctl(struct txgbe_adapter *adapter,
 				   struct txgbe_ring *);
 void txgbe_clear_rscctl(struct txgbe_adapter *adapter,
@@ -1425,6 +1679,13 @@ void txgbe_dbg_exit(void);
 void txgbe_dump(struct txgbe_adapter *adapter);
 void txgbe_setup_reta(struct txgbe_adapter *adapter);
 
+void txgbe_module_init(struct txgbe_adapter *adapter);
+void txgbe_module_invalidate(struct txgbe_adapter *adapter);
+int txgbe_module_fill(struct txgbe_adapter *adapter);
+void txgbe_module_dom_subtask(struct txgbe_adapter *adapter);
+int txgbe_module_read(struct txgbe_adapter *adapter, u8 dev_addr,
+		      u32 offset, u32 len, u8 *data);
+
 static inline struct netdev_queue *txring_txq(const struct txgbe_ring *ring)
 {
 	return netdev_get_tx_queue(ring->netdev, ring->queue_index);
@@ -1472,6 +1733,10 @@ int txgbe_ndo_hwtstamp_set(struct net_device *dev,
 void txgbe_ptp_start_cyclecounter(struct txgbe_adapter *adapter);
 void txgbe_ptp_reset(struct txgbe_adapter *adapter);
 void txgbe_ptp_check_pps_event(struct txgbe_adapter *adapter);
+void txgbe_ptp_check_tx_event(struct txgbe_adapter *adapter);
+void txgbe_ptp_tx_queued(struct txgbe_adapter *adapter, struct sk_buff *skb);
+void txgbe_ptp_tx_done(struct txgbe_adapter *adapter);
+void txgbe_ptp_tx_abort(struct txgbe_adapter *adapter);
 int txgbe_ptp_set_timestamp_mode(struct txgbe_adapter *adapter,
 				 struct hwtstamp_config *config);
 #endif /* HAVE_PTP_1588_CLOCK */
@@ -137,6 +137,702 @@ static const struct file_operations txgbe_dbg_rings_fops = {
 	.release = single_release,
 };
 
+static void txgbe_dbg_numa_ring(struct seq_file *m, const char *type,
+				struct txgbe_ring *ring)
+{
+	int qv_node = ring->q_vector ? ring->q_vector->numa_node : NUMA_NO_NODE;
+
+	seq_printf(m, "  %s%-3u  %9d  %8d  %s\n",
+		   type, ring->queue_index, ring->numa_node, qv_node,
+		   (qv_node != NUMA_NO_NODE && qv_node != ring->numa_node) ?
+		   "yes" : "no");
+}
+
+static int txgbe_dbg_numa_show(struct seq_file *m, void *v)
+{
+	struct txgbe_adapter *adapter = m->private;
+	unsigned int i;
+
+	if (!adapter)
+		return -EINVAL;
+
+	seq_printf(m, "dev_node=%d\n\n",
+		   dev_to_node(pci_dev_to_dev(adapter->pdev)));
+
+	seq_puts(m, "q_vectors:\n  idx  numa_node  first_cpu  ncpus  cpu  moves\n");
+	for (i = 0; i < adapter->num_q_vectors; i++) {
+		struct txgbe_q_vector *q_vector = adapter->q_vector[i];
+		int first_cpu = -1;
+		unsigned int ncpus = 0;
+
+		if (!q_vector)
+			continue;
+#ifdef HAVE_IRQ_AFFINITY_HINT
+		ncpus = cpumask_weight(&q_vector->affinity_mask);
+		if (ncpus)
+			first_cpu = cpumask_first(&q_vector->affinity_mask);
+#endif
+		seq_printf(m, "  %3u  %9d  %9d  %5u  %3d  %5u\n", i,
+			   q_vector->numa_node, first_cpu, ncpus,
+			   q_vector->cpu, q_vector->affinity_moves);
+	}
+
+	/* ring memory moves to the vector node on the next reinit */
+	seq_puts(m, "\nrings:\n  queue  ring_node  vec_node  misplaced\n");
+	for (i = 0; i < adapter->num_tx_queues; i++)
+		if (adapter->tx_ring[i])
+			txgbe_dbg_numa_ring(m, "tx", adapter->tx_ring[i]);
+	for (i = 0; i < adapter->num_xdp_queues; i++)
+		if (adapter->xdp_ring[i])
+			txgbe_dbg_numa_ring(m, "xdp", adapter->xdp_ring[i]);
+	for (i = 0; i < adapter->num_rx_queues; i++)
+		if (adapter->rx_ring[i])
+			txgbe_dbg_numa_ring(m, "rx", adapter->rx_ring[i]);
+
+	return 0;
+}
+
+static int txgbe_dbg_numa_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, txgbe_dbg_numa_show, inode->i_private);
+}
+
+static const struct file_operations txgbe_dbg_numa_fops = {
+	.owner = THIS_MODULE,
+	.open = txgbe_dbg_numa_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int txgbe_dbg_tx_rate_show(struct seq_file *m, void *v)
+{
+	struct txgbe_adapter *adapter = m->private;
+	unsigned int i;
+
+	if (!adapter)
+		return -EINVAL;
+
+	/* limits are in Mbps, 0 means unlimited */
+	seq_puts(m, "tc  maxrate\n");
+	for (i = 0; i < netdev_get_num_tc(adapter->netdev) &&
+		    i < TXGBE_DCB_MAX_TRAFFIC_CLASS; i++)
+		seq_printf(m, "%2u  %7u\n", i, adapter->tc_maxrate[i]);
+
+	seq_puts(m, "\nqueue  reg_idx  tc  queue_rate  paced  packets  bytes  restarts  busy  paced_stops\n");
+	for (i = 0; i < adapter->num_tx_queues; i++) {
+		struct txgbe_ring *ring = adapter->tx_ring[i];
+
+		if (!ring)
+			continue;
+		seq_printf(m, "%5u  %7u  %2u  %10u  %5u  %llu  %llu  %llu  %llu  %llu\n",
+			   ring->queue_index, ring->reg_idx, ring->dcb_tc,
+			   adapter->tx_maxrate[ring->queue_index],
+			   ring->tx_maxrate, ring->stats.packets,
+			   ring->stats.bytes, ring->tx_stats.restart_queue,
+			   ring->tx_stats.tx_busy, ring->tx_stats.paced_stops);
+	}
+
+	return 0;
+}
+
+static int txgbe_dbg_tx_rate_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, txgbe_dbg_tx_rate_show, inode->i_private);
+}
+
+static const struct file_operations txgbe_dbg_tx_rate_fops = {
+	.owner = THIS_MODULE,
+	.open = txgbe_dbg_tx_rate_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int txgbe_dbg_rx_pressure_show(struct seq_file *m, void *v)
+{
+	struct txgbe_adapter *adapter = m->private;
+	struct txgbe_hw *hw;
+	unsigned int i;
+
+	if (!adapter)
+		return -EINVAL;
+	hw = &adapter->hw;
+
+	seq_printf(m, "thresh %u%%  drop_intervals %llu  unattributed %llu\n",
+		   adapter->rx_pressure_pct, adapter->rx_drop_intervals,
+		   adapter->rx_drop_unattributed);
+
+	/* fill_now is read from the head and tail registers */
+	seq_puts(m, "\nqueue  reg_idx  count  thresh  fill_now  fill_hwm  over  events  drop_intervals\n");
+	for (i = 0; i < adapter->num_rx_queues; i++) {
+		struct txgbe_ring *ring = adapter->rx_ring[i];
+		u32 rp, wp;
+
+		if (!ring)
+			continue;
+		rp = rd32(hw, TXGBE_PX_RR_RP(ring->reg_idx));
+		wp = rd32(hw, TXGBE_PX_RR_WP(ring->reg_idx));
+		seq_printf(m, "%5u  %7u  %5u  %6u  %8u  %8u  %4d  %6llu  %llu\n",
+			   ring->queue_index, ring->reg_idx, ring->count,
+			   ring->pressure_thresh,
+			   ring->count - 1 -
+			   (wp + ring->count - rp) % ring->count,
+			   ring->rx_stats.fill_hwm,
+			   test_bit(__TXGBE_RX_PRESSURE, &ring->state),
+			   ring->rx_stats.pressure_events,
+			   ring->rx_stats.drop_intervals);
+	}
+
+	return 0;
+}
+
+static int txgbe_dbg_rx_pressure_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, txgbe_dbg_rx_pressure_show, inode->i_private);
+}
+
+/* writing a percentage sets the threshold and restarts the watermarks */
+static ssize_t txgbe_dbg_rx_pressure_write(struct file *filp,
+					   const char __user *buffer,
+					   size_t count, loff_t *ppos)
+{
+	struct seq_file *m = filp->private_data;
+	u32 pct;
+	int err;
+
+	err = kstrtou32_from_user(buffer, count, 0, &pct);
+	if (err)
+		return err;
+	if (pct > 100)
+		return -EINVAL;
+
+	txgbe_set_rx_pressure(m->private, pct);
+
+	return count;
+}
+
+static const struct file_operations txgbe_dbg_rx_pressure_fops = {
+	.owner = THIS_MODULE,
+	.open = txgbe_dbg_rx_pressure_open,
+	.read = seq_read,
+	.write = txgbe_dbg_rx_pressure_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int txgbe_dbg_vpack_show(struct seq_file *m, void *v)
+{
+	struct txgbe_adapter *adapter = m->private;
+	unsigned int i;
+
+	if (!adapter)
+		return -EINVAL;
+
+	seq_printf(m, "enabled %d  low %u  high %u  hosts %u  folds %llu  unfolds %llu\n",
+		   !!(adapter->eth_priv_flags &
+		      TXGBE_ETH_PRIV_FLAG_VECTOR_PACKING),
+		   adapter->vpack_low, adapter->vpack_high,
+		   adapter->vpack_hosts, adapter->vpack_folds,
+		   adapter->vpack_unfolds);
+
+	seq_puts(m, "\nvector  rx  tx  pkts/s  load  host  guests\n");
+	for (i = 0; i < adapter->num_q_vectors; i++) {
+		struct txgbe_q_vector *q_vector = adapter->q_vector[i];
+		struct txgbe_q_vector *host;
+
+		if (!q_vector)
+			continue;
+		host = READ_ONCE(q_vector->vpack_host);
+		seq_printf(m, "%6u  %2u  %2u  %6u  %4u  ",
+			   q_vector->v_idx, q_vector->rx.count,
+			   q_vector->tx.count, q_vector->vpack_rate,
+			   q_vector->vpack_load);
+		if (host)
+			seq_printf(m, "%4u", host->v_idx);
+		else
+			seq_puts(m, "   -");
+		seq_printf(m, "  %u\n", q_vector->vpack_guests);
+	}
+
+	return 0;
+}
+
+static int txgbe_dbg_vpack_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, txgbe_dbg_vpack_show, inode->i_private);
+}
+
+/* writing "<low> <high> <hosts>" sets the packing thresholds */
+static ssize_t txgbe_dbg_vpack_write(struct file *filp,
+				     const char __user *buffer,
+				     size_t count, loff_t *ppos)
+{
+	struct seq_file *m = filp->private_data;
+	u32 low, high, hosts;
+	char buf[48];
+
+	if (count >= sizeof(buf))
+		return -ENOSPC;
+	if (copy_from_user(buf, buffer, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "%u %u %u", &low, &high, &hosts) != 3 ||
+	    low > high || !hosts)
+		return -EINVAL;
+
+	txgbe_set_vpack(m->private, low, high, hosts);
+
+	return count;
+}
+
+static const struct file_operations txgbe_dbg_vpack_fops = {
+	.owner = THIS_MODULE,
+	.open = txgbe_dbg_vpack_open,
+	.read = seq_read,
+	.write = txgbe_dbg_vpack_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static const char * const txgbe_dbg_napi_sched[] = {
+	[TXGBE_NAPI_SCHED_KEEP] = "keep",
+	[TXGBE_NAPI_SCHED_NORMAL] = "normal",
+	[TXGBE_NAPI_SCHED_FIFO_LOW] = "fifo-low",
+	[TXGBE_NAPI_SCHED_FIFO] = "fifo",
+};
+
+static int txgbe_dbg_napi_show(struct seq_file *m, void *v)
+{
+	struct txgbe_adapter *adapter = m->private;
+#ifdef HAVE_DEV_SET_THREADED
+	const char *owner = "kernel";
+#else
+	const char *owner = "driver";
+#endif
+	unsigned int i;
+
+	if (!adapter)
+		return -EINVAL;
+
+	seq_printf(m, "threaded %d  (%s threads)  stats %s\n",
+		   !!(adapter->eth_priv_flags &
+		      TXGBE_ETH_PRIV_FLAG_NAPI_THREADED), owner,
+		   READ_ONCE(adapter->napi_poll_stats) ? "on" : "off");
+
+	seq_puts(m, "\nvector  thread  sched     nice  cpus  softirq_polls  softirq_us  thread_polls  thread_us  busy_polls  busy_us\n");
+	for (i = 0; i < adapter->num_q_vectors; i++) {
+		struct txgbe_q_vector *q_vector = adapter->q_vector[i];
+		struct task_struct *thread;
+
+		if (!q_vector)
+			continue;
+#ifdef HAVE_DEV_SET_THREADED
+		thread = READ_ONCE(q_vector->napi.thread);
+#else
+		thread = READ_ONCE(q_vector->poll_thread);
+#endif
+		seq_printf(m, "%6u  %6d  %-8s  %4d  ", i,
+			   thread ? task_pid_nr(thread) : -1,
+			   txgbe_dbg_napi_sched[adapter->napi_sched[i]],
+			   adapter->napi_nice[i]);
+#ifdef HAVE_IRQ_AFFINITY_HINT
+		if (!cpumask_empty(&q_vector->affinity_mask))
+			seq_printf(m, "%*pbl",
+				   cpumask_pr_args(&q_vector->affinity_mask));
+		else
+#endif
+			seq_puts(m, "-");
+		seq_printf(m, "  %13llu  %10llu  %12llu  %9llu  %10llu  %llu\n",
+			   q_vector->polls[TXGBE_POLL_SOFTIRQ],
+			   div_u64(q_vector->poll_ns[TXGBE_POLL_SOFTIRQ], 1000),
+			   q_vector->polls[TXGBE_POLL_THREAD],
+			   div_u64(q_vector->poll_ns[TXGBE_POLL_THREAD], 1000),
+			   q_vector->polls[TXGBE_POLL_BUSY],
+			   div_u64(q_vector->poll_ns[TXGBE_POLL_BUSY], 1000));
+	}
+
+	return 0;
+}
+
+static int txgbe_dbg_napi_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, txgbe_dbg_napi_show, inode->i_private);
+}
+
+/* writing "<vector|all> keep|normal <nice>|fifo-low|fifo" schedules the
+ * NAPI threads of the vector, or of all of them; "stats on|off" turns the
+ * poll time accounting on or off
+ */
+static ssize_t txgbe_dbg_napi_write(struct file *filp,
+				    const char __user *buffer,
+				    size_t count, loff_t *ppos)
+{
+	struct seq_file *m = filp->private_data;
+	char buf[48], vec[8], name[12];
+	int v_idx, nice = 0, n;
+	u8 sched;
+
+	if (count >= sizeof(buf))
+		return -ENOSPC;
+	if (copy_from_user(buf, buffer, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	n = sscanf(buf, "%7s %11s %d", vec, name, &nice);
+	if (n < 2)
+		return -EINVAL;
+
+	if (!strcmp(vec, "stats")) {
+		struct txgbe_adapter *adapter = m->private;
+
+		if (!strcmp(name, "on"))
+			WRITE_ONCE(adapter->napi_poll_stats, true);
+		else if (!strcmp(name, "off"))
+			WRITE_ONCE(adapter->napi_poll_stats, false);
+		else
+			return -EINVAL;
+		return count;
+	}
+
+	if (!strcmp(vec, "all"))
+		v_idx = -1;
+	else if (kstrtoint(vec, 0, &v_idx) || v_idx < 0 ||
+		 v_idx >= MAX_MSIX_Q_VECTORS)
+		return -EINVAL;
+
+	for (sched = 0; sched < ARRAY_SIZE(txgbe_dbg_napi_sched); sched++)
+		if (!strcmp(name, txgbe_dbg_napi_sched[sched]))
+			break;
+	if (sched == ARRAY_SIZE(txgbe_dbg_napi_sched) ||
+	    (sched == TXGBE_NAPI_SCHED_NORMAL &&
+	     (nice < MIN_NICE || nice > MAX_NICE)))
+		return -EINVAL;
+
+	txgbe_set_napi_sched(m->private, v_idx, sched, nice);
+
+	return count;
+}
+
+static const struct file_operations txgbe_dbg_napi_fops = {
+	.owner = THIS_MODULE,
+	.open = txgbe_dbg_napi_open,
+	.read = seq_read,
+	.write = txgbe_dbg_napi_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/* log2 microsecond histogram, the last bucket is open ended */
+static void txgbe_dbg_us_hist(struct seq_file *m, const char *name,
+			      const u32 *hist, unsigned int buckets)
+{
+	unsigned int i;
+
+	seq_printf(m, "%s:\n", name);
+	for (i = 0; i < buckets; i++) {
+		if (!hist[i])
+			continue;
+		if (i == buckets - 1)
+			seq_printf(m, "  >= %6u us  %u\n", 1U << i, hist[i]);
+		else
+			seq_printf(m, "  < %7u us  %u\n", 2U << i, hist[i]);
+	}
+}
+
+static int txgbe_dbg_vf_mbx_show(struct seq_file *m, void *v)
+{
+	struct txgbe_adapter *adapter = m->private;
+	struct txgbe_mbx_stats *stats;
+	unsigned int vf;
+
+	if (!adapter)
+		return -EINVAL;
+
+	stats = &adapter->hw.mbx.stats;
+	seq_printf(m, "rate_limit=%d/s reqs=%u acks=%u rsts=%u deferred=0x%016llx\n\n",
+		   txgbe_vf_mbx_rate, stats->reqs, stats->acks, stats->rsts,
+		   adapter->vf_mbx_deferred);
+
+	/* interrupt to dispatch, then time spent handling one message */
+	txgbe_dbg_us_hist(m, "dispatch_latency", adapter->mbx_queue_hist,
+			  TXGBE_MBX_HIST_BUCKETS);
+	txgbe_dbg_us_hist(m, "service_time", adapter->mbx_service_hist,
+			  TXGBE_MBX_HIST_BUCKETS);
+
+	seq_puts(m, "\n  vf  msgs  throttled  max_service_us\n");
+	for (vf = 0; vf < adapter->num_vfs && adapter->vfinfo; vf++)
+		seq_printf(m, "  %2u  %4u  %9u  %14u\n", vf,
+			   adapter->vfinfo[vf].mbx_msgs,
+			   adapter->vfinfo[vf].mbx_throttled,
+			   adapter->vfinfo[vf].mbx_max_service_us);
+
+	return 0;
+}
+
+static int txgbe_dbg_vf_mbx_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, txgbe_dbg_vf_mbx_show, inode->i_private);
+}
+
+static const struct file_operations txgbe_dbg_vf_mbx_fops = {
+	.owner = THIS_MODULE,
+	.open = txgbe_dbg_vf_mbx_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int txgbe_dbg_hic_show(struct seq_file *m, void *v)
+{
+	struct txgbe_adapter *adapter = m->private;
+	struct txgbe_hic *hic;
+
+	if (!adapter)
+		return -EINVAL;
+
+	hic = &adapter->hic;
+	seq_printf(m, "cmds=%u batches=%u polls=%u irq_wakeups=%u timeouts=%u\n",
+		   hic->cmds, hic->batches, hic->polls, hic->irq_wakeups,
+		   hic->timeouts);
+	seq_printf(m, "irq_cmds=%u last_wait_us=%u max_wait_us=%u\n",
+		   bitmap_weight(hic->irq_cmds, TXGBE_HIC_CMDS),
+		   hic->last_wait_us, hic->max_wait_us);
+
+	return 0;
+}
+
+static int txgbe_dbg_hic_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, txgbe_dbg_hic_show, inode->i_private);
+}
+
+static const struct file_operations txgbe_dbg_hic_fops = {
+	.owner = THIS_MODULE,
+	.open = txgbe_dbg_hic_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int txgbe_dbg_module_show(struct seq_file *m, void *v)
+{
+	struct txgbe_adapter *adapter = m->private;
+	struct txgbe_module_cache *mc;
+
+	if (!adapter)
+		return -EINVAL;
+
+	mc = &adapter->module;
+	mutex_lock(&mc->lock);
+	seq_printf(m, "valid=%d a2=%d fills=%u fill_errors=%u last_fill_us=%u\n",
+		   mc->valid, mc->has_a2, mc->fills, mc->fill_errors,
+		   mc->last_fill_us);
+	seq_printf(m, "dom_refreshes=%u dom_errors=%u last_dom_us=%u "
+		   "dom_age_ms=%u hits=%u\n",
+		   mc->dom_refreshes, mc->dom_errors, mc->last_dom_us,
+		   mc->valid ? jiffies_to_msecs(jiffies - mc->dom_updated) : 0,
+		   mc->hits);
+	if (mc->valid && mc->has_a2)
+		seq_printf(m, "dom: %*ph\n", TXGBE_MODULE_DOM_LEN,
+			   &mc->a2[TXGBE_MODULE_DOM_OFFSET]);
+	mutex_unlock(&mc->lock);
+
+	return 0;
+}
+
+static int txgbe_dbg_module_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, txgbe_dbg_module_show, inode->i_private);
+}
+
+static const struct file_operations txgbe_dbg_module_fops = {
+	.owner = THIS_MODULE,
+	.open = txgbe_dbg_module_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static const char * const txgbe_dbg_link_ev_names[] = {
+	[TXGBE_LINK_EV_LSC] = "lsc",
+	[TXGBE_LINK_EV_MODULE] = "module",
+	[TXGBE_LINK_EV_GPIO] = "gpio",
+	[TXGBE_LINK_EV_SFP_POLL] = "sfp_poll",
+	[TXGBE_LINK_EV_CARRIER_UP] = "carrier_up",
+	[TXGBE_LINK_EV_CARRIER_DOWN] = "carrier_down",
+};
+
+static int txgbe_dbg_link_show(struct seq_file *m, void *v)
+{
+	struct txgbe_adapter *adapter = m->private;
+	struct txgbe_link_log *log;
+	u32 head, i, n;
+
+	if (!adapter)
+		return -EINVAL;
+
+	log = &adapter->link_log;
+	spin_lock_irq(&log->lock);
+	seq_printf(m, "events=%u lsc_int=%llu reruns=%u last_up_us=%u "
+		   "max_up_us=%u\n\n",
+		   log->head, adapter->lsc_int, log->reruns, log->last_up_us,
+		   log->max_up_us);
+
+	/* oldest first, monotonic ns as from ktime_get_ns() */
+	head = log->head;
+	n = min_t(u32, head, TXGBE_LINK_LOG_LEN);
+	for (i = head - n; i != head; i++) {
+		u32 slot = i % TXGBE_LINK_LOG_LEN;
+
+		seq_printf(m, "%llu %s\n", log->ev[slot].ns,
+			   txgbe_dbg_link_ev_names[log->ev[slot].type]);
+	}
+	spin_unlock_irq(&log->lock);
+
+	return 0;
+}
+
+static int txgbe_dbg_link_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, txgbe_dbg_link_show, inode->i_private);
+}
+
+static const struct file_operations txgbe_dbg_link_fops = {
+	.owner = THIS_MODULE,
+	.open = txgbe_dbg_link_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static const char * const txgbe_dbg_recovery_names[] = {
+	[TXGBE_RECOVERY_DETECTED] = "detected",
+	[TXGBE_RECOVERY_QUIESCED] = "quiesced",
+	[TXGBE_RECOVERY_BUS_RESET] = "bus_reset",
+	[TXGBE_RECOVERY_LINK_UP] = "link_up",
+	[TXGBE_RECOVERY_DEV_READY] = "dev_ready",
+	[TXGBE_RECOVERY_SLOT_RESET] = "slot_reset",
+	[TXGBE_RECOVERY_RESUMED] = "resumed",
+};
+
+static int txgbe_dbg_recovery_show(struct seq_file *m, void *v)
+{
+	struct txgbe_adapter *adapter = m->private;
+	struct txgbe_recovery_log *log;
+	int i;
+
+	if (!adapter)
+		return -EINVAL;
+
+	log = &adapter->recovery_log;
+	seq_printf(m, "recoveries=%u active=%d start_ns=%llu\n\n",
+		   log->count, log->active, log->start_ns);
+
+	/* us since the error was seen, phases not reached are left out */
+	for (i = 0; i < TXGBE_RECOVERY_PHASES; i++) {
+		if (!log->phase_ns[i])
+			continue;
+		seq_printf(m, "%-10s %llu\n", txgbe_dbg_recovery_names[i],
+			   div_u64(log->phase_ns[i], NSEC_PER_USEC));
+	}
+
+	return 0;
+}
+
+static int txgbe_dbg_recovery_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, txgbe_dbg_recovery_show, inode->i_private);
+}
+
+static const struct file_operations txgbe_dbg_recovery_fops = {
+	.owner = THIS_MODULE,
+	.open = txgbe_dbg_recovery_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void txgbe_dbg_regtbl_line(struct seq_file *m, const char *name,
+				  struct txgbe_reg_table *tbl)
+{
+	seq_printf(m, "%-5s writes=%llu skipped=%llu flushes=%llu known=%u/%u\n",
+		   name, tbl->writes, tbl->skipped, tbl->flushes,
+		   bitmap_weight(tbl->known, TXGBE_REG_TABLE_MAX), tbl->size);
+}
+
+static int txgbe_dbg_regtbl_show(struct seq_file *m, void *v)
+{
+	struct txgbe_adapter *adapter = m->private;
+	struct txgbe_mac_info *mac;
+
+	if (!adapter)
+		return -EINVAL;
+
+	mac = &adapter->hw.mac;
+	txgbe_dbg_regtbl_line(m, "mta", &mac->mta_tbl);
+	txgbe_dbg_regtbl_line(m, "uta", &mac->uta_tbl);
+	txgbe_dbg_regtbl_line(m, "vfta", &mac->vft_tbl);
+	txgbe_dbg_regtbl_line(m, "reta", &mac->reta_tbl);
+	seq_printf(m, "\nrar used=%u uc_uta=%u\n",
+		   bitmap_weight(adapter->mac_used, TXGBE_MAX_MAC_FILTERS),
+		   adapter->uc_uta_count);
+	seq_printf(m, "vlvf used=%u valid=%d\n",
+		   hweight64(mac->vlvf.used), mac->vlvf.valid);
+
+	return 0;
+}
+
+static int txgbe_dbg_regtbl_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, txgbe_dbg_regtbl_show, inode->i_private);
+}
+
+static const struct file_operations txgbe_dbg_regtbl_fops = {
+	.owner = THIS_MODULE,
+	.open = txgbe_dbg_regtbl_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+#ifdef HAVE_PTP_1588_CLOCK
+static int txgbe_dbg_ptp_show(struct seq_file *m, void *v)
+{
+	struct txgbe_adapter *adapter = m->private;
+
+	if (!adapter)
+		return -EINVAL;
+
+	seq_printf(m, "tx_in_progress=%d irq=%u clean=%u polled=%u "
+		   "timeouts=%u skipped=%u\n\n",
+		   test_bit(__TXGBE_PTP_TX_IN_PROGRESS, &adapter->state),
+		   adapter->tx_hwtstamp_irq, adapter->tx_hwtstamp_clean,
+		   adapter->tx_hwtstamp_polled, adapter->tx_hwtstamp_timeouts,
+		   adapter->tx_hwtstamp_skipped);
+
+	/* Tx descriptor write-back to skb_tstamp_tx() */
+	txgbe_dbg_us_hist(m, "tx_tstamp_latency", adapter->ptp_tx_hist,
+			  TXGBE_PTP_TX_HIST_BUCKETS);
+
+	return 0;
+}
+
+static int txgbe_dbg_ptp_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, txgbe_dbg_ptp_show, inode->i_private);
+}
+
+static const struct file_operations txgbe_dbg_ptp_fops = {
+	.owner = THIS_MODULE,
+	.open = txgbe_dbg_ptp_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+#endif /* HAVE_PTP_1588_CLOCK */
 static struct dentry *txgbe_dbg_root;
 static int txgbe_data_mode;
 
@@ -572,6 +1268,77 @@ void txgbe_dbg_adapter_init(struct txgbe_adapter *adapter)
 				    &txgbe_dbg_rings_fops);
 	if (!pfile)
 		e_dev_err("debugfs rings for %s failed\n", name);
+
+	pfile = debugfs_create_file("numa", 0400,
+				    adapter->txgbe_dbg_adapter, adapter,
+				    &txgbe_dbg_numa_fops);
+	if (!pfile)
+		e_dev_err("debugfs numa for %s failed\n", name);
+
+	pfile = debugfs_create_file("tx_rate", 0400,
+				    adapter->txgbe_dbg_adapter, adapter,
+				    &txgbe_dbg_tx_rate_fops);
+	if (!pfile)
+		e_dev_err("debugfs tx_rate for %s failed\n", name);
+
+	pfile = debugfs_create_file("rx_pressure", 0600,
+				    adapter->txgbe_dbg_adapter, adapter,
+				    &txgbe_dbg_rx_pressure_fops);
+	if (!pfile)
+		e_dev_err("debugfs rx_pressure for %s failed\n", name);
+	pfile = debugfs_create_file("vpack", 0600,
+				    adapter->txgbe_dbg_adapter, adapter,
+				    &txgbe_dbg_vpack_fops);
+	if (!pfile)
+		e_dev_err("debugfs vpack for %s failed\n", name);
+	pfile = debugfs_create_file("napi", 0600,
+				    adapter->txgbe_dbg_adapter, adapter,
+				    &txgbe_dbg_napi_fops);
+	if (!pfile)
+		e_dev_err("debugfs napi for %s failed\n", name);
+	pfile = debugfs_create_file("vf_mbx", 0400,
+				    adapter->txgbe_dbg_adapter, adapter,
+				    &txgbe_dbg_vf_mbx_fops);
+	if (!pfile)
+		e_dev_err("debugfs vf_mbx for %s failed\n", name);
+
+	pfile = debugfs_create_file("hic", 0400,
+				    adapter->txgbe_dbg_adapter, adapter,
+				    &txgbe_dbg_hic_fops);
+	if (!pfile)
+		e_dev_err("debugfs hic for %s failed\n", name);
+
+	pfile = debugfs_create_file("module", 0400,
+				    adapter->txgbe_dbg_adapter, adapter,
+				    &txgbe_dbg_module_fops);
+	if (!pfile)
+		e_dev_err("debugfs module for %s failed\n", name);
+
+	pfile = debugfs_create_file("link", 0400,
+				    adapter->txgbe_dbg_adapter, adapter,
+				    &txgbe_dbg_link_fops);
+	if (!pfile)
+		e_dev_err("debugfs link for %s failed\n", name);
+
+	pfile = debugfs_create_file("recovery", 0400,
+				    adapter->txgbe_dbg_adapter, adapter,
+				    &txgbe_dbg_recovery_fops);
+	if (!pfile)
+		e_dev_err("debugfs recovery for %s failed\n", name);
+
+	pfile = debugfs_create_file("regtbl", 0400,
+				    adapter->txgbe_dbg_adapter, adapter,
+				    &txgbe_dbg_regtbl_fops);
+	if (!pfile)
+		e_dev_err("debugfs regtbl for %s failed\n", name);
+
+#ifdef HAVE_PTP_1588_CLOCK
+	pfile = debugfs_create_file("ptp", 0400,
+				    adapter->txgbe_dbg_adapter, adapter,
+				    &txgbe_dbg_ptp_fops);
+	if (!pfile)
+		e_dev_err("debugfs ptp for %s failed\n", name);
+#endif
 }
 
 /**
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (c) 2015 - 2022 Beijing WangXun Technology Co., Ltd. */
+
+#include <linux/firmware.h>
+
+#include "txgbe.h"
+#include "txgbe_hw.h"
+#include "txgbe_flash.h"
+#include "txgbe_devlink.h"
+
+#ifdef HAVE_TXGBE_DEVLINK
+/*
+ * devlink instance of a PF.  It only implements flash_update, which
+ * writes a full flash image the same way ethtool -f region 0 does, with
+ * per sector progress reported to the user.
+ */
+
+static struct txgbe_adapter *txgbe_devlink_adapter(struct devlink *devlink)
+{
+	return *(struct txgbe_adapter **)devlink_priv(devlink);
+}
+
+static void txgbe_devlink_flash_status(struct txgbe_flash_update *fu,
+				       const char *msg, u32 done, u32 total)
+{
+	devlink_flash_update_status_notify(fu->priv, msg, NULL, done, total);
+}
+
+static int txgbe_devlink_flash_update(struct devlink *devlink,
+				      struct devlink_flash_update_params *params,
+				      struct netlink_ext_ack *extack)
+{
+	struct txgbe_adapter *adapter = txgbe_devlink_adapter(devlink);
+	struct txgbe_flash_update fu = {
+		.notify = txgbe_devlink_flash_status,
+		.priv = devlink,
+	};
+	const struct firmware *fw;
+	int err;
+
+#ifdef HAVE_DEVLINK_FLASH_UPDATE_PARAMS_FW
+	fw = params->fw;
+#else
+	err = request_firmware(&fw, params->file_name, &adapter->pdev->dev);
+	if (err) {
+		NL_SET_ERR_MSG_MOD(extack, "Unable to read the image file");
+		return err;
+	}
+#endif
+
+	if (!mutex_trylock(&adapter->flash_lock)) {
+		NL_SET_ERR_MSG_MOD(extack, "A flash update is already running");
+		err = -EBUSY;
+		goto out;
+	}
+
+#ifdef HAVE_DEVLINK_FLASH_UPDATE_BEGIN_END_NOTIFY
+	devlink_flash_update_begin_notify(devlink);
+#endif
+	err = txgbe_upgrade_flash(&adapter->hw, 0, fw->data, fw->size, &fu);
+#ifdef HAVE_DEVLINK_FLASH_UPDATE_BEGIN_END_NOTIFY
+	devlink_flash_update_end_notify(devlink);
+#endif
+	mutex_unlock(&adapter->flash_lock);
+
+	if (err == -EOPNOTSUPP)
+		NL_SET_ERR_MSG_MOD(extack,
+				   "Image does not match the card, or the flash was already updated and needs a reboot");
+	else if (err)
+		NL_SET_ERR_MSG_MOD(extack, "Flash programming failed");
+	else
+		dev_info(&adapter->pdev->dev,
+			 "loaded firmware, reboot to make firmware work\n");
+
+out:
+#ifndef HAVE_DEVLINK_FLASH_UPDATE_PARAMS_FW
+	release_firmware(fw);
+#endif
+	return err;
+}
+
+#ifndef HAVE_DEVLINK_FLASH_UPDATE_PARAMS
+static int txgbe_devlink_flash_update_compat(struct devlink *devlink,
+					     const char *file_name,
+					     const char *component,
+					     struct netlink_ext_ack *extack)
+{
+	struct devlink_flash_update_params params = {};
+
+	if (component) {
+		NL_SET_ERR_MSG_MOD(extack, "Flash components are not supported");
+		return -EOPNOTSUPP;
+	}
+
+	params.file_name = file_name;
+
+	return txgbe_devlink_flash_update(devlink, &params, extack);
+}
+#endif /* !HAVE_DEVLINK_FLASH_UPDATE_PARAMS */
+
+static const struct devlink_ops txgbe_devlink_ops = {
+#ifdef HAVE_DEVLINK_FLASH_UPDATE_PARAMS
+	.flash_update = txgbe_devlink_flash_update,
+#else
+	.flash_update = txgbe_devlink_flash_update_compat,
+#endif
+};
+
+/**
+ * txgbe_devlink_register - create and register the devlink instance
+ * @adapter: board private structure
+ *
+ * devlink is optional; the driver keeps working without it.
+ **/
+void txgbe_devlink_register(struct txgbe_adapter *adapter)
+{
+	struct device *dev = &adapter->pdev->dev;
+	struct devlink *devlink;
+#ifdef HAVE_DEVLINK_REGISTER_SETS_DEV
+	int err;
+#endif
+
+	devlink = devlink_alloc(&txgbe_devlink_ops,
+				sizeof(struct txgbe_adapter *), dev);
+	if (!devlink) {
+		e_dev_warn("devlink_alloc failed\n");
+		return;
+	}
+	*(struct txgbe_adapter **)devlink_priv(devlink) = adapter;
+
+#ifdef HAVE_DEVLINK_REGISTER_SETS_DEV
+	err = devlink_register(devlink, dev);
+	if (err) {
+		e_dev_warn("devlink_register failed: %d\n", err);
+		devlink_free(devlink);
+		return;
+	}
+#else
+	devlink_register(devlink);
+#endif
+	adapter->devlink = devlink;
+}
+
+/**
+ * txgbe_devlink_unregister - remove the devlink instance
+ * @adapter: board private structure
+ **/
+void txgbe_devlink_unregister(struct txgbe_adapter *adapter)
+{
+	if (!adapter->devlink)
+		return;
+
+	devlink_unregister(adapter->devlink);
+	devlink_free(adapter->devlink);
+	adapter->devlink = NULL;
+}
+#endif /* HAVE_TXGBE_DEVLINK */
@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (c) 2015 - 2022 Beijing WangXun Technology Co., Ltd. */
+#ifndef _TXGBE_DEVLINK_H_
+#define _TXGBE_DEVLINK_H_
+
+#if IS_ENABLED(CONFIG_NET_DEVLINK) && defined(HAVE_DEVLINK_FLASH_UPDATE)
+#define HAVE_TXGBE_DEVLINK
+
+void txgbe_devlink_register(struct txgbe_adapter *adapter);
+void txgbe_devlink_unregister(struct txgbe_adapter *adapter);
+#else
+static inline void txgbe_devlink_register(struct txgbe_adapter *adapter) { }
+static inline void txgbe_devlink_unregister(struct txgbe_adapter *adapter) { }
+#endif /* CONFIG_NET_DEVLINK && HAVE_DEVLINK_FLASH_UPDATE */
+
+#endif /* _TXGBE_DEVLINK_H_ */
@@ -36,6 +36,7 @@
 
 #include "txgbe.h"
 #include "txgbe_hw.h"
+#include "txgbe_flash.h"
 #if defined(ETHTOOL_GMODULEINFO)||defined(HAVE_ETHTOOL_SET_PHYS_ID)
 #include "txgbe_phy.h"
 #endif
@@ -127,6 +128,7 @@ static struct txgbe_stats txgbe_gstrings_stats[] = {
 	TXGBE_STAT("tx_bytes_nic", stats.gotc),
 	TXGBE_STAT("lsc_int", lsc_int),
 	TXGBE_STAT("tx_busy", tx_busy),
+	TXGBE_STAT("tx_paced_stops", tx_paced_stops),
 	TXGBE_STAT("non_eop_descs", non_eop_descs),
 	TXGBE_STAT("rx_broadcast", stats.bprc),
 	TXGBE_STAT("tx_broadcast", stats.bptc),
@@ -134,6 +136,9 @@ static struct txgbe_stats txgbe_gstrings_stats[] = {
 	TXGBE_STAT("tx_multicast", stats.mptc),
 	TXGBE_STAT("rx_no_buffer_count", stats.rnbc[0]),
 	TXGBE_STAT("tx_timeout_count", tx_timeout_count),
+	TXGBE_STAT("tx_hang_count", tx_hang_count),
+	TXGBE_STAT("tx_queue_restarts", tx_queue_restarts),
+	TXGBE_STAT("tx_queue_restart_failed", tx_queue_restart_failed),
 	TXGBE_STAT("tx_restart_queue", restart_queue),
 	TXGBE_STAT("rx_long_length_count", stats.roc),
 	TXGBE_STAT("rx_short_length_count", stats.ruc),
@@ -150,12 +155,20 @@ static struct txgbe_stats txgbe_gstrings_stats[] = {
 	TXGBE_STAT("lro_flushed", lro_stats.flushed),
 #endif /* TXGBE_NO_LRO */
 	TXGBE_STAT("rx_no_dma_resources", hw_rx_no_dma_resources),
+	TXGBE_STAT("rx_pressure_events", rx_pressure_events),
+	TXGBE_STAT("rx_drop_intervals", rx_drop_intervals),
+	TXGBE_STAT("rx_drop_unattributed", rx_drop_unattributed),
 	TXGBE_STAT("hw_rsc_aggregated", rsc_total_count),
 	TXGBE_STAT("hw_rsc_flushed", rsc_total_flush),
+	TXGBE_STAT("hw_rsc_gro_hw", rsc_total_gro_hw),
 #ifdef HAVE_TX_MQ
 	TXGBE_STAT("fdir_match", stats.fdirmatch),
 	TXGBE_STAT("fdir_miss", stats.fdirmiss),
 	TXGBE_STAT("fdir_overflow", fdir_overflow),
+	TXGBE_STAT("fdir_atr_added", atr_added),
+	TXGBE_STAT("fdir_atr_suppressed", atr_suppressed),
+	TXGBE_STAT("fdir_atr_failed", atr_failed),
+	TXGBE_STAT("fdir_atr_backoff", atr_backoff),
 #endif /* HAVE_TX_MQ */
 #if IS_ENABLED(CONFIG_FCOE)
 	TXGBE_STAT("fcoe_bad_fccrc", stats.fccrc),
@@ -239,6 +252,9 @@ struct txgbe_priv_flags {
 
 static const struct txgbe_priv_flags txgbe_gstrings_priv_flags[] = {
 	TXGBE_PRIV_FLAG("lldp", TXGBE_ETH_PRIV_FLAG_LLDP, 0),
+	TXGBE_PRIV_FLAG("flow-affinity", TXGBE_ETH_PRIV_FLAG_FLOW_AFFINITY, 0),
+	TXGBE_PRIV_FLAG("vector-packing", TXGBE_ETH_PRIV_FLAG_VECTOR_PACKING, 0),
+	TXGBE_PRIV_FLAG("napi-threaded", TXGBE_ETH_PRIV_FLAG_NAPI_THREADED, 0),
 };
 
 #define TXGBE_PRIV_FLAGS_STR_LEN ARRAY_SIZE(txgbe_gstrings_priv_flags)
@@ -2117,6 +2133,10 @@ static int txgbe_set_priv_flags(struct net_device *dev, u32 flags)
 	if (changed_flags & TXGBE_ETH_PRIV_FLAG_LLDP)
 		status = txgbe_hic_write_lldp(&adapter->hw, (u32)(new_flags & TXGBE_ETH_PRIV_FLAG_LLDP));
 
+	if (!status && (changed_flags & TXGBE_ETH_PRIV_FLAG_NAPI_THREADED))
+		status = txgbe_set_napi_threaded(adapter,
+				!!(new_flags & TXGBE_ETH_PRIV_FLAG_NAPI_THREADED));
+
 	if(!status)
 		adapter->eth_priv_flags = new_flags;
 
@@ -3447,9 +3467,9 @@ static bool txgbe_update_rsc(struct txgbe_adapter *adapter)
 {
 	struct net_device *netdev = adapter->netdev;
 
-	/* nothing to do if LRO or RSC are not enabled */
+	/* nothing to do if LRO/GRO_HW or RSC are not enabled */
 	if (!(adapter->flags2 & TXGBE_FLAG2_RSC_CAPABLE) ||
-	    !(netdev->features & NETIF_F_LRO))
+	    !(netdev->features & TXGBE_NETIF_F_RSC))
 		return false;
 
 	/* check the feature flag value and enable RSC if necessary */
@@ -4993,32 +5013,19 @@ static int txgbe_get_module_info(struct net_device *dev,
 				       struct ethtool_modinfo *modinfo)
 {
 	struct txgbe_adapter *adapter = netdev_priv(dev);
-	struct txgbe_hw *hw = &adapter->hw;
-	u32 status;
+	u8 id[TXGBE_SFF_SFF_8472_COMP - TXGBE_SFF_SFF_8472_SWAP + 1];
 	u8 sff8472_rev, addr_mode;
 	bool page_swap = false;
-	u32 swfw_mask = hw->phy.phy_semaphore_mask;
-
-	if (0 != TCALL(hw, mac.ops.acquire_swfw_sync, swfw_mask))
-	   return -EBUSY;
-	
-	if (!test_bit(__TXGBE_DOWN, &adapter->state))
-		cancel_work_sync(&adapter->sfp_sta_task);
-
-	/* Check whether we support SFF-8472 or not */
-	status = TCALL(hw, phy.ops.read_i2c_eeprom,
-					     TXGBE_SFF_SFF_8472_COMP,
-					     &sff8472_rev);
-	if (status != 0)
-		goto ERROR_IO;
+	int err;
 
-	/* addressing mode is not supported */
-	status = TCALL(hw, phy.ops.read_i2c_eeprom,
-					     TXGBE_SFF_SFF_8472_SWAP,
-					     &addr_mode);
-	if (status != 0)
-		goto ERROR_IO;
+	/* bytes 0x5C-0x5E of A0 come from the module cache */
+	err = txgbe_module_read(adapter, TXGBE_I2C_EEPROM_DEV_ADDR,
+				TXGBE_SFF_SFF_8472_SWAP, sizeof(id), id);
+	if (err)
+		return err;
 
+	addr_mode = id[0];
+	sff8472_rev = id[TXGBE_SFF_SFF_8472_COMP - TXGBE_SFF_SFF_8472_SWAP];
 
 	if (addr_mode & TXGBE_SFF_ADDRESSING_MODE) {
 		e_err(drv, "Address change required to access page 0xA2, "
@@ -5038,13 +5045,7 @@ static int txgbe_get_module_info(struct net_device *dev,
 		modinfo->eeprom_len = ETH_MODULE_SFF_8472_LEN;
 	}
 
-	TCALL(hw, mac.ops.release_swfw_sync, swfw_mask);
-
 	return 0;
-
-ERROR_IO:
-	TCALL(hw, mac.ops.release_swfw_sync, swfw_mask);
-	return -EIO;
 }
 
 static int txgbe_get_module_eeprom(struct net_device *dev,
@@ -5052,54 +5053,73 @@ static int txgbe_get_module_eeprom(struct net_device *dev,
 					 u8 *data)
 {
 	struct txgbe_adapter *adapter = netdev_priv(dev);
-	struct txgbe_hw *hw = &adapter->hw;
-	u32 status = TXGBE_ERR_PHY_ADDR_INVALID;
-	u8 databyte = 0xFF;
-	int i = 0;
-	u32 swfw_mask = hw->phy.phy_semaphore_mask;
-
-	if (0 != TCALL(hw, mac.ops.acquire_swfw_sync, swfw_mask))
-	   return -EBUSY;
-
-	if (!test_bit(__TXGBE_DOWN, &adapter->state))
-		cancel_work_sync(&adapter->sfp_sta_task);
-
+	u32 offset = ee->offset, len = ee->len, n;
+	u8 dev_addr;
+	int err;
 
 	if (ee->len == 0)
-		goto ERROR_INVAL;
+		return -EINVAL;
+
+	/* the flat ethtool layout is A0 followed by A2 */
+	while (len) {
+		if (offset < ETH_MODULE_SFF_8079_LEN) {
+			dev_addr = TXGBE_I2C_EEPROM_DEV_ADDR;
+			n = min_t(u32, len, ETH_MODULE_SFF_8079_LEN - offset);
+			err = txgbe_module_read(adapter, dev_addr, offset, n,
+						data);
+		} else {
+			dev_addr = TXGBE_I2C_EEPROM_DEV_ADDR2;
+			n = len;
+			err = txgbe_module_read(adapter, dev_addr,
+						offset - ETH_MODULE_SFF_8079_LEN,
+						n, data);
+		}
+		if (err)
+			return err;
 
-	for (i = ee->offset; i < ee->offset + ee->len; i++) {
-		/* I2C reads can take long time */
-		if (test_bit(__TXGBE_IN_SFP_INIT, &adapter->state))
-			goto ERROR_BUSY;
+		offset += n;
+		data += n;
+		len -= n;
+	}
 
-		if (i < ETH_MODULE_SFF_8079_LEN)
-			status = TCALL(hw, phy.ops.read_i2c_eeprom, i,
-				       &databyte);
-		else
-			status = TCALL(hw, phy.ops.read_i2c_sff8472, i,
-				       &databyte);
+	return 0;
+}
 
-		if (status != 0)
-			goto ERROR_IO;
+#ifdef HAVE_ETHTOOL_MODULE_EEPROM_BY_PAGE
+static int
+txgbe_get_module_eeprom_by_page(struct net_device *dev,
+				const struct ethtool_module_eeprom *page_data,
+				struct netlink_ext_ack *extack)
+{
+	struct txgbe_adapter *adapter = netdev_priv(dev);
+	u8 dev_addr;
+	int err;
 
-		data[i - ee->offset] = databyte;
+	if (page_data->bank || page_data->page) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "SFP modules have no banked or paged memory");
+		return -EINVAL;
 	}
 
-	TCALL(hw, mac.ops.release_swfw_sync, swfw_mask);
+	if (page_data->i2c_address == TXGBE_I2C_EEPROM_DEV_ADDR >> 1) {
+		dev_addr = TXGBE_I2C_EEPROM_DEV_ADDR;
+	} else if (page_data->i2c_address == TXGBE_I2C_EEPROM_DEV_ADDR2 >> 1) {
+		dev_addr = TXGBE_I2C_EEPROM_DEV_ADDR2;
+	} else {
+		NL_SET_ERR_MSG_MOD(extack, "Unsupported I2C address");
+		return -EINVAL;
+	}
 
-	return 0;
+	err = txgbe_module_read(adapter, dev_addr, page_data->offset,
+				page_data->length, page_data->data);
+	if (err == -EINVAL)
+		NL_SET_ERR_MSG_MOD(extack, "Page not implemented by the module");
+	if (err)
+		return err;
 
-ERROR_INVAL:
-	TCALL(hw, mac.ops.release_swfw_sync, swfw_mask);
-	return -EINVAL;
-ERROR_BUSY:
-	TCALL(hw, mac.ops.release_swfw_sync, swfw_mask);
-	return -EBUSY;
-ERROR_IO:
-	TCALL(hw, mac.ops.release_swfw_sync, swfw_mask);
-	return -EIO;
+	return page_data->length;
 }
+#endif /* HAVE_ETHTOOL_MODULE_EEPROM_BY_PAGE */
 #endif /* ETHTOOL_GMODULEINFO */
 
 #ifdef ETHTOOL_GEEE
@@ -5183,14 +5203,17 @@ static int txgbe_set_flash(struct net_device *netdev, struct ethtool_flash *ef)
 	int ret;
 	const struct firmware *fw;
 	struct txgbe_adapter *adapter = netdev_priv(netdev);
+	struct txgbe_flash_update fu = {};
 
 	ret = request_firmware(&fw, ef->data, &netdev->dev);
 	if (ret < 0)
 		return ret;
 
 	if (ef->region == 0) {
+		mutex_lock(&adapter->flash_lock);
 		ret = txgbe_upgrade_flash(&adapter->hw, ef->region,
-							fw->data, fw->size);
+					  fw->data, fw->size, &fu);
+		mutex_unlock(&adapter->flash_lock);
 	} else {
 		if (txgbe_mng_present(&adapter->hw)) {
 		ret = txgbe_upgrade_flash_hostif(&adapter->hw, ef->region,
@@ -5303,6 +5326,9 @@ static struct ethtool_ops txgbe_ethtool_ops = {
 #ifdef ETHTOOL_GMODULEINFO
 	.get_module_info        = txgbe_get_module_info,
 	.get_module_eeprom      = txgbe_get_module_eeprom,
+#ifdef HAVE_ETHTOOL_MODULE_EEPROM_BY_PAGE
+	.get_module_eeprom_by_page = txgbe_get_module_eeprom_by_page,
+#endif
 #endif
 #ifdef HAVE_ETHTOOL_GET_TS_INFO
 	.get_ts_info            = txgbe_get_ts_info,
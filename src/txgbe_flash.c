@@ -0,0 +1,406 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (c) 2015 - 2022 Beijing WangXun Technology Co., Ltd. */
+
+#include "txgbe.h"
+#include "txgbe_hw.h"
+#include "txgbe_flash.h"
+
+#define TXGBE_FLASH_SECTOR_DWORDS       (SPI_SECTOR_SIZE / 4)
+#define TXGBE_FLASH_VPD_LEN             (TXGBE_VPD_END - TXGBE_VPD_OFFSET)
+
+/* board specific data that survives an image update */
+struct txgbe_flash_keep {
+	u32 mac0[2];
+	u32 mac1[2];
+	u32 sn[TXGBE_FLASH_SN_DWORDS];
+	bool sn_is_str;
+	u8 vpd[TXGBE_FLASH_VPD_LEN];
+};
+
+static void txgbe_flash_notify(struct txgbe_flash_update *fu,
+			       const char *msg, u32 done, u32 total)
+{
+	if (fu->notify)
+		fu->notify(fu, msg, done, total);
+}
+
+static u32 txgbe_flash_le32(const u8 *buf, u32 off)
+{
+	u32 val = buf[off + 3] << 24 | buf[off + 2] << 16 |
+		  buf[off + 1] << 8 | buf[off];
+
+	return __le32_to_cpu(val);
+}
+
+static int txgbe_flash_check_id(struct txgbe_hw *hw, const u8 *data)
+{
+	struct txgbe_adapter *adapter = hw->back;
+	u16 sub_id = data[TXGBE_FLASH_IMAGE_ID_OFFSET] << 8 |
+		     data[TXGBE_FLASH_IMAGE_ID_OFFSET + 1];
+	u16 dev_id = data[TXGBE_FLASH_IMAGE_ID_OFFSET + 2] << 8 |
+		     data[TXGBE_FLASH_IMAGE_ID_OFFSET + 3];
+
+	/*check sub_id*/
+	e_info(drv, "Checking sub_id .......\n");
+	e_info(drv, "The card's sub_id : %04x\n", hw->subsystem_device_id);
+	e_info(drv, "The image's sub_id : %04x\n", sub_id);
+	if ((hw->subsystem_device_id & 0xfff) == (sub_id & 0xfff)) {
+		e_info(drv, "It is a right image\n");
+	} else if (hw->subsystem_device_id == 0xffff) {
+		e_info(drv, "update anyway\n");
+	} else {
+		e_err(drv, "====The Gigabit image is not match the Gigabit card====\n");
+		e_err(drv, "====Please check your image====\n");
+		return -EOPNOTSUPP;
+	}
+
+	/*check dev_id*/
+	e_info(drv, "Checking dev_id .......\n");
+	e_info(drv, "The image's dev_id : %04x\n", dev_id);
+	e_info(drv, "The card's dev_id : %04x\n", hw->device_id);
+	if (!((hw->device_id & 0xfff0) == (dev_id & 0xfff0)) &&
+	    !(hw->device_id == 0xffff)) {
+		e_err(drv, "====The Gigabit image is not match the Gigabit card====\n");
+		e_err(drv, "====Please check your image====\n");
+		return -EOPNOTSUPP;
+	}
+
+	return 0;
+}
+
+static void txgbe_flash_save_board(struct txgbe_hw *hw,
+				   struct txgbe_flash_keep *keep)
+{
+	struct txgbe_adapter *adapter = hw->back;
+	u32 i;
+
+	txgbe_flash_read_dword(hw, MAC_ADDR0_WORD0_OFFSET_1G, &keep->mac0[0]);
+	txgbe_flash_read_dword(hw, MAC_ADDR0_WORD1_OFFSET_1G, &keep->mac0[1]);
+	keep->mac0[1] &= U16_MAX;
+	txgbe_flash_read_dword(hw, MAC_ADDR1_WORD0_OFFSET_1G, &keep->mac1[0]);
+	txgbe_flash_read_dword(hw, MAC_ADDR1_WORD1_OFFSET_1G, &keep->mac1[1]);
+	keep->mac1[1] &= U16_MAX;
+
+	for (i = 0; i < TXGBE_FLASH_SN_DWORDS; i++)
+		txgbe_flash_read_dword(hw, PRODUCT_SERIAL_NUM_OFFSET_1G + 4 * i,
+				       &keep->sn[i]);
+	keep->sn_is_str = keep->sn[TXGBE_FLASH_SN_DWORDS - 1] != U32_MAX;
+
+	e_info(drv, "Old: MAC Address0 is: 0x%04x%08x\n",
+	       keep->mac0[1], keep->mac0[0]);
+	e_info(drv, "     MAC Address1 is: 0x%04x%08x\n",
+	       keep->mac1[1], keep->mac1[0]);
+}
+
+/* rebuild the image VPD around the serial number of the board */
+static void txgbe_flash_build_vpd(const u8 *data,
+				  struct txgbe_flash_keep *keep)
+{
+	u8 id_str_len, pn_str_len, sn_str_len, rv_str_len;
+	u8 *vpd_tend = keep->vpd;
+	u32 curadr, vpdadr, i;
+	u32 chksum = 0;
+	char sn_str[40];
+	u16 vpd_ro_len;
+
+	memset(vpd_tend, 0xff, TXGBE_FLASH_VPD_LEN);
+
+	curadr = TXGBE_VPD_OFFSET + 1;
+	id_str_len = data[curadr] | data[curadr + 1] << 8;
+	curadr += (7 + id_str_len);
+	pn_str_len = data[curadr];
+	curadr += 1 + pn_str_len;
+
+	for (i = 0; i < curadr - TXGBE_VPD_OFFSET; i++)
+		vpd_tend[i] = data[TXGBE_VPD_OFFSET + i];
+
+	memset(sn_str, 0x0, sizeof(sn_str));
+	if (keep->sn_is_str) {
+		for (i = 0; i < TXGBE_FLASH_SN_DWORDS; i++)
+			sn_str[i] = keep->sn[TXGBE_FLASH_SN_DWORDS - 1 - i];
+		sn_str_len = strlen(sn_str);
+	} else {
+		sn_str_len = 0x12;
+		sprintf(sn_str, "%02x%08x%08x", (keep->sn[2] & 0xff),
+			keep->sn[1], keep->sn[0]);
+	}
+
+	vpdadr = curadr - TXGBE_VPD_OFFSET;
+
+	if (data[curadr] == 'S' && data[curadr + 1] == 'N') {
+		if (data[curadr + 2]) {
+			for (i = sn_str_len; i < data[curadr + 2]; i++)
+				sn_str[i] = 0x20;
+			sn_str_len = data[curadr + 2];
+		}
+		curadr += 3 + data[curadr + 2];
+		rv_str_len = data[2 + curadr];
+	} else {
+		rv_str_len = data[2 + curadr];
+	}
+
+	vpd_tend[vpdadr] = 'S';
+	vpd_tend[vpdadr + 1] = 'N';
+	vpd_tend[vpdadr + 2] = sn_str_len;
+
+	for (i = 0; i < sn_str_len; i++)
+		vpd_tend[vpdadr + 3 + i] = sn_str[i];
+
+	vpdadr = vpdadr + 3 + sn_str_len;
+
+	for (i = 0; i < 3; i++)
+		vpd_tend[vpdadr + i] = data[curadr + i];
+
+	vpdadr += 3;
+	for (i = 0; i < rv_str_len; i++)
+		vpd_tend[vpdadr + i] = 0x0;
+
+	vpdadr += rv_str_len;
+	vpd_ro_len = pn_str_len + sn_str_len + rv_str_len + 9;
+	vpd_tend[4 + id_str_len] = vpd_ro_len & 0xff;
+	vpd_tend[5 + id_str_len] = (vpd_ro_len >> 8) & 0xff;
+
+	for (i = 0; i < vpdadr; i++)
+		chksum += vpd_tend[i];
+	chksum = ~(chksum & 0xff) + 1;
+	vpd_tend[vpdadr - rv_str_len] = chksum;
+	vpd_tend[vpdadr] = 0x78;
+}
+
+/* checksum over the first 4K with the rebuilt VPD, stored at 0x15e */
+static u16 txgbe_flash_image_chksum(const u8 *data,
+				    const struct txgbe_flash_keep *keep)
+{
+	const u8 *vpd = keep->vpd;
+	u32 chksum = 0;
+	u32 i;
+
+	for (i = 0; i < 0x1000; i += 2) {
+		if (i >= TXGBE_VPD_OFFSET && i < TXGBE_VPD_END)
+			chksum += (vpd[i - TXGBE_VPD_OFFSET + 1] << 8 |
+				   vpd[i - TXGBE_VPD_OFFSET]);
+		else if (i != TXGBE_FLASH_CHKSUM_OFFSET)
+			chksum += (data[i + 1] << 8 | data[i]);
+	}
+
+	return (0xbaba - chksum) & 0xffff;
+}
+
+/**
+ * txgbe_flash_sector_image - contents of a sector after the update
+ * @data: image
+ * @size: image size
+ * @addr: sector address
+ * @keep: board data to preserve
+ * @buf: TXGBE_FLASH_SECTOR_DWORDS dwords to fill
+ *
+ * Image data, with the MAC addresses, serial number and VPD of the board
+ * in place.  The dword below the checksum is left erased; the checksum
+ * itself is written separately once all sectors are done.
+ **/
+static void txgbe_flash_sector_image(const u8 *data, u32 size, u32 addr,
+				     const struct txgbe_flash_keep *keep,
+				     u32 *buf)
+{
+	u32 i, a, idx;
+
+	for (i = 0; i < TXGBE_FLASH_SECTOR_DWORDS; i++) {
+		a = addr + i * 4;
+
+		if (a + 4 > size)
+			buf[i] = U32_MAX;
+		else if (a == MAC_ADDR0_WORD0_OFFSET_1G)
+			buf[i] = keep->mac0[0];
+		else if (a == MAC_ADDR0_WORD1_OFFSET_1G)
+			buf[i] = keep->mac0[1] | 0x80000000;
+		else if (a == MAC_ADDR1_WORD0_OFFSET_1G)
+			buf[i] = keep->mac1[0];
+		else if (a == MAC_ADDR1_WORD1_OFFSET_1G)
+			buf[i] = keep->mac1[1] | 0x80000000;
+		else if (a >= PRODUCT_SERIAL_NUM_OFFSET_1G &&
+			 a < PRODUCT_SERIAL_NUM_OFFSET_1G +
+			     4 * TXGBE_FLASH_SN_DWORDS) {
+			idx = (a - PRODUCT_SERIAL_NUM_OFFSET_1G) / 4;
+			/* a binary serial number only uses 3 dwords */
+			buf[i] = (keep->sn_is_str || idx < 3) ?
+				 keep->sn[idx] : U32_MAX;
+		} else if (a >= TXGBE_VPD_OFFSET && a < TXGBE_VPD_END)
+			buf[i] = txgbe_flash_le32(keep->vpd,
+						  a - TXGBE_VPD_OFFSET);
+		else if (a == (TXGBE_FLASH_CHKSUM_OFFSET & ~3))
+			buf[i] = U32_MAX;
+		else
+			buf[i] = txgbe_flash_le32(data, a);
+	}
+}
+
+/* returns the index of the first dword that differs, or -1 */
+static int txgbe_flash_sector_diff(struct txgbe_hw *hw, u32 addr,
+				   const u32 *buf)
+{
+	u32 i, val;
+
+	for (i = 0; i < TXGBE_FLASH_SECTOR_DWORDS; i++) {
+		if (txgbe_flash_read_dword(hw, addr + i * 4, &val) ||
+		    val != buf[i])
+			return i;
+	}
+
+	return -1;
+}
+
+/**
+ * txgbe_flash_sector_write - erase, program and verify one sector
+ * @hw: pointer to hardware structure
+ * @addr: sector address
+ * @buf: sector contents
+ * @fu: update state
+ *
+ * Dwords are programmed back to back; the sector is read back once at
+ * the end instead of after every dword.
+ **/
+static int txgbe_flash_sector_write(struct txgbe_hw *hw, u32 addr,
+				    const u32 *buf,
+				    struct txgbe_flash_update *fu)
+{
+	struct txgbe_adapter *adapter = hw->back;
+	int try, status, bad = 0;
+	u32 i, val;
+
+	for (try = 0; try <= TXGBE_FLASH_SECTOR_RETRIES; try++) {
+		if (try)
+			fu->retries++;
+
+		wr32(hw, SPI_CMD_CFG1_ADDR, 0x0103c720);
+		status = txgbe_flash_erase_sector(hw, addr);
+		wr32(hw, SPI_CMD_CFG1_ADDR, 0x0103c7d8);
+		if (status)
+			e_err(drv, "Erase sector 0x%06x command, return status = %0d\n",
+			      addr, status);
+		msleep(50);
+
+		for (i = 0; i < TXGBE_FLASH_SECTOR_DWORDS; i++) {
+			if (buf[i] == U32_MAX)
+				continue;
+			status = txgbe_flash_program_dword(hw, addr + i * 4,
+							   buf[i]);
+			if (status)
+				break;
+			fu->dwords++;
+		}
+
+		bad = txgbe_flash_sector_diff(hw, addr, buf);
+		if (bad < 0)
+			return 0;
+	}
+
+	txgbe_flash_read_dword(hw, addr + bad * 4, &val);
+	e_err(drv, "ERROR: Program 0x%08x @addr: 0x%08x is failed !!\n",
+	      buf[bad], addr + bad * 4);
+	e_err(drv, "		 Read data from Flash is: 0x%08x\n", val);
+
+	return -EBUSY;
+}
+
+/**
+ * txgbe_upgrade_flash - write a full flash image
+ * @hw: pointer to hardware structure
+ * @region: ethtool flash region, always 0 here
+ * @data: image
+ * @size: image size
+ * @fu: progress callback and result counters
+ *
+ * Keeps the MAC addresses and serial number of the board, rebuilds the
+ * VPD and checksum, and only rewrites the sectors that differ from the
+ * image.
+ **/
+int txgbe_upgrade_flash(struct txgbe_hw *hw, u32 region,
+			const u8 *data, u32 size,
+			struct txgbe_flash_update *fu)
+{
+	struct txgbe_adapter *adapter = hw->back;
+	struct txgbe_flash_keep *keep;
+	u32 *buf = NULL;
+	u32 sector, addr;
+	u16 chksum;
+	int err = 0;
+
+	fu->sectors = 0;
+	fu->written = 0;
+	fu->skipped = 0;
+	fu->retries = 0;
+	fu->dwords = 0;
+
+	if (rd32(hw, PRB_CTL) & 0x80000000) {
+		e_info(drv, "The flash has been successfully upgraded once, please reboot to make it work.\n");
+		return -EOPNOTSUPP;
+	}
+
+	if (size < TXGBE_FLASH_IMAGE_ID_OFFSET + 4) {
+		e_err(drv, "Flash image is too small: %u bytes\n", size);
+		return -EINVAL;
+	}
+
+	err = txgbe_flash_check_id(hw, data);
+	if (err)
+		return err;
+
+	keep = kzalloc(sizeof(*keep), GFP_KERNEL);
+	buf = kcalloc(TXGBE_FLASH_SECTOR_DWORDS, sizeof(u32), GFP_KERNEL);
+	if (!keep || !buf) {
+		e_info(drv, "failed to allocate memory for flash update\n");
+		err = -ENOMEM;
+		goto err_exit;
+	}
+
+	txgbe_flash_notify(fu, "Preparing to flash", 0, 0);
+
+	/* unlock flash write protect*/
+	wr32(hw, TXGBE_SPI_CMDCFG0, 0x9f050206);
+	wr32(hw, 0x10194, 0x9f050206);
+
+	msleep(1000);
+
+	txgbe_flash_save_board(hw, keep);
+
+	txgbe_flash_usr_cmd(hw, 0x6);   /* write enable*/
+	txgbe_flash_usr_cmd(hw, 0x98);  /* global protection un-lock*/
+	txgbe_flash_write_unlock(hw);
+	msleep(1000);
+
+	txgbe_flash_build_vpd(data, keep);
+	chksum = txgbe_flash_image_chksum(data, keep);
+
+	fu->sectors = DIV_ROUND_UP(size, SPI_SECTOR_SIZE);
+	for (sector = 0; sector < fu->sectors; sector++) {
+		txgbe_flash_notify(fu, "Flashing", sector, fu->sectors);
+
+		addr = sector * SPI_SECTOR_SIZE;
+		txgbe_flash_sector_image(data, size, addr, keep, buf);
+
+		/* sector 0 holds the checksum, which is not part of buf */
+		if (sector && txgbe_flash_sector_diff(hw, addr, buf) < 0) {
+			fu->skipped++;
+			continue;
+		}
+
+		err = txgbe_flash_sector_write(hw, addr, buf, fu);
+		if (err)
+			goto err_exit;
+		fu->written++;
+	}
+
+	txgbe_flash_write_dword(hw, TXGBE_FLASH_CHKSUM_OFFSET,
+				0xffff0000 | chksum);
+
+	wr32(hw, PRB_CTL, rd32(hw, PRB_CTL) | 0x80000000);
+
+	txgbe_flash_notify(fu, "Flashing", fu->sectors, fu->sectors);
+	e_info(drv, "Flash updated: %u of %u sectors written, %u unchanged, %u retried\n",
+	       fu->written, fu->sectors, fu->skipped, fu->retries);
+
+err_exit:
+	kfree(buf);
+	kfree(keep);
+	return err;
+}
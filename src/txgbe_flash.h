@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (c) 2015 - 2022 Beijing WangXun Technology Co., Ltd. */
+#ifndef _TXGBE_FLASH_H_
+#define _TXGBE_FLASH_H_
+
+/*
+ * Whole image SPI flash programming (ethtool -f region 0, devlink dev
+ * flash).
+ *
+ * The image is written one 4K sector at a time.  Every sector is first
+ * read back and compared with what it would hold after the update (image
+ * data with the board MAC addresses and serial number kept); matching
+ * sectors are neither erased nor programmed.  A changed sector is erased,
+ * programmed back to back without a read after every dword, and then
+ * verified once by reading the sector back.  Sector 0 carries the VPD and
+ * the image checksum and is always rewritten.
+ *
+ * txgbe_flash.c only uses the SPI primitives declared in txgbe_hw.h and
+ * register access, so tools/flashsim can build it against a simulated
+ * flash part.
+ */
+
+/* the sub_id/dev_id of the image are stored right below 1MB */
+#define TXGBE_FLASH_IMAGE_ID_OFFSET     0xfffdc
+#define TXGBE_FLASH_CHKSUM_OFFSET       0x15e
+#define TXGBE_FLASH_SN_DWORDS           24
+/* a sector that still fails verification after this many rewrites fails
+ * the update
+ */
+#define TXGBE_FLASH_SECTOR_RETRIES      1
+
+struct txgbe_flash_update {
+	/* progress callback, may be NULL */
+	void (*notify)(struct txgbe_flash_update *fu, const char *msg,
+		       u32 done, u32 total);
+	void *priv;
+
+	/* filled in by txgbe_upgrade_flash() */
+	u32 sectors;
+	u32 written;                    /* erased and programmed */
+	u32 skipped;                    /* already matched the image */
+	u32 retries;
+	u32 dwords;                     /* dwords programmed */
+};
+
+int txgbe_upgrade_flash(struct txgbe_hw *hw, u32 region,
+			const u8 *data, u32 size,
+			struct txgbe_flash_update *fu);
+
+#endif /* _TXGBE_FLASH_H_ */
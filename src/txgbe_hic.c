@@ -0,0 +1,302 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (c) 2015 - 2022 Beijing WangXun Technology Co., Ltd. */
+
+#include "txgbe.h"
+#include "txgbe_hw.h"
+#include "txgbe_hic.h"
+
+#define txgbe_hic_of(hw) (&((struct txgbe_adapter *)(hw)->back)->hic)
+
+/**
+ *  txgbe_hic_init - initialize the host interface command engine
+ *  @hic: engine state
+ **/
+void txgbe_hic_init(struct txgbe_hic *hic)
+{
+	memset(hic, 0, sizeof(*hic));
+	mutex_init(&hic->lock);
+	init_completion(&hic->fw_event);
+	hic->cur_cmd = TXGBE_HIC_CMDS;
+}
+
+/**
+ *  txgbe_hic_event - MNG_HOST_MBOX interrupt
+ *  @hic: engine state
+ *
+ *  Called from the misc interrupt.  Marks the opcode in flight as one
+ *  the firmware answers with an interrupt, so later waits for it sleep
+ *  on the completion instead of polling.
+ **/
+void txgbe_hic_event(struct txgbe_hic *hic)
+{
+	u16 cmd = READ_ONCE(hic->cur_cmd);
+
+	if (cmd < TXGBE_HIC_CMDS)
+		set_bit(cmd, hic->irq_cmds);
+	complete(&hic->fw_event);
+}
+
+/**
+ *  txgbe_hic_lock - start a run of host interface commands
+ *  @hw: pointer to the HW structure
+ *
+ *  Takes the per-PF request lock and the SW_MB semaphore.  Every
+ *  __txgbe_host_interface_command() until txgbe_hic_unlock() runs under
+ *  this single hold.
+ **/
+s32 txgbe_hic_lock(struct txgbe_hw *hw)
+{
+	struct txgbe_hic *hic = txgbe_hic_of(hw);
+
+	mutex_lock(&hic->lock);
+	if (TCALL(hw, mac.ops.acquire_swfw_sync, TXGBE_MNG_SWFW_SYNC_SW_MB)
+	    != 0) {
+		mutex_unlock(&hic->lock);
+		return TXGBE_ERR_SWFW_SYNC;
+	}
+	hic->batch_cmds = 0;
+
+	return 0;
+}
+
+/**
+ *  txgbe_hic_unlock - end a run of host interface commands
+ *  @hw: pointer to the HW structure
+ **/
+void txgbe_hic_unlock(struct txgbe_hw *hw)
+{
+	struct txgbe_hic *hic = txgbe_hic_of(hw);
+
+	if (hic->batch_cmds > 1)
+		hic->batches++;
+	TCALL(hw, mac.ops.release_swfw_sync, TXGBE_MNG_SWFW_SYNC_SW_MB);
+	mutex_unlock(&hic->lock);
+}
+
+/**
+ *  txgbe_hic_wait_fw - wait for the firmware to finish a command
+ *  @hw: pointer to the HW structure
+ *  @timeout: time in ms to wait
+ *  @cmd: opcode of the command
+ *
+ *  Polls MBOX_CTL.FWRDY starting at TXGBE_HIC_POLL_MIN_US and doubling
+ *  the interval up to TXGBE_HIC_POLL_MAX_US, so fast commands finish in
+ *  tens of microseconds and slow ones cost a wakeup per millisecond.
+ *  Opcodes in hic->irq_cmds sleep on the MNG_HOST_MBOX completion
+ *  instead, which is jiffy-granular but woken as soon as the firmware
+ *  answers; an opcode that completes without waking it is dropped from
+ *  the set.  Returns true once FWRDY is set, false on timeout.
+ **/
+static bool txgbe_hic_wait_fw(struct txgbe_hw *hw, u32 timeout, u8 cmd)
+{
+	struct txgbe_hic *hic = txgbe_hic_of(hw);
+	u64 start = ktime_get_ns();
+	u64 deadline = start + (u64)timeout * NSEC_PER_MSEC;
+	unsigned int step = TXGBE_HIC_POLL_MIN_US;
+	bool irq = test_bit(cmd, hic->irq_cmds);
+	bool woken = false;
+	bool slept = false;
+	bool done = false;
+	u64 now;
+
+	for (;;) {
+		if (txgbe_check_mng_access(hw) &&
+		    (rd32(hw, TXGBE_MNG_MBOX_CTL) & TXGBE_MNG_MBOX_CTL_FWRDY)) {
+			done = true;
+			break;
+		}
+
+		now = ktime_get_ns();
+		if (now >= deadline)
+			break;
+
+		hic->polls++;
+		slept = true;
+		if (irq) {
+			woken = wait_for_completion_timeout(&hic->fw_event,
+						usecs_to_jiffies(step)) != 0;
+			if (woken)
+				hic->irq_wakeups++;
+		} else {
+			usleep_range(step, step * 2);
+		}
+		step = min_t(unsigned int, step * 2, TXGBE_HIC_POLL_MAX_US);
+	}
+
+	/* FWRDY came up without the interrupt: poll this opcode again */
+	if (irq && done && slept && !woken)
+		clear_bit(cmd, hic->irq_cmds);
+
+	hic->last_wait_us = (u32)div_u64(ktime_get_ns() - start,
+					 NSEC_PER_USEC);
+	if (hic->last_wait_us > hic->max_wait_us)
+		hic->max_wait_us = hic->last_wait_us;
+	if (!done)
+		hic->timeouts++;
+
+	return done;
+}
+
+/**
+ *  __txgbe_host_interface_command - Issue command to manageability block
+ *  @hw: pointer to the HW structure
+ *  @buffer: contains the command to write and where the return status will
+ *   be placed
+ *  @length: length of buffer, must be multiple of 4 bytes
+ *  @timeout: time in ms to wait for command completion
+ *  @return_data: read and return data from the buffer (true) or not (false)
+ *
+ *  Same as txgbe_host_interface_command() but must be called between
+ *  txgbe_hic_lock() and txgbe_hic_unlock().
+ **/
+s32 __txgbe_host_interface_command(struct txgbe_hw *hw, u32 *buffer,
+				   u32 length, u32 timeout, bool return_data)
+{
+	struct txgbe_hic *hic = txgbe_hic_of(hw);
+	u32 i, bi;
+	u32 hdr_size = sizeof(struct txgbe_hic_hdr);
+	u16 buf_len;
+	u32 dword_len;
+	u32 buf[64] = {};
+	bool fw_done = true;
+
+	if (length == 0 || length > TXGBE_HI_MAX_BLOCK_BYTE_LENGTH) {
+		DEBUGOUT1("Buffer length failure buffersize=%d.\n", length);
+		return TXGBE_ERR_HOST_INTERFACE_COMMAND;
+	}
+
+	/* Calculate length in DWORDs. We must be DWORD aligned */
+	if ((length % (sizeof(u32))) != 0) {
+		DEBUGOUT("Buffer length failure, not aligned to dword");
+		return TXGBE_ERR_INVALID_ARGUMENT;
+	}
+
+	hic->cmds++;
+	hic->batch_cmds++;
+	dword_len = length >> 2;
+
+	/* The device driver writes the relevant command block
+	 * into the ram area.
+	 */
+	for (i = 0; i < dword_len; i++) {
+		if (!txgbe_check_mng_access(hw))
+			return TXGBE_ERR_MNG_ACCESS_FAILED;
+		wr32a(hw, TXGBE_MNG_MBOX, i, TXGBE_CPU_TO_LE32(buffer[i]));
+		/* write flush */
+		buf[i] = rd32a(hw, TXGBE_MNG_MBOX, i);
+	}
+
+	/* arm the completion before the firmware can answer */
+	reinit_completion(&hic->fw_event);
+
+	/* Setting this bit tells the ARC that a new command is pending. */
+	if (!txgbe_check_mng_access(hw))
+		return TXGBE_ERR_MNG_ACCESS_FAILED;
+	WRITE_ONCE(hic->cur_cmd, buffer[0] & 0xff);
+	wr32m(hw, TXGBE_MNG_MBOX_CTL,
+		TXGBE_MNG_MBOX_CTL_SWRDY, TXGBE_MNG_MBOX_CTL_SWRDY);
+
+	if (timeout)
+		fw_done = txgbe_hic_wait_fw(hw, timeout, buffer[0] & 0xff);
+	WRITE_ONCE(hic->cur_cmd, TXGBE_HIC_CMDS);
+
+	buf[0] = rd32(hw, TXGBE_MNG_MBOX);
+
+	if ((buf[0] & 0xff0000) >> 16 == 0x80) {
+		DEBUGOUT("It's unknown cmd.\n");
+		return TXGBE_ERR_MNG_ACCESS_FAILED;
+	}
+	/* Check command completion */
+	if (!fw_done) {
+		ERROR_REPORT1(TXGBE_ERROR_CAUTION,
+						"Command has failed with no status valid.\n");
+
+		ERROR_REPORT1(TXGBE_ERROR_CAUTION, "write value:\n");
+		for (i = 0; i < dword_len; i++) {
+			ERROR_REPORT1(TXGBE_ERROR_CAUTION, "%x ", buffer[i]);
+		}
+		ERROR_REPORT1(TXGBE_ERROR_CAUTION, "read value:\n");
+		for (i = 0; i < dword_len; i++) {
+			ERROR_REPORT1(TXGBE_ERROR_CAUTION, "%x ", buf[i]);
+		}
+		ERROR_REPORT1(TXGBE_ERROR_CAUTION, "cmd 0x%x, reply 0x%x\n",
+			      buffer[0] & 0xff, ~buf[0] >> 24);
+		if ((buffer[0] & 0xff) != (~buf[0] >> 24))
+			return TXGBE_ERR_HOST_INTERFACE_COMMAND;
+	}
+
+	if (!return_data)
+		return 0;
+
+	/* Calculate length in DWORDs */
+	dword_len = hdr_size >> 2;
+
+	/* first pull in the header so we know the buffer length */
+	for (bi = 0; bi < dword_len; bi++) {
+		if (!txgbe_check_mng_access(hw))
+			return TXGBE_ERR_MNG_ACCESS_FAILED;
+		buffer[bi] = rd32a(hw, TXGBE_MNG_MBOX, bi);
+		TXGBE_LE32_TO_CPUS(&buffer[bi]);
+	}
+
+	/* If there is any thing in data position pull it in */
+	buf_len = ((struct txgbe_hic_hdr *)buffer)->buf_len;
+	if (buf_len == 0)
+		return 0;
+
+	if (length < buf_len + hdr_size) {
+		DEBUGOUT("Buffer not large enough for reply message.\n");
+		return TXGBE_ERR_HOST_INTERFACE_COMMAND;
+	}
+
+	/* Calculate length in DWORDs, add 3 for odd lengths */
+	dword_len = (buf_len + 3) >> 2;
+
+	/* Pull in the rest of the buffer (bi is where we left off) */
+	for (; bi <= dword_len; bi++) {
+		if (!txgbe_check_mng_access(hw))
+			return TXGBE_ERR_MNG_ACCESS_FAILED;
+		buffer[bi] = rd32a(hw, TXGBE_MNG_MBOX, bi);
+		TXGBE_LE32_TO_CPUS(&buffer[bi]);
+	}
+
+	return 0;
+}
+
+/**
+ *  txgbe_host_interface_command - Issue command to manageability block
+ *  @hw: pointer to the HW structure
+ *  @buffer: contains the command to write and where the return status will
+ *   be placed
+ *  @length: length of buffer, must be multiple of 4 bytes
+ *  @timeout: time in ms to wait for command completion
+ *  @return_data: read and return data from the buffer (true) or not (false)
+ *   Needed because FW structures are big endian and decoding of
+ *   these fields can be 8 bit or 16 bit based on command. Decoding
+ *   is not easily understood without making a table of commands.
+ *   So we will leave this up to the caller to read back the data
+ *   in these cases.
+ *
+ *  Communicates with the manageability block.  On success return 0
+ *  else return TXGBE_ERR_HOST_INTERFACE_COMMAND.
+ **/
+s32 txgbe_host_interface_command(struct txgbe_hw *hw, u32 *buffer,
+				 u32 length, u32 timeout, bool return_data)
+{
+	s32 status;
+
+	if (length == 0 || length > TXGBE_HI_MAX_BLOCK_BYTE_LENGTH) {
+		DEBUGOUT1("Buffer length failure buffersize=%d.\n", length);
+		return TXGBE_ERR_HOST_INTERFACE_COMMAND;
+	}
+
+	status = txgbe_hic_lock(hw);
+	if (status)
+		return status;
+
+	status = __txgbe_host_interface_command(hw, buffer, length, timeout,
+						return_data);
+
+	txgbe_hic_unlock(hw);
+	return status;
+}
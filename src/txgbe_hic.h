@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (c) 2015 - 2022 Beijing WangXun Technology Co., Ltd. */
+#ifndef _TXGBE_HIC_H_
+#define _TXGBE_HIC_H_
+
+/*
+ * Host interface (manageability mailbox) command engine.
+ *
+ * Commands are serialized per PF by hic->lock, whose waiters form the
+ * request queue, and on the device by the SW_MB SW/FW semaphore.  The
+ * wait for firmware completion sleeps with an exponential backoff; for
+ * the opcodes the firmware has been seen to answer with the MNG_HOST_MBOX
+ * interrupt it sleeps on that interrupt instead.  Several commands can be issued under a single
+ * lock/semaphore hold with txgbe_hic_lock()/__txgbe_host_interface_command()
+ * /txgbe_hic_unlock().
+ *
+ * txgbe_hic.c only depends on the declarations below plus register
+ * access, so tools/hicsim can build it against a fake firmware.
+ */
+
+/* completion poll interval, doubled on every miss */
+#define TXGBE_HIC_POLL_MIN_US   20
+#define TXGBE_HIC_POLL_MAX_US   1000
+/* struct txgbe_hic_hdr.cmd is a u8 */
+#define TXGBE_HIC_CMDS          256
+
+struct txgbe_hic {
+	struct mutex lock;              /* request queue of this PF */
+	struct completion fw_event;     /* MNG_HOST_MBOX interrupt */
+	DECLARE_BITMAP(irq_cmds, TXGBE_HIC_CMDS); /* raise MNG_HOST_MBOX */
+	u16 cur_cmd;                    /* in flight, TXGBE_HIC_CMDS if none */
+
+	u32 cmds;
+	u32 batches;                    /* lock holds with more than 1 cmd */
+	u32 batch_cmds;                 /* commands in the current hold */
+	u32 polls;
+	u32 irq_wakeups;
+	u32 timeouts;
+	u32 last_wait_us;
+	u32 max_wait_us;
+};
+
+void txgbe_hic_init(struct txgbe_hic *hic);
+void txgbe_hic_event(struct txgbe_hic *hic);
+s32 txgbe_hic_lock(struct txgbe_hw *hw);
+void txgbe_hic_unlock(struct txgbe_hw *hw);
+s32 __txgbe_host_interface_command(struct txgbe_hw *hw, u32 *buffer,
+				   u32 length, u32 timeout, bool return_data);
+
+#endif /* _TXGBE_HIC_H_ */
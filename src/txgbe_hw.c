@@ -44,6 +44,8 @@ static DEFINE_SPINLOCK(txgbe_inda_lock);
 #define TXGBE_SP_RAR_ENTRIES    128
 #define TXGBE_SP_MC_TBL_SIZE    128
 #define TXGBE_SP_VFT_TBL_SIZE   128
+#define TXGBE_SP_UC_TBL_SIZE    128
+#define TXGBE_SP_RSS_TBL_SIZE   32
 #define TXGBE_SP_RX_PB_SIZE     512
 
 STATIC s32 txgbe_get_eeprom_semaphore(struct txgbe_hw *hw);
@@ -1038,8 +1040,7 @@ s32 txgbe_init_rx_addrs(struct txgbe_hw *hw)
 	psrctl |= hw->mac.mc_filter_type << TXGBE_PSR_CTL_MO_SHIFT;
 	wr32(hw, TXGBE_PSR_CTL, psrctl);
 	DEBUGOUT(" Clearing MTA\n");
-	for (i = 0; i < hw->mac.mcft_size; i++)
-		wr32(hw, TXGBE_PSR_MC_TBL(i), 0);
+	txgbe_reg_table_fill(hw, &hw->mac.mta_tbl, 0);
 
 	TCALL(hw, mac.ops.init_uta_tables);
 
@@ -1254,10 +1255,9 @@ s32 txgbe_update_mc_addr_list(struct txgbe_hw *hw, u8 *mc_addr_list,
 		txgbe_set_mta(hw, next(hw, &mc_addr_list, &vmdq));
 	}
 
-	/* Enable mta */
-	for (i = 0; i < hw->mac.mcft_size; i++)
-		wr32a(hw, TXGBE_PSR_MC_TBL(0), i,
-				      hw->mac.mta_shadow[i]);
+	/* Enable mta, only the registers whose hash bits changed are written */
+	txgbe_reg_table_sync(hw, &hw->mac.mta_tbl, hw->mac.mta_shadow,
+			     hw->mac.mcft_size);
 
 	if (hw->addr_ctrl.mta_in_use > 0) {
 		psrctl = rd32(hw, TXGBE_PSR_CTL);
@@ -2143,14 +2143,108 @@ s32 txgbe_set_vmdq_san_mac(struct txgbe_hw *hw, u32 vmdq)
  **/
 s32 txgbe_init_uta_tables(struct txgbe_hw *hw)
 {
-	int i;
-
-	for (i = 0; i < 128; i++)
-		wr32(hw, TXGBE_PSR_UC_TBL(i), 0);
+	memset(hw->mac.uta_shadow, 0, sizeof(hw->mac.uta_shadow));
+	txgbe_reg_table_fill(hw, &hw->mac.uta_tbl, 0);
 
 	return 0;
 }
 
+/**
+ *  txgbe_set_uta - Set bit-vector in unicast table
+ *  @hw: pointer to hardware structure
+ *  @addr: unicast address
+ *
+ *  Sets the bit-vector of @addr in uta_shadow.  The UTA is hashed the same
+ *  way as the MTA; a pool with ROPE set accepts unicast frames that hit it.
+ *  The caller writes uta_shadow with txgbe_reg_table_sync().
+ **/
+void txgbe_set_uta(struct txgbe_hw *hw, u8 *addr)
+{
+	u32 vector = txgbe_mta_vector(hw, addr);
+
+	hw->mac.uta_shadow[(vector >> 5) & 0x7F] |= (1 << (vector & 0x1F));
+}
+
+/**
+ *  txgbe_load_vlvf - read the VLAN pool filter into its software copy
+ *  @hw: pointer to hardware structure
+ *
+ *  Only reads the hardware when the copy is not valid, i.e. after a reset
+ *  that was not followed by txgbe_clear_vfta().
+ **/
+void txgbe_load_vlvf(struct txgbe_hw *hw)
+{
+	struct txgbe_vlvf_shadow *sh = &hw->mac.vlvf;
+	u32 i, vid;
+
+	if (sh->valid)
+		return;
+
+	memset(sh, 0, sizeof(*sh));
+	for (i = 0; i < TXGBE_PSR_VLAN_SWC_ENTRIES; i++) {
+		wr32(hw, TXGBE_PSR_VLAN_SWC_IDX, i);
+		sh->vlvf[i] = rd32(hw, TXGBE_PSR_VLAN_SWC);
+		sh->pools[i] = rd32(hw, TXGBE_PSR_VLAN_SWC_VM_L) |
+			       (u64)rd32(hw, TXGBE_PSR_VLAN_SWC_VM_H) << 32;
+		if (!i || !sh->vlvf[i])
+			continue;
+		sh->used |= 1ULL << i;
+		vid = sh->vlvf[i] & TXGBE_PSR_VLAN_SWC_VLANID_MASK;
+		if (!sh->slot[vid])
+			sh->slot[vid] = i;
+	}
+	sh->valid = true;
+}
+
+/* write the registers of VLVF entry @index that differ from the copy */
+static void txgbe_write_vlvf(struct txgbe_hw *hw, u32 index, u32 vlvf,
+			     u64 pools)
+{
+	struct txgbe_vlvf_shadow *sh = &hw->mac.vlvf;
+	u32 old = sh->vlvf[index];
+
+	if (old == vlvf && sh->pools[index] == pools)
+		return;
+
+	wr32(hw, TXGBE_PSR_VLAN_SWC_IDX, index);
+	if ((u32)pools != (u32)sh->pools[index])
+		wr32(hw, TXGBE_PSR_VLAN_SWC_VM_L, (u32)pools);
+	if ((pools >> 32) != (sh->pools[index] >> 32))
+		wr32(hw, TXGBE_PSR_VLAN_SWC_VM_H, (u32)(pools >> 32));
+	if (old != vlvf)
+		wr32(hw, TXGBE_PSR_VLAN_SWC, vlvf);
+	sh->pools[index] = pools;
+	sh->vlvf[index] = vlvf;
+
+	if (!index || old == vlvf)
+		return;
+	if (old) {
+		sh->slot[old & TXGBE_PSR_VLAN_SWC_VLANID_MASK] = 0;
+		sh->used &= ~(1ULL << index);
+	}
+	if (vlvf) {
+		sh->slot[vlvf & TXGBE_PSR_VLAN_SWC_VLANID_MASK] = index;
+		sh->used |= 1ULL << index;
+	}
+}
+
+/**
+ *  txgbe_find_vlvf_entry - find the VLVF entry of a VLAN
+ *  @hw: pointer to hardware structure
+ *  @vlan: VLAN id
+ *
+ *  Returns the VLVF index of @vlan, or -1 if it has none.
+ **/
+s32 txgbe_find_vlvf_entry(struct txgbe_hw *hw, u32 vlan)
+{
+	/* short cut the special case */
+	if (vlan == 0)
+		return 0;
+
+	txgbe_load_vlvf(hw);
+	return hw->mac.vlvf.slot[vlan & TXGBE_PSR_VLAN_SWC_VLANID_MASK] ? : -1;
+}
+
 /**
  *  txgbe_find_vlvf_slot - find the vlanid or the first empty slot
  *  @hw: pointer to hardware structure
@@ -2161,43 +2255,47 @@ s32 txgbe_init_uta_tables(struct txgbe_hw *hw)
  **/
 s32 txgbe_find_vlvf_slot(struct txgbe_hw *hw, u32 vlan)
 {
-	u32 bits = 0;
-	u32 first_empty_slot = 0;
+	struct txgbe_vlvf_shadow *sh = &hw->mac.vlvf;
 	s32 regindex;
+	u64 free;
 
-	/* short cut the special case */
-	if (vlan == 0)
-		return 0;
+	regindex = txgbe_find_vlvf_entry(hw, vlan);
+	if (regindex >= 0)
+		return regindex;
 
-	/*
-	 * Search for the vlan id in the VLVF entries. Save off the first empty
-	 * slot found along the way
-	 */
-	for (regindex = 1; regindex < TXGBE_PSR_VLAN_SWC_ENTRIES; regindex++) {
-		wr32(hw, TXGBE_PSR_VLAN_SWC_IDX, regindex);
-		bits = rd32(hw, TXGBE_PSR_VLAN_SWC);
-		if (!bits && !(first_empty_slot))
-			first_empty_slot = regindex;
-		else if ((bits & 0x0FFF) == vlan)
-			break;
+	/* entry 0 belongs to VLAN 0 */
+	free = ~sh->used & ~1ULL;
+	if (!free) {
+		ERROR_REPORT1(TXGBE_ERROR_SOFTWARE,
+			     "No space in VLVF.\n");
+		return TXGBE_ERR_NO_SPACE;
 	}
 
-	/*
-	 * If regindex is less than TXGBE_VLVF_ENTRIES, then we found the vlan
-	 * in the VLVF. Else use the first empty VLVF register for this
-	 * vlan id.
-	 */
-	if (regindex >= TXGBE_PSR_VLAN_SWC_ENTRIES) {
-		if (first_empty_slot)
-			regindex = first_empty_slot;
-		else {
-			ERROR_REPORT1(TXGBE_ERROR_SOFTWARE,
-				     "No space in VLVF.\n");
-			regindex = TXGBE_ERR_NO_SPACE;
-		}
-	}
+	return __ffs64(free);
+}
 
-	return regindex;
+/**
+ *  txgbe_set_vlvf_pool - add or remove a pool from a VLVF entry
+ *  @hw: pointer to hardware structure
+ *  @index: VLVF index
+ *  @vind: VMDq output index
+ *  @on: add or remove
+ *
+ *  Leaves the VLAN id of the entry alone; nothing is written if the pool
+ *  bit already has the wanted value.
+ **/
+void txgbe_set_vlvf_pool(struct txgbe_hw *hw, u32 index, u32 vind, bool on)
+{
+	struct txgbe_vlvf_shadow *sh = &hw->mac.vlvf;
+	u64 pools;
+
+	txgbe_load_vlvf(hw);
+	pools = sh->pools[index];
+	if (on)
+		pools |= 1ULL << vind;
+	else
+		pools &= ~(1ULL << vind);
+	txgbe_write_vlvf(hw, index, sh->vlvf[index], pools);
 }
 
 /**
@@ -2260,7 +2358,7 @@ s32 txgbe_set_vfta(struct txgbe_hw *hw, u32 vlan, u32 vind,
 		return ret_val;
 
 	if (vfta_changed)
-		wr32(hw, TXGBE_PSR_VLAN_TBL(regindex), vfta);
+		txgbe_reg_table_set(hw, &hw->mac.vft_tbl, regindex, vfta);
 	/* errata 5 */
 	hw->mac.vft_shadow[regindex] = vfta;
 	return 0;
@@ -2295,52 +2393,17 @@ s32 txgbe_set_vlvf(struct txgbe_hw *hw, u32 vlan, u32 vind,
 	vt = rd32(hw, TXGBE_CFG_PORT_CTL);
 	if (vt & TXGBE_CFG_PORT_CTL_NUM_VT_MASK) {
 		s32 vlvf_index;
-		u32 bits;
+		u64 pools;
 
 		vlvf_index = txgbe_find_vlvf_slot(hw, vlan);
 		if (vlvf_index < 0)
 			return vlvf_index;
 
-		wr32(hw, TXGBE_PSR_VLAN_SWC_IDX, vlvf_index);
-		if (vlan_on) {
-			/* set the pool bit */
-			if (vind < 32) {
-				bits = rd32(hw,
-						TXGBE_PSR_VLAN_SWC_VM_L);
-				bits |= (1 << vind);
-				wr32(hw,
-						TXGBE_PSR_VLAN_SWC_VM_L,
-						bits);
-			} else {
-				bits = rd32(hw,
-					TXGBE_PSR_VLAN_SWC_VM_H);
-				bits |= (1 << (vind - 32));
-				wr32(hw,
-					TXGBE_PSR_VLAN_SWC_VM_H,
-					bits);
-			}
-		} else {
-			/* clear the pool bit */
-			if (vind < 32) {
-				bits = rd32(hw,
-						TXGBE_PSR_VLAN_SWC_VM_L);
-				bits &= ~(1 << vind);
-				wr32(hw,
-						TXGBE_PSR_VLAN_SWC_VM_L,
-						bits);
-				bits |= rd32(hw,
-					TXGBE_PSR_VLAN_SWC_VM_H);
-			} else {
-				bits = rd32(hw,
-					TXGBE_PSR_VLAN_SWC_VM_H);
-				bits &= ~(1 << (vind - 32));
-				wr32(hw,
-					TXGBE_PSR_VLAN_SWC_VM_H,
-					bits);
-				bits |= rd32(hw,
-						TXGBE_PSR_VLAN_SWC_VM_L);
-			}
-		}
+		pools = hw->mac.vlvf.pools[vlvf_index];
+		if (vlan_on)
+			pools |= 1ULL << vind;
+		else
+			pools &= ~(1ULL << vind);
 
 		/*
 		 * If there are still bits set in the VLVFB registers
@@ -2354,12 +2417,12 @@ s32 txgbe_set_vlvf(struct txgbe_hw *hw, u32 vlan, u32 vind,
 		 * there may be multiple pools and/or VFs using the
 		 * VLAN ID entry.  In that case we cannot clear the
 		 * VFTA bit until all pools/VFs using that VLAN ID have also
-		 * been cleared.  This will be indicated by "bits" being
+		 * been cleared.  This will be indicated by "pools" being
 		 * zero.
 		 */
-		if (bits) {
-			wr32(hw, TXGBE_PSR_VLAN_SWC,
-					(TXGBE_PSR_VLAN_SWC_VIEN | vlan));
+		if (pools) {
+			txgbe_write_vlvf(hw, vlvf_index,
+					 TXGBE_PSR_VLAN_SWC_VIEN | vlan, pools);
 			if ((!vlan_on) && (vfta_changed != NULL)) {
 				/* someone wants to clear the vfta entry
 				 * but some pools/VFs are still using it.
@@ -2367,7 +2430,7 @@ s32 txgbe_set_vlvf(struct txgbe_hw *hw, u32 vlan, u32 vind,
 				*vfta_changed = false;
 			}
 		} else
-			wr32(hw, TXGBE_PSR_VLAN_SWC, 0);
+			txgbe_write_vlvf(hw, vlvf_index, 0, 0);
 	}
 
 	return 0;
@@ -2383,11 +2446,9 @@ s32 txgbe_clear_vfta(struct txgbe_hw *hw)
 {
 	u32 offset;
 
-	for (offset = 0; offset < hw->mac.vft_size; offset++) {
-		wr32(hw, TXGBE_PSR_VLAN_TBL(offset), 0);
-		/* errata 5 */
-		hw->mac.vft_shadow[offset] = 0;
-	}
+	txgbe_reg_table_fill(hw, &hw->mac.vft_tbl, 0);
+	/* errata 5 */
+	memset(hw->mac.vft_shadow, 0, sizeof(hw->mac.vft_shadow));
 
 	for (offset = 0; offset < TXGBE_PSR_VLAN_SWC_ENTRIES; offset++) {
 		wr32(hw, TXGBE_PSR_VLAN_SWC_IDX, offset);
@@ -2395,6 +2456,8 @@ s32 txgbe_clear_vfta(struct txgbe_hw *hw)
 		wr32(hw, TXGBE_PSR_VLAN_SWC_VM_L, 0);
 		wr32(hw, TXGBE_PSR_VLAN_SWC_VM_H, 0);
 	}
+	memset(&hw->mac.vlvf, 0, sizeof(hw->mac.vlvf));
+	hw->mac.vlvf.valid = true;
 
 	return 0;
 }
@@ -2578,162 +2641,6 @@ u8 txgbe_calculate_checksum(u8 *buffer, u32 length)
 	return (u8) (0 - sum);
 }
 
-/**
- *  txgbe_host_interface_command - Issue command to manageability block
- *  @hw: pointer to the HW structure
- *  @buffer: contains the command to write and where the return status will
- *   be placed
- *  @length: length of buffer, must be multiple of 4 bytes
- *  @timeout: time in ms to wait for command completion
- *  @return_data: read and return data from the buffer (true) or not (false)
- *   Needed because FW structures are big endian and decoding of
- *   these fields can be 8 bit or 16 bit based on command. Decoding
- *   is not easily understood without making a table of commands.
- *   So we will leave this up to the caller to read back the data
- *   in these cases.
- *
- *  Communicates with the manageability block.  On success return 0
- *  else return TXGBE_ERR_HOST_INTERFACE_COMMAND.
- **/
-s32 txgbe_host_interface_command(struct txgbe_hw *hw, u32 *buffer,
-				 u32 length, u32 timeout, bool return_data)
-{
-	u32 hicr, i, bi;
-	u32 hdr_size = sizeof(struct txgbe_hic_hdr);
-	u16 buf_len;
-	u32 dword_len;
-	s32 status = 0;
-	u32 buf[64] = {};
-
-	if (length == 0 || length > TXGBE_HI_MAX_BLOCK_BYTE_LENGTH) {
-		DEBUGOUT1("Buffer length failure buffersize=%d.\n", length);
-		return TXGBE_ERR_HOST_INTERFACE_COMMAND;
-	}
-
-	if (TCALL(hw, mac.ops.acquire_swfw_sync, TXGBE_MNG_SWFW_SYNC_SW_MB)
-	    != 0) {
-		return TXGBE_ERR_SWFW_SYNC;
-	}
-
-
-	/* Calculate length in DWORDs. We must be DWORD aligned */
-	if ((length % (sizeof(u32))) != 0) {
-		DEBUGOUT("Buffer length failure, not aligned to dword");
-		status = TXGBE_ERR_INVALID_ARGUMENT;
-		goto rel_out;
-	}
-
-	dword_len = length >> 2;
-
-	/* The device driver writes the relevant command block
-	 * into the ram area.
-	 */
-	for (i = 0; i < dword_len; i++) {
-		if (txgbe_check_mng_access(hw)) {
-			wr32a(hw, TXGBE_MNG_MBOX,
-						i, TXGBE_CPU_TO_LE32(buffer[i]));
-			/* write flush */
-			buf[i] = rd32a(hw, TXGBE_MNG_MBOX, i);
-		}
-		else {
-			status = TXGBE_ERR_MNG_ACCESS_FAILED;
-			goto rel_out;
-		}
-	}
-	/* Setting this bit tells the ARC that a new command is pending. */
-	if (txgbe_check_mng_access(hw))
-		wr32m(hw, TXGBE_MNG_MBOX_CTL,
-			TXGBE_MNG_MBOX_CTL_SWRDY, TXGBE_MNG_MBOX_CTL_SWRDY);
-	else {
-		status = TXGBE_ERR_MNG_ACCESS_FAILED;
-		goto rel_out;
-	}
-
-	for (i = 0; i < timeout; i++) {
-		if (txgbe_check_mng_access(hw)) {
-			hicr = rd32(hw, TXGBE_MNG_MBOX_CTL);
-			if ((hicr & TXGBE_MNG_MBOX_CTL_FWRDY))
-				break;
-		}
-		msec_delay(1);
-	}
-
-	buf[0] = rd32(hw, TXGBE_MNG_MBOX);
-
-	if ((buf[0] & 0xff0000) >> 16 == 0x80) {
-		DEBUGOUT("It's unknown cmd.\n");
-		status = TXGBE_ERR_MNG_ACCESS_FAILED;
-		goto rel_out;
-	}
-	/* Check command completion */
-	if (timeout != 0 && i == timeout) {
-		ERROR_REPORT1(TXGBE_ERROR_CAUTION,
-						"Command has failed with no status valid.\n");
-
-		ERROR_REPORT1(TXGBE_ERROR_CAUTION, "write value:\n");
-		for (i = 0; i < dword_len; i++) {
-			ERROR_REPORT1(TXGBE_ERROR_CAUTION, "%x ", buffer[i]);
-		}
-		ERROR_REPORT1(TXGBE_ERROR_CAUTION, "read value:\n");
-		for (i = 0; i < dword_len; i++) {
-			ERROR_REPORT1(TXGBE_ERROR_CAUTION, "%x ", buf[i]);
-		}
-		printk("===%x= %x=\n", buffer[0] & 0xff, (~buf[0] >> 24));
-		if( (buffer[0] & 0xff) != (~buf[0] >> 24)) {
-			status = TXGBE_ERR_HOST_INTERFACE_COMMAND;
-			goto rel_out;
-		}
-	}
-
-	if (!return_data)
-		goto rel_out;
-
-	/* Calculate length in DWORDs */
-	dword_len = hdr_size >> 2;
-
-	/* first pull in the header so we know the buffer length */
-	for (bi = 0; bi < dword_len; bi++) {
-		if (txgbe_check_mng_access(hw)) {
-			buffer[bi] = rd32a(hw, TXGBE_MNG_MBOX,
-							bi);
-			TXGBE_LE32_TO_CPUS(&buffer[bi]);
-		} else {
-			status = TXGBE_ERR_MNG_ACCESS_FAILED;
-			goto rel_out;
-		}
-	}
-
-	/* If there is any thing in data position pull it in */
-	buf_len = ((struct txgbe_hic_hdr *)buffer)->buf_len;
-	if (buf_len == 0)
-		goto rel_out;
-
-	if (length < buf_len + hdr_size) {
-		DEBUGOUT("Buffer not large enough for reply message.\n");
-		status = TXGBE_ERR_HOST_INTERFACE_COMMAND;
-		goto rel_out;
-	}
-
-	/* Calculate length in DWORDs, add 3 for odd lengths */
-	dword_len = (buf_len + 3) >> 2;
-
-	/* Pull in the rest of the buffer (bi is where we left off) */
-	for (; bi <= dword_len; bi++) {
-		if (txgbe_check_mng_access(hw)) {
-			buffer[bi] = rd32a(hw, TXGBE_MNG_MBOX,
-							bi);
-			TXGBE_LE32_TO_CPUS(&buffer[bi]);
-		} else {
-			status = TXGBE_ERR_MNG_ACCESS_FAILED;
-			goto rel_out;
-		}
-	}
-
-rel_out:
-	TCALL(hw, mac.ops.release_swfw_sync, TXGBE_MNG_SWFW_SYNC_SW_MB);
-	return status;
-}
-
 /**
  *  txgbe_set_fw_drv_ver - Sends driver version to firmware
  *  @hw: pointer to the HW structure
@@ -3004,7 +2911,7 @@ static int txgbe_fmgr_cmd_op(struct txgbe_hw *hw, u32 cmd, u32 cmd_addr)
 
 	return 0;
 }
-static int fmgr_usr_cmd_op(struct txgbe_hw *hw, u32 usr_cmd)
+int txgbe_flash_usr_cmd(struct txgbe_hw *hw, u32 usr_cmd)
 {
 	u8 status = 0;
 
@@ -3014,22 +2921,29 @@ static int fmgr_usr_cmd_op(struct txgbe_hw *hw, u32 usr_cmd)
 	return status;
 }
 
-static int txgbe_flash_erase_chip(struct txgbe_hw *hw)
+static __maybe_unused int txgbe_flash_erase_chip(struct txgbe_hw *hw)
 {
 	return txgbe_fmgr_cmd_op(hw, SPI_CMD_ERASE_CHIP, 0);
 }
 
-static int txgbe_flash_erase_sector(struct txgbe_hw *hw, u32 sec_addr)
+int txgbe_flash_erase_sector(struct txgbe_hw *hw, u32 sec_addr)
 {
 	return txgbe_fmgr_cmd_op(hw, SPI_CMD_ERASE_SECTOR, sec_addr);
 }
-static int txgbe_flash_write_dword(struct txgbe_hw *hw, u32 addr, u32 dword)
+
+/* program without reading back, callers verify a whole sector at once */
+int txgbe_flash_program_dword(struct txgbe_hw *hw, u32 addr, u32 dword)
+{
+	wr32(hw, SPI_H_DAT_REG_ADDR, dword);
+	return txgbe_fmgr_cmd_op(hw, SPI_CMD_WRITE_DWORD, addr);
+}
+
+int txgbe_flash_write_dword(struct txgbe_hw *hw, u32 addr, u32 dword)
 {
 	int status = 0;
 	u32 data;
 
-	wr32(hw, SPI_H_DAT_REG_ADDR, dword);
-	status = txgbe_fmgr_cmd_op(hw, SPI_CMD_WRITE_DWORD, addr);
+	status = txgbe_flash_program_dword(hw, addr, dword);
 	if (status)
 		return status;
 
@@ -3112,7 +3026,7 @@ static __maybe_unused int txgbe_flash_read_cab(struct txgbe_hw *hw, u32 addr ,u1
 
 	return rd32(hw,0x1e108);
 }
-static int txgbe_flash_write_unlock(struct txgbe_hw *hw)
+int txgbe_flash_write_unlock(struct txgbe_hw *hw)
 {
 	int status;
 	struct txgbe_hic_read_shadow_ram buffer;
@@ -3154,259 +3068,6 @@ static __maybe_unused int txgbe_flash_write_lock(struct txgbe_hw *hw)
 	return status;
 }
 
-int txgbe_upgrade_flash(struct txgbe_hw *hw, u32 region,
-			const u8 *data, u32 size)
-{
-	u32 mac_addr0_dword0_t, mac_addr0_dword1_t, mac_addr1_dword0_t, mac_addr1_dword1_t;
-	u32 serial_num_dword0_t, serial_num_dword1_t, serial_num_dword2_t;
-	struct txgbe_adapter *adapter = hw->back;
-	u8 status = 0, skip = 0, flash_vendor = 0;
-	u32 sector_num = 0, read_data = 0, i = 0;
-	u32 sn[24];
-	char sn_str[40];
-	u8 sn_is_str = true;
-	u8 *vpd_tend = NULL;
-	u32 curadr = 0;
-	u32 vpdadr = 0;
-	u8 id_str_len, pn_str_len, sn_str_len, rv_str_len;
-	u16 vpd_ro_len;
-	u32 chksum = 0;
-	int err = 0;
-
-	read_data = rd32(hw, PRB_CTL);
-	if (read_data & 0x80000000) {
-		e_info(drv, "The flash has been successfully upgraded once, please reboot to make it work.\n");
-		return -EOPNOTSUPP;
-	}
-
-	/*check sub_id*/;
-	e_info(drv, "Checking sub_id .......\n");
-	e_info(drv, "The card's sub_id : %04x\n", hw->subsystem_device_id);
-	e_info(drv, "The image's sub_id : %04x\n", data[0xfffdc] << 8  | data[0xfffdd]);
-	if ((hw->subsystem_device_id & 0xfff) == 
-		((data[0xfffdc] << 8  | data[0xfffdd]) & 0xfff)){
-		e_info(drv, "It is a right image\n");
-	} else if (hw->subsystem_device_id == 0xffff){
-		e_info(drv, "update anyway\n");
-	} else {
-		e_err(drv, "====The Gigabit image is not match the Gigabit card====\n");
-		e_err(drv, "====Please check your image====\n");
-		return -EOPNOTSUPP;
-	}
-
-	/*check dev_id*/
-	e_info(drv, "Checking dev_id .......\n");
-	e_info(drv, "The image's dev_id : %04x\n", data[0xfffde] << 8  | data[0xfffdf]);
-	e_info(drv, "The card's dev_id : %04x\n", hw->device_id);
-	if (!((hw->device_id & 0xfff0) == ((data[0xfffde] << 8 | data[0xfffdf]) & 0xfff0)) &&
-	    !(hw->device_id == 0xffff))
-	{
-		e_err(drv, "====The Gigabit image is not match the Gigabit card====\n");
-		e_err(drv, "====Please check your image====\n");
-		return -EOPNOTSUPP;
-	}
-
-	/* unlock flash write protect*/
-	wr32(hw, TXGBE_SPI_CMDCFG0, 0x9f050206);
-	wr32(hw, 0x10194, 0x9f050206);
-
-	msleep(1000);
-
-	txgbe_flash_read_dword(hw, MAC_ADDR0_WORD0_OFFSET_1G, &mac_addr0_dword0_t);
-	txgbe_flash_read_dword(hw, MAC_ADDR0_WORD1_OFFSET_1G, &mac_addr0_dword1_t);
-	mac_addr0_dword1_t = mac_addr0_dword1_t & U16_MAX;
-	txgbe_flash_read_dword(hw, MAC_ADDR1_WORD0_OFFSET_1G, &mac_addr1_dword0_t);
-	txgbe_flash_read_dword(hw, MAC_ADDR1_WORD1_OFFSET_1G, &mac_addr1_dword1_t);
-	mac_addr1_dword1_t = mac_addr1_dword1_t & U16_MAX;
-
-	for (i = 0; i < 24; i++) {
-		txgbe_flash_read_dword(hw, PRODUCT_SERIAL_NUM_OFFSET_1G + 4 * i, &sn[i]);
-	}
-	if (sn[23] == U32_MAX)
-		sn_is_str = false;
-
-	txgbe_flash_read_dword(hw, PRODUCT_SERIAL_NUM_OFFSET_1G, &serial_num_dword0_t);
-	txgbe_flash_read_dword(hw, PRODUCT_SERIAL_NUM_OFFSET_1G + 4, &serial_num_dword1_t);
-	txgbe_flash_read_dword(hw, PRODUCT_SERIAL_NUM_OFFSET_1G + 8, &serial_num_dword2_t);
-	e_info(drv, "Old: MAC Address0 is: 0x%04x%08x\n", mac_addr0_dword1_t, mac_addr0_dword0_t);
-	e_info(drv, "     MAC Address1 is: 0x%04x%08x\n", mac_addr1_dword1_t, mac_addr1_dword0_t);
-
-	status = fmgr_usr_cmd_op(hw, 0x6);	/* write enable*/
-	status = fmgr_usr_cmd_op(hw, 0x98); /* global protection un-lock*/
-	txgbe_flash_write_unlock(hw);
-	msleep(1000);
-
-	//rebuild vpd
-	vpd_tend = kcalloc(256, sizeof(u8), GFP_KERNEL);
-	if (!vpd_tend) {
-		e_info(drv, "failed to allocate memory for vpd\n");
-		return -ENOMEM;
-	}
-	memset(vpd_tend, 0xff, 256 * sizeof(u8));
-
-	curadr = TXGBE_VPD_OFFSET + 1;
-	id_str_len = data[curadr] | data[curadr + 1] << 8;
-	curadr += (7 + id_str_len);
-	pn_str_len = data[curadr];
-	curadr += 1 + pn_str_len;
-
-	for (i = 0; i < curadr - TXGBE_VPD_OFFSET; i++) {
-		vpd_tend[i] = data[TXGBE_VPD_OFFSET + i];
-	}
-
-	memset(sn_str, 0x0, sizeof(sn_str));
-	if (sn_is_str) {
-		for (i = 0; i < 24; i++) {
-			sn_str[i] = sn[23-i];
-		}
-		sn_str_len = strlen(sn_str);
-	} else {
-		sn_str_len = 0x12;
-		sprintf(sn_str ,"%02x%08x%08x",(serial_num_dword2_t & 0xff), serial_num_dword1_t, serial_num_dword0_t);
-	}
-
-	vpdadr = curadr - TXGBE_VPD_OFFSET;
-
-	if (data[curadr] == 'S' && data[curadr + 1] == 'N') {
-		if (data[curadr + 2]) {
-			for (i = sn_str_len; i < data[curadr + 2]; i++)
-				sn_str[i] = 0x20;
-			sn_str_len = data[curadr + 2];
-		}
-		curadr += 3 + data[curadr + 2];
-		rv_str_len = data[2 + curadr];
-	} else {
-		rv_str_len = data[2 + curadr];
-	}
-
-	vpd_tend[vpdadr] = 'S';
-	vpd_tend[vpdadr + 1] = 'N';
-	vpd_tend[vpdadr + 2] = sn_str_len;
-
-	for (i = 0; i < sn_str_len; i++)
-		vpd_tend[vpdadr + 3 + i] = sn_str[i];
-
-	vpdadr = vpdadr+ 3 + sn_str_len;
-
-	for (i = 0; i < 3; i++)
-		vpd_tend[vpdadr + i] = data [curadr + i];
-
-	vpdadr += 3;
-	for (i = 0; i < rv_str_len; i++)
-		vpd_tend[vpdadr + i] = 0x0;
-
-	vpdadr += rv_str_len;
-	vpd_ro_len = pn_str_len + sn_str_len + rv_str_len + 9;
-	vpd_tend[4 + id_str_len] = vpd_ro_len & 0xff;
-	vpd_tend[5 + id_str_len] = (vpd_ro_len >> 8) & 0xff;
-
-	for (i = 0; i < vpdadr; i++)
-		chksum += vpd_tend[i];
-	chksum = ~(chksum & 0xff) + 1;
-	vpd_tend[vpdadr - rv_str_len] = chksum;
-	vpd_tend[vpdadr] = 0x78;
-
-	/*Note: for Spanish FLASH, first 8 sectors (4KB) in sector0 (64KB) 
-	need to use a special erase command (4K sector erase)*/
-	if (flash_vendor == 1) {
-		wr32(hw, SPI_CMD_CFG1_ADDR, 0x0103c720);
-		for (i = 0; i < 8; i++) {
-			txgbe_flash_erase_sector(hw, i * 128);
-			msleep(20); // 20 ms
-		}
-		wr32(hw, SPI_CMD_CFG1_ADDR, 0x0103c7d8);
-	}
-
-	sector_num = size / SPI_SECTOR_SIZE;
-	/* Winbond Flash, erase chip command is okay, but erase sector doestn't work*/
-	if (flash_vendor == 2) {
-		status = txgbe_flash_erase_chip(hw);
-		e_err(drv, "Erase chip command, return status = %0d\n", status);
-		msleep(1000);
-	} else {
-		wr32(hw, SPI_CMD_CFG1_ADDR, 0x0103c720);
-		for (i = 0; i < sector_num; i++) {
-			status = txgbe_flash_erase_sector(hw, i * SPI_SECTOR_SIZE);
-			if (status)
-				e_err(drv, "Erase sector[%2d] command, return status = %0d\n", i, status);
-			msleep(50);
-		}
-		wr32(hw, SPI_CMD_CFG1_ADDR, 0x0103c7d8);
-	}
-
-	/* Program Image file in dword*/
-	for (i = 0; i < size / 4; i++) {
-		read_data = data[4 * i + 3] << 24 | data[4 * i + 2] << 16 | data[4 * i + 1] << 8 | data[4 * i];
-		read_data = __le32_to_cpu(read_data);
-		skip = ((i * 4 == MAC_ADDR0_WORD0_OFFSET_1G) || (i * 4 == MAC_ADDR0_WORD1_OFFSET_1G) ||
-			(i * 4 == MAC_ADDR1_WORD0_OFFSET_1G) || (i * 4 == MAC_ADDR1_WORD1_OFFSET_1G) ||
-			(i * 4 >= PRODUCT_SERIAL_NUM_OFFSET_1G && i * 4 <= PRODUCT_SERIAL_NUM_OFFSET_1G + 92) ||
-			(i * 4 >= TXGBE_VPD_OFFSET && i * 4 < TXGBE_VPD_END) || 
-			(i * 4 == 0x15c));
-		if (read_data != U32_MAX && !skip) {
-			status = txgbe_flash_write_dword(hw, i * 4, read_data);
-			if (status) {
-				e_err(drv, "ERROR: Program 0x%08x @addr: 0x%08x is failed !!\n", read_data, i * 4);
-				txgbe_flash_read_dword(hw, i * 4, &read_data);
-				e_err(drv, "		 Read data from Flash is: 0x%08x\n", read_data);
-				err = -EBUSY;
-				goto err_exit;
-			}
-		}
-	}
-
-	for (i = 0; i < 256 / 4; i++) {
-		read_data = vpd_tend[4 * i + 3] << 24 | vpd_tend[4 * i + 2] << 16 | vpd_tend[4 * i + 1] << 8 | vpd_tend[4 * i];
-		read_data = __le32_to_cpu(read_data);
-		if (read_data != U32_MAX) {
-			status = txgbe_flash_write_dword(hw, TXGBE_VPD_OFFSET + i * 4, read_data);
-			if (status) {
-				e_err(drv, "ERROR: Program 0x%08x @addr: 0x%08x is failed !!\n", read_data, i * 4);
-				txgbe_flash_read_dword(hw, i * 4, &read_data);
-				e_err(drv, "		 Read data from Flash is: 0x%08x\n", read_data);
-				err = -EBUSY;
-				goto err_exit;
-			}
-		}
-	}
-
-	chksum = 0;
-	for (i = 0; i< 0x1000; i += 2) {
-		if (i >= TXGBE_VPD_OFFSET && i < TXGBE_VPD_END) {
-			chksum += (vpd_tend[i - TXGBE_VPD_OFFSET + 1] << 8 | vpd_tend[i - TXGBE_VPD_OFFSET]);
-		} else if (i == 0x15e) {
-			continue;
-		} else {
-			chksum += (data[i + 1] << 8 | data[i]);
-		}
-	}
-	chksum = 0xbaba - chksum;
-	chksum &= 0xffff;
-	status = txgbe_flash_write_dword(hw, 0x15e, 0xffff0000 | chksum);
-
-	txgbe_flash_write_dword(hw, MAC_ADDR0_WORD0_OFFSET_1G, mac_addr0_dword0_t);
-	txgbe_flash_write_dword(hw, MAC_ADDR0_WORD1_OFFSET_1G, (mac_addr0_dword1_t | 0x80000000));//lan0
-	txgbe_flash_write_dword(hw, MAC_ADDR1_WORD0_OFFSET_1G, mac_addr1_dword0_t);
-	txgbe_flash_write_dword(hw, MAC_ADDR1_WORD1_OFFSET_1G, (mac_addr1_dword1_t | 0x80000000));//lan1
-	if (sn_is_str) {
-		for (i = 0; i < 24; i++) {
-			txgbe_flash_write_dword(hw, PRODUCT_SERIAL_NUM_OFFSET_1G + 4 * i, sn[i]);
-		}
-	} else {
-		txgbe_flash_write_dword(hw, PRODUCT_SERIAL_NUM_OFFSET_1G, serial_num_dword0_t);
-		txgbe_flash_write_dword(hw, PRODUCT_SERIAL_NUM_OFFSET_1G + 4, serial_num_dword1_t);
-		txgbe_flash_write_dword(hw, PRODUCT_SERIAL_NUM_OFFSET_1G + 8, serial_num_dword2_t);
-	}
-
-	wr32(hw, PRB_CTL, rd32(hw, PRB_CTL) | 0x80000000);
-
-err_exit:
-	if (vpd_tend)
-		kfree(vpd_tend);
-	return err;
-}
-
-
 /**
  * txgbe_set_rxpba - Initialize Rx packet buffer
  * @hw: pointer to hardware structure
@@ -4269,6 +3930,7 @@ s32 txgbe_init_ops(struct txgbe_hw *hw)
 	phy->ops.setup_link_speed = txgbe_setup_phy_link_speed;
 	phy->ops.get_firmware_version = txgbe_get_phy_firmware_version;
 	phy->ops.read_i2c_byte = txgbe_read_i2c_byte;
+	phy->ops.read_i2c_block = txgbe_read_i2c_block;
 	phy->ops.write_i2c_byte = txgbe_write_i2c_byte;
 	phy->ops.read_i2c_sff8472 = txgbe_read_i2c_sff8472;
 	phy->ops.read_i2c_eeprom = txgbe_read_i2c_eeprom;
@@ -4339,6 +4001,14 @@ s32 txgbe_init_ops(struct txgbe_hw *hw)
 	mac->ops.setup_rxpba = txgbe_set_rxpba;
 	mac->mcft_size          = TXGBE_SP_MC_TBL_SIZE;
 	mac->vft_size           = TXGBE_SP_VFT_TBL_SIZE;
+	txgbe_reg_table_init(&mac->mta_tbl, TXGBE_PSR_MC_TBL(0),
+			     TXGBE_SP_MC_TBL_SIZE);
+	txgbe_reg_table_init(&mac->uta_tbl, TXGBE_PSR_UC_TBL(0),
+			     TXGBE_SP_UC_TBL_SIZE);
+	txgbe_reg_table_init(&mac->vft_tbl, TXGBE_PSR_VLAN_TBL(0),
+			     TXGBE_SP_VFT_TBL_SIZE);
+	txgbe_reg_table_init(&mac->reta_tbl, TXGBE_RDB_RSSTBL(0),
+			     TXGBE_SP_RSS_TBL_SIZE);
 	mac->num_rar_entries    = TXGBE_SP_RAR_ENTRIES;
 	mac->rx_pb_size         = TXGBE_SP_RX_PB_SIZE;
 	mac->max_rx_queues      = TXGBE_SP_MAX_RX_QUEUES;
@@ -5772,6 +5442,13 @@ s32 txgbe_reset_hw(struct txgbe_hw *hw)
 	struct txgbe_adapter *adapter = hw->back;
 	u32 value;
 
+	/* the reset clears the filter tables, write them in full next time */
+	txgbe_reg_table_forget(&hw->mac.mta_tbl);
+	txgbe_reg_table_forget(&hw->mac.uta_tbl);
+	txgbe_reg_table_forget(&hw->mac.vft_tbl);
+	txgbe_reg_table_forget(&hw->mac.reta_tbl);
+	hw->mac.vlvf.valid = false;
+
 	/* Call adapter stop to disable tx/rx and clear interrupts */
 	status = TCALL(hw, mac.ops.stop_adapter);
 	if (status != 0)
@@ -6305,19 +5982,16 @@ u32 txgbe_atr_compute_sig_hash(union txgbe_atr_hash_dword input,
 }
 
 /**
- *  txgbe_atr_add_signature_filter - Adds a signature hash filter
+ *  txgbe_fdir_write_signature - program a signature filter by its hash
  *  @hw: pointer to hardware structure
- *  @input: unique input dword
- *  @common: compressed common input dword
+ *  @flow_type: TXGBE_ATR_FLOW_TYPE_* of the flow
+ *  @sig_hash: txgbe_atr_compute_sig_hash() of the flow
  *  @queue: queue index to direct traffic to
  **/
-s32 txgbe_fdir_add_signature_filter(struct txgbe_hw *hw,
-					  union txgbe_atr_hash_dword input,
-					  union txgbe_atr_hash_dword common,
-					  u8 queue)
+s32 txgbe_fdir_write_signature(struct txgbe_hw *hw, u8 flow_type,
+			       u32 sig_hash, u8 queue)
 {
 	u32 fdirhashcmd = 0;
-	u8 flow_type;
 	u32 fdircmd;
 	s32 err;
 
@@ -6326,7 +6000,6 @@ s32 txgbe_fdir_add_signature_filter(struct txgbe_hw *hw,
 	 * lowest 2 bits are FDIRCMD.L4TYPE, third lowest bit is FDIRCMD.IPV6
 	 * fifth is FDIRCMD.TUNNEL_FILTER
 	 */
-	flow_type = input.formatted.flow_type;
 	switch (flow_type) {
 	case TXGBE_ATR_FLOW_TYPE_TCPV4:
 	case TXGBE_ATR_FLOW_TYPE_UDPV4:
@@ -6347,7 +6020,7 @@ s32 txgbe_fdir_add_signature_filter(struct txgbe_hw *hw,
 	fdircmd |= (u32)flow_type << TXGBE_RDB_FDIR_CMD_FLOW_TYPE_SHIFT;
 	fdircmd |= (u32)queue << TXGBE_RDB_FDIR_CMD_RX_QUEUE_SHIFT;
 
-	fdirhashcmd |= txgbe_atr_compute_sig_hash(input, common);
+	fdirhashcmd |= sig_hash;
 	fdirhashcmd |= 0x1 << TXGBE_RDB_FDIR_HASH_BUCKET_VALID_SHIFT;
 	wr32(hw, TXGBE_RDB_FDIR_HASH, fdirhashcmd);
 
@@ -6364,6 +6037,24 @@ s32 txgbe_fdir_add_signature_filter(struct txgbe_hw *hw,
 	return 0;
 }
 
+/**
+ *  txgbe_atr_add_signature_filter - Adds a signature hash filter
+ *  @hw: pointer to hardware structure
+ *  @input: unique input dword
+ *  @common: compressed common input dword
+ *  @queue: queue index to direct traffic to
+ **/
+s32 txgbe_fdir_add_signature_filter(struct txgbe_hw *hw,
+					  union txgbe_atr_hash_dword input,
+					  union txgbe_atr_hash_dword common,
+					  u8 queue)
+{
+	return txgbe_fdir_write_signature(hw, input.formatted.flow_type,
+					  txgbe_atr_compute_sig_hash(input,
+								     common),
+					  queue);
+}
+
 #define TXGBE_COMPUTE_BKT_HASH_ITERATION(_n) \
 do { \
 	u32 n = (_n); \
@@ -7064,6 +6755,14 @@ s32 txgbe_read_ee_hostif_buffer(struct txgbe_hw *hw,
 		DEBUGOUT("EEPROM read buffer - semaphore failed\n");
 		return status;
 	}
+
+	/* all chunks go out under one mailbox hold */
+	status = txgbe_hic_lock(hw);
+	if (status) {
+		DEBUGOUT("EEPROM read buffer - mailbox semaphore failed\n");
+		goto out;
+	}
+
 	while (words) {
 		if (words > FW_MAX_READ_BUFFER_SIZE / 2)
 			words_to_read = FW_MAX_READ_BUFFER_SIZE / 2;
@@ -7079,14 +6778,14 @@ s32 txgbe_read_ee_hostif_buffer(struct txgbe_hw *hw,
 		buffer.address = TXGBE_CPU_TO_BE32((offset + current_word) * 2);
 		buffer.length = TXGBE_CPU_TO_BE16(words_to_read * 2);
 
-		status = txgbe_host_interface_command(hw, (u32 *)&buffer,
-						      sizeof(buffer),
-						      TXGBE_HI_COMMAND_TIMEOUT,
-						      false);
+		status = __txgbe_host_interface_command(hw, (u32 *)&buffer,
+							sizeof(buffer),
+							TXGBE_HI_COMMAND_TIMEOUT,
+							false);
 
 		if (status) {
 			DEBUGOUT("Host interface command failed\n");
-			goto out;
+			goto out_unlock;
 		}
 
 		for (i = 0; i < words_to_read; i++) {
@@ -7096,7 +6795,7 @@ s32 txgbe_read_ee_hostif_buffer(struct txgbe_hw *hw,
 				value = rd32(hw, reg);
 			else {
 				status = TXGBE_ERR_MNG_ACCESS_FAILED;
-				return status;
+				goto out_unlock;
 			}
 			data[current_word] = (u16)(value & 0xffff);
 			current_word++;
@@ -7110,6 +6809,8 @@ s32 txgbe_read_ee_hostif_buffer(struct txgbe_hw *hw,
 		words -= words_to_read;
 	}
 
+out_unlock:
+	txgbe_hic_unlock(hw);
 out:
 	TCALL(hw, mac.ops.release_swfw_sync,
 		TXGBE_MNG_SWFW_SYNC_SW_FLASH);
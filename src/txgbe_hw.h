@@ -181,12 +181,16 @@ s32 txgbe_set_vmdq_san_mac(struct txgbe_hw *hw, u32 vmdq);
 s32 txgbe_clear_vmdq(struct txgbe_hw *hw, u32 rar, u32 vmdq);
 s32 txgbe_insert_mac_addr(struct txgbe_hw *hw, u8 *addr, u32 vmdq);
 s32 txgbe_init_uta_tables(struct txgbe_hw *hw);
+void txgbe_set_uta(struct txgbe_hw *hw, u8 *addr);
 s32 txgbe_set_vfta(struct txgbe_hw *hw, u32 vlan,
 			 u32 vind, bool vlan_on);
 s32 txgbe_set_vlvf(struct txgbe_hw *hw, u32 vlan, u32 vind,
 			   bool vlan_on, bool *vfta_changed);
 s32 txgbe_clear_vfta(struct txgbe_hw *hw);
 s32 txgbe_find_vlvf_slot(struct txgbe_hw *hw, u32 vlan);
+s32 txgbe_find_vlvf_entry(struct txgbe_hw *hw, u32 vlan);
+void txgbe_load_vlvf(struct txgbe_hw *hw);
+void txgbe_set_vlvf_pool(struct txgbe_hw *hw, u32 index, u32 vind, bool on);
 
 s32 txgbe_get_wwn_prefix(struct txgbe_hw *hw, u16 *wwnn_prefix,
 				 u16 *wwpn_prefix);
@@ -232,6 +236,8 @@ s32 txgbe_fdir_add_signature_filter(struct txgbe_hw *hw,
 					  union txgbe_atr_hash_dword input,
 					  union txgbe_atr_hash_dword common,
 					  u8 queue);
+s32 txgbe_fdir_write_signature(struct txgbe_hw *hw, u8 flow_type,
+			       u32 sig_hash, u8 queue);
 s32 txgbe_fdir_set_input_mask(struct txgbe_hw *hw,
 			union txgbe_atr_input *input_mask, bool cloud_mode);
 s32 txgbe_fdir_write_perfect_filter(struct txgbe_hw *hw,
@@ -285,8 +291,6 @@ s32 txgbe_calc_eeprom_checksum(struct txgbe_hw *hw);
 s32 txgbe_validate_eeprom_checksum(struct txgbe_hw *hw,
 					    u16 *checksum_val);
 s32 txgbe_update_flash(struct txgbe_hw *hw);
-int txgbe_upgrade_flash(struct txgbe_hw *hw, u32 region,
-								const u8 *data, u32 size);
 s32 txgbe_write_ee_hostif_buffer(struct txgbe_hw *hw,
 				u16 offset, u16 words, u16 *data);
 s32 txgbe_write_ee_hostif(struct txgbe_hw *hw, u16 offset,
@@ -312,6 +316,11 @@ s32 txgbe_set_link_to_kx(struct txgbe_hw *hw,
 			       u32 speed,
 			       bool autoneg);
 int txgbe_flash_read_dword(struct txgbe_hw *hw, u32 addr, u32 *data);
+int txgbe_flash_write_dword(struct txgbe_hw *hw, u32 addr, u32 dword);
+int txgbe_flash_program_dword(struct txgbe_hw *hw, u32 addr, u32 dword);
+int txgbe_flash_erase_sector(struct txgbe_hw *hw, u32 sec_addr);
+int txgbe_flash_usr_cmd(struct txgbe_hw *hw, u32 usr_cmd);
+int txgbe_flash_write_unlock(struct txgbe_hw *hw);
 s32 txgbe_hic_write_lldp(struct txgbe_hw *hw,u32 open);
 int txgbe_is_lldp(struct txgbe_hw *hw);
 s32 txgbe_set_sgmii_an37_ability(struct txgbe_hw *hw);
@@ -887,6 +887,10 @@ static int txgbe_alloc_q_vector(struct txgbe_adapter *adapter,
 	}
 
 #endif
+	/* without a policy CPU keep the vector next to the device */
+	if (node == -1)
+		node = dev_to_node(pci_dev_to_dev(adapter->pdev));
+
 	/* allocate q_vector and rings */
 	q_vector = kzalloc_node(size, GFP_KERNEL, node);
 	if (!q_vector)
@@ -39,6 +39,7 @@
 #include <linux/timekeeping.h>
 #include <linux/ktime.h>
 #include <linux/timer.h>
+#include <linux/kthread.h>
 #ifndef KTIME_ZERO
 #define KTIME_ZERO ((ktime_t)0)
 #endif
@@ -55,6 +56,7 @@
 
 #include <linux/if_bridge.h>
 #include "txgbe.h"
+#include "txgbe_devlink.h"
 #ifdef HAVE_SCTP
 #include <linux/sctp.h>
 #endif
@@ -94,6 +96,8 @@
 #include "txgbe_phy.h"
 #include "txgbe_pcierr.h"
 #include "txgbe_bp.h"
+#define CREATE_TRACE_POINTS
+#include "txgbe_trace.h"
 
 char txgbe_driver_name[32] = TXGBE_NAME;
 static const char txgbe_driver_string[] =
@@ -145,6 +149,8 @@ static const struct pci_device_id txgbe_pci_tbl[] = {
 };
 MODULE_DEVICE_TABLE(pci, txgbe_pci_tbl);
 
+static struct pci_driver txgbe_driver;
+
 
 MODULE_AUTHOR("Beijing WangXun Technology Co., Ltd, <linux.nic@trustnetic.com>");
 MODULE_DESCRIPTION("WangXun(R) 10 Gigabit PCI Express Network Driver");
@@ -247,6 +253,18 @@ MODULE_PARM_DESC(txgbe_tx_wthresh_safe,
 		"Use safe Tx descriptor write-back threshold for sensitive "
 		"platforms (default: 1 on LoongArch, 0 elsewhere)");
 
+int txgbe_vf_mbx_rate __read_mostly = TXGBE_DEFAULT_VF_MBX_RATE;
+module_param(txgbe_vf_mbx_rate, int, 0644);
+MODULE_PARM_DESC(txgbe_vf_mbx_rate,
+		"Maximum VF mailbox messages handled per second per VF, "
+		"excess is deferred (0=unlimited, default 2000)");
+
+int txgbe_sfp_dom_interval __read_mostly = TXGBE_DEFAULT_SFP_DOM_INTERVAL;
+module_param(txgbe_sfp_dom_interval, int, 0644);
+MODULE_PARM_DESC(txgbe_sfp_dom_interval,
+		"SFP DOM (temperature, Rx/Tx power) refresh interval in ms, run "
+		"from the service task (0=read on each ethtool -m, default 2000)");
+
 int txgbe_sfp_status_poll __read_mostly = 1;
 module_param(txgbe_sfp_status_poll, int, 0644);
 MODULE_PARM_DESC(txgbe_sfp_status_poll,
@@ -443,6 +461,31 @@ static void txgbe_service_event_schedule(struct txgbe_adapter *adapter)
 		queue_work(txgbe_wq, &adapter->service_task);
 }
 
+/**
+ * txgbe_service_event_kick - schedule the service task for an urgent event
+ * @adapter: board private structure
+ *
+ * Like txgbe_service_event_schedule(), but if a pass is already running
+ * it may be past the subtask that handles the event, so make sure another
+ * pass follows instead of leaving the event to the next service timer tick.
+ **/
+static void txgbe_service_event_kick(struct txgbe_adapter *adapter)
+{
+	if (test_bit(__TXGBE_DOWN, &adapter->state) ||
+	    test_bit(__TXGBE_REMOVING, &adapter->state))
+		return;
+
+	if (!test_and_set_bit(__TXGBE_SERVICE_SCHED, &adapter->state)) {
+		queue_work(txgbe_wq, &adapter->service_task);
+		return;
+	}
+
+	set_bit(__TXGBE_SERVICE_RERUN, &adapter->state);
+	/* pairs with txgbe_service_event_complete() */
+	smp_mb__after_atomic();
+	txgbe_service_event_schedule(adapter);
+}
+
 static void txgbe_service_event_complete(struct txgbe_adapter *adapter)
 {
 	BUG_ON(!test_bit(__TXGBE_SERVICE_SCHED, &adapter->state));
@@ -450,6 +493,53 @@ static void txgbe_service_event_complete(struct txgbe_adapter *adapter)
 	/* flush memory to make sure state is correct before next watchdog */
 	smp_mb__before_atomic();
 	clear_bit(__TXGBE_SERVICE_SCHED, &adapter->state);
+
+	smp_mb__after_atomic();
+	if (test_and_clear_bit(__TXGBE_SERVICE_RERUN, &adapter->state)) {
+		adapter->link_log.reruns++;
+		txgbe_service_event_schedule(adapter);
+	}
+}
+
+/**
+ * txgbe_link_event - timestamp a link or module event
+ * @adapter: board private structure
+ * @type: what happened
+ *
+ * Called from the misc interrupt and the service task.  Also measures the
+ * time from the first event after the carrier went down to carrier up.
+ **/
+static void txgbe_link_event(struct txgbe_adapter *adapter,
+			     enum txgbe_link_ev type)
+{
+	struct txgbe_link_log *log = &adapter->link_log;
+	u64 now = ktime_get_ns();
+	unsigned long flags;
+	u32 slot;
+
+	spin_lock_irqsave(&log->lock, flags);
+	slot = log->head++ % TXGBE_LINK_LOG_LEN;
+	log->ev[slot].ns = now;
+	log->ev[slot].type = type;
+
+	switch (type) {
+	case TXGBE_LINK_EV_CARRIER_UP:
+		if (log->pending_ns) {
+			log->last_up_us = (u32)div_u64(now - log->pending_ns,
+						       NSEC_PER_USEC);
+			log->max_up_us = max(log->max_up_us, log->last_up_us);
+		}
+		log->pending_ns = 0;
+		break;
+	case TXGBE_LINK_EV_CARRIER_DOWN:
+		log->pending_ns = 0;
+		break;
+	default:
+		if (!log->pending_ns)
+			log->pending_ns = now;
+		break;
+	}
+	spin_unlock_irqrestore(&log->lock, flags);
 }
 
 static void txgbe_remove_adapter(struct txgbe_hw *hw)
@@ -755,11 +845,41 @@ static void txgbe_tx_timeout_reset(struct txgbe_adapter *adapter)
 	    !test_bit(__TXGBE_RESETTING, &adapter->state) &&
 	    !test_bit(__TXGBE_REMOVING, &adapter->state)) {
 		adapter->flags2 |= TXGBE_FLAG2_PF_RESET_REQUESTED;
+		txgbe_trace(reset_step, adapter, TXGBE_TRACE_TX_TIMEOUT, -1);
 		e_warn(drv, "initiating reset due to tx timeout\n");
 		txgbe_service_event_schedule(adapter);
 	}
 }
 
+/**
+ * txgbe_tx_hang_restart - ask for a restart of a single hung Tx queue
+ * @adapter: driver private struct
+ * @tx_ring: the hung ring, its subqueue is already stopped
+ *
+ * First step of the Tx hang recovery: txgbe_tx_restart_subtask() flushes
+ * and reprograms only this ring, the other queues and the link stay up.
+ * XDP rings are fed from every Rx queue and a ring that hangs again within
+ * TXGBE_TX_RESTART_WINDOW of its last restart is not fixed by another one,
+ * both get the full reset instead.
+ *
+ * Returns true if the restart was scheduled.
+ **/
+static bool txgbe_tx_hang_restart(struct txgbe_adapter *adapter,
+				  struct txgbe_ring *tx_ring)
+{
+	if (ring_is_xdp(tx_ring) || !tx_ring->q_vector)
+		return false;
+
+	if (tx_ring->last_tx_restart &&
+	    time_before(jiffies, tx_ring->last_tx_restart +
+				 TXGBE_TX_RESTART_WINDOW))
+		return false;
+
+	set_bit(__TXGBE_TX_RESTART_REQ, &tx_ring->state);
+	txgbe_service_event_kick(adapter);
+	return true;
+}
+
 /**
  * txgbe_tx_timeout - Respond to a Tx Hang
  * @netdev: network interface device structure
@@ -850,11 +970,9 @@ static bool txgbe_clean_tx_irq(struct txgbe_q_vector *q_vector,
 			       struct txgbe_ring *tx_ring)
 {
 	struct txgbe_adapter *adapter = q_vector->adapter;
-	struct txgbe_tx_buffer *tx_buffer;
-	union txgbe_tx_desc *tx_desc;
 	unsigned int total_bytes = 0, total_packets = 0;
 	unsigned int budget = q_vector->tx.work_limit;
-	unsigned int i = tx_ring->next_to_clean;
+	unsigned int i;
 	u16 vid = 0;
 
 	if (test_bit(__TXGBE_DOWN, &adapter->state) ||
@@ -862,116 +980,22 @@ static bool txgbe_clean_tx_irq(struct txgbe_q_vector *q_vector,
 	    test_bit(__TXGBE_REMOVING, &adapter->state))
 		return true;
 
-	tx_buffer = &tx_ring->tx_buffer_info[i];
-	tx_desc = TXGBE_TX_DESC(tx_ring, i);
-	i -= tx_ring->count;
-
-	do {
-		union txgbe_tx_desc *eop_desc = tx_buffer->next_to_watch;
-
-		/* if next_to_watch is not set then there is no work pending */
-		if (!eop_desc)
-			break;
-
-		/* prevent any other reads prior to eop_desc */
-		smp_rmb();
-
-		/* if DD is not set pending work has not been completed */
-		if (!(eop_desc->wb.status & cpu_to_le32(TXGBE_TXD_STAT_DD)))
-			break;
-
-		/* clear next_to_watch to prevent false hangs */
-		tx_buffer->next_to_watch = NULL;
-
-		/* update the statistics for this packet */
-		total_bytes += tx_buffer->bytecount;
-		total_packets += tx_buffer->gso_segs;
-
-#ifdef HAVE_XDP_SUPPORT
-		if (ring_is_xdp(tx_ring))
-#ifdef HAVE_XDP_FRAME_STRUCT
-			xdp_return_frame(tx_buffer->xdpf);
-#else
-			page_frag_free(tx_buffer->data);
-#endif
-		else
-			dev_consume_skb_any(tx_buffer->skb);
-#else
-		/* free the skb */
-		dev_consume_skb_any(tx_buffer->skb);
-#endif
-
-		/* unmap skb header data */
-		dma_unmap_single(tx_ring->dev,
-				 dma_unmap_addr(tx_buffer, dma),
-				 dma_unmap_len(tx_buffer, len),
-				 DMA_TO_DEVICE);
-
-		/* clear tx_buffer data */
-#ifdef HAVE_XDP_SUPPORT
-		if (ring_is_xdp(tx_ring))
-#ifdef HAVE_XDP_FRAME_STRUCT
-			tx_buffer->xdpf = NULL;
-#else
-			tx_buffer->data = NULL;
-#endif
-		else
-#endif
-		tx_buffer->skb = NULL;
-		dma_unmap_len_set(tx_buffer, len, 0);
-
-		/* unmap remaining buffers */
-		while (tx_desc != eop_desc) {
-			tx_buffer++;
-			tx_desc++;
-			i++;
-			if (unlikely(!i)) {
-				i -= tx_ring->count;
-				tx_buffer = tx_ring->tx_buffer_info;
-				tx_desc = TXGBE_TX_DESC(tx_ring, 0);
-			}
-
-			/* unmap any remaining paged data */
-			if (dma_unmap_len(tx_buffer, len)) {
-				dma_unmap_page(tx_ring->dev,
-					       dma_unmap_addr(tx_buffer, dma),
-					       dma_unmap_len(tx_buffer, len),
-					       DMA_TO_DEVICE);
-				dma_unmap_len_set(tx_buffer, len, 0);
-			}
-		}
-
-		/* move us one more past the eop_desc for start of next pkt */
-		tx_buffer++;
-		tx_desc++;
-		i++;
-		if (unlikely(!i)) {
-			i -= tx_ring->count;
-			tx_buffer = tx_ring->tx_buffer_info;
-			tx_desc = TXGBE_TX_DESC(tx_ring, 0);
-		}
-
-		/* issue prefetch for next Tx descriptor */
-		prefetch(tx_desc);
-
-		/* update budget accounting */
-		budget--;
-	} while (likely(budget));
-
-	i += tx_ring->count;
-	tx_ring->next_to_clean = i;
-	u64_stats_update_begin(&tx_ring->syncp);
-	tx_ring->stats.bytes += total_bytes;
-	tx_ring->stats.packets += total_packets;
-	u64_stats_update_end(&tx_ring->syncp);
+	budget = txgbe_tx_reclaim(tx_ring, budget, &total_bytes,
+				  &total_packets);
+	i = tx_ring->next_to_clean;
 	q_vector->tx.total_bytes += total_bytes;
 	q_vector->tx.total_packets += total_packets;
+	txgbe_trace(clean_tx_irq, tx_ring, total_packets, total_bytes,
+		    q_vector->tx.work_limit);
 
 	if (check_for_tx_hang(tx_ring) && txgbe_check_tx_hang(tx_ring)) {
 	/* schedule immediate reset if we believe we hung */
 		struct txgbe_hw *hw = &adapter->hw;
 //		u16 value = 0;
 
+		txgbe_trace(reset_step, adapter, TXGBE_TRACE_TX_HANG,
+			    tx_ring->queue_index);
+
 		e_err(drv, "Detected Tx Unit Hang%s\n"
 			"  Tx Queue             <%d>\n"
 			"  TDH, TDT             <%x>, <%x>\n"
@@ -995,6 +1019,14 @@ static bool txgbe_clean_tx_irq(struct txgbe_q_vector *q_vector,
 		if (!ring_is_xdp(tx_ring))
 			netif_stop_subqueue(tx_ring->netdev, tx_ring->queue_index);
 
+		adapter->tx_hang_count++;
+		if (vid != TXGBE_FAILED_READ_CFG_WORD &&
+		    txgbe_tx_hang_restart(adapter, tx_ring)) {
+			e_info(probe, "tx hang detected on queue %d, "
+			       "restarting the queue\n", tx_ring->queue_index);
+			return true;
+		}
+
 		e_info(probe,
 		       "tx hang %d detected on queue %d, resetting adapter\n",
 			adapter->tx_timeout_count + 1, tx_ring->queue_index);
@@ -1039,6 +1071,7 @@ static bool txgbe_clean_tx_irq(struct txgbe_q_vector *q_vector,
 			netif_wake_subqueue(tx_ring->netdev,
 					    tx_ring->queue_index);
 			++tx_ring->tx_stats.restart_queue;
+			txgbe_trace(tx_queue_wake, tx_ring, TX_WAKE_THRESHOLD);
 		}
 #else
 		if (netif_queue_stopped(tx_ring->netdev) &&
@@ -1047,6 +1080,7 @@ static bool txgbe_clean_tx_irq(struct txgbe_q_vector *q_vector,
 		    !test_bit(__TXGBE_REMOVING, &adapter->state)) {
 			netif_wake_queue(tx_ring->netdev);
 			++tx_ring->tx_stats.restart_queue;
+			txgbe_trace(tx_queue_wake, tx_ring, TX_WAKE_THRESHOLD);
 		}
 #endif
 	}
@@ -1165,170 +1199,6 @@ static inline void txgbe_rx_checksum(struct txgbe_ring *ring,
 	ring->rx_stats.csum_good_cnt++;
 }
 
-static bool txgbe_alloc_mapped_skb(struct txgbe_ring *rx_ring,
-			struct txgbe_rx_buffer *bi)
-{
-	struct sk_buff *skb = bi->skb;
-	dma_addr_t dma = bi->dma;
-
-	if (unlikely(dma))
-		return true;
-
-	if (likely(!skb)) {
-		skb = netdev_alloc_skb_ip_align(rx_ring->netdev,
-						rx_ring->rx_buf_len);
-		if (unlikely(!skb)) {
-			rx_ring->rx_stats.alloc_rx_buff_failed++;
-			return false;
-		}
-
-		bi->skb = skb;
-
-	}
-
-	dma = dma_map_single(rx_ring->dev, skb->data,
-			     rx_ring->rx_buf_len, DMA_FROM_DEVICE);
-
-	/*
-	 * if mapping failed free memory back to system since
-	 * there isn't much point in holding memory we can't use
-	 */
-	if (dma_mapping_error(rx_ring->dev, dma)) {
-		dev_kfree_skb_any(skb);
-		bi->skb = NULL;
-
-		rx_ring->rx_stats.alloc_rx_buff_failed++;
-		return false;
-	}
-
-	bi->dma = dma;
-	return true;
-}
-
-#ifndef CONFIG_TXGBE_DISABLE_PACKET_SPLIT
-static bool txgbe_alloc_mapped_page(struct txgbe_ring *rx_ring,
-				    struct txgbe_rx_buffer *bi)
-{
-	struct page *page = bi->page;
-	dma_addr_t dma;
-
-	/* since we are recycling buffers we should seldom need to alloc */
-	if (likely(page))
-		return true;
-
-	/* alloc new page for storage */
-	page = dev_alloc_pages(txgbe_rx_pg_order(rx_ring));
-	if (unlikely(!page)) {
-		rx_ring->rx_stats.alloc_rx_page_failed++;
-		return false;
-	}
-
-	/* map page for use */
-	dma = dma_map_page(rx_ring->dev, page, 0,
-			   txgbe_rx_pg_size(rx_ring), DMA_FROM_DEVICE);
-
-	/*
-	 * if mapping failed free memory back to system since
-	 * there isn't much point in holding memory we can't use
-	 */
-	if (dma_mapping_error(rx_ring->dev, dma)) {
-		__free_pages(page, txgbe_rx_pg_order(rx_ring));
-
-		rx_ring->rx_stats.alloc_rx_page_failed++;
-		return false;
-	}
-
-	bi->page_dma = dma;
-	bi->page = page;
-	bi->page_offset = txgbe_rx_offset(rx_ring);
-#ifdef HAVE_PAGE_COUNT_BULK_UPDATE
-	page_ref_add(page, USHRT_MAX - 1);
-	bi->pagecnt_bias = USHRT_MAX;
-#else
-	bi->pagecnt_bias = 1;
-#endif
-	return true;
-}
-#endif
-
-/**
- * txgbe_alloc_rx_buffers - Replace used receive buffers
- * @rx_ring: ring to place buffers on
- * @cleaned_count: number of buffers to replace
- **/
-void txgbe_alloc_rx_buffers(struct txgbe_ring *rx_ring, u16 cleaned_count)
-{
-	union txgbe_rx_desc *rx_desc;
-	struct txgbe_rx_buffer *bi;
-	u16 i = rx_ring->next_to_use;
-
-	/* nothing to do */
-	if (!cleaned_count)
-		return;
-
-	rx_desc = TXGBE_RX_DESC(rx_ring, i);
-	bi = &rx_ring->rx_buffer_info[i];
-	i -= rx_ring->count;
-
-	do {
-#ifdef CONFIG_TXGBE_DISABLE_PACKET_SPLIT
-		if (!txgbe_alloc_mapped_skb(rx_ring, bi))
-			break;
-		rx_desc->read.pkt_addr = cpu_to_le64(bi->dma);
-
-#else
-		if (ring_is_hs_enabled(rx_ring)) {
-			if (!txgbe_alloc_mapped_skb(rx_ring, bi))
-				break;
-			rx_desc->read.hdr_addr = cpu_to_le64(bi->dma);
-		}
-
-		if (!txgbe_alloc_mapped_page(rx_ring, bi))
-			break;
-
-		/* sync the buffer for use by the device */
-		dma_sync_single_range_for_device(rx_ring->dev, bi->page_dma,
-						bi->page_offset,
-						txgbe_rx_bufsz(rx_ring),
-						DMA_FROM_DEVICE);
-
-		rx_desc->read.pkt_addr =
-			cpu_to_le64(bi->page_dma + bi->page_offset);
-#endif
-
-		rx_desc++;
-		bi++;
-		i++;
-		if (unlikely(!i)) {
-			rx_desc = TXGBE_RX_DESC(rx_ring, 0);
-			bi = rx_ring->rx_buffer_info;
-			i -= rx_ring->count;
-		}
-
-		/* clear the status bits for the next_to_use descriptor */
-		rx_desc->wb.upper.status_error = 0;
-
-		cleaned_count--;
-	} while (cleaned_count);
-
-	i += rx_ring->count;
-
-	if (rx_ring->next_to_use != i) {
-		rx_ring->next_to_use = i;
-#ifndef CONFIG_TXGBE_DISABLE_PACKET_SPLIT
-		/* update next to alloc since we have filled the ring */
-		rx_ring->next_to_alloc = i;
-#endif
-		/* Force memory writes to complete before letting h/w
-		 * know there are new descriptors to fetch.  (Only
-		 * applicable for weak-ordered memory model archs,
-		 * such as IA-64).
-		 */
-		wmb();
-		writel(i, rx_ring->tail);
-	}
-}
-
 static inline u16 txgbe_get_hlen(struct txgbe_ring *rx_ring,
 				 union txgbe_rx_desc *rx_desc)
 {
@@ -1827,18 +1697,108 @@ static void txgbe_lro_receive(struct txgbe_q_vector *q_vector,
 #endif /* TXGBE_NO_LRO */
 #ifdef NETIF_F_GSO
 static void txgbe_set_rsc_gso_size(struct txgbe_ring __maybe_unused *ring,
+				   union txgbe_rx_desc *rx_desc,
 				   struct sk_buff *skb)
 {
+	txgbe_dptype dptype = decode_rx_desc_ptype(rx_desc);
 	u16 hdr_len = eth_get_headlen(skb->dev, skb->data, skb_headlen(skb));
 
 	/* set gso_size to avoid messing up TCP MSS */
 	skb_shinfo(skb)->gso_size = DIV_ROUND_UP((skb->len - hdr_len),
 						 TXGBE_CB(skb)->append_cnt);
-	skb_shinfo(skb)->gso_type = SKB_GSO_TCPV4;
+	if (dptype.ip == TXGBE_DEC_PTYPE_IP_IPV6)
+		skb_shinfo(skb)->gso_type = SKB_GSO_TCPV6;
+	else
+		skb_shinfo(skb)->gso_type = SKB_GSO_TCPV4;
 }
 
 #endif /* NETIF_F_GSO */
+#ifdef NETIF_F_GRO_HW
+/**
+ * txgbe_rsc_gro_fixup - make an RSC frame look like a GRO built skb
+ * @rx_ring: rx descriptor ring the frame was received on
+ * @rx_desc: EOP Rx descriptor of the coalesced frame
+ * @skb: coalesced frame, skb->data still pointing at the MAC header
+ *
+ * With NETIF_F_GRO_HW the stack may forward or re-segment the frame, so
+ * it has to carry the same state tcp_gro_complete() would leave behind:
+ * transport header, pseudo header checksum, CHECKSUM_PARTIAL and a
+ * gso_segs count.  Frames with VLAN tags still in the payload (Rx VLAN
+ * stripping off) are handled as well as IPv4 and IPv6.
+ **/
+static void txgbe_rsc_gro_fixup(struct txgbe_ring *rx_ring,
+				union txgbe_rx_desc *rx_desc,
+				struct sk_buff *skb)
+{
+	txgbe_dptype dptype = decode_rx_desc_ptype(rx_desc);
+	unsigned int nhoff = ETH_HLEN;
+	unsigned int thoff;
+	unsigned int payload;
+	struct tcphdr *th;
+	__be16 proto;
+
+	if (!(rx_ring->netdev->features & NETIF_F_GRO_HW))
+		return;
+
+	/* only plain TCP frames with a verified checksum are converted */
+	if (skb->ip_summed != CHECKSUM_UNNECESSARY ||
+	    dptype.etype != TXGBE_DEC_PTYPE_ETYPE_NONE ||
+	    dptype.prot != TXGBE_DEC_PTYPE_PROT_TCP)
+		return;
+
+	proto = ((struct ethhdr *)skb->data)->h_proto;
+	while (proto == htons(ETH_P_8021Q) || proto == htons(ETH_P_8021AD)) {
+		if (skb_headlen(skb) < nhoff + VLAN_HLEN)
+			return;
+		proto = ((struct vlan_hdr *)(skb->data + nhoff))->
+			h_vlan_encapsulated_proto;
+		nhoff += VLAN_HLEN;
+	}
+
+	if (proto == htons(ETH_P_IP)) {
+		struct iphdr *iph = (struct iphdr *)(skb->data + nhoff);
+
+		if (skb_headlen(skb) < nhoff + sizeof(struct iphdr))
+			return;
+		thoff = nhoff + (iph->ihl << 2);
+		if (skb_headlen(skb) < thoff + sizeof(struct tcphdr))
+			return;
+		th = (struct tcphdr *)(skb->data + thoff);
+		th->check = ~tcp_v4_check(skb->len - thoff,
+					  iph->saddr, iph->daddr, 0);
+	} else if (proto == htons(ETH_P_IPV6)) {
+		struct ipv6hdr *ip6h = (struct ipv6hdr *)(skb->data + nhoff);
+
+		thoff = nhoff + sizeof(struct ipv6hdr);
+		if (skb_headlen(skb) < thoff + sizeof(struct tcphdr) ||
+		    ip6h->nexthdr != IPPROTO_TCP)
+			return;
+		th = (struct tcphdr *)(skb->data + thoff);
+		th->check = ~tcp_v6_check(skb->len - thoff,
+					  &ip6h->saddr, &ip6h->daddr, 0);
+	} else {
+		return;
+	}
+
+	payload = skb->len - thoff - (th->doff << 2);
+
+	skb_set_network_header(skb, nhoff);
+	skb_set_transport_header(skb, thoff);
+	skb->csum_start = skb_transport_header(skb) - skb->head;
+	skb->csum_offset = offsetof(struct tcphdr, check);
+	skb->ip_summed = CHECKSUM_PARTIAL;
+
+	skb_shinfo(skb)->gso_segs = DIV_ROUND_UP(payload,
+						 skb_shinfo(skb)->gso_size);
+	if (th->cwr)
+		skb_shinfo(skb)->gso_type |= SKB_GSO_TCP_ECN;
+
+	rx_ring->rx_stats.rsc_gro_hw++;
+}
+
+#endif /* NETIF_F_GRO_HW */
 static void txgbe_update_rsc_stats(struct txgbe_ring *rx_ring,
+				   union txgbe_rx_desc *rx_desc,
 				   struct sk_buff *skb)
 {
 	/* if append_cnt is 0 then frame is not RSC */
@@ -1849,7 +1809,7 @@ static void txgbe_update_rsc_stats(struct txgbe_ring *rx_ring,
 	rx_ring->rx_stats.rsc_flush++;
 
 #ifdef NETIF_F_GSO
-	txgbe_set_rsc_gso_size(rx_ring, skb);
+	txgbe_set_rsc_gso_size(rx_ring, rx_desc, skb);
 
 #endif
 	/* gso_size is computed using append_cnt so always clear it last */
@@ -1909,13 +1869,17 @@ void txgbe_process_skb_fields(struct txgbe_ring *rx_ring,
 	u32 flags = rx_ring->q_vector->adapter->flags;
 #endif /* HAVE_PTP_1588_CLOCK */
 
-	txgbe_update_rsc_stats(rx_ring, skb);
+	txgbe_update_rsc_stats(rx_ring, rx_desc, skb);
 
 #ifdef NETIF_F_RXHASH
 	txgbe_rx_hash(rx_ring, rx_desc, skb);
 #endif /* NETIF_F_RXHASH */
 
 	txgbe_rx_checksum(rx_ring, rx_desc, skb);
+#ifdef NETIF_F_GRO_HW
+	if (skb_is_gso(skb))
+		txgbe_rsc_gro_fixup(rx_ring, rx_desc, skb);
+#endif
 #ifdef HAVE_PTP_1588_CLOCK
 	if (unlikely(flags & TXGBE_FLAG_RX_HWTSTAMP_ENABLED) &&
 		unlikely(txgbe_test_staterr(rx_desc, TXGBE_RXD_STAT_TS))) {
@@ -2946,6 +2910,8 @@ static int txgbe_clean_rx_irq(struct txgbe_q_vector *q_vector,
 	u64_stats_update_end(&rx_ring->syncp);
 	q_vector->rx.total_packets += total_rx_packets;
 	q_vector->rx.total_bytes += total_rx_bytes;
+	txgbe_trace(clean_rx_irq, rx_ring, total_rx_packets, total_rx_bytes,
+		    budget);
 
 #ifndef TXGBE_NO_LRO
 	txgbe_lro_flush_all(q_vector);
@@ -3104,6 +3070,8 @@ static int txgbe_clean_rx_irq(struct txgbe_q_vector *q_vector,
 	u64_stats_update_end(&rx_ring->syncp);
 	q_vector->rx.total_packets += total_rx_packets;
 	q_vector->rx.total_bytes += total_rx_bytes;
+	txgbe_trace(clean_rx_irq, rx_ring, total_rx_packets, total_rx_bytes,
+		    budget);
 
 	if (cleaned_count)
 		txgbe_alloc_rx_buffers(rx_ring, cleaned_count);
@@ -3116,6 +3084,14 @@ static int txgbe_clean_rx_irq(struct txgbe_q_vector *q_vector,
 }
 
 #endif /* CONFIG_TXGBE_DISABLE_PACKET_SPLIT */
+/* account a poll that started at @start, see txgbe_poll() */
+static void txgbe_poll_account(struct txgbe_q_vector *q_vector,
+			       enum txgbe_poll_ctx ctx, u64 start)
+{
+	q_vector->polls[ctx]++;
+	q_vector->poll_ns[ctx] += local_clock() - start;
+}
+
 #ifdef HAVE_NDO_BUSY_POLL
 /* must be called with local_bh_disable()d */
 static int txgbe_busy_poll_recv(struct napi_struct *napi)
@@ -3124,7 +3100,9 @@ static int txgbe_busy_poll_recv(struct napi_struct *napi)
 			container_of(napi, struct txgbe_q_vector, napi);
 	struct txgbe_adapter *adapter = q_vector->adapter;
 	struct txgbe_ring  *ring;
+	u64 start = 0;
 	int found = 0;
+	bool stats;
 
 	if (test_bit(__TXGBE_DOWN, &adapter->state))
 		return LL_FLUSH_FAILED;
@@ -3132,6 +3110,10 @@ static int txgbe_busy_poll_recv(struct napi_struct *napi)
 	if (!txgbe_qv_lock_poll(q_vector))
 		return LL_FLUSH_BUSY;
 
+	stats = READ_ONCE(adapter->napi_poll_stats);
+	if (stats)
+		start = local_clock();
+
 	txgbe_for_each_ring(ring, q_vector->rx) {
 		found = txgbe_clean_rx_irq(q_vector, ring, 4);
 #ifdef BP_EXTENDED_STATS
@@ -3144,6 +3126,8 @@ static int txgbe_busy_poll_recv(struct napi_struct *napi)
 			break;
 	}
 
+	if (stats)
+		txgbe_poll_account(q_vector, TXGBE_POLL_BUSY, start);
 	txgbe_qv_unlock_poll(q_vector);
 
 	return found;
@@ -3177,6 +3161,10 @@ static void txgbe_configure_msix(struct txgbe_adapter *adapter)
 		struct txgbe_q_vector *q_vector = adapter->q_vector[v_idx];
 		struct txgbe_ring *ring;
 
+		/* every vector starts unfolded, see txgbe_vpack_subtask() */
+		WRITE_ONCE(q_vector->vpack_host, NULL);
+		q_vector->vpack_guests = 0;
+
 		txgbe_for_each_ring(ring, q_vector->rx)
 			txgbe_set_ivar(adapter, 0, ring->reg_idx, v_idx);
 
@@ -3314,6 +3302,8 @@ static void txgbe_set_itr(struct txgbe_q_vector *q_vector)
 		new_itr = (10 * new_itr * q_vector->itr) /
 			  ((9 * new_itr) + q_vector->itr);
 
+		txgbe_trace(set_itr, q_vector, q_vector->itr, new_itr);
+
 		/* save the algorithm value here */
 		q_vector->itr = new_itr;
 
@@ -3422,13 +3412,15 @@ static void txgbe_check_sfp_event(struct txgbe_adapter *adapter, u32 eicr)
 				wr32(hw, TXGBE_GPIO_EOI,
 						TXGBE_GPIO_EOI_2);
 				adapter->sfp_poll_time = 0;
-				txgbe_service_event_schedule(adapter);
+				txgbe_link_event(adapter, TXGBE_LINK_EV_MODULE);
+				txgbe_service_event_kick(adapter);
 			} 
 			if (reg & TXGBE_GPIO_INTSTATUS_3) {
 				adapter->flags |= TXGBE_FLAG_NEED_LINK_CONFIG;
 				wr32(hw, TXGBE_GPIO_EOI,
 						TXGBE_GPIO_EOI_3);
-				txgbe_service_event_schedule(adapter);
+				txgbe_link_event(adapter, TXGBE_LINK_EV_GPIO);
+				txgbe_service_event_kick(adapter);
 			}
 
 			if (reg & TXGBE_GPIO_INTSTATUS_6) {
@@ -3436,7 +3428,8 @@ static void txgbe_check_sfp_event(struct txgbe_adapter *adapter, u32 eicr)
 						TXGBE_GPIO_EOI_6);
 				adapter->flags |=
 					TXGBE_FLAG_NEED_LINK_CONFIG;
-				txgbe_service_event_schedule(adapter);
+				txgbe_link_event(adapter, TXGBE_LINK_EV_GPIO);
+				txgbe_service_event_kick(adapter);
 			}
 			wr32(hw, TXGBE_GPIO_INTMASK, 0x0);
 		}
@@ -3448,9 +3441,8 @@ static void txgbe_check_lsc(struct txgbe_adapter *adapter)
 	adapter->lsc_int++;
 	adapter->flags |= TXGBE_FLAG_NEED_LINK_UPDATE;
 	adapter->link_check_timeout = jiffies;
-	if (!test_bit(__TXGBE_DOWN, &adapter->state)) {
-		txgbe_service_event_schedule(adapter);
-	}
+	txgbe_link_event(adapter, TXGBE_LINK_EV_LSC);
+	txgbe_service_event_kick(adapter);
 }
 
 /**
@@ -3543,7 +3535,10 @@ static irqreturn_t txgbe_msix_other(int __always_unused irq, void *data)
 	}
 
 	if (eicr & TXGBE_PX_MISC_IC_VF_MBOX)
-		txgbe_msg_task(adapter);
+		txgbe_schedule_msg_task(adapter);
+
+	if (eicr & TXGBE_PX_MISC_IC_MNG_HOST_MBOX)
+		txgbe_hic_event(&adapter->hic);
 
 	if (eicr & TXGBE_PX_MISC_IC_PCIE_REQ_ERR) {
 		ERROR_REPORT1(TXGBE_ERROR_POLLING,
@@ -3601,8 +3596,10 @@ static irqreturn_t txgbe_msix_other(int __always_unused irq, void *data)
 	txgbe_check_overtemp_event(adapter, eicr);
 
 #ifdef HAVE_PTP_1588_CLOCK
-	if (unlikely(eicr & TXGBE_PX_MISC_IC_TIMESYNC))
+	if (unlikely(eicr & TXGBE_PX_MISC_IC_TIMESYNC)) {
 		txgbe_ptp_check_pps_event(adapter);
+		txgbe_ptp_check_tx_event(adapter);
+	}
 #endif
 
 	/* re-enable the original interrupt state, no lsc, no queues */
@@ -3614,32 +3611,187 @@ static irqreturn_t txgbe_msix_other(int __always_unused irq, void *data)
 	return IRQ_HANDLED;
 }
 
+#ifndef HAVE_DEV_SET_THREADED
+/**
+ * txgbe_qv_thread_schedule - hand a poll of a vector to its NAPI thread
+ * @q_vector: vector to poll
+ *
+ * Only posts the request, the thread takes the NAPI context itself.  A
+ * request made while the thread is polling just makes it poll again,
+ * where napi_schedule_prep() would mark the context missed and have
+ * napi_complete_done() move the next poll to softirq.  Every schedule of
+ * a vector with a driver thread must come through here.
+ *
+ * Returns false if the vector has no driver thread and is polled from
+ * softirq, see txgbe_napi_thread().
+ **/
+bool txgbe_qv_thread_schedule(struct txgbe_q_vector *q_vector)
+{
+	struct task_struct *thread = READ_ONCE(q_vector->poll_thread);
+
+	if (!thread)
+		return false;
+
+	if (!test_and_set_bit(0, &q_vector->poll_thread_sched))
+		wake_up_process(thread);
+
+	return true;
+}
+
+#endif /* !HAVE_DEV_SET_THREADED */
 static irqreturn_t txgbe_msix_clean_rings(int __always_unused irq, void *data)
 {
 	struct txgbe_q_vector *q_vector = data;
 
 	/* EIAM disabled interrupts (on this vector) for us */
 
-	if (q_vector->rx.ring || q_vector->tx.ring)
-		napi_schedule_irqoff(&q_vector->napi);
+	if (!q_vector->rx.ring && !q_vector->tx.ring)
+		return IRQ_HANDLED;
+
+#ifndef HAVE_DEV_SET_THREADED
+	if (txgbe_qv_thread_schedule(q_vector))
+		return IRQ_HANDLED;
+#endif
+	napi_schedule_irqoff(&q_vector->napi);
 
 	return IRQ_HANDLED;
 }
 
 /**
- * txgbe_poll - NAPI polling RX/TX cleanup routine
- * @napi: napi struct with our devices info in it
- * @budget: amount of work driver is allowed to do this pass, in packets
+ * txgbe_rx_pressure - sample the fill level of an Rx ring after a clean
+ * @ring: Rx ring that was just cleaned
+ * @unused: txgbe_desc_unused() of the ring before the clean
+ * @ntc: next_to_clean before the clean
  *
- * This function will clean all queues associated with a q_vector.
+ * The fill level is the number of descriptors the hardware cannot write
+ * into: completions not cleaned yet plus buffers not given back yet.  When
+ * it reaches the ring size the next frame is dropped for lack of buffers.
+ *
+ * No register is read.  The level at the start of the poll is estimated
+ * as the descriptors unused then plus those the clean went through.
+ * Whether the ring is still over the threshold afterwards is exact: it
+ * only takes the one descriptor the hardware must have written back for
+ * that to be true, and its done bit is in host memory.  Crossing the
+ * threshold in either direction emits the txgbe_rx_pressure tracepoint,
+ * falling back below it only once the level is a quarter below.
  **/
-int txgbe_poll(struct napi_struct *napi, int budget)
+static void txgbe_rx_pressure(struct txgbe_ring *ring, u16 unused, u16 ntc)
 {
-	struct txgbe_q_vector *q_vector =
-			       container_of(napi, struct txgbe_q_vector, napi);
-	struct txgbe_adapter *adapter = q_vector->adapter;
-	struct txgbe_ring *ring;
-	int per_ring_budget;
+	struct txgbe_rx_queue_stats *stats = &ring->rx_stats;
+	u16 thresh = ring->pressure_thresh;
+	u16 fill, posted, need;
+	union txgbe_rx_desc *rx_desc;
+	bool over;
+
+	if (!thresh)
+		return;
+
+	fill = unused + (ring->next_to_clean >= ntc ? 0 : ring->count) +
+	       ring->next_to_clean - ntc;
+
+	unused = txgbe_desc_unused(ring);
+	posted = ring->count - 1 - unused;
+	if (unused >= thresh) {
+		over = true;
+	} else {
+		need = thresh - unused;
+		over = false;
+		if (need <= posted) {
+			ntc = ring->next_to_clean + need - 1;
+			if (ntc >= ring->count)
+				ntc -= ring->count;
+			rx_desc = TXGBE_RX_DESC(ring, ntc);
+			/* the AF_XDP refill clears only the length */
+			over = txgbe_test_staterr(rx_desc, TXGBE_RXD_STAT_DD) &&
+			       rx_desc->wb.upper.length;
+		}
+	}
+	if (over)
+		fill = max(fill, thresh);
+
+	if (fill > stats->fill_hwm)
+		stats->fill_hwm = fill;
+	if (fill > READ_ONCE(stats->fill_intvl))
+		WRITE_ONCE(stats->fill_intvl, fill);
+
+	if (test_bit(__TXGBE_RX_PRESSURE, &ring->state)) {
+		if (over || fill >= thresh - thresh / 4)
+			return;
+		clear_bit(__TXGBE_RX_PRESSURE, &ring->state);
+	} else {
+		if (!over && fill < thresh)
+			return;
+		set_bit(__TXGBE_RX_PRESSURE, &ring->state);
+		stats->pressure_events++;
+		over = true;
+	}
+	txgbe_trace(rx_pressure, ring, fill, thresh, over);
+}
+
+/**
+ * txgbe_set_rx_pressure - set the Rx ring pressure threshold
+ * @adapter: board private structure
+ * @pct: fill level in percent of the ring, 0 turns sampling off
+ *
+ * Also restarts the per-ring high watermarks.
+ **/
+void txgbe_set_rx_pressure(struct txgbe_adapter *adapter, u32 pct)
+{
+	int i;
+
+	adapter->rx_pressure_pct = min_t(u32, pct, 100);
+	for (i = 0; i < adapter->num_rx_queues; i++) {
+		struct txgbe_ring *ring = adapter->rx_ring[i];
+
+		if (!ring)
+			continue;
+		ring->pressure_thresh = (ring->count - 1) *
+					adapter->rx_pressure_pct / 100;
+		ring->rx_stats.fill_hwm = 0;
+		WRITE_ONCE(ring->rx_stats.fill_intvl, 0);
+		clear_bit(__TXGBE_RX_PRESSURE, &ring->state);
+	}
+}
+
+/**
+ * txgbe_vpack_poll_guests - schedule the vectors folded onto this one
+ * @q_vector: host vector being polled
+ *
+ * Each folded vector keeps its own NAPI context, so its rings are still
+ * only cleaned by it and it runs right after this one on the same CPU.
+ **/
+static void txgbe_vpack_poll_guests(struct txgbe_q_vector *q_vector)
+{
+	struct txgbe_adapter *adapter = q_vector->adapter;
+	int i;
+
+	for (i = 0; i < adapter->num_q_vectors; i++) {
+		struct txgbe_q_vector *guest = adapter->q_vector[i];
+
+		if (READ_ONCE(guest->vpack_host) != q_vector)
+			continue;
+#ifndef HAVE_DEV_SET_THREADED
+		if (txgbe_qv_thread_schedule(guest))
+			continue;
+#endif
+		napi_schedule(&guest->napi);
+	}
+}
+
+/**
+ * __txgbe_poll - NAPI polling RX/TX cleanup routine
+ * @napi: napi struct with our devices info in it
+ * @budget: amount of work driver is allowed to do this pass, in packets
+ *
+ * This function will clean all queues associated with a q_vector.
+ **/
+static int __txgbe_poll(struct napi_struct *napi, int budget)
+{
+	struct txgbe_q_vector *q_vector =
+			       container_of(napi, struct txgbe_q_vector, napi);
+	struct txgbe_adapter *adapter = q_vector->adapter;
+	struct txgbe_ring *ring;
+	int per_ring_budget;
 	int work_done = 0;
 	bool clean_complete = true;
 
@@ -3648,6 +3800,12 @@ int txgbe_poll(struct napi_struct *napi, int budget)
 		txgbe_update_tph(q_vector);
 #endif
 
+	txgbe_trace(napi_poll_enter, q_vector, budget);
+
+	/* the queues of folded vectors interrupt this one */
+	if (unlikely(q_vector->vpack_guests))
+		txgbe_vpack_poll_guests(q_vector);
+
 	txgbe_for_each_ring(ring, q_vector->tx) {
 #ifdef HAVE_AF_XDP_ZC_SUPPORT
 		bool wd = ring->xsk_pool ?
@@ -3661,15 +3819,17 @@ int txgbe_poll(struct napi_struct *napi, int budget)
 	}
 
 #ifdef HAVE_NDO_BUSY_POLL
-	if (test_bit(NAPI_STATE_NPSVC, &napi->state))
-		return budget;
-
-	if (!txgbe_qv_lock_napi(q_vector))
-		return budget;
+	if (test_bit(NAPI_STATE_NPSVC, &napi->state) ||
+	    !txgbe_qv_lock_napi(q_vector)) {
+		clean_complete = false;
+		goto out;
+	}
 #endif
 	/* Exit if we are called by netpoll */
-	if (budget <= 0)
-		return budget;
+	if (budget <= 0) {
+		clean_complete = false;
+		goto out;
+	}
 
 	/* attempt to distribute budget to each queue fairly, but don't allow
 	 * the budget to go below 1 because we'll exit polling */
@@ -3679,6 +3839,8 @@ int txgbe_poll(struct napi_struct *napi, int budget)
 		per_ring_budget = budget;
 
 	txgbe_for_each_ring(ring, q_vector->rx) {
+		u16 unused = txgbe_desc_unused(ring);
+		u16 ntc = ring->next_to_clean;
 #ifdef HAVE_AF_XDP_ZC_SUPPORT
 		int cleaned = ring->xsk_pool ?
 			      txgbe_clean_rx_irq_zc(q_vector, ring,
@@ -3690,6 +3852,7 @@ int txgbe_poll(struct napi_struct *napi, int budget)
 						 per_ring_budget);
 #endif /* HAVE_AF_XDP_ZC_SUPPORT */
 
+		txgbe_rx_pressure(ring, unused, ntc);
 		work_done += cleaned;
 		if (cleaned >= per_ring_budget)
 			clean_complete = false;
@@ -3703,6 +3866,10 @@ int txgbe_poll(struct napi_struct *napi, int budget)
 		clean_complete = true;
 
 #endif
+out:
+	txgbe_trace(napi_poll_exit, q_vector, budget, work_done,
+		    clean_complete);
+
 	/* If all work not completed, return budget and keep polling */
 	if (!clean_complete)
 		return budget;
@@ -3721,6 +3888,117 @@ int txgbe_poll(struct napi_struct *napi, int budget)
 	return 0;
 }
 
+/**
+ * txgbe_poll - NAPI poll routine of a q_vector
+ * @napi: napi struct with our devices info in it
+ * @budget: amount of work driver is allowed to do this pass, in packets
+ *
+ * While enabled through debugfs "napi", accounts the time of each poll to
+ * the context it ran in: softirq, a NAPI thread, or a task busy polling.
+ * The legacy ndo_busy_poll path does the same in txgbe_busy_poll_recv().
+ **/
+int txgbe_poll(struct napi_struct *napi, int budget)
+{
+	struct txgbe_q_vector *q_vector =
+			       container_of(napi, struct txgbe_q_vector, napi);
+	enum txgbe_poll_ctx ctx;
+	int work_done;
+	u64 start;
+
+	if (!READ_ONCE(q_vector->adapter->napi_poll_stats))
+		return __txgbe_poll(napi, budget);
+
+	start = local_clock();
+	work_done = __txgbe_poll(napi, budget);
+
+	if (in_serving_softirq())
+		ctx = TXGBE_POLL_SOFTIRQ;
+	else if (current->flags & PF_KTHREAD)
+		ctx = TXGBE_POLL_THREAD;
+	else
+		ctx = TXGBE_POLL_BUSY;
+	txgbe_poll_account(q_vector, ctx, start);
+
+	return work_done;
+}
+
+#ifdef HAVE_IRQ_AFFINITY_NOTIFY
+/**
+ * txgbe_cpumask_to_node - NUMA node shared by every CPU in a mask
+ * @mask: IRQ affinity mask
+ *
+ * Returns NUMA_NO_NODE when the mask spans several nodes.
+ **/
+static int txgbe_cpumask_to_node(const cpumask_t *mask)
+{
+	int node = NUMA_NO_NODE;
+	int cpu;
+
+	for_each_cpu(cpu, mask) {
+		if (node == NUMA_NO_NODE)
+			node = cpu_to_node(cpu);
+		else if (node != cpu_to_node(cpu))
+			return NUMA_NO_NODE;
+	}
+
+	return node;
+}
+
+/**
+ * txgbe_irq_affinity_notify - re-pin q_vector state to a new IRQ affinity
+ * @notify: notifier embedded in the q_vector
+ * @mask: new affinity of the vector IRQ
+ *
+ * Runs from a workqueue whenever an operator or irqbalance moves the
+ * vector IRQ.  The affinity hint moves along with it and TPH/DCA steering
+ * is reprogrammed on the next poll.  The XPS map of the vector's Tx rings
+ * needs rtnl, so it is rewritten by txgbe_xps_subtask(); that keeps the
+ * sending CPU, Tx completions and the ATR-steered Rx queue on the same
+ * core.  Ring memory follows on the next reinit, see
+ * txgbe_migrate_rings_numa().
+ **/
+static void txgbe_irq_affinity_notify(struct irq_affinity_notify *notify,
+				      const cpumask_t *mask)
+{
+	struct txgbe_q_vector *q_vector =
+		container_of(notify, struct txgbe_q_vector, affinity_notify);
+	struct txgbe_adapter *adapter = q_vector->adapter;
+	struct txgbe_ring *ring;
+
+	if (cpumask_empty(mask))
+		return;
+
+#ifdef HAVE_IRQ_AFFINITY_HINT
+	cpumask_copy(&q_vector->affinity_mask, mask);
+#endif
+	q_vector->numa_node = txgbe_cpumask_to_node(mask);
+	/* the last CPU TPH was programmed for, see txgbe_update_tph() */
+	q_vector->cpu = -1;
+	q_vector->affinity_moves++;
+	/* the NAPI thread follows, see txgbe_napi_thread_subtask() */
+	WRITE_ONCE(q_vector->napi_thread_applied, NULL);
+
+	/* XPS follows, see txgbe_xps_subtask() */
+	txgbe_for_each_ring(ring, q_vector->tx) {
+		if (ring_is_xdp(ring))
+			continue;
+		clear_bit(__TXGBE_TX_XPS_INIT_DONE, &ring->state);
+	}
+	txgbe_service_event_schedule(adapter);
+
+	if (txgbe_perf_diag)
+		dev_info(pci_dev_to_dev(adapter->pdev),
+			 "%s: q_vector=%u affinity moved, cpu=%u numa_node=%d\n",
+			 netdev_name(adapter->netdev), q_vector->v_idx,
+			 cpumask_first(mask), q_vector->numa_node);
+}
+
+/* the notifier is embedded in the q_vector, nothing to release */
+static void txgbe_irq_affinity_release(struct kref __always_unused *ref)
+{
+}
+
+#endif /* HAVE_IRQ_AFFINITY_NOTIFY */
 /**
  * txgbe_request_msix_irqs - Initialize MSI-X interrupts
  * @adapter: board private structure
@@ -3760,6 +4038,12 @@ static int txgbe_request_msix_irqs(struct txgbe_adapter *adapter)
 			      " '%s' Error: %d\n", q_vector->name, err);
 			goto free_queue_irqs;
 		}
+#ifdef HAVE_IRQ_AFFINITY_NOTIFY
+		q_vector->affinity_notify.notify = txgbe_irq_affinity_notify;
+		q_vector->affinity_notify.release = txgbe_irq_affinity_release;
+		irq_set_affinity_notifier(entry->vector,
+					  &q_vector->affinity_notify);
+#endif
 #ifdef HAVE_IRQ_AFFINITY_HINT
 		if (txgbe_perf_diag >= 2) {
 			int cpu = cpumask_empty(&q_vector->affinity_mask) ?
@@ -3813,6 +4097,10 @@ static int txgbe_request_msix_irqs(struct txgbe_adapter *adapter)
 free_queue_irqs:
 	while (vector) {
 		vector--;
+#ifdef HAVE_IRQ_AFFINITY_NOTIFY
+		irq_set_affinity_notifier(adapter->msix_entries[vector].vector,
+					  NULL);
+#endif
 #ifdef HAVE_IRQ_AFFINITY_HINT
 		irq_set_affinity_hint(adapter->msix_entries[vector].vector,
 				      NULL);
@@ -3893,12 +4181,17 @@ static irqreturn_t txgbe_intr(int __always_unused irq, void *data)
 	txgbe_check_overtemp_event(adapter, eicr_misc);
 
 #ifdef HAVE_PTP_1588_CLOCK
-	if (unlikely(eicr_misc & TXGBE_PX_MISC_IC_TIMESYNC))
+	if (unlikely(eicr_misc & TXGBE_PX_MISC_IC_TIMESYNC)) {
 		txgbe_ptp_check_pps_event(adapter);
+		txgbe_ptp_check_tx_event(adapter);
+	}
 #endif
 	adapter->isb_mem[TXGBE_ISB_MISC] = 0;
 	/* would disable interrupts here but it is auto disabled */
-	napi_schedule_irqoff(&q_vector->napi);
+#ifndef HAVE_DEV_SET_THREADED
+	if (!txgbe_qv_thread_schedule(q_vector))
+#endif
+		napi_schedule_irqoff(&q_vector->napi);
 
 	/*
 	 * re-enable link(maybe) and non-queue interrupts, no flush.
@@ -3956,6 +4249,9 @@ static void txgbe_free_irq(struct txgbe_adapter *adapter)
 		if (!q_vector->rx.ring && !q_vector->tx.ring)
 			continue;
 
+#ifdef HAVE_IRQ_AFFINITY_NOTIFY
+		irq_set_affinity_notifier(entry->vector, NULL);
+#endif
 #ifdef HAVE_IRQ_AFFINITY_HINT
 		/* clear the affinity_mask in the IRQ descriptor */
 		irq_set_affinity_hint(entry->vector, NULL);
@@ -4012,18 +4308,155 @@ static void txgbe_configure_msi_and_legacy(struct txgbe_adapter *adapter)
 }
 
 /**
- * txgbe_configure_tx_ring - Configure Tx ring after Reset
+ * txgbe_tx_ring_maxrate - rate limit that applies to a Tx ring
  * @adapter: board private structure
- * @ring: structure containing ring specific data
+ * @ring: Tx ring
  *
- * Configure the Tx descriptor ring after a reset.
+ * A per-queue limit set through ndo_set_tx_maxrate wins; otherwise the
+ * mqprio limit of the ring's traffic class is split evenly across the
+ * queues of that class, the same way VF limits are split across the
+ * queues of a pool.  Returns the limit in Mbps, 0 if unlimited.
  **/
-void txgbe_configure_tx_ring(struct txgbe_adapter *adapter,
-			     struct txgbe_ring *ring)
+static u32 txgbe_tx_ring_maxrate(struct txgbe_adapter *adapter,
+				 struct txgbe_ring *ring)
+{
+	u16 queues = adapter->ring_feature[RING_F_RSS].indices;
+	u32 rate;
+
+	if (ring_is_xdp(ring))
+		return 0;
+
+	if (adapter->tx_maxrate[ring->queue_index])
+		return adapter->tx_maxrate[ring->queue_index];
+
+	if (netdev_get_num_tc(adapter->netdev) <= 1 ||
+	    ring->dcb_tc >= TXGBE_DCB_MAX_TRAFFIC_CLASS)
+		return 0;
+
+	rate = adapter->tc_maxrate[ring->dcb_tc];
+	if (!rate)
+		return 0;
+
+	/* never round a configured limit down to "unlimited" */
+	return max_t(u32, rate / max_t(u16, queues, 1), 1);
+}
+
+/**
+ * txgbe_set_tx_rate_limit - program the Tx rate pacer of one ring
+ * @adapter: board private structure
+ * @ring: Tx ring
+ *
+ * Uses the same per-queue pacer as txgbe_set_vf_rate_limit(), selected
+ * through TDM_RP_IDX by the ring's register index.
+ **/
+static void txgbe_set_tx_rate_limit(struct txgbe_adapter *adapter,
+				    struct txgbe_ring *ring)
+{
+	struct txgbe_hw *hw = &adapter->hw;
+	u32 rate = txgbe_tx_ring_maxrate(adapter, ring);
+
+	/* leave the pacer alone for rings that never had a limit, it may be
+	 * shared with the VF pools
+	 */
+	if (!rate && !ring->tx_maxrate)
+		return;
+
+	/* see txgbe_set_vf_rate_limit() for the MMW value */
+	wr32(hw, TXGBE_TDM_MMW, 0x14);
+
+	wr32(hw, TXGBE_TDM_RP_IDX, ring->reg_idx);
+	wr32(hw, TXGBE_TDM_RP_RATE, TXGBE_TDM_RP_RATE_MAX(rate));
+	if (rate)
+		wr32m(hw, TXGBE_TDM_RP_CTL,
+			TXGBE_TDM_RP_CTL_RLEN, TXGBE_TDM_RP_CTL_RLEN);
+	else
+		wr32m(hw, TXGBE_TDM_RP_CTL,
+			TXGBE_TDM_RP_CTL_RLEN, 0);
+
+	ring->tx_maxrate = rate;
+}
+
+/**
+ * txgbe_wait_rings_cfg - wait for a batch of queue enables or disables
+ * @adapter: board private structure
+ * @rings: rings whose enable bit has just been written
+ * @count: number of rings
+ * @tx: Tx rings (TR_CFG.ENABLE) rather than Rx rings (RR_CFG.RR_EN)
+ * @enable: wait for the bit to be set rather than cleared
+ *
+ * Queues start and stop independently of each other, so the enable bit of
+ * every ring is written first and all of them are polled together here,
+ * which costs one wait instead of one per ring.  Enables may sleep,
+ * disables busy-wait like txgbe_disable_rx_queue().
+ **/
+static void txgbe_wait_rings_cfg(struct txgbe_adapter *adapter,
+				 struct txgbe_ring **rings, unsigned int count,
+				 bool tx, bool enable)
+{
+	struct txgbe_hw *hw = &adapter->hw;
+	u32 mask = tx ? TXGBE_PX_TR_CFG_ENABLE : TXGBE_PX_RR_CFG_RR_EN;
+	int wait_loop = enable ? TXGBE_RING_ENABLE_POLL : TXGBE_MAX_RX_DESC_POLL;
+	unsigned int done = 0;
+	u32 reg;
+
+	if (TXGBE_REMOVED(hw->hw_addr))
+		return;
+
+	/* rings[0 .. done) have reached the requested state; a queue never
+	 * goes back once it got there, so each pass resumes at the first
+	 * ring that had not
+	 */
+	for (;;) {
+		for (; done < count; done++) {
+			u8 idx = rings[done]->reg_idx;
+
+			reg = rd32(hw, tx ? TXGBE_PX_TR_CFG(idx) :
+					    TXGBE_PX_RR_CFG(idx));
+			if (!!(reg & mask) != enable)
+				break;
+		}
+		if (done == count || !wait_loop--)
+			break;
+		if (enable)
+			usleep_range(100, 200);
+		else
+			udelay(10);
+	}
+
+	for (; done < count; done++) {
+		u8 idx = rings[done]->reg_idx;
+
+		reg = rd32(hw, tx ? TXGBE_PX_TR_CFG(idx) :
+				    TXGBE_PX_RR_CFG(idx));
+		if (!!(reg & mask) == enable)
+			continue;
+		if (tx && enable)
+			e_err(drv, "Could not enable Tx Queue %d\n", idx);
+		else if (tx)
+			e_err(drv, "TR_CFG.ENABLE on Tx queue %d not cleared "
+			      "within the polling period\n", idx);
+		else
+			e_err(drv, "RXDCTL.ENABLE on Rx queue %d not %s "
+			      "within the polling period\n", idx,
+			      enable ? "set" : "cleared");
+	}
+}
+
+#define TXGBE_ATR_BACKOFF_MAX	3
+
+/* ATR sample rate of the Tx rings, see txgbe_atr_adapt_subtask() */
+static u8 txgbe_atr_rate(struct txgbe_adapter *adapter)
+{
+	return min_t(u32, adapter->atr_sample_rate << adapter->atr_backoff,
+		     255);
+}
+
+/* program a Tx ring and set its enable bit without waiting for it */
+static void __txgbe_configure_tx_ring(struct txgbe_adapter *adapter,
+				      struct txgbe_ring *ring)
 {
 	struct txgbe_hw *hw = &adapter->hw;
 	u64 tdba = ring->dma;
-	int wait_loop = 10;
 	u32 txdctl = TXGBE_PX_TR_CFG_ENABLE;
 	u8 reg_idx = ring->reg_idx;
 #ifdef HAVE_AF_XDP_ZC_SUPPORT
@@ -4089,8 +4522,9 @@ void txgbe_configure_tx_ring(struct txgbe_adapter *adapter,
 
 	/* reinitialize flowdirector state */
 	if (adapter->flags & TXGBE_FLAG_FDIR_HASH_CAPABLE) {
-		ring->atr_sample_rate = adapter->atr_sample_rate;
+		ring->atr_sample_rate = txgbe_atr_rate(adapter);
 		ring->atr_count = 0;
+		memset(ring->atr_cache, 0, sizeof(ring->atr_cache));
 		set_bit(__TXGBE_TX_FDIR_INIT_DONE, &ring->state);
 	} else {
 		ring->atr_sample_rate = 0;
@@ -4108,20 +4542,26 @@ void txgbe_configure_tx_ring(struct txgbe_adapter *adapter,
 
 	clear_bit(__TXGBE_HANG_CHECK_ARMED, &ring->state);
 
+	/* reapply the rate limit, it is kept across resets */
+	txgbe_set_tx_rate_limit(adapter, ring);
+
 	/* enable queue */
 	wr32(hw, TXGBE_PX_TR_CFG(reg_idx), txdctl);
-
-
-	/* poll to verify queue is enabled */
-	do {
-		msleep(1);
-		txdctl = rd32(hw, TXGBE_PX_TR_CFG(reg_idx));
-	} while (--wait_loop && !(txdctl & TXGBE_PX_TR_CFG_ENABLE));
-	if (!wait_loop)
-		e_err(drv, "Could not enable Tx Queue %d\n", reg_idx);
 }
 
-
+/**
+ * txgbe_configure_tx_ring - Configure Tx ring after Reset
+ * @adapter: board private structure
+ * @ring: structure containing ring specific data
+ *
+ * Configure the Tx descriptor ring after a reset.
+ **/
+void txgbe_configure_tx_ring(struct txgbe_adapter *adapter,
+			     struct txgbe_ring *ring)
+{
+	__txgbe_configure_tx_ring(adapter, ring);
+	txgbe_wait_rings_cfg(adapter, &ring, 1, true, true);
+}
 
 /**
  * txgbe_configure_tx - Configure Transmit Unit after Reset
@@ -4145,11 +4585,20 @@ static void txgbe_configure_tx(struct txgbe_adapter *adapter)
 	wr32m(hw, TXGBE_TDM_CTL,
 		TXGBE_TDM_CTL_TE, TXGBE_TDM_CTL_TE);
 
-	/* Setup the HW Tx Head and Tail descriptor pointers */
-	for (i = 0; i < adapter->num_tx_queues; i++)
-		txgbe_configure_tx_ring(adapter, adapter->tx_ring[i]);
+	/* Setup the HW Tx Head and Tail descriptor pointers, then wait for
+	 * all of the queues to come up at once
+	 */
+	for (i = 0; i < adapter->num_tx_queues; i++) {
+		/* a failed txgbe_restart_tx_ring() left the ring disabled */
+		clear_bit(__TXGBE_TX_DISABLED, &adapter->tx_ring[i]->state);
+		__txgbe_configure_tx_ring(adapter, adapter->tx_ring[i]);
+	}
 	for (i = 0; i < adapter->num_xdp_queues; i++)
-		txgbe_configure_tx_ring(adapter, adapter->xdp_ring[i]);
+		__txgbe_configure_tx_ring(adapter, adapter->xdp_ring[i]);
+	txgbe_wait_rings_cfg(adapter, adapter->tx_ring,
+			     adapter->num_tx_queues, true, true);
+	txgbe_wait_rings_cfg(adapter, adapter->xdp_ring,
+			     adapter->num_xdp_queues, true, true);
 	wr32m(hw, TXGBE_TSC_BUF_AE, 0x3FF, 0x10);
 	/* enable mac transmitter */
 	wr32m(hw, TXGBE_MAC_TX_CFG,
@@ -4287,21 +4736,17 @@ void txgbe_store_reta(struct txgbe_adapter *adapter)
 {
 	u32 i, reta_entries = txgbe_rss_indir_tbl_entries(adapter);
 	struct txgbe_hw *hw = &adapter->hw;
-	u32 reta = 0;
+	u32 reta[TXGBE_MAX_RETA_ENTRIES / 4] = { 0 };
 	u8 *indir_tbl = adapter->rss_indir_tbl;
 
 	/* Fill out the redirection table as follows:
 	 *  - 8 bit wide entries containing 4 bit RSS index
 	 */
+	for (i = 0; i < reta_entries; i++)
+		reta[i >> 2] |= indir_tbl[i] << (i & 0x3) * 8;
 
-	/* Write redirection table to HW */
-	for (i = 0; i < reta_entries; i++) {
-		reta |= indir_tbl[i] << (i & 0x3) * 8;
-		if ((i & 3) == 3) {
-			wr32(hw, TXGBE_RDB_RSSTBL(i >> 2), reta);
-			reta = 0;
-		}
-	}
+	/* Write the registers that changed to HW */
+	txgbe_reg_table_sync(hw, &hw->mac.reta_tbl, reta, reta_entries >> 2);
 }
 
 void txgbe_store_vfreta(struct txgbe_adapter *adapter)
@@ -4488,28 +4933,6 @@ void txgbe_configure_rscctl(struct txgbe_adapter *adapter,
 	wr32(hw, TXGBE_PX_RR_CFG(reg_idx), rscctrl);
 }
 
-static void txgbe_rx_desc_queue_enable(struct txgbe_adapter *adapter,
-				       struct txgbe_ring *ring)
-{
-	struct txgbe_hw *hw = &adapter->hw;
-	int wait_loop = TXGBE_MAX_RX_DESC_POLL;
-	u32 rxdctl;
-	u8 reg_idx = ring->reg_idx;
-
-	if (TXGBE_REMOVED(hw->hw_addr))
-		return;
-
-	do {
-		msleep(1);
-		rxdctl = rd32(hw, TXGBE_PX_RR_CFG(reg_idx));
-	} while (--wait_loop && !(rxdctl & TXGBE_PX_RR_CFG_RR_EN));
-
-	if (!wait_loop) {
-		e_err(drv, "RXDCTL.ENABLE on Rx queue %d "
-		      "not set within the polling period\n", reg_idx);
-	}
-}
-
 /* disable the specified tx ring/queue */
 static __maybe_unused void txgbe_disable_tx_queue(struct txgbe_adapter *adapter,
 				   struct txgbe_ring *ring)
@@ -4540,36 +4963,61 @@ static __maybe_unused void txgbe_disable_tx_queue(struct txgbe_adapter *adapter,
 	}
 }
 
-/* disable the specified rx ring/queue */
-void txgbe_disable_rx_queue(struct txgbe_adapter *adapter,
-			    struct txgbe_ring *ring)
+/* clear the enable bit of an rx ring/queue without waiting for it */
+static void __txgbe_disable_rx_queue(struct txgbe_adapter *adapter,
+				     struct txgbe_ring *ring)
 {
 	struct txgbe_hw *hw = &adapter->hw;
-	int wait_loop = TXGBE_MAX_RX_DESC_POLL;
-	u32 rxdctl;
-	u8 reg_idx = ring->reg_idx;
 
 	if (TXGBE_REMOVED(hw->hw_addr))
 		return;
 
 	/* write value back with RXDCTL.ENABLE bit cleared */
-	wr32m(hw, TXGBE_PX_RR_CFG(reg_idx),
+	wr32m(hw, TXGBE_PX_RR_CFG(ring->reg_idx),
 		TXGBE_PX_RR_CFG_RR_EN, 0);
+}
+
+/* disable the specified rx ring/queue */
+void txgbe_disable_rx_queue(struct txgbe_adapter *adapter,
+			    struct txgbe_ring *ring)
+{
+	__txgbe_disable_rx_queue(adapter, ring);
 
 	/* the hardware may take up to 100us to really disable the rx queue */
-	do {
-		udelay(10);
-		rxdctl = rd32(hw, TXGBE_PX_RR_CFG(reg_idx));
-	} while (--wait_loop && (rxdctl & TXGBE_PX_RR_CFG_RR_EN));
+	txgbe_wait_rings_cfg(adapter, &ring, 1, false, false);
+}
 
-	if (!wait_loop) {
-		e_err(drv, "RXDCTL.ENABLE on Rx queue %d not cleared within "
-		      "the polling period\n", reg_idx);
-	}
+/**
+ * txgbe_disable_rx_queues - disable all rx rings and wait once
+ * @adapter: board private structure
+ **/
+static void txgbe_disable_rx_queues(struct txgbe_adapter *adapter)
+{
+	int i;
+
+	for (i = 0; i < adapter->num_rx_queues; i++)
+		__txgbe_disable_rx_queue(adapter, adapter->rx_ring[i]);
+	txgbe_wait_rings_cfg(adapter, adapter->rx_ring,
+			     adapter->num_rx_queues, false, false);
 }
 
-void txgbe_configure_rx_ring(struct txgbe_adapter *adapter,
-			     struct txgbe_ring *ring)
+static void txgbe_alloc_rx_ring_buffers(struct txgbe_ring *ring)
+{
+#ifdef HAVE_AF_XDP_ZC_SUPPORT
+	if (ring->xsk_pool)
+		txgbe_alloc_rx_buffers_zc(ring, txgbe_desc_unused(ring));
+	else
+		txgbe_alloc_rx_buffers(ring, txgbe_desc_unused(ring));
+#else
+	txgbe_alloc_rx_buffers(ring, txgbe_desc_unused(ring));
+#endif /* HAVE_AF_XDP_ZC_SUPPORT */
+}
+
+/* program a disabled Rx ring and set its enable bit without waiting for
+ * it; the caller fills the ring once the queue is up
+ */
+static void __txgbe_configure_rx_ring(struct txgbe_adapter *adapter,
+				      struct txgbe_ring *ring)
 {
 	struct txgbe_hw *hw = &adapter->hw;
 	struct net_device *netdev = adapter->netdev;
@@ -4580,9 +5028,7 @@ void txgbe_configure_rx_ring(struct txgbe_adapter *adapter,
 		netdev_features_t features = netdev->features;
 #endif
 
-	/* disable queue to avoid issues while updating state */
 	rxdctl = rd32(hw, TXGBE_PX_RR_CFG(reg_idx));
-	txgbe_disable_rx_queue(adapter, ring);
 #ifdef HAVE_AF_XDP_ZC_SUPPORT
 	if(ring->q_vector)
 		xdp_rxq_info_unreg_mem_model(&ring->xdp_rxq);
@@ -4641,6 +5087,9 @@ void txgbe_configure_rx_ring(struct txgbe_adapter *adapter,
 #ifndef CONFIG_TXGBE_DISABLE_PACKET_SPLIT
 	ring->next_to_alloc = 0;
 #endif
+	ring->pressure_thresh = (ring->count - 1) *
+				adapter->rx_pressure_pct / 100;
+	clear_bit(__TXGBE_RX_PRESSURE, &ring->state);
 
 	txgbe_configure_srrctl(adapter, ring);
 	/* In ESX, RSCCTL configuration is done by on demand */
@@ -4649,16 +5098,16 @@ void txgbe_configure_rx_ring(struct txgbe_adapter *adapter,
 	/* enable receive descriptor ring */
 	wr32m(hw, TXGBE_PX_RR_CFG(reg_idx),
 		TXGBE_PX_RR_CFG_RR_EN, TXGBE_PX_RR_CFG_RR_EN);
+}
 
-	txgbe_rx_desc_queue_enable(adapter, ring);
-#ifdef HAVE_AF_XDP_ZC_SUPPORT
-	if (ring->xsk_pool)
-		txgbe_alloc_rx_buffers_zc(ring, txgbe_desc_unused(ring));
-	else
-		txgbe_alloc_rx_buffers(ring, txgbe_desc_unused(ring));
-#else
-	txgbe_alloc_rx_buffers(ring, txgbe_desc_unused(ring));
-#endif /* HAVE_AF_XDP_ZC_SUPPORT */
+void txgbe_configure_rx_ring(struct txgbe_adapter *adapter,
+			     struct txgbe_ring *ring)
+{
+	/* disable queue to avoid issues while updating state */
+	txgbe_disable_rx_queue(adapter, ring);
+	__txgbe_configure_rx_ring(adapter, ring);
+	txgbe_wait_rings_cfg(adapter, &ring, 1, false, true);
+	txgbe_alloc_rx_ring_buffers(ring);
 }
 
 static void txgbe_setup_psrtype(struct txgbe_adapter *adapter)
@@ -4932,10 +5381,17 @@ static void txgbe_configure_rx(struct txgbe_adapter *adapter)
 
 	/*
 	 * Setup the HW Rx Head and Tail Descriptor Pointers and
-	 * the Base and Length of the Rx Descriptor Ring
+	 * the Base and Length of the Rx Descriptor Ring.  Every step that
+	 * waits on the hardware (queue disable, queue enable) is done for
+	 * all rings at once before the rings are filled.
 	 */
+	txgbe_disable_rx_queues(adapter);
 	for (i = 0; i < adapter->num_rx_queues; i++)
-		txgbe_configure_rx_ring(adapter, adapter->rx_ring[i]);
+		__txgbe_configure_rx_ring(adapter, adapter->rx_ring[i]);
+	txgbe_wait_rings_cfg(adapter, adapter->rx_ring,
+			     adapter->num_rx_queues, false, true);
+	for (i = 0; i < adapter->num_rx_queues; i++)
+		txgbe_alloc_rx_ring_buffers(adapter->rx_ring[i]);
 
 	rxctrl = rd32(hw, TXGBE_RDB_PB_CTL);
 
@@ -5178,10 +5634,24 @@ static void txgbe_restore_vlan(struct txgbe_adapter *adapter)
 	}
 #else
 	struct net_device *netdev = adapter->netdev;
+	struct txgbe_hw *hw = &adapter->hw;
 	u16 vid;
 
 	txgbe_vlan_mode(netdev, netdev->features);
 
+	/*
+	 * Without pools there is no VLVF to program: put the active VLANs
+	 * into the VFTA copy and write the words that changed in one batch,
+	 * instead of one txgbe_set_vfta() per VLAN.
+	 */
+	if (!(adapter->flags & TXGBE_FLAG_VMDQ_ENABLED)) {
+		for_each_set_bit(vid, adapter->active_vlans, VLAN_N_VID)
+			hw->mac.vft_shadow[vid >> 5] |= 1 << (vid & 0x1F);
+		txgbe_reg_table_sync(hw, &hw->mac.vft_tbl, hw->mac.vft_shadow,
+				     hw->mac.vft_size);
+		return;
+	}
+
 	for_each_set_bit(vid, adapter->active_vlans, VLAN_N_VID)
 #if (defined NETIF_F_HW_VLAN_CTAG_RX) || (defined NETIF_F_HW_VLAN_STAG_RX)
 		txgbe_vlan_rx_add_vid(netdev, htons(ETH_P_8021Q), vid);
@@ -5280,104 +5750,144 @@ int txgbe_write_mc_addr_list(struct net_device *netdev)
 }
 
 
+static u32 txgbe_mac_hash(const u8 *addr)
+{
+	/* the OUI rarely differs between filters, hash_min() mixes the rest */
+	return (u32)addr[2] << 24 | addr[3] << 16 | addr[4] << 8 | addr[5];
+}
+
+static struct txgbe_mac_addr *txgbe_mac_find(struct txgbe_adapter *adapter,
+					     const u8 *addr)
+{
+	struct txgbe_mac_addr *entry;
+
+	hash_for_each_possible(adapter->mac_hash, entry, hnode,
+			       txgbe_mac_hash(addr)) {
+		if (ether_addr_equal(entry->addr, addr))
+			return entry;
+	}
+	return NULL;
+}
+
+static void txgbe_mac_mark(struct txgbe_adapter *adapter, u32 i)
+{
+	adapter->mac_table[i].state |= TXGBE_MAC_STATE_MODIFIED;
+	set_bit(i, adapter->mac_dirty);
+}
+
+static void txgbe_mac_write(struct txgbe_adapter *adapter, u32 i)
+{
+	struct txgbe_mac_addr *entry = &adapter->mac_table[i];
+	struct txgbe_hw *hw = &adapter->hw;
+
+	if (entry->state & TXGBE_MAC_STATE_IN_USE)
+		TCALL(hw, mac.ops.set_rar, i, entry->addr, entry->pools,
+		      TXGBE_PSR_MAC_SWC_AD_H_AV);
+	else
+		TCALL(hw, mac.ops.clear_rar, i);
+	entry->state &= ~TXGBE_MAC_STATE_MODIFIED;
+}
+
 void txgbe_full_sync_mac_table(struct txgbe_adapter *adapter)
 {
 	struct txgbe_hw *hw = &adapter->hw;
-	int i;
-	for (i = 0; i < hw->mac.num_rar_entries; i++) {
-		if (adapter->mac_table[i].state & TXGBE_MAC_STATE_IN_USE) {
-			TCALL(hw, mac.ops.set_rar, i,
-				adapter->mac_table[i].addr,
-				adapter->mac_table[i].pools,
-				TXGBE_PSR_MAC_SWC_AD_H_AV);
-		} else {
-			TCALL(hw, mac.ops.clear_rar, i);
-		}
-		adapter->mac_table[i].state &= ~(TXGBE_MAC_STATE_MODIFIED);
-	}
+	u32 i;
+
+	for (i = 0; i < hw->mac.num_rar_entries; i++)
+		txgbe_mac_write(adapter, i);
+	bitmap_zero(adapter->mac_dirty, TXGBE_MAX_MAC_FILTERS);
 }
 
+/* write the entries changed since the last sync, and only those */
 static void txgbe_sync_mac_table(struct txgbe_adapter *adapter)
 {
 	struct txgbe_hw *hw = &adapter->hw;
-	int i;
-	for (i = 0; i < hw->mac.num_rar_entries; i++) {
-		if (adapter->mac_table[i].state & TXGBE_MAC_STATE_MODIFIED) {
-			if (adapter->mac_table[i].state &
-					TXGBE_MAC_STATE_IN_USE) {
-				TCALL(hw, mac.ops.set_rar, i,
-						adapter->mac_table[i].addr,
-						adapter->mac_table[i].pools,
-						TXGBE_PSR_MAC_SWC_AD_H_AV);
-			} else {
-				TCALL(hw, mac.ops.clear_rar, i);
-			}
-			adapter->mac_table[i].state &=
-				~(TXGBE_MAC_STATE_MODIFIED);
-		}
+	unsigned int i;
+
+	for_each_set_bit(i, adapter->mac_dirty, hw->mac.num_rar_entries) {
+		clear_bit(i, adapter->mac_dirty);
+		txgbe_mac_write(adapter, i);
 	}
 }
 
 int txgbe_available_rars(struct txgbe_adapter *adapter)
 {
 	struct txgbe_hw *hw = &adapter->hw;
-	u32 i, count = 0;
 
-	for (i = 0; i < hw->mac.num_rar_entries; i++) {
-		if (adapter->mac_table[i].state == 0)
-			count++;
-	}
-	return count;
+	return hw->mac.num_rar_entries -
+	       bitmap_weight(adapter->mac_used, hw->mac.num_rar_entries);
 }
 
 /* this function destroys the first RAR entry */
 static void txgbe_mac_set_default_filter(struct txgbe_adapter *adapter,
 					 u8 *addr)
 {
+	struct txgbe_mac_addr *entry = &adapter->mac_table[0];
 	struct txgbe_hw *hw = &adapter->hw;
 
-	memcpy(&adapter->mac_table[0].addr, addr, ETH_ALEN);
-	adapter->mac_table[0].pools = 1ULL << VMDQ_P(0);
-	adapter->mac_table[0].state = (TXGBE_MAC_STATE_DEFAULT |
-				       TXGBE_MAC_STATE_IN_USE);
-	TCALL(hw, mac.ops.set_rar, 0, adapter->mac_table[0].addr,
-			    adapter->mac_table[0].pools,
-			    TXGBE_PSR_MAC_SWC_AD_H_AV);
+	hash_del(&entry->hnode);
+	memset(entry->refs, 0, sizeof(entry->refs));
+	memcpy(&entry->addr, addr, ETH_ALEN);
+	entry->pools = 1ULL << VMDQ_P(0);
+	entry->refs[VMDQ_P(0)] = 1;
+	entry->state = (TXGBE_MAC_STATE_DEFAULT |
+			TXGBE_MAC_STATE_IN_USE);
+	hash_add(adapter->mac_hash, &entry->hnode, txgbe_mac_hash(addr));
+	set_bit(0, adapter->mac_used);
+	clear_bit(0, adapter->mac_dirty);
+	TCALL(hw, mac.ops.set_rar, 0, entry->addr, entry->pools,
+	      TXGBE_PSR_MAC_SWC_AD_H_AV);
 }
 
+/**
+ * txgbe_add_mac_filter - add a unicast address to a pool
+ * @adapter: board private structure
+ * @addr: address
+ * @pool: VMDq pool
+ *
+ * An address already in the table gets @pool added to its RAR, otherwise
+ * it takes the first free RAR.  Every add must be balanced by a
+ * txgbe_del_mac_filter() for the same pool.
+ *
+ * Returns the RAR index, or -ENOMEM if the table is full.
+ **/
 int txgbe_add_mac_filter(struct txgbe_adapter *adapter, const u8 *addr, u16 pool)
 {
 	struct txgbe_hw *hw = &adapter->hw;
+	struct txgbe_mac_addr *entry;
 	u32 i;
 
-	if (is_zero_ether_addr(addr))
+	if (is_zero_ether_addr(addr) || pool >= TXGBE_MAX_VMDQ_INDICES)
 		return -EINVAL;
 
-	for (i = 0; i < hw->mac.num_rar_entries; i++) {
-
-		if (adapter->mac_table[i].state & TXGBE_MAC_STATE_IN_USE)
-		{
-			if (ether_addr_equal(addr, adapter->mac_table[i].addr)) {
-				if (adapter->mac_table[i].pools != (1ULL << pool)) {
-					memcpy(adapter->mac_table[i].addr, addr, ETH_ALEN);
-					adapter->mac_table[i].pools |= (1ULL << pool);
-					txgbe_sync_mac_table(adapter);
-					return i;
-				}
-			}
-		}
-
-		if (adapter->mac_table[i].state & TXGBE_MAC_STATE_IN_USE) {
-			continue;
+	entry = txgbe_mac_find(adapter, addr);
+	if (entry) {
+		i = entry - adapter->mac_table;
+		if (entry->refs[pool] == U8_MAX)
+			return -ENOSPC;
+		entry->refs[pool]++;
+		if (!(entry->pools & (1ULL << pool))) {
+			entry->pools |= (1ULL << pool);
+			txgbe_mac_mark(adapter, i);
+			txgbe_sync_mac_table(adapter);
 		}
-		adapter->mac_table[i].state |= (TXGBE_MAC_STATE_MODIFIED |
-						TXGBE_MAC_STATE_IN_USE);
-		memcpy(adapter->mac_table[i].addr, addr, ETH_ALEN);
-		adapter->mac_table[i].pools |= (1ULL << pool);
-		txgbe_sync_mac_table(adapter);
 		return i;
 	}
-	return -ENOMEM;
+
+	i = find_first_zero_bit(adapter->mac_used, hw->mac.num_rar_entries);
+	if (i >= hw->mac.num_rar_entries)
+		return -ENOMEM;
+
+	entry = &adapter->mac_table[i];
+	memcpy(entry->addr, addr, ETH_ALEN);
+	entry->pools = 1ULL << pool;
+	entry->refs[pool] = 1;
+	entry->state |= TXGBE_MAC_STATE_IN_USE;
+	hash_add(adapter->mac_hash, &entry->hnode, txgbe_mac_hash(addr));
+	set_bit(i, adapter->mac_used);
+	txgbe_mac_mark(adapter, i);
+	txgbe_sync_mac_table(adapter);
+	return i;
 }
 
 static void txgbe_flush_sw_mac_table(struct txgbe_adapter *adapter)
@@ -5386,50 +5896,56 @@ static void txgbe_flush_sw_mac_table(struct txgbe_adapter *adapter)
 	struct txgbe_hw *hw = &adapter->hw;
 
 	for (i = 0; i < hw->mac.num_rar_entries; i++) {
-		adapter->mac_table[i].state |= TXGBE_MAC_STATE_MODIFIED;
+		hash_del(&adapter->mac_table[i].hnode);
 		adapter->mac_table[i].state &= ~TXGBE_MAC_STATE_IN_USE;
 		memset(adapter->mac_table[i].addr, 0, ETH_ALEN);
+		memset(adapter->mac_table[i].refs, 0,
+		       sizeof(adapter->mac_table[i].refs));
 		adapter->mac_table[i].pools = 0;
+		txgbe_mac_mark(adapter, i);
 	}
+	bitmap_zero(adapter->mac_used, TXGBE_MAX_MAC_FILTERS);
 	txgbe_sync_mac_table(adapter);
 }
 
+/**
+ * txgbe_del_mac_filter - drop a unicast address from a pool
+ * @adapter: board private structure
+ * @addr: address
+ * @pool: VMDq pool
+ *
+ * The pool leaves the RAR when its last user is gone, and the RAR is freed
+ * when no pool is left.
+ *
+ * Returns -ENOMEM if the address is not in the table.
+ **/
 int txgbe_del_mac_filter(struct txgbe_adapter *adapter, const u8 *addr, u16 pool)
 {
-	/* search table for addr, if found, set to 0 and sync */
+	struct txgbe_mac_addr *entry;
 	u32 i;
-	struct txgbe_hw *hw = &adapter->hw;
 
-	if (is_zero_ether_addr(addr))
+	if (is_zero_ether_addr(addr) || pool >= TXGBE_MAX_VMDQ_INDICES)
 		return -EINVAL;
 
-	for (i = 0; i < hw->mac.num_rar_entries; i++) {
-		if (ether_addr_equal(addr, adapter->mac_table[i].addr)){
-			if (adapter->mac_table[i].pools & (1ULL << pool)) {
-				adapter->mac_table[i].state |= TXGBE_MAC_STATE_MODIFIED;
-				adapter->mac_table[i].state &= ~TXGBE_MAC_STATE_IN_USE;
-
-				adapter->mac_table[i].pools &= ~(1ULL << pool) ;
-				txgbe_sync_mac_table(adapter);
-			}
-			return 0;
-		}
-
-		if (adapter->mac_table[i].pools != (1 << pool))
-			continue;
-		if ( !ether_addr_equal(addr, adapter->mac_table[i].addr))
-			continue;
-
-		adapter->mac_table[i].state |= TXGBE_MAC_STATE_MODIFIED;
-		adapter->mac_table[i].state &= ~TXGBE_MAC_STATE_IN_USE;
-		memset(adapter->mac_table[i].addr, 0, ETH_ALEN);
-		adapter->mac_table[i].pools = 0;
-		txgbe_sync_mac_table(adapter);
+	entry = txgbe_mac_find(adapter, addr);
+	if (!entry)
+		return -ENOMEM;
+	if (!(entry->pools & (1ULL << pool)))
+		return 0;
+	if (entry->refs[pool] && --entry->refs[pool])
 		return 0;
 
-
+	i = entry - adapter->mac_table;
+	entry->pools &= ~(1ULL << pool);
+	if (!entry->pools) {
+		hash_del(&entry->hnode);
+		entry->state &= ~TXGBE_MAC_STATE_IN_USE;
+		memset(entry->addr, 0, ETH_ALEN);
+		clear_bit(i, adapter->mac_used);
 	}
-	return -ENOMEM;
+	txgbe_mac_mark(adapter, i);
+	txgbe_sync_mac_table(adapter);
+	return 0;
 }
 
 #ifdef HAVE_SET_RX_MODE
@@ -5457,20 +5973,86 @@ int txgbe_write_uc_addr_list(struct net_device *netdev, int pool)
 #else
 		struct dev_mc_list *ha;
 #endif
+		struct txgbe_mac_addr *entry;
+		const u8 *addr;
+
 		netdev_for_each_uc_addr(ha, netdev) {
 #ifdef NETDEV_HW_ADDR_T_UNICAST
-			txgbe_del_mac_filter(adapter, ha->addr, pool);
-			txgbe_add_mac_filter(adapter, ha->addr, pool);
+			addr = ha->addr;
 #else
-			txgbe_del_mac_filter(adapter, ha->da_addr, pool);
-			txgbe_add_mac_filter(adapter, ha->da_addr, pool);
+			addr = ha->da_addr;
 #endif
+			/* already there: no second reference, no RAR write */
+			entry = txgbe_mac_find(adapter, addr);
+			if (!entry || !(entry->pools & (1ULL << pool)))
+				txgbe_add_mac_filter(adapter, addr, pool);
 			count++;
 		}
 	}
 	return count;
 }
 
+/**
+ * txgbe_write_uc_uta - hash the unicast addresses without a RAR into the UTA
+ * @adapter: board private structure
+ *
+ * The PF pool accepts UTA hits through ROPE, so a unicast list larger than
+ * the RAR table keeps hardware filtering instead of turning on unicast
+ * promiscuous mode.  Only UTA registers that change are written.
+ *
+ * The UTA is port wide and macvlan pools set ROPE as well, so with VMDq or
+ * SR-IOV enabled they would receive the PF's overflow.  The UTA is left
+ * empty then and the addresses are reported back as unfiltered.
+ *
+ * Returns the number of addresses that need unicast promiscuous mode.
+ **/
+static u32 txgbe_write_uc_uta(struct txgbe_adapter *adapter)
+{
+	struct net_device *netdev = adapter->netdev;
+	struct txgbe_hw *hw = &adapter->hw;
+#ifdef NETDEV_HW_ADDR_T_UNICAST
+	struct netdev_hw_addr *ha;
+#else
+	struct dev_mc_list *ha;
+#endif
+	struct txgbe_mac_addr *entry;
+	bool shared;
+	u32 count = 0;
+	u8 *addr;
+
+	shared = !!(adapter->flags & (TXGBE_FLAG_VMDQ_ENABLED |
+				      TXGBE_FLAG_SRIOV_ENABLED));
+
+	memset(hw->mac.uta_shadow, 0, sizeof(hw->mac.uta_shadow));
+	netdev_for_each_uc_addr(ha, netdev) {
+#ifdef NETDEV_HW_ADDR_T_UNICAST
+		addr = ha->addr;
+#else
+		addr = ha->da_addr;
+#endif
+		entry = txgbe_mac_find(adapter, addr);
+		if (entry && (entry->pools & (1ULL << VMDQ_P(0))))
+			continue;
+		if (!shared)
+			txgbe_set_uta(hw, addr);
+		count++;
+	}
+	txgbe_reg_table_sync(hw, &hw->mac.uta_tbl, hw->mac.uta_shadow,
+			     TXGBE_MAX_UTA);
+
+	if (shared) {
+		adapter->uc_uta_count = 0;
+		return count;
+	}
+
+	if (count && !adapter->uc_uta_count)
+		e_info(drv, "%u unicast addresses do not fit in the RAR table, filtering them by hash\n",
+		       count);
+	adapter->uc_uta_count = count;
+
+	return 0;
+}
+
 static int txgbe_uc_sync(struct net_device *netdev, const unsigned char *addr)
 {
 	struct txgbe_adapter *adapter = netdev_priv(netdev);
@@ -5529,8 +6111,6 @@ static void txgbe_vlan_promisc_enable(struct txgbe_adapter *adapter)
 {
 	struct txgbe_hw *hw = &adapter->hw;
 	u32 vlnctrl, i;
-	u32 vind;
-	u32 bits;
 
 	vlnctrl = rd32(hw, TXGBE_PSR_VLAN_CTL);
 
@@ -5553,44 +6133,22 @@ static void txgbe_vlan_promisc_enable(struct txgbe_adapter *adapter)
 	adapter->flags2 |= TXGBE_FLAG2_VLAN_PROMISC;
 
 	/* Add PF to all active pools */
-	vind = VMDQ_P(0);
-	for (i = TXGBE_PSR_VLAN_SWC_ENTRIES; --i;) {
-		wr32(hw, TXGBE_PSR_VLAN_SWC_IDX, i);
-
-		if (vind < 32) {
-			bits = rd32(hw,
-					TXGBE_PSR_VLAN_SWC_VM_L);
-			bits |= (1 << vind);
-			wr32(hw,
-					TXGBE_PSR_VLAN_SWC_VM_L,
-					bits);
-		} else {
-			bits = rd32(hw,
-				TXGBE_PSR_VLAN_SWC_VM_H);
-			bits |= (1 << (vind - 32));
-			wr32(hw,
-				TXGBE_PSR_VLAN_SWC_VM_H,
-				bits);
-		}
-	}
+	for (i = TXGBE_PSR_VLAN_SWC_ENTRIES; --i;)
+		txgbe_set_vlvf_pool(hw, i, VMDQ_P(0), true);
 
 	/* Set all bits in the VLAN filter table array */
-	for (i = 0; i < hw->mac.vft_size; i++) {
-		wr32(hw, TXGBE_PSR_VLAN_TBL(i), ~0U);
-	}
+	txgbe_reg_table_fill(hw, &hw->mac.vft_tbl, ~0U);
 }
 
 static void txgbe_scrub_vfta(struct txgbe_adapter *adapter)
 {
 	struct txgbe_hw *hw = &adapter->hw;
-	u32 i, vid, bits;
-	u32 vfta;
-	u32 vind;
+	u32 i, vid;
 	u32 vlvf;
 
+	txgbe_load_vlvf(hw);
 	for (i = TXGBE_PSR_VLAN_SWC_ENTRIES; --i;) {
-		wr32(hw, TXGBE_PSR_VLAN_SWC_IDX, i);
-		vlvf = rd32(hw, TXGBE_PSR_VLAN_SWC);
+		vlvf = hw->mac.vlvf.vlvf[i];
 
 		/* pull VLAN ID from VLVF */
 		vid = vlvf & ~TXGBE_PSR_VLAN_SWC_VIEN;
@@ -5602,29 +6160,16 @@ static void txgbe_scrub_vfta(struct txgbe_adapter *adapter)
 		}
 
 		/* remove PF from the pool */
-		vind = VMDQ_P(0);
-		if (vind < 32) {
-			bits = rd32(hw,
-					TXGBE_PSR_VLAN_SWC_VM_L);
-			bits &= ~(1 << vind);
-			wr32(hw,
-					TXGBE_PSR_VLAN_SWC_VM_L,
-					bits);
-		} else {
-			bits = rd32(hw,
-				TXGBE_PSR_VLAN_SWC_VM_H);
-			bits &= ~(1 << (vind - 32));
-			wr32(hw,
-				TXGBE_PSR_VLAN_SWC_VM_H,
-				bits);
-		}
+		txgbe_set_vlvf_pool(hw, i, VMDQ_P(0), false);
 	}
 
+	/* VLANs added while in promiscuous mode only went to active_vlans */
+	for_each_set_bit(vid, adapter->active_vlans, VLAN_N_VID)
+		hw->mac.vft_shadow[vid >> 5] |= 1 << (vid & 0x1F);
+
 	/* extract values from vft_shadow and write back to VFTA */
-	for (i = 0; i < hw->mac.vft_size; i++) {
-		vfta = hw->mac.vft_shadow[i];
-		wr32(hw, TXGBE_PSR_VLAN_TBL(i), vfta);
-	}
+	txgbe_reg_table_sync(hw, &hw->mac.vft_tbl, hw->mac.vft_shadow,
+			     hw->mac.vft_size);
 }
 
 static void txgbe_vlan_promisc_disable(struct txgbe_adapter *adapter)
@@ -5739,11 +6284,12 @@ void txgbe_set_rx_mode(struct net_device *netdev)
 	}
 
 	/*
-	 * Write addresses to available RAR registers, if there is not
-	 * sufficient space to store all the addresses then enable
-	 * unicast promiscuous mode
+	 * Write addresses to available RAR registers, the ones that do not
+	 * fit are hashed into the UTA, which the pool accepts through ROPE.
+	 * If the UTA cannot be used enable unicast promiscuous mode
 	 */
-	 if (__dev_uc_sync(netdev, txgbe_uc_sync, txgbe_uc_unsync)) {
+	__dev_uc_sync(netdev, txgbe_uc_sync, txgbe_uc_unsync);
+	if (txgbe_write_uc_uta(adapter)) {
 		vmolr &= ~TXGBE_PSR_VM_L2CTL_ROPE;
 		fctrl |= TXGBE_PSR_CTL_UPE;
 	}
@@ -5774,13 +6320,230 @@ void txgbe_set_rx_mode(struct net_device *netdev)
 		else
 			txgbe_vlan_promisc_enable(adapter);
 #else
-		wr32(hw, TXGBE_PSR_VLAN_CTL, vlnctrl);
-#endif /* NETIF_F_HW_VLAN_CTAG_FILTER */
+		wr32(hw, TXGBE_PSR_VLAN_CTL, vlnctrl);
+#endif /* NETIF_F_HW_VLAN_CTAG_FILTER */
+
+	/* enable cloud switch */
+	if (adapter->flags2 & TXGBE_FLAG2_CLOUD_SWITCH_ENABLED) {
+		txgbe_add_cloud_switcher(adapter, 0x10, 0);
+	}
+}
+
+/* the NAPI thread of a vector, kernel or driver owned, or NULL */
+static struct task_struct *txgbe_qv_thread(struct txgbe_q_vector *q_vector)
+{
+#ifdef HAVE_DEV_SET_THREADED
+	return READ_ONCE(q_vector->napi.thread);
+#else
+	return READ_ONCE(q_vector->poll_thread);
+#endif
+}
+
+/**
+ * txgbe_napi_thread_apply - set the CPUs and scheduling of a NAPI thread
+ * @q_vector: vector polled by @thread
+ * @thread: NAPI thread of the vector
+ *
+ * The thread may run on the CPUs of the vector's affinity_mask, which
+ * follows the IRQ affinity, and is scheduled as set by
+ * txgbe_set_napi_sched().
+ **/
+static void txgbe_napi_thread_apply(struct txgbe_q_vector *q_vector,
+				    struct task_struct *thread)
+{
+	struct txgbe_adapter *adapter = q_vector->adapter;
+	u16 v_idx = q_vector->v_idx;
+
+	switch (adapter->napi_sched[v_idx]) {
+	case TXGBE_NAPI_SCHED_NORMAL:
+		sched_set_normal(thread, adapter->napi_nice[v_idx]);
+		break;
+	case TXGBE_NAPI_SCHED_FIFO_LOW:
+		sched_set_fifo_low(thread);
+		break;
+	case TXGBE_NAPI_SCHED_FIFO:
+		sched_set_fifo(thread);
+		break;
+	default:
+		break;
+	}
+
+#ifdef HAVE_IRQ_AFFINITY_HINT
+	if (!cpumask_empty(&q_vector->affinity_mask))
+		set_cpus_allowed_ptr(thread, &q_vector->affinity_mask);
+#endif
+	WRITE_ONCE(q_vector->napi_thread_applied, thread);
+}
+
+/**
+ * txgbe_napi_threads_apply - apply pending NAPI thread settings
+ * @adapter: board private structure
+ *
+ * Called with the RTNL held, which keeps the kernel's NAPI threads alive.
+ **/
+static void txgbe_napi_threads_apply(struct txgbe_adapter *adapter)
+{
+	int i;
+
+	for (i = 0; i < adapter->num_q_vectors; i++) {
+		struct txgbe_q_vector *q_vector = adapter->q_vector[i];
+		struct task_struct *thread = txgbe_qv_thread(q_vector);
+
+		if (thread && thread != q_vector->napi_thread_applied)
+			txgbe_napi_thread_apply(q_vector, thread);
+	}
+}
+
+#ifndef HAVE_DEV_SET_THREADED
+/**
+ * txgbe_napi_thread - poll a vector from a driver thread
+ * @data: q_vector
+ *
+ * Threaded NAPI for kernels without dev_set_threaded(), modelled on the
+ * kernel's napi_threaded_poll().  Schedules of the vector post a request
+ * with txgbe_qv_thread_schedule() instead of raising NET_RX, and the
+ * thread takes the NAPI context and polls until txgbe_poll() completes
+ * it.  Requests that come in meanwhile are run by the next pass.  Only a
+ * context already held by a busy poller is left to that owner.
+ **/
+static int txgbe_napi_thread(void *data)
+{
+	struct txgbe_q_vector *q_vector = data;
+	struct napi_struct *napi = &q_vector->napi;
+
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!test_and_clear_bit(0, &q_vector->poll_thread_sched)) {
+			if (kthread_should_stop())
+				break;
+			schedule();
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+
+		/* disabled, or held by a busy poller that polls it again */
+		if (!napi_schedule_prep(napi))
+			continue;
+
+		for (;;) {
+			int budget = napi->weight;
+			int work;
+
+			local_bh_disable();
+			work = txgbe_poll(napi, budget);
+			if (work >= budget)
+				napi_gro_flush(napi, false);
+			local_bh_enable();
+			if (work < budget)
+				break;
+			cond_resched();
+		}
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+/* start a driver NAPI thread per vector, softirq polls the ones that fail */
+static void txgbe_napi_threads_start(struct txgbe_adapter *adapter)
+{
+	int i;
+
+	for (i = 0; i < adapter->num_q_vectors; i++) {
+		struct txgbe_q_vector *q_vector = adapter->q_vector[i];
+		struct task_struct *thread;
+
+		thread = kthread_create_on_node(txgbe_napi_thread, q_vector,
+						q_vector->numa_node,
+						"napi/%s-%d",
+						adapter->netdev->name, i);
+		if (IS_ERR(thread)) {
+			e_warn(drv, "NAPI thread for vector %d failed: %ld\n",
+			       i, PTR_ERR(thread));
+			continue;
+		}
+		q_vector->poll_thread_sched = 0;
+		wake_up_process(thread);
+		WRITE_ONCE(q_vector->poll_thread, thread);
+	}
+}
+
+/* with every NAPI context disabled, so no poll can be handed over */
+static void txgbe_napi_threads_stop(struct txgbe_adapter *adapter)
+{
+	int i;
+
+	for (i = 0; i < adapter->num_q_vectors; i++) {
+		struct txgbe_q_vector *q_vector = adapter->q_vector[i];
+		struct task_struct *thread = q_vector->poll_thread;
+
+		if (!thread)
+			continue;
+		WRITE_ONCE(q_vector->poll_thread, NULL);
+		kthread_stop(thread);
+		q_vector->napi_thread_applied = NULL;
+	}
+}
+
+#endif /* !HAVE_DEV_SET_THREADED */
+/**
+ * txgbe_set_napi_threaded - poll the vectors from threads or softirq
+ * @adapter: board private structure
+ * @threaded: true for threaded NAPI
+ *
+ * Called with the RTNL held.  Uses the kernel's threaded NAPI where
+ * there is one, which /sys/class/net/<dev>/threaded also switches.
+ * Otherwise the driver starts its own threads, see txgbe_napi_thread(),
+ * with a reinit of a running interface.
+ **/
+int txgbe_set_napi_threaded(struct txgbe_adapter *adapter, bool threaded)
+{
+#ifdef HAVE_DEV_SET_THREADED
+	int err;
+
+	err = dev_set_threaded(adapter->netdev, threaded);
+	if (err)
+		return err;
+	txgbe_napi_threads_apply(adapter);
+#else
+	if (threaded)
+		adapter->eth_priv_flags |= TXGBE_ETH_PRIV_FLAG_NAPI_THREADED;
+	else
+		adapter->eth_priv_flags &= ~TXGBE_ETH_PRIV_FLAG_NAPI_THREADED;
+	if (netif_running(adapter->netdev))
+		txgbe_reinit_locked(adapter);
+#endif
 
-	/* enable cloud switch */
-	if (adapter->flags2 & TXGBE_FLAG2_CLOUD_SWITCH_ENABLED) {
-		txgbe_add_cloud_switcher(adapter, 0x10, 0);
+	return 0;
+}
+
+/**
+ * txgbe_set_napi_sched - set the scheduling of NAPI threads
+ * @adapter: board private structure
+ * @v_idx: vector, or -1 for all of them
+ * @sched: enum txgbe_napi_sched
+ * @nice: nice value for TXGBE_NAPI_SCHED_NORMAL
+ *
+ * Kept across resets, and applied to threads started later.
+ **/
+void txgbe_set_napi_sched(struct txgbe_adapter *adapter, int v_idx,
+			  u8 sched, s8 nice)
+{
+	int i;
+
+	for (i = 0; i < MAX_MSIX_Q_VECTORS; i++) {
+		if (v_idx >= 0 && i != v_idx)
+			continue;
+		adapter->napi_sched[i] = sched;
+		adapter->napi_nice[i] = nice;
+		if (i < adapter->num_q_vectors && adapter->q_vector[i])
+			WRITE_ONCE(adapter->q_vector[i]->napi_thread_applied,
+				   NULL);
 	}
+
+	rtnl_lock();
+	txgbe_napi_threads_apply(adapter);
+	rtnl_unlock();
 }
 
 static void txgbe_napi_enable_all(struct txgbe_adapter *adapter)
@@ -5795,6 +6558,12 @@ static void txgbe_napi_enable_all(struct txgbe_adapter *adapter)
 #endif
 		napi_enable(&q_vector->napi);
 	}
+
+#ifndef HAVE_DEV_SET_THREADED
+	if (adapter->eth_priv_flags & TXGBE_ETH_PRIV_FLAG_NAPI_THREADED)
+		txgbe_napi_threads_start(adapter);
+#endif
+	txgbe_napi_threads_apply(adapter);
 }
 
 static void txgbe_napi_disable_all(struct txgbe_adapter *adapter)
@@ -5812,6 +6581,10 @@ static void txgbe_napi_disable_all(struct txgbe_adapter *adapter)
 		}
 #endif
 	}
+
+#ifndef HAVE_DEV_SET_THREADED
+	txgbe_napi_threads_stop(adapter);
+#endif
 }
 
 #ifdef HAVE_DCBNL_IEEE
@@ -6766,6 +7539,100 @@ static void txgbe_up_complete(struct txgbe_adapter *adapter)
 		adapter->flags2 &= ~TXGBE_FLAG2_ECC_ERR_RESET;
 }
 
+/**
+ * txgbe_ring_numa_misplaced - check ring memory against its q_vector node
+ * @ring: ring to check
+ *
+ * Returns true if the IRQ affinity of the owning q_vector moved to a
+ * single node other than the one the ring memory was allocated on.
+ **/
+static bool txgbe_ring_numa_misplaced(struct txgbe_ring *ring)
+{
+	int node;
+
+	if (!ring || !ring->desc || !ring->q_vector)
+		return false;
+
+	node = ring->q_vector->numa_node;
+	return node != NUMA_NO_NODE && node != ring->numa_node;
+}
+
+/**
+ * txgbe_migrate_ring_numa - move descriptor ring and buffer_info to a node
+ * @ring: quiesced ring, buffer_info must already be cleaned
+ * @rx: @ring is an Rx ring
+ *
+ * New memory is allocated first so a failure leaves the ring untouched.
+ **/
+static void txgbe_migrate_ring_numa(struct txgbe_ring *ring, bool rx)
+{
+	struct device *dev = ring->dev;
+	int orig_node = dev_to_node(dev);
+	int node = ring->q_vector->numa_node;
+	unsigned int bi_size;
+	void *bi, *desc;
+	dma_addr_t dma;
+
+	bi_size = rx ? sizeof(struct txgbe_rx_buffer) :
+		       sizeof(struct txgbe_tx_buffer);
+	bi = vzalloc_node(bi_size * ring->count, node);
+	if (!bi)
+		return;
+
+	set_dev_node(dev, node);
+	desc = dma_alloc_coherent(dev, ring->size, &dma, GFP_KERNEL);
+	set_dev_node(dev, orig_node);
+	if (!desc) {
+		vfree(bi);
+		return;
+	}
+
+	dma_free_coherent(dev, ring->size, ring->desc, ring->dma);
+	if (rx) {
+		vfree(ring->rx_buffer_info);
+		ring->rx_buffer_info = bi;
+	} else {
+		vfree(ring->tx_buffer_info);
+		ring->tx_buffer_info = bi;
+	}
+
+	ring->desc = desc;
+	ring->dma = dma;
+	ring->numa_node = node;
+}
+
+/**
+ * txgbe_migrate_rings_numa - lazily follow IRQ affinity with ring memory
+ * @adapter: board private structure, interface must be down
+ *
+ * The affinity notifier only records the new node of a q_vector, the
+ * rings are moved here on the next reinit when they are guaranteed idle.
+ **/
+static void txgbe_migrate_rings_numa(struct txgbe_adapter *adapter)
+{
+	int i;
+
+	for (i = 0; i < adapter->num_tx_queues; i++)
+		if (txgbe_ring_numa_misplaced(adapter->tx_ring[i]))
+			txgbe_migrate_ring_numa(adapter->tx_ring[i], false);
+
+	for (i = 0; i < adapter->num_xdp_queues; i++)
+		if (txgbe_ring_numa_misplaced(adapter->xdp_ring[i]))
+			txgbe_migrate_ring_numa(adapter->xdp_ring[i], false);
+
+	for (i = 0; i < adapter->num_rx_queues; i++) {
+		struct txgbe_ring *ring = adapter->rx_ring[i];
+
+#ifdef HAVE_AF_XDP_ZC_SUPPORT
+		/* zero-copy rings are owned by the xsk pool setup */
+		if (ring && ring->xsk_pool)
+			continue;
+#endif
+		if (txgbe_ring_numa_misplaced(ring))
+			txgbe_migrate_ring_numa(ring, true);
+	}
+}
+
 void txgbe_reinit_locked(struct txgbe_adapter *adapter)
 {
 	if (adapter->flags2 & TXGBE_FLAG2_KR_PRO_REINIT) {
@@ -6783,7 +7650,10 @@ void txgbe_reinit_locked(struct txgbe_adapter *adapter)
 
 	while (test_and_set_bit(__TXGBE_RESETTING, &adapter->state))
 		usleep_range(1000, 2000);
+	txgbe_trace(reset_step, adapter, TXGBE_TRACE_REINIT_START, -1);
 	txgbe_down(adapter);
+	txgbe_migrate_rings_numa(adapter);
+	txgbe_trace(reset_step, adapter, TXGBE_TRACE_REINIT_DOWN, -1);
 	/*
 	 * If SR-IOV enabled then wait a bit before bringing the adapter
 	 * back up to give the VFs time to respond to the reset.  The
@@ -6795,6 +7665,7 @@ void txgbe_reinit_locked(struct txgbe_adapter *adapter)
 	txgbe_up(adapter);
 	clear_bit(__TXGBE_RESETTING, &adapter->state);
 	adapter->flags2 &= ~TXGBE_FLAG2_KR_PRO_REINIT;
+	txgbe_trace(reset_step, adapter, TXGBE_TRACE_REINIT_DONE, -1);
 }
 
 void txgbe_up(struct txgbe_adapter *adapter)
@@ -7068,10 +7939,8 @@ static void txgbe_disable_device(struct txgbe_adapter *adapter)
 	/* disable receives */
 	TCALL(hw, mac.ops.disable_rx);
 
-	/* disable all enabled rx queues */
-	for (i = 0; i < adapter->num_rx_queues; i++)
-		/* this call also flushes the previous write */
-		txgbe_disable_rx_queue(adapter, adapter->rx_ring[i]);
+	/* disable all enabled rx queues, the poll also flushes the writes */
+	txgbe_disable_rx_queues(adapter);
 
 	netif_tx_stop_all_queues(netdev);
 
@@ -7164,6 +8033,8 @@ void txgbe_down(struct txgbe_adapter *adapter)
 	struct txgbe_hw *hw = &adapter->hw;
 
 	txgbe_disable_device(adapter);
+	/* module events are not handled while down */
+	txgbe_module_invalidate(adapter);
 
 #ifdef HAVE_PCI_ERS
 	if (!pci_channel_offline(adapter->pdev))
@@ -7278,6 +8149,7 @@ static int __devinit txgbe_sw_init(struct txgbe_adapter *adapter)
 		e_err(probe, "mac_table allocation failed: %d\n", err);
 		goto out;
 	}
+	hash_init(adapter->mac_hash);
 
 	memcpy(adapter->rss_key, def_rss_key, sizeof(def_rss_key));
 #ifdef HAVE_AF_XDP_SUPPORT
@@ -7377,6 +8249,11 @@ static int __devinit txgbe_sw_init(struct txgbe_adapter *adapter)
 	adapter->tx_work_limit = TXGBE_DEFAULT_TX_WORK;
 	adapter->rx_work_limit = TXGBE_DEFAULT_RX_WORK;
 
+	/* vector packing is off until the private flag is set */
+	adapter->vpack_low = TXGBE_VPACK_LOW_DEFAULT;
+	adapter->vpack_high = TXGBE_VPACK_HIGH_DEFAULT;
+	adapter->vpack_hosts = 1;
+
 	adapter->tx_timeout_recovery_level = 0;
 	adapter->cmplt_to_dis = false;
 
@@ -7405,10 +8282,13 @@ int txgbe_setup_tx_resources(struct txgbe_ring *tx_ring)
 
 	if (tx_ring->q_vector)
 		numa_node = tx_ring->q_vector->numa_node;
+	tx_ring->numa_node = numa_node;
 
 	tx_ring->tx_buffer_info = vzalloc_node(size, numa_node);
-	if (!tx_ring->tx_buffer_info)
+	if (!tx_ring->tx_buffer_info) {
 		tx_ring->tx_buffer_info = vzalloc(size);
+		tx_ring->numa_node = NUMA_NO_NODE;
+	}
 	if (!tx_ring->tx_buffer_info)
 		goto err;
 
@@ -7422,9 +8302,11 @@ int txgbe_setup_tx_resources(struct txgbe_ring *tx_ring)
 					   &tx_ring->dma,
 					   GFP_KERNEL);
 	set_dev_node(dev, orig_node);
-	if (!tx_ring->desc)
+	if (!tx_ring->desc) {
 		tx_ring->desc = dma_alloc_coherent(dev, tx_ring->size,
 						   &tx_ring->dma, GFP_KERNEL);
+		tx_ring->numa_node = NUMA_NO_NODE;
+	}
 	if (!tx_ring->desc)
 		goto err;
 
@@ -7502,10 +8384,13 @@ int txgbe_setup_rx_resources(struct txgbe_ring *rx_ring)
 
 	if (rx_ring->q_vector)
 		numa_node = rx_ring->q_vector->numa_node;
+	rx_ring->numa_node = numa_node;
 
 	rx_ring->rx_buffer_info = vzalloc_node(size, numa_node);
-	if (!rx_ring->rx_buffer_info)
+	if (!rx_ring->rx_buffer_info) {
 		rx_ring->rx_buffer_info = vzalloc(size);
+		rx_ring->numa_node = NUMA_NO_NODE;
+	}
 	if (!rx_ring->rx_buffer_info)
 		goto err;
 
@@ -7519,9 +8404,11 @@ int txgbe_setup_rx_resources(struct txgbe_ring *rx_ring)
 					   &rx_ring->dma,
 					   GFP_KERNEL);
 	set_dev_node(dev, orig_node);
-	if (!rx_ring->desc)
+	if (!rx_ring->desc) {
 		rx_ring->desc = dma_alloc_coherent(dev, rx_ring->size,
 						   &rx_ring->dma, GFP_KERNEL);
+		rx_ring->numa_node = NUMA_NO_NODE;
+	}
 	if (!rx_ring->desc)
 		goto err;
 
@@ -7770,6 +8657,25 @@ static int txgbe_change_mtu(struct net_device *netdev, int new_mtu)
 	return 0;
 }
 
+/**
+ * txgbe_bringup_step - report the end of a probe or open step
+ * @adapter: board private structure
+ * @step: TXGBE_BRINGUP_* step that just finished
+ *
+ * Emits txgbe_bringup_step with the time since the previous step and since
+ * adapter->bringup_start_ns, which the caller sets when probe or open
+ * begins.
+ **/
+static void txgbe_bringup_step(struct txgbe_adapter *adapter, int step)
+{
+	u64 now = ktime_get_ns();
+
+	txgbe_trace(bringup_step, adapter, step,
+		    now - adapter->bringup_last_ns,
+		    now - adapter->bringup_start_ns);
+	adapter->bringup_last_ns = now;
+}
+
 /**
  * txgbe_open - Called when a network interface is made active
  * @netdev: network interface device structure
@@ -7796,6 +8702,9 @@ int txgbe_open(struct net_device *netdev)
 
 	netif_carrier_off(netdev);
 
+	adapter->bringup_start_ns = ktime_get_ns();
+	adapter->bringup_last_ns = adapter->bringup_start_ns;
+
 	/* allocate transmit descriptors */
 	err = txgbe_setup_all_tx_resources(adapter);
 	if (err)
@@ -7809,12 +8718,15 @@ int txgbe_open(struct net_device *netdev)
 	err = txgbe_setup_isb_resources(adapter);
 	if (err)
 		goto err_req_isb;
+	txgbe_bringup_step(adapter, TXGBE_BRINGUP_RESOURCES);
 
 	txgbe_configure(adapter);
+	txgbe_bringup_step(adapter, TXGBE_BRINGUP_CONFIGURE);
 
 	err = txgbe_request_irq(adapter);
 	if (err)
 		goto err_req_irq;
+	txgbe_bringup_step(adapter, TXGBE_BRINGUP_REQUEST_IRQ);
 
 	/* Notify the stack of the actual queue counts. */
 	err = netif_set_real_num_tx_queues(netdev, adapter->num_vmdqs > 1
@@ -7853,6 +8765,7 @@ int txgbe_open(struct net_device *netdev)
 #endif
 
 	txgbe_up_complete(adapter);
+	txgbe_bringup_step(adapter, TXGBE_BRINGUP_OPEN_DONE);
 
 #if defined(HAVE_UDP_ENC_RX_OFFLOAD) && defined(HAVE_UDP_TUNNEL_NIC_INFO)
 	udp_tunnel_nic_reset_ntf(netdev);
@@ -8275,6 +9188,41 @@ static struct net_device_stats *txgbe_get_stats(struct net_device *netdev)
 }
 #endif
 
+/**
+ * txgbe_rx_pressure_drops - relate Rx drops to ring fill levels
+ * @adapter: board private structure
+ * @drops: frames dropped since the last stats update, for lack of Rx
+ *         descriptors or packet buffer space
+ *
+ * The hardware does not count drops per queue.  Instead, every ring that
+ * was over its pressure threshold at some point since the last update is
+ * charged with one drop interval.  Drops with no ring over it point at
+ * something other than slow ring cleaning, e.g. PCIe or the packet buffer.
+ **/
+static void txgbe_rx_pressure_drops(struct txgbe_adapter *adapter, u32 drops)
+{
+	bool charged = false;
+	int i;
+
+	for (i = 0; i < adapter->num_rx_queues; i++) {
+		struct txgbe_ring *ring = adapter->rx_ring[i];
+		u16 fill = READ_ONCE(ring->rx_stats.fill_intvl);
+
+		WRITE_ONCE(ring->rx_stats.fill_intvl, 0);
+		if (!drops || !ring->pressure_thresh ||
+		    fill < ring->pressure_thresh)
+			continue;
+		ring->rx_stats.drop_intervals++;
+		charged = true;
+	}
+
+	if (!drops)
+		return;
+	adapter->rx_drop_intervals++;
+	if (!charged && adapter->rx_pressure_pct)
+		adapter->rx_drop_unattributed++;
+}
+
 /**
  * txgbe_update_stats - Update the board statistics counters.
  * @adapter: board private structure
@@ -8291,6 +9239,9 @@ void txgbe_update_stats(struct txgbe_adapter *adapter)
 	u64 total_mpc = 0;
 	u32 i, missed_rx = 0, mpc, bprc, lxon, lxoff;
 	u64 non_eop_descs = 0, restart_queue = 0, tx_busy = 0;
+	u64 tx_paced_stops = 0, rx_pressure_events = 0;
+	u64 atr_added = 0, atr_suppressed = 0, atr_failed = 0;
+	u32 no_dma;
 	u64 alloc_rx_page_failed = 0, alloc_rx_buff_failed = 0;
 	u64 bytes = 0, packets = 0, hw_csum_rx_error = 0;
 	u64 hw_csum_rx_good = 0;
@@ -8305,12 +9256,15 @@ void txgbe_update_stats(struct txgbe_adapter *adapter)
 	if (adapter->flags2 & TXGBE_FLAG2_RSC_ENABLED) {
 		u64 rsc_count = 0;
 		u64 rsc_flush = 0;
+		u64 rsc_gro_hw = 0;
 		for (i = 0; i < adapter->num_rx_queues; i++) {
 			rsc_count += adapter->rx_ring[i]->rx_stats.rsc_count;
 			rsc_flush += adapter->rx_ring[i]->rx_stats.rsc_flush;
+			rsc_gro_hw += adapter->rx_ring[i]->rx_stats.rsc_gro_hw;
 		}
 		adapter->rsc_total_count = rsc_count;
 		adapter->rsc_total_flush = rsc_flush;
+		adapter->rsc_total_gro_hw = rsc_gro_hw;
 	}
 
 #ifndef TXGBE_NO_LRO
@@ -8332,10 +9286,12 @@ void txgbe_update_stats(struct txgbe_adapter *adapter)
 		alloc_rx_buff_failed += rx_ring->rx_stats.alloc_rx_buff_failed;
 		hw_csum_rx_error += rx_ring->rx_stats.csum_err;
 		hw_csum_rx_good += rx_ring->rx_stats.csum_good_cnt;
+		rx_pressure_events += rx_ring->rx_stats.pressure_events;
 		bytes += rx_ring->stats.bytes;
 		packets += rx_ring->stats.packets;
 
 	}
+	adapter->rx_pressure_events = rx_pressure_events;
 	adapter->non_eop_descs = non_eop_descs;
 	adapter->alloc_rx_page_failed = alloc_rx_page_failed;
 	adapter->alloc_rx_buff_failed = alloc_rx_buff_failed;
@@ -8351,6 +9307,10 @@ void txgbe_update_stats(struct txgbe_adapter *adapter)
 		struct txgbe_ring *tx_ring = adapter->tx_ring[i];
 		restart_queue += tx_ring->tx_stats.restart_queue;
 		tx_busy += tx_ring->tx_stats.tx_busy;
+		tx_paced_stops += tx_ring->tx_stats.paced_stops;
+		atr_added += tx_ring->tx_stats.atr_added;
+		atr_suppressed += tx_ring->tx_stats.atr_suppressed;
+		atr_failed += tx_ring->tx_stats.atr_failed;
 		bytes += tx_ring->stats.bytes;
 		packets += tx_ring->stats.packets;
 	}
@@ -8364,6 +9324,10 @@ void txgbe_update_stats(struct txgbe_adapter *adapter)
 	}
 	adapter->restart_queue = restart_queue;
 	adapter->tx_busy = tx_busy;
+	adapter->tx_paced_stops = tx_paced_stops;
+	adapter->atr_added = atr_added;
+	adapter->atr_suppressed = atr_suppressed;
+	adapter->atr_failed = atr_failed;
 	net_stats->tx_bytes = bytes;
 	net_stats->tx_packets = packets;
 
@@ -8399,8 +9363,9 @@ void txgbe_update_stats(struct txgbe_adapter *adapter)
 	hwstats->gotc += (u64)rd32(hw, TXGBE_PX_GOTC_MSB) << 32;
 
 
-	adapter->hw_rx_no_dma_resources +=
-				     rd32(hw, TXGBE_RDM_DRP_PKT);
+	no_dma = rd32(hw, TXGBE_RDM_DRP_PKT);
+	adapter->hw_rx_no_dma_resources += no_dma;
+	txgbe_rx_pressure_drops(adapter, missed_rx + no_dma);
 	hwstats->lxonrxc += rd32(hw, TXGBE_MAC_LXONRXC);
 #ifdef HAVE_TX_MQ
 	hwstats->fdirmatch += rd32(hw, TXGBE_RDB_FDIR_MATCH);
@@ -8489,10 +9454,18 @@ static void txgbe_fdir_reinit_subtask(struct txgbe_adapter *adapter)
 
 	adapter->fdir_overflow++;
 
+	/* the table filled up: sample less from now on */
+	if (adapter->atr_backoff < TXGBE_ATR_BACKOFF_MAX)
+		adapter->atr_backoff++;
+
 	if (txgbe_reinit_fdir_tables(hw) == 0) {
-		for (i = 0; i < adapter->num_tx_queues; i++)
-			set_bit(__TXGBE_TX_FDIR_INIT_DONE,
-				&(adapter->tx_ring[i]->state));
+		for (i = 0; i < adapter->num_tx_queues; i++) {
+			struct txgbe_ring *ring = adapter->tx_ring[i];
+
+			ring->atr_sample_rate = txgbe_atr_rate(adapter);
+			memset(ring->atr_cache, 0, sizeof(ring->atr_cache));
+			set_bit(__TXGBE_TX_FDIR_INIT_DONE, &ring->state);
+		}
 		/* re-enable flow director interrupts */
 		wr32m(hw, TXGBE_PX_MISC_IEN,
 			TXGBE_PX_MISC_IEN_FLOW_DIR, TXGBE_PX_MISC_IEN_FLOW_DIR);
@@ -8501,7 +9474,301 @@ static void txgbe_fdir_reinit_subtask(struct txgbe_adapter *adapter)
 		      "ignored adding FDIR ATR filters\n");
 	}
 }
-#endif /* HAVE_TX_MQ */
+
+/**
+ * txgbe_atr_adapt_subtask - adapt the ATR sample rate to the FDIR table
+ * @adapter: pointer to the device adapter structure
+ *
+ * Runs at most once a second.  Sampling backs off, doubling the rate
+ * each time, while fewer than a quarter of the filters are free or adds
+ * fail, so the table does not fill up and force a flush by
+ * txgbe_fdir_reinit_subtask().  It speeds up again while more than half
+ * are free and most received packets miss the table.
+ **/
+static void txgbe_atr_adapt_subtask(struct txgbe_adapter *adapter)
+{
+	struct txgbe_hw *hw = &adapter->hw;
+	u64 match, miss;
+	u32 free, fail, backoff, rate;
+	int i;
+
+	if (!(adapter->flags & TXGBE_FLAG_FDIR_HASH_CAPABLE) ||
+	    !adapter->atr_sample_rate ||
+	    test_bit(__TXGBE_DOWN, &adapter->state) ||
+	    time_before(jiffies, adapter->atr_adapt_time + HZ))
+		return;
+	adapter->atr_adapt_time = jiffies;
+
+	free = rd32(hw, TXGBE_RDB_FDIR_FREE) & TXGBE_RDB_FDIR_FREE_FREE_MASK;
+	fail = rd32(hw, TXGBE_RDB_FDIR_FAIL_ST) &
+	       TXGBE_RDB_FDIR_FAIL_ST_ADD_MASK;
+	adapter->fdir_free_max = max(adapter->fdir_free_max, free);
+
+	/* fdirmatch and fdirmiss are summed by txgbe_update_stats() */
+	match = adapter->stats.fdirmatch - adapter->fdir_last_match;
+	miss = adapter->stats.fdirmiss - adapter->fdir_last_miss;
+	adapter->fdir_last_match = adapter->stats.fdirmatch;
+	adapter->fdir_last_miss = adapter->stats.fdirmiss;
+
+	backoff = adapter->atr_backoff;
+	if (fail || free < adapter->fdir_free_max / 4) {
+		if (backoff < TXGBE_ATR_BACKOFF_MAX)
+			backoff++;
+	} else if (backoff && free > adapter->fdir_free_max / 2 &&
+		   miss > match) {
+		backoff--;
+	}
+	if (backoff == adapter->atr_backoff)
+		return;
+
+	adapter->atr_backoff = backoff;
+	rate = txgbe_atr_rate(adapter);
+	for (i = 0; i < adapter->num_tx_queues; i++) {
+		struct txgbe_ring *ring = adapter->tx_ring[i];
+
+		if (ring->atr_sample_rate)
+			WRITE_ONCE(ring->atr_sample_rate, rate);
+	}
+}
+#endif /* HAVE_TX_MQ */
+
+/* map the interrupt causes of a vector's queues to MSI-X vector @v_idx */
+static void txgbe_vpack_map(struct txgbe_q_vector *q_vector, u16 v_idx)
+{
+	struct txgbe_adapter *adapter = q_vector->adapter;
+	struct txgbe_ring *ring;
+
+	txgbe_for_each_ring(ring, q_vector->rx)
+		txgbe_set_ivar(adapter, 0, ring->reg_idx, v_idx);
+	txgbe_for_each_ring(ring, q_vector->tx)
+		txgbe_set_ivar(adapter, 1, ring->reg_idx, v_idx);
+	TXGBE_WRITE_FLUSH(&adapter->hw);
+}
+
+/**
+ * txgbe_vpack_fold - move a vector's queue interrupts to a host vector
+ * @q_vector: vector to fold
+ * @host: vector that polls it from now on
+ *
+ * A cause raised before the IVAR write still sets the bit of @q_vector
+ * and is handled by its own interrupt, later ones wake @host.
+ **/
+static void txgbe_vpack_fold(struct txgbe_q_vector *q_vector,
+			     struct txgbe_q_vector *host)
+{
+	WRITE_ONCE(q_vector->vpack_host, host);
+	host->vpack_guests++;
+	txgbe_vpack_map(q_vector, host->v_idx);
+	q_vector->adapter->vpack_folds++;
+}
+
+/**
+ * txgbe_vpack_unfold - give a folded vector its own interrupt back
+ * @q_vector: folded vector
+ *
+ * The vector's interrupt is fired once for causes its host took after
+ * the last poll but before the IVAR write.
+ **/
+static void txgbe_vpack_unfold(struct txgbe_q_vector *q_vector)
+{
+	struct txgbe_adapter *adapter = q_vector->adapter;
+
+	txgbe_vpack_map(q_vector, q_vector->v_idx);
+	q_vector->vpack_host->vpack_guests--;
+	WRITE_ONCE(q_vector->vpack_host, NULL);
+	txgbe_intr_trigger(&adapter->hw, TXGBE_INTR_Q(q_vector->v_idx));
+	adapter->vpack_unfolds++;
+}
+
+/* unfold every vector, e.g. when packing is turned off */
+static void txgbe_vpack_unfold_all(struct txgbe_adapter *adapter)
+{
+	int i;
+
+	for (i = 0; i < adapter->num_q_vectors; i++)
+		if (adapter->q_vector[i]->vpack_host)
+			txgbe_vpack_unfold(adapter->q_vector[i]);
+}
+
+/**
+ * txgbe_set_vpack - set the vector packing thresholds
+ * @adapter: board private structure
+ * @low: packets/s below which a vector is folded
+ * @high: packets/s of a host and its folded vectors that unfolds them
+ * @hosts: number of vectors others are folded onto, from vector 0 up
+ *
+ * Takes effect at the next run of txgbe_vpack_subtask(), which unfolds
+ * the vectors a changed number of hosts moves to another host.
+ **/
+void txgbe_set_vpack(struct txgbe_adapter *adapter, u32 low, u32 high,
+		     u32 hosts)
+{
+	adapter->vpack_low = low;
+	adapter->vpack_high = high;
+	adapter->vpack_hosts = max_t(u32, hosts, 1);
+}
+
+/**
+ * txgbe_vpack_subtask - fold idle queue vectors onto fewer interrupts
+ * @adapter: pointer to the device adapter structure
+ *
+ * With the vector-packing private flag set, runs at most once a second.
+ * A vector carrying fewer than vpack_low packets/s has its queue causes
+ * mapped to one of the first vpack_hosts vectors, vector i to host
+ * i % vpack_hosts, as long as that keeps the host under half of
+ * vpack_high.  The host's poll then schedules its NAPI context, so idle
+ * queues cost no interrupt wake-ups of their own.  Once a host and its
+ * folded vectors reach vpack_high packets/s, all of them are unfolded.
+ **/
+static void txgbe_vpack_subtask(struct txgbe_adapter *adapter)
+{
+	unsigned long elapsed = jiffies - adapter->vpack_time;
+	u32 hosts = adapter->vpack_hosts;
+	int i;
+
+	if (!(adapter->flags & TXGBE_FLAG_MSIX_ENABLED) ||
+	    test_bit(__TXGBE_DOWN, &adapter->state) ||
+	    test_bit(__TXGBE_RESETTING, &adapter->state) ||
+	    test_bit(__TXGBE_REMOVING, &adapter->state) ||
+	    elapsed < HZ)
+		return;
+	adapter->vpack_time = jiffies;
+
+	for (i = 0; i < adapter->num_q_vectors; i++) {
+		struct txgbe_q_vector *q_vector = adapter->q_vector[i];
+		struct txgbe_ring *ring;
+		u64 pkts = 0;
+
+		txgbe_for_each_ring(ring, q_vector->rx)
+			pkts += ring->stats.packets;
+		txgbe_for_each_ring(ring, q_vector->tx)
+			pkts += ring->stats.packets;
+		q_vector->vpack_rate = min_t(u64, U32_MAX,
+					     div_u64((pkts - q_vector->vpack_pkts)
+						     * HZ, elapsed));
+		q_vector->vpack_pkts = pkts;
+		q_vector->vpack_load = q_vector->vpack_rate;
+	}
+
+	if (!(adapter->eth_priv_flags & TXGBE_ETH_PRIV_FLAG_VECTOR_PACKING) ||
+	    hosts >= adapter->num_q_vectors) {
+		txgbe_vpack_unfold_all(adapter);
+		return;
+	}
+
+	/* a folded vector counts against its host */
+	for (i = 0; i < adapter->num_q_vectors; i++) {
+		struct txgbe_q_vector *q_vector = adapter->q_vector[i];
+		struct txgbe_q_vector *host = q_vector->vpack_host;
+
+		if (!host)
+			continue;
+		if (host != adapter->q_vector[i % hosts]) {
+			txgbe_vpack_unfold(q_vector);
+			continue;
+		}
+		host->vpack_load += q_vector->vpack_rate;
+	}
+
+	for (i = hosts; i < adapter->num_q_vectors; i++) {
+		struct txgbe_q_vector *q_vector = adapter->q_vector[i];
+		struct txgbe_q_vector *host = adapter->q_vector[i % hosts];
+
+		if (q_vector->vpack_host) {
+			if (host->vpack_load >= adapter->vpack_high)
+				txgbe_vpack_unfold(q_vector);
+			continue;
+		}
+		if (q_vector->vpack_rate >= adapter->vpack_low ||
+		    host->vpack_load + q_vector->vpack_rate >=
+		    adapter->vpack_high / 2 ||
+		    (!q_vector->rx.ring && !q_vector->tx.ring))
+			continue;
+		txgbe_vpack_fold(q_vector, host);
+		host->vpack_load += q_vector->vpack_rate;
+	}
+}
+
+/**
+ * txgbe_napi_thread_subtask - keep NAPI threads on their vector settings
+ * @adapter: pointer to the device adapter structure
+ *
+ * Picks up threads the kernel started after /sys/class/net/<dev>/threaded
+ * was written, and vectors whose IRQ affinity moved.
+ **/
+static void txgbe_napi_thread_subtask(struct txgbe_adapter *adapter)
+{
+	int i;
+
+	if (test_bit(__TXGBE_DOWN, &adapter->state) ||
+	    test_bit(__TXGBE_RESETTING, &adapter->state))
+		return;
+
+#ifdef HAVE_DEV_SET_THREADED
+	/* the private flag reports what sysfs may have changed */
+	if (READ_ONCE(adapter->netdev->threaded))
+		adapter->eth_priv_flags |= TXGBE_ETH_PRIV_FLAG_NAPI_THREADED;
+	else
+		adapter->eth_priv_flags &= ~TXGBE_ETH_PRIV_FLAG_NAPI_THREADED;
+
+#endif
+	for (i = 0; i < adapter->num_q_vectors; i++) {
+		struct txgbe_q_vector *q_vector = adapter->q_vector[i];
+
+		if (txgbe_qv_thread(q_vector) !=
+		    READ_ONCE(q_vector->napi_thread_applied))
+			break;
+	}
+	if (i == adapter->num_q_vectors || !rtnl_trylock())
+		return;
+
+	txgbe_napi_threads_apply(adapter);
+	rtnl_unlock();
+}
+
+/**
+ * txgbe_xps_subtask - rewrite the XPS map of Tx rings whose IRQ moved
+ * @adapter: pointer to the device adapter structure
+ *
+ * txgbe_irq_affinity_notify() clears the XPS init bit of the rings it
+ * moves.  netif_set_xps_queue() must not race a reinit, so the map is
+ * written here under rtnl; while down or resetting, txgbe_configure_tx_ring()
+ * writes it instead.
+ **/
+static void txgbe_xps_subtask(struct txgbe_adapter *adapter)
+{
+	int i;
+
+	if (test_bit(__TXGBE_DOWN, &adapter->state) ||
+	    test_bit(__TXGBE_RESETTING, &adapter->state))
+		return;
+
+	for (i = 0; i < adapter->num_tx_queues; i++)
+		if (!test_bit(__TXGBE_TX_XPS_INIT_DONE,
+			      &adapter->tx_ring[i]->state))
+			break;
+	if (i == adapter->num_tx_queues || !rtnl_trylock())
+		return;
+
+	/* the reinit may have finished while waiting for rtnl */
+	if (test_bit(__TXGBE_DOWN, &adapter->state) ||
+	    test_bit(__TXGBE_RESETTING, &adapter->state))
+		goto unlock;
+
+	for (; i < adapter->num_tx_queues; i++) {
+		struct txgbe_ring *ring = adapter->tx_ring[i];
+		struct txgbe_q_vector *q_vector = ring->q_vector;
+
+		if (test_and_set_bit(__TXGBE_TX_XPS_INIT_DONE, &ring->state))
+			continue;
+		if (q_vector && !cpumask_empty(&q_vector->affinity_mask))
+			netif_set_xps_queue(adapter->netdev,
+					    &q_vector->affinity_mask,
+					    ring->queue_index);
+	}
+unlock:
+	rtnl_unlock();
+}
 
 /**
  * txgbe_check_hang_subtask - check for hung queues and dropped interrupts
@@ -8695,6 +9962,7 @@ static void txgbe_watchdog_link_is_up(struct txgbe_adapter *adapter)
 	       (flow_tx ? "TX" : "None"))));
 
 	netif_carrier_on(netdev);
+	txgbe_link_event(adapter, TXGBE_LINK_EV_CARRIER_UP);
 
 	netif_tx_wake_all_queues(netdev);
 #ifdef HAVE_VIRTUAL_STATION
@@ -8745,6 +10013,7 @@ static void txgbe_watchdog_link_is_down(struct txgbe_adapter *adapter)
 #endif
 	e_info(drv, "NIC Link is Down\n");
 	netif_carrier_off(netdev);
+	txgbe_link_event(adapter, TXGBE_LINK_EV_CARRIER_DOWN);
 	netif_tx_stop_all_queues(netdev);
 
 	/* ping all the active vfs to let them know link has changed */
@@ -8940,6 +10209,10 @@ static void txgbe_sfp_detection_subtask(struct txgbe_adapter *adapter)
 
 	adapter->sfp_poll_time = jiffies + TXGBE_SFP_POLL_JIFFIES - 1;
 
+	/* module event pending, cached EEPROM may belong to the old one */
+	if (adapter->flags2 & TXGBE_FLAG2_SFP_NEEDS_RESET)
+		txgbe_module_invalidate(adapter);
+
 	err = TCALL(hw, phy.ops.identify_sfp);
 	if (err == TXGBE_ERR_SFP_NOT_SUPPORTED)
 		goto sfp_out;
@@ -8976,6 +10249,14 @@ static void txgbe_sfp_detection_subtask(struct txgbe_adapter *adapter)
 	adapter->flags |= TXGBE_FLAG_NEED_LINK_CONFIG;
 	e_info(probe, "detected SFP+: %d\n", hw->phy.sfp_type);
 
+	/* static pages are read once per insertion, see txgbe_module_read()
+	 * for a port that is down
+	 */
+	if (!test_bit(__TXGBE_DOWN, &adapter->state) &&
+	    txgbe_module_fill(adapter))
+		e_dev_warn("failed to read SFP+ module EEPROM, "
+			   "ethtool -m will retry\n");
+
 sfp_out:
 	clear_bit(__TXGBE_IN_SFP_INIT, &adapter->state);
 
@@ -9070,6 +10351,30 @@ static void txgbe_sfp_reset_eth_phy_subtask(struct txgbe_adapter *adapter)
 	}
 }
 
+/**
+ * txgbe_service_timer_period - service timer interval
+ * @adapter: board private structure
+ *
+ * Returns the interval in jiffies until the next service timer tick for
+ * the current link state and device type.
+ **/
+static unsigned long txgbe_service_timer_period(struct txgbe_adapter *adapter)
+{
+	struct txgbe_hw *hw = &adapter->hw;
+
+	/* poll faster when waiting for link */
+	if (adapter->flags & TXGBE_FLAG_NEED_LINK_UPDATE) {
+		if ((hw->subsystem_device_id & 0xF0) == TXGBE_ID_KR_KX_KX4)
+			return HZ;
+		else if (BOND_CHECK_LINK_MODE == 1)
+			return HZ / 100;
+		else
+			return HZ / 10;
+	}
+
+	return HZ * 2;
+}
+
 /**
  * txgbe_service_timer - Timer Call-back
  * @data: pointer to adapter cast into an unsigned long
@@ -9081,16 +10386,7 @@ static void txgbe_service_timer(struct timer_list *t)
 	struct txgbe_hw *hw = &adapter->hw;
 	u32 val = 0;
 
-	/* poll faster when waiting for link */
-	if (adapter->flags & TXGBE_FLAG_NEED_LINK_UPDATE) {
-		if ((hw->subsystem_device_id & 0xF0) == TXGBE_ID_KR_KX_KX4)
-			next_event_offset = HZ ;
-		else if (BOND_CHECK_LINK_MODE == 1)
-			next_event_offset = HZ / 100;
-		else
-			next_event_offset = HZ / 10;
-	} else
-		next_event_offset = HZ * 2;
+	next_event_offset = txgbe_service_timer_period(adapter);
 
 	/* record which func to provoke PCIE recovery */
 	if (rd32(&adapter->hw, TXGBE_MIS_PF_SM) == 1) {
@@ -9194,6 +10490,10 @@ release_sem:
 	if (hw->f2c_mod_status != status) {
 		hw->f2c_mod_status = status;
 		adapter->flags |= TXGBE_FLAG_NEED_LINK_UPDATE;
+		adapter->link_check_timeout = jiffies;
+		txgbe_link_event(adapter, TXGBE_LINK_EV_SFP_POLL);
+		/* no interrupt for the copper PHY, act on the poll now */
+		txgbe_service_event_kick(adapter);
 	}
 }
 
@@ -9224,6 +10524,143 @@ static void txgbe_link_check_timer(struct timer_list *t)
 }
 #endif
 
+/**
+ * txgbe_restart_tx_ring - flush and restart a single Tx ring
+ * @adapter: board private structure
+ * @tx_ring: ring to restart, its subqueue is stopped
+ *
+ * Same sequence as txgbe_txrx_ring_disable()/txgbe_txrx_ring_enable() for
+ * AF_XDP, limited to the Tx ring.  Returns true if the queue came back.
+ * A queue that does not stop after the flush keeps its buffers and stays
+ * disabled until the full reset the caller then requests; txgbe_configure_tx()
+ * enables it again.
+ **/
+static bool txgbe_restart_tx_ring(struct txgbe_adapter *adapter,
+				  struct txgbe_ring *tx_ring)
+{
+	struct txgbe_hw *hw = &adapter->hw;
+	struct txgbe_q_vector *q_vector = tx_ring->q_vector;
+	struct netdev_queue *txq = txring_txq(tx_ring);
+	bool ok;
+	int i;
+
+	adapter->tx_queue_restarts++;
+	tx_ring->last_tx_restart = jiffies;
+	txgbe_trace(reset_step, adapter, TXGBE_TRACE_TX_RESTART,
+		    tx_ring->queue_index);
+
+	/* keep xmit off the ring and wait out one already inside it */
+	set_bit(__TXGBE_TX_DISABLED, &tx_ring->state);
+	__netif_tx_lock_bh(txq);
+	__netif_tx_unlock_bh(txq);
+
+	/* Rx and Tx of the vector share the napi context */
+	napi_disable(&q_vector->napi);
+
+	wr32(hw, TXGBE_PX_TR_CFG(tx_ring->reg_idx), TXGBE_PX_TR_CFG_SWFLSH);
+	TXGBE_WRITE_FLUSH(hw);
+	for (i = 0; i < TXGBE_TX_FLUSH_POLL; i++) {
+		if (TXGBE_REMOVED(hw->hw_addr) ||
+		    !(rd32(hw, TXGBE_PX_TR_CFG(tx_ring->reg_idx)) &
+		      TXGBE_PX_TR_CFG_ENABLE))
+			break;
+		usleep_range(1000, 2000);
+	}
+
+	/* the engine may still fetch from the buffers, leave them mapped
+	 * and let the caller escalate to a full reset
+	 */
+	if (i == TXGBE_TX_FLUSH_POLL || TXGBE_REMOVED(hw->hw_addr)) {
+		e_err(drv, "Tx queue %d did not stop after a flush\n",
+		      tx_ring->reg_idx);
+		napi_enable(&q_vector->napi);
+#ifndef HAVE_DEV_SET_THREADED
+		if (txgbe_qv_thread_schedule(q_vector))
+			return false;
+#endif
+		local_bh_disable();
+		napi_schedule(&q_vector->napi);
+		local_bh_enable();
+		return false;
+	}
+
+	txgbe_clean_tx_ring(tx_ring);
+	txgbe_configure_tx_ring(adapter, tx_ring);
+	ok = !TXGBE_REMOVED(hw->hw_addr) &&
+	     (rd32(hw, TXGBE_PX_TR_CFG(tx_ring->reg_idx)) &
+	      TXGBE_PX_TR_CFG_ENABLE);
+
+	clear_bit(__TXGBE_TX_DISABLED, &tx_ring->state);
+	napi_enable(&q_vector->napi);
+	/* an interrupt that came in while napi was disabled left the vector
+	 * masked, poll once to unmask it
+	 */
+#ifndef HAVE_DEV_SET_THREADED
+	if (!txgbe_qv_thread_schedule(q_vector))
+#endif
+	{
+		local_bh_disable();
+		napi_schedule(&q_vector->napi);
+		local_bh_enable();
+	}
+
+	if (ok)
+		netif_tx_wake_queue(txq);
+	return ok;
+}
+
+/**
+ * txgbe_tx_restart_subtask - restart Tx queues that reported a hang
+ * @adapter: board private structure
+ *
+ * Runs the single queue restarts requested by txgbe_tx_hang_restart().  A
+ * queue that does not come back escalates to the full reset done by
+ * txgbe_reset_subtask().
+ **/
+static void txgbe_tx_restart_subtask(struct txgbe_adapter *adapter)
+{
+	struct txgbe_ring *tx_ring;
+	bool failed = false;
+	int i;
+
+	for (i = 0; i < adapter->num_tx_queues; i++)
+		if (test_bit(__TXGBE_TX_RESTART_REQ,
+			     &adapter->tx_ring[i]->state))
+			break;
+	if (i == adapter->num_tx_queues)
+		return;
+
+	rtnl_lock();
+	for (i = 0; i < adapter->num_tx_queues; i++) {
+		tx_ring = adapter->tx_ring[i];
+		if (!test_and_clear_bit(__TXGBE_TX_RESTART_REQ,
+					&tx_ring->state))
+			continue;
+
+		/* a reset or down already takes care of the ring */
+		if (test_bit(__TXGBE_DOWN, &adapter->state) ||
+		    test_bit(__TXGBE_RESETTING, &adapter->state) ||
+		    test_bit(__TXGBE_REMOVING, &adapter->state))
+			continue;
+
+		if (txgbe_restart_tx_ring(adapter, tx_ring))
+			continue;
+
+		adapter->tx_queue_restart_failed++;
+		txgbe_trace(reset_step, adapter, TXGBE_TRACE_TX_RESTART_FAIL,
+			    tx_ring->queue_index);
+		e_err(drv, "Tx queue %d did not restart\n",
+		      tx_ring->queue_index);
+		failed = true;
+	}
+	rtnl_unlock();
+
+	if (failed) {
+		txgbe_print_tx_hang_status(adapter);
+		txgbe_tx_timeout_reset(adapter);
+	}
+}
+
 static void txgbe_reset_subtask(struct txgbe_adapter *adapter)
 {
 	u32 reset_flag = 0;
@@ -9242,6 +10679,7 @@ static void txgbe_reset_subtask(struct txgbe_adapter *adapter)
 
 	netdev_err(adapter->netdev, "Reset adapter\n");
 	adapter->tx_timeout_count++;
+	txgbe_trace(reset_step, adapter, TXGBE_TRACE_RESET_SUBTASK, -1);
 
 	rtnl_lock();
 	if (adapter->flags2 & TXGBE_FLAG2_GLOBAL_RESET_REQUESTED) {
@@ -9332,6 +10770,7 @@ static void txgbe_check_pcie_subtask(struct txgbe_adapter *adapter)
 	if (!(adapter->flags2 & TXGBE_FLAG2_PCIE_NEED_RECOVER))
 		return;
 
+	txgbe_trace(reset_step, adapter, TXGBE_TRACE_PCIE_RECOVER, -1);
 	txgbe_print_tx_hang_status(adapter);
 
 	wr32m(&adapter->hw, TXGBE_MIS_PF_SM, TXGBE_MIS_PF_SM_SM, 0);
@@ -9340,7 +10779,7 @@ static void txgbe_check_pcie_subtask(struct txgbe_adapter *adapter)
 		status = txgbe_check_recovery_capability(adapter->pdev);
 		if (status) {
 			e_info(probe, "do recovery\n");
-			txgbe_pcie_do_recovery(adapter->pdev);
+			txgbe_pcie_do_recovery(adapter);
 		} else {
 			e_err(drv, "This platform can't support pcie recovery, skip it\n");
 		}
@@ -9358,6 +10797,10 @@ static void txgbe_service_task(struct work_struct *work)
 	struct txgbe_adapter *adapter = container_of(work,
 						     struct txgbe_adapter,
 						     service_task);
+
+	/* events flagged before this point are handled by this pass */
+	clear_bit(__TXGBE_SERVICE_RERUN, &adapter->state);
+	smp_mb__after_atomic();
 	if (TXGBE_REMOVED(adapter->hw.hw_addr)) {
 		if (!test_bit(__TXGBE_DOWN, &adapter->state)) {
 			rtnl_lock();
@@ -9383,16 +10826,35 @@ static void txgbe_service_task(struct work_struct *work)
 #endif /* HAVE_UDP_ENC_RX_OFFLOAD || HAVE_VXLAN_RX_OFFLOAD */
 
 	txgbe_check_pcie_subtask(adapter);
+	txgbe_tx_restart_subtask(adapter);
 	txgbe_reset_subtask(adapter);
 	txgbe_sfp_detection_subtask(adapter);
 	txgbe_sfp_link_config_subtask(adapter);
 	txgbe_sfp_reset_eth_phy_subtask(adapter);
+	txgbe_module_dom_subtask(adapter);
 	txgbe_check_overtemp_subtask(adapter);
 	txgbe_watchdog_subtask(adapter);
 #ifdef HAVE_TX_MQ
 	txgbe_fdir_reinit_subtask(adapter);
+	txgbe_atr_adapt_subtask(adapter);
 #endif
+	txgbe_vpack_subtask(adapter);
+	txgbe_napi_thread_subtask(adapter);
+	txgbe_xps_subtask(adapter);
 	txgbe_check_hang_subtask(adapter);
+
+	/* still waiting for link: the service timer is the safety net for a
+	 * missed interrupt, don't leave it armed for the idle period
+	 */
+	if ((adapter->flags & TXGBE_FLAG_NEED_LINK_UPDATE) &&
+	    !test_bit(__TXGBE_DOWN, &adapter->state) &&
+	    timer_pending(&adapter->service_timer)) {
+		unsigned long expires = jiffies +
+					txgbe_service_timer_period(adapter);
+
+		if (time_after(adapter->service_timer.expires, expires))
+			mod_timer(&adapter->service_timer, expires);
+	}
 #ifdef HAVE_PTP_1588_CLOCK
 	if (test_bit(__TXGBE_PTP_RUNNING, &adapter->state)) {
 		txgbe_ptp_overflow_check(adapter);
@@ -9996,6 +11458,9 @@ static int __txgbe_maybe_stop_tx(struct txgbe_ring *tx_ring, u16 size)
 {
 	struct txgbe_adapter *adapter = netdev_priv(tx_ring->netdev);
 	netif_stop_subqueue(tx_ring->netdev, tx_ring->queue_index);
+	txgbe_trace(tx_queue_stop, tx_ring, size);
+	if (tx_ring->tx_maxrate)
+		++tx_ring->tx_stats.paced_stops;
 
 	/* Herbert's original patch had:
 	 *  smp_mb__after_netif_stop_queue();
@@ -10018,6 +11483,7 @@ static int __txgbe_maybe_stop_tx(struct txgbe_ring *tx_ring, u16 size)
 	/* A reprieve! - use start_queue because it doesn't call schedule */
 	netif_start_subqueue(tx_ring->netdev, tx_ring->queue_index);
 	++tx_ring->tx_stats.restart_queue;
+	txgbe_trace(tx_queue_wake, tx_ring, size);
 	return 0;
 }
 
@@ -10042,6 +11508,7 @@ static int txgbe_tx_map(struct txgbe_ring *tx_ring,
 	u32 tx_flags = first->tx_flags;
 	u32 cmd_type = txgbe_tx_cmd_type(tx_flags);
 	u16 i = tx_ring->next_to_use;
+	bool kick;
 
 	tx_desc = TXGBE_TX_DESC(tx_ring, i);
 
@@ -10152,7 +11619,11 @@ static int txgbe_tx_map(struct txgbe_ring *tx_ring,
 
 	txgbe_maybe_stop_tx(tx_ring, DESC_NEEDED);
 
-	if (netif_xmit_stopped(txring_txq(tx_ring)) || !netdev_xmit_more()) {
+	kick = netif_xmit_stopped(txring_txq(tx_ring)) || !netdev_xmit_more();
+	txgbe_trace(tx_map, tx_ring, first - tx_ring->tx_buffer_info,
+		    first->bytecount, kick);
+
+	if (kick) {
 		writel(i, tx_ring->tail);
 #ifndef SPIN_UNLOCK_IMPLIES_MMIOWB
 
@@ -10204,12 +11675,17 @@ static void txgbe_atr(struct txgbe_ring *ring,
 	struct txgbe_q_vector *q_vector = ring->q_vector;
 	union txgbe_atr_hash_dword input = { .dword = 0 };
 	union txgbe_atr_hash_dword common = { .dword = 0 };
+	struct txgbe_adapter *adapter;
 	union network_header hdr;
 	struct tcphdr *th;
+	u32 hash, idx;
+	u64 key;
+	u16 gen;
 
 	/* if ring doesn't have a interrupt vector, cannot perform ATR */
 	if (!q_vector)
 		return;
+	adapter = q_vector->adapter;
 
 	/* do nothing if sampling is disabled */
 	if (!ring->atr_sample_rate)
@@ -10283,9 +11759,41 @@ static void txgbe_atr(struct txgbe_ring *ring,
 		common.ip ^= hdr.ipv4->saddr ^ hdr.ipv4->daddr;
 	}
 
-	/* This assumes the Rx queue and Tx queue are bound to the same CPU */
-	txgbe_fdir_add_signature_filter(&q_vector->adapter->hw,
-					      input, common, ring->queue_index);
+	/*
+	 * A flow whose filter this ring wrote last time is not written
+	 * again: the write polls FDIRCMD from the xmit path and only
+	 * repeats what the table already holds.  Bit 15 is not part of the
+	 * hash, so an empty slot never matches.  The ring stands for the
+	 * target queue of the cached filter.  Every write bumps the slot's
+	 * generation in the adapter, which the entry must also match, so a
+	 * write for another ring drops the flow from this one without
+	 * looking at the other rings, and a flow that moves back to a ring
+	 * it used before is written again.
+	 */
+	hash = txgbe_atr_compute_sig_hash(input, common);
+	idx = (hash ^ (hash >> 16)) & (TXGBE_ATR_CACHE_SIZE - 1);
+	gen = READ_ONCE(adapter->atr_gen[idx]);
+	key = hash | BIT(15);
+	if (ring->atr_cache[idx] == (key | (u64)gen << 32)) {
+		ring->tx_stats.atr_suppressed++;
+		return;
+	}
+
+	/*
+	 * This assumes the Rx queue and Tx queue are bound to the same CPU,
+	 * which the flow-affinity private flag guarantees without XPS, see
+	 * txgbe_flow_txq()
+	 */
+	if (txgbe_fdir_write_signature(&adapter->hw,
+				       input.formatted.flow_type, hash,
+				       ring->queue_index)) {
+		ring->tx_stats.atr_failed++;
+		return;
+	}
+	gen = READ_ONCE(adapter->atr_gen[idx]) + 1;
+	WRITE_ONCE(adapter->atr_gen[idx], gen);
+	ring->atr_cache[idx] = key | (u64)gen << 32;
+	ring->tx_stats.atr_added++;
 }
 
 
@@ -10345,7 +11853,7 @@ static int txgbe_xdp_setup(struct net_device *dev, struct bpf_prog *prog)
 			adapter->lro_before_xdp = !!(adapter->flags2 & TXGBE_FLAG2_RSC_ENABLED);
 			if (adapter->flags2 & TXGBE_FLAG2_RSC_ENABLED) {
 				e_dev_err("XDP not support LRO");
-				dev->features &= ~NETIF_F_LRO;
+				dev->features &= ~TXGBE_NETIF_F_RSC;
 				adapter->flags2 &= ~TXGBE_FLAG2_RSC_ENABLED;
 			}
 		}
@@ -10466,10 +11974,8 @@ static int txgbe_xdp_xmit(struct net_device *dev, struct xdp_buff *xdp)
 	if (unlikely(!ring))
 		return -ENXIO;
 
-#ifdef HAVE_AF_XDP_ZC_SUPPORT
 	if (unlikely(test_bit(__TXGBE_TX_DISABLED, &ring->state)))
 		return -ENXIO;
-#endif
 	
 #ifdef HAVE_NDO_XDP_XMIT_BULK_AND_FLAGS
 	if (static_branch_unlikely(&txgbe_xdp_locking_key))
@@ -10541,14 +12047,123 @@ static void txgbe_xdp_flush(struct net_device *dev)
 #endif /*HAVE_XDP_SUPPORT*/
 
 #ifdef HAVE_NETDEV_SELECT_QUEUE
-#if IS_ENABLED(CONFIG_FCOE)
+/* RSS key byte @i as the hardware reads it out of RSSRK */
+#define TXGBE_RSS_KEY_BYTE(key, i) \
+	((u32)(u8)((key)[(i) >> 2] >> (((i) & 3) * 8)))
+
+/**
+ * txgbe_rss_hash - compute the Toeplitz hash RSS gives a frame
+ * @key: RSS key, as written to RSSRK
+ * @data: hash input in network byte order
+ * @len: length of @data, at most TXGBE_RSS_KEY_SIZE - 4
+ **/
+static u32 txgbe_rss_hash(const u32 *key, const u8 *data, unsigned int len)
+{
+	unsigned int i, b;
+	u32 v, hash = 0;
+
+	v = TXGBE_RSS_KEY_BYTE(key, 0) << 24 | TXGBE_RSS_KEY_BYTE(key, 1) << 16 |
+	    TXGBE_RSS_KEY_BYTE(key, 2) << 8 | TXGBE_RSS_KEY_BYTE(key, 3);
+	for (i = 0; i < len; i++) {
+		u32 next = TXGBE_RSS_KEY_BYTE(key, i + 4);
+
+		for (b = 0; b < 8; b++) {
+			if (data[i] & (0x80 >> b))
+				hash ^= v;
+			v = v << 1 | ((next >> (7 - b)) & 1);
+		}
+	}
+
+	return hash;
+}
+
+/**
+ * txgbe_flow_txq - pick the Tx queue paired with a flow's Rx queue
+ * @adapter: board private structure
+ * @skb: packet to send
+ *
+ * A forwarded packet goes out on the queue number it came in on.  For a
+ * local flow the RSS hash of the reply direction is computed the way the
+ * hardware does it and looked up in the redirection table.  Either way
+ * the Tx completions are cleaned by the vector that receives the flow,
+ * and ATR, which steers a flow to the queue it is sent on, agrees with
+ * RSS instead of following whatever CPU the sender ran on.
+ *
+ * Returns the queue, or -1 if the packet is not IP.
+ **/
+static int txgbe_flow_txq(struct txgbe_adapter *adapter, struct sk_buff *skb)
+{
+	unsigned int nq = adapter->netdev->real_num_tx_queues;
+	const u8 *nh = skb_network_header(skb);
+	const u8 *end = skb_tail_pointer(skb);
+	u8 data[36];			/* IPv6 addresses and ports */
+	unsigned int len;
+	bool ports;
+	u32 hash;
+	int txq;
+
+	if (skb_rx_queue_recorded(skb)) {
+		txq = skb_get_rx_queue(skb);
+		while (txq >= nq)
+			txq -= nq;
+		return txq;
+	}
+
+	/* the reply is hashed: destination first, then source */
+	switch (vlan_get_protocol(skb)) {
+	case __constant_htons(ETH_P_IP): {
+		const struct iphdr *iph = (const struct iphdr *)nh;
+
+		if (nh < skb->data || nh + sizeof(*iph) > end)
+			return -1;
+		memcpy(data, &iph->daddr, 4);
+		memcpy(data + 4, &iph->saddr, 4);
+		len = 8;
+		ports = !(iph->frag_off & htons(IP_MF | IP_OFFSET)) &&
+			(iph->protocol == IPPROTO_TCP ||
+			 (iph->protocol == IPPROTO_UDP &&
+			  adapter->flags2 & TXGBE_FLAG2_RSS_FIELD_IPV4_UDP));
+		nh += iph->ihl * 4;
+		break;
+	}
+	case __constant_htons(ETH_P_IPV6): {
+		const struct ipv6hdr *ip6h = (const struct ipv6hdr *)nh;
+
+		if (nh < skb->data || nh + sizeof(*ip6h) > end)
+			return -1;
+		memcpy(data, &ip6h->daddr, 16);
+		memcpy(data + 16, &ip6h->saddr, 16);
+		len = 32;
+		ports = ip6h->nexthdr == IPPROTO_TCP ||
+			(ip6h->nexthdr == IPPROTO_UDP &&
+			 adapter->flags2 & TXGBE_FLAG2_RSS_FIELD_IPV6_UDP);
+		nh += sizeof(*ip6h);
+		break;
+	}
+	default:
+		return -1;
+	}
+
+	/* TCP and UDP both start with source and destination port */
+	if (ports && nh + 4 <= end) {
+		memcpy(data + len, nh + 2, 2);
+		memcpy(data + len + 2, nh, 2);
+		len += 4;
+	}
+
+	hash = txgbe_rss_hash(adapter->rss_key, data, len);
+	txq = adapter->rss_indir_tbl[hash &
+				     (txgbe_rss_indir_tbl_entries(adapter) - 1)];
+
+	return txq < nq ? txq : -1;
+}
 
 #if defined(HAVE_NDO_SELECT_QUEUE_FALLBACK_REMOVED)
 static u16 txgbe_select_queue(struct net_device *dev, struct sk_buff *skb,
 			      struct net_device *sb_dev)
 #elif defined(HAVE_NDO_SELECT_QUEUE_SB_DEV)
 static u16 txgbe_select_queue(struct net_device *dev, struct sk_buff *skb,
-			      __always_unused struct net_device *sb_dev,
+			      struct net_device *sb_dev,
 			      select_queue_fallback_t fallback)
 #elif defined(HAVE_NDO_SELECT_QUEUE_ACCEL_FALLBACK)
 static u16 txgbe_select_queue(struct net_device *dev, struct sk_buff *skb,
@@ -10562,44 +12177,63 @@ static u16 txgbe_select_queue(struct net_device *dev, struct sk_buff *skb)
 #endif /* HAVE_NDO_SELECT_QUEUE_ACCEL */
 {
 	struct txgbe_adapter *adapter = netdev_priv(dev);
+#if IS_ENABLED(CONFIG_FCOE)
 	struct txgbe_ring_feature *f;
+#endif
 	int txq;
 
+#if IS_ENABLED(CONFIG_FCOE)
 	/*
-	 * only execute the code below if protocol is FCoE
-	 * or FIP and we have FCoE enabled on the adapter
+	 * FCoE and FIP go to the FCoE queues if we have FCoE enabled on
+	 * the adapter
 	 */
 	switch (vlan_get_protocol(skb)) {
 	case __constant_htons(ETH_P_FCOE):
 	case __constant_htons(ETH_P_FIP):
-		adapter = netdev_priv(dev);
-
-		if (adapter->flags & TXGBE_FLAG_FCOE_ENABLED)
+		if (!(adapter->flags & TXGBE_FLAG_FCOE_ENABLED))
 			break;
-		fallthrough;
+
+		f = &adapter->ring_feature[RING_F_FCOE];
+
+		txq = skb_rx_queue_recorded(skb) ? skb_get_rx_queue(skb) :
+						   smp_processor_id();
+
+		while (txq >= f->indices)
+			txq -= f->indices;
+
+		return txq + f->offset;
 	default:
+		break;
+	}
+#endif /* CONFIG_FCOE */
+
+	/*
+	 * Flow affinity only knows the plain RSS layout: no pools, no traffic
+	 * classes and no macvlan offload queues.
+	 */
+	if ((adapter->eth_priv_flags & TXGBE_ETH_PRIV_FLAG_FLOW_AFFINITY) &&
+	    (adapter->flags2 & TXGBE_FLAG2_RSS_ENABLED) &&
+	    !(adapter->flags & TXGBE_FLAG_VMDQ_ENABLED) &&
+#if defined(HAVE_NDO_SELECT_QUEUE_FALLBACK_REMOVED) || \
+	defined(HAVE_NDO_SELECT_QUEUE_SB_DEV)
+	    (!sb_dev || sb_dev == dev) &&
+#endif
+	    !netdev_get_num_tc(dev)) {
+		txq = txgbe_flow_txq(adapter, skb);
+		if (txq >= 0)
+			return txq;
+	}
+
 #if defined(HAVE_NDO_SELECT_QUEUE_FALLBACK_REMOVED)
-		return netdev_pick_tx(dev, skb, sb_dev);
+	return netdev_pick_tx(dev, skb, sb_dev);
 #elif defined(HAVE_NDO_SELECT_QUEUE_SB_DEV)
-		return fallback(dev, skb, sb_dev);
+	return fallback(dev, skb, sb_dev);
 #elif defined(HAVE_NDO_SELECT_QUEUE_ACCEL_FALLBACK)
-		return fallback(dev, skb);
+	return fallback(dev, skb);
 #else
-		return __netdev_pick_tx(dev, skb);
+	return __netdev_pick_tx(dev, skb);
 #endif
-	}
-
-	f = &adapter->ring_feature[RING_F_FCOE];
-
-	txq = skb_rx_queue_recorded(skb) ? skb_get_rx_queue(skb) :
-					   smp_processor_id();
-
-	while (txq >= f->indices)
-		txq -= f->indices;
-
-	return txq + f->offset;
 }
-#endif /* CONFIG_FCOE */
 #endif /* HAVE_NETDEV_SELECT_QUEUE */
 
 /**
@@ -10737,10 +12371,8 @@ netdev_tx_t txgbe_xmit_frame_ring(struct sk_buff *skb,
 #endif
 		tx_flags |= TXGBE_TX_FLAGS_TSTAMP;
 
-		/* schedule check for Tx timestamp */
-		adapter->ptp_tx_skb = skb_get(skb);
-		adapter->ptp_tx_start = jiffies;
-		schedule_work(&adapter->ptp_tx_work);
+		/* track the skb until its Tx timestamp is delivered */
+		txgbe_ptp_tx_queued(adapter, skb);
 		} else {
 			adapter->tx_hwtstamp_skipped++;
 		}
@@ -10849,12 +12481,8 @@ out_drop:
 	first->skb = NULL;
 #ifdef HAVE_PTP_1588_CLOCK
 cleanup_tx_tstamp:
-	if (unlikely(tx_flags & TXGBE_TX_FLAGS_TSTAMP)) {
-		dev_kfree_skb_any(adapter->ptp_tx_skb);
-		adapter->ptp_tx_skb = NULL;
-		cancel_work_sync(&adapter->ptp_tx_work);
-		clear_bit_unlock(__TXGBE_PTP_TX_IN_PROGRESS, &adapter->state);
-	}
+	if (unlikely(tx_flags & TXGBE_TX_FLAGS_TSTAMP))
+		txgbe_ptp_tx_abort(adapter);
 #endif
 
 	return NETDEV_TX_OK;
@@ -10900,10 +12528,8 @@ static netdev_tx_t txgbe_xmit_frame(struct sk_buff *skb,
 	tx_ring = adapter->tx_ring[0];
 #endif
 
-#ifdef HAVE_AF_XDP_ZC_SUPPORT
 	if (unlikely(test_bit(__TXGBE_TX_DISABLED, &tx_ring->state)))
 		return NETDEV_TX_BUSY;
-#endif
 
 	if (tx_ring->tx_buffer_info == NULL) {
 		dev_kfree_skb_any(skb);
@@ -11201,7 +12827,64 @@ int txgbe_setup_tc(struct net_device *dev, u8 tc)
 }
 
 #ifdef NETIF_F_HW_TC
-#ifdef TC_MQPRIO_HW_OFFLOAD_MAX
+#ifdef HAVE_TC_MQPRIO_QOPT_OFFLOAD
+/**
+ * txgbe_setup_tc_mqprio - mqprio offload
+ * @dev: net device to configure
+ * @mqprio: mqprio configuration
+ *
+ * The queue layout of each traffic class is always chosen by the driver.
+ * In channel mode with the bw_rlimit shaper the max_rate of every class
+ * is programmed into the Tx pacer of the queues of that class; min_rate
+ * has no hardware counterpart and is refused.
+ **/
+static int txgbe_setup_tc_mqprio(struct net_device *dev,
+				 struct tc_mqprio_qopt_offload *mqprio)
+{
+	struct txgbe_adapter *adapter = netdev_priv(dev);
+	u32 tc_maxrate[TXGBE_DCB_MAX_TRAFFIC_CLASS] = { 0 };
+	u32 old_maxrate[TXGBE_DCB_MAX_TRAFFIC_CLASS];
+	u8 num_tc = mqprio->qopt.num_tc;
+	int err;
+	u8 tc;
+
+	if (mqprio->mode == TC_MQPRIO_MODE_CHANNEL &&
+	    mqprio->shaper == TC_MQPRIO_SHAPER_BW_RATE) {
+		if (num_tc > TXGBE_DCB_MAX_TRAFFIC_CLASS)
+			return -EINVAL;
+
+		for (tc = 0; tc < num_tc; tc++) {
+			u64 rate;
+
+			if ((mqprio->flags & TC_MQPRIO_F_MIN_RATE) &&
+			    mqprio->min_rate[tc])
+				return -EOPNOTSUPP;
+
+			if (!(mqprio->flags & TC_MQPRIO_F_MAX_RATE))
+				continue;
+
+			/* tc passes bytes per second, the pacer wants Mbps */
+			rate = div_u64(mqprio->max_rate[tc] * 8, 1000000);
+			if (mqprio->max_rate[tc] && !rate)
+				rate = 1;
+			if (rate > SPEED_10000)
+				return -EINVAL;
+			tc_maxrate[tc] = (u32)rate;
+		}
+	}
+
+	/* txgbe_setup_tc() reopens the device, which programs the pacers */
+	memcpy(old_maxrate, adapter->tc_maxrate, sizeof(old_maxrate));
+	memcpy(adapter->tc_maxrate, tc_maxrate, sizeof(tc_maxrate));
+
+	mqprio->qopt.hw = TC_MQPRIO_HW_OFFLOAD_TCS;
+	err = txgbe_setup_tc(dev, num_tc);
+	if (err)
+		memcpy(adapter->tc_maxrate, old_maxrate, sizeof(old_maxrate));
+
+	return err;
+}
+#elif defined(TC_MQPRIO_HW_OFFLOAD_MAX)
 static int txgbe_setup_tc_mqprio(struct net_device *dev,
 				 struct tc_mqprio_qopt *mqprio)
 {
@@ -11250,6 +12933,37 @@ __txgbe_setup_tc(struct net_device *dev, __always_unused u32 handle,
 }
 #endif /* NETIF_F_HW_TC */
 
+#ifdef HAVE_NDO_SET_TX_MAXRATE
+/**
+ * txgbe_set_tx_maxrate - limit the transmit rate of one Tx queue
+ * @netdev: network interface device structure
+ * @queue_index: Tx queue to limit
+ * @maxrate: limit in Mbps, 0 to remove it
+ *
+ * The limit is remembered per queue index and reapplied whenever the
+ * ring is configured, so it survives resets and ring reallocation.
+ **/
+static int txgbe_set_tx_maxrate(struct net_device *netdev, int queue_index,
+				u32 maxrate)
+{
+	struct txgbe_adapter *adapter = netdev_priv(netdev);
+
+	if (queue_index < 0 || queue_index >= adapter->num_tx_queues)
+		return -EINVAL;
+
+	if (maxrate > SPEED_10000)
+		return -EINVAL;
+
+	adapter->tx_maxrate[queue_index] = maxrate;
+
+	if (!test_bit(__TXGBE_DOWN, &adapter->state))
+		txgbe_set_tx_rate_limit(adapter,
+					adapter->tx_ring[queue_index]);
+
+	return 0;
+}
+
+#endif /* HAVE_NDO_SET_TX_MAXRATE */
 #ifdef CONFIG_PCI_IOV
 void txgbe_sriov_reinit(struct txgbe_adapter *adapter)
 {
@@ -11295,8 +13009,17 @@ static netdev_features_t txgbe_fix_features(struct net_device *netdev,
 #endif /* CONFIG_DCB */
 	/* If Rx checksum is disabled, then RSC/LRO should also be disabled */
 	if (!(features & NETIF_F_RXCSUM))
-		features &= ~NETIF_F_LRO;
+		features &= ~TXGBE_NETIF_F_RSC;
+
+#ifdef NETIF_F_GRO_HW
+	/* hardware GRO is RSC only, there is no software fallback */
+	if (!(adapter->flags2 & TXGBE_FLAG2_RSC_CAPABLE))
+		features &= ~NETIF_F_GRO_HW;
 
+	/* GRO_HW and LRO both drive RSC, GRO_HW wins */
+	if (features & NETIF_F_GRO_HW)
+		features &= ~NETIF_F_LRO;
+#endif
 #ifdef TXGBE_NO_LRO
 	/* Turn off LRO if not RSC capable */
 	if (!(adapter->flags2 & TXGBE_FLAG2_RSC_CAPABLE))
@@ -11308,6 +13031,9 @@ static netdev_features_t txgbe_fix_features(struct net_device *netdev,
 			e_dev_err("LRO is not supported with XDP\n");
 			features &= ~NETIF_F_LRO;
 		}
+#ifdef NETIF_F_GRO_HW
+		features &= ~NETIF_F_GRO_HW;
+#endif
 	}
 
 #if defined(NETIF_F_HW_VLAN_CTAG_FILTER)
@@ -11344,8 +13070,8 @@ static int txgbe_set_features(struct net_device *netdev,
 	bool need_reset = false;
 	netdev_features_t changed = netdev->features ^ features;
 
-	/* Make sure RSC matches LRO, reset if change */
-	if (!(features & NETIF_F_LRO)) {
+	/* Make sure RSC matches LRO/GRO_HW, reset if change */
+	if (!(features & TXGBE_NETIF_F_RSC)) {
 		if (adapter->flags2 & TXGBE_FLAG2_RSC_ENABLED)
 			need_reset = true;
 		adapter->flags2 &= ~TXGBE_FLAG2_RSC_ENABLED;
@@ -11355,7 +13081,7 @@ static int txgbe_set_features(struct net_device *netdev,
 		    adapter->rx_itr_setting > TXGBE_MIN_RSC_ITR) {
 			adapter->flags2 |= TXGBE_FLAG2_RSC_ENABLED;
 			need_reset = true;
-		} else if ((netdev->features ^ features) & NETIF_F_LRO) {
+		} else if ((netdev->features ^ features) & TXGBE_NETIF_F_RSC) {
 #ifdef TXGBE_NO_LRO
 			e_info(probe, "rx-usecs set too low, "
 			       "disabling RSC\n");
@@ -12024,13 +13750,7 @@ static const struct net_device_ops txgbe_netdev_ops = {
 	.ndo_stop               = txgbe_close,
 	.ndo_start_xmit         = txgbe_xmit_frame,
 #ifdef HAVE_NETDEV_SELECT_QUEUE
-#if IS_ENABLED(CONFIG_FCOE)
 	.ndo_select_queue       = txgbe_select_queue,
-#else
-#ifndef HAVE_MQPRIO
-	.ndo_select_queue       = __netdev_pick_tx,
-#endif
-#endif
 #endif /* HAVE_NETDEV_SELECT_QUEUE */
 	.ndo_set_rx_mode        = txgbe_set_rx_mode,
 	.ndo_validate_addr      = eth_validate_addr,
@@ -12104,6 +13824,13 @@ static const struct net_device_ops txgbe_netdev_ops = {
 #endif /* NETIF_F_HW_TC */
 #endif /* HAVE_RHEL7_NETDEV_OPS_EXT_NDO_SETUP_TC */
 #endif /* HAVE_SETUP_TC */
+#ifdef HAVE_NDO_SET_TX_MAXRATE
+#ifdef HAVE_RHEL7_EXTENDED_NDO_SET_TX_MAXRATE
+	.extended.ndo_set_tx_maxrate = txgbe_set_tx_maxrate,
+#else
+	.ndo_set_tx_maxrate	= txgbe_set_tx_maxrate,
+#endif /* HAVE_RHEL7_EXTENDED_NDO_SET_TX_MAXRATE */
+#endif /* HAVE_NDO_SET_TX_MAXRATE */
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	.ndo_poll_controller    = txgbe_netpoll,
 #endif
@@ -12248,11 +13975,7 @@ void txgbe_assign_netdev_ops(struct net_device *dev)
 	dev->poll_controller = &txgbe_netpoll;
 #endif
 #ifdef HAVE_NETDEV_SELECT_QUEUE
-#if IS_ENABLED(CONFIG_FCOE)
 	dev->select_queue = &txgbe_select_queue;
-#else
-	dev->select_queue = &__netdev_pick_tx;
-#endif
 #endif /* HAVE_NETDEV_SELECT_QUEUE */
 #endif /* HAVE_NET_DEVICE_OPS */
 
@@ -12290,6 +14013,63 @@ int txgbe_wol_supported(struct txgbe_adapter *adapter)
 		return false;
 }
 
+/* board indices in use, see txgbe_board_index() */
+#define TXGBE_MAX_BOARDS	256
+static DECLARE_BITMAP(txgbe_boards, TXGBE_MAX_BOARDS);
+static DEFINE_MUTEX(txgbe_boards_lock);
+
+/**
+ * txgbe_board_index - stable index of a port among the txgbe ports
+ * @pdev: PCI device being probed
+ *
+ * The index selects the per-board module parameters and the CPU spread of
+ * the queue vectors.  It used to be the number of ports probed so far,
+ * which depends on probe order; instead count the txgbe functions that
+ * sort before this one by PCI domain, bus and devfn.  Functions bound to
+ * another driver are skipped.  After a hot remove and add that rank can
+ * belong to a port that is still bound, then the first free index is
+ * used.  txgbe_board_release() gives the index back.
+ **/
+static int txgbe_board_index(struct pci_dev *pdev)
+{
+	struct pci_dev *dev = NULL;
+	int index = 0;
+
+	for_each_pci_dev(dev) {
+		if (dev == pdev || !pci_match_id(txgbe_pci_tbl, dev))
+			continue;
+		if (dev->dev.driver && dev->dev.driver != &txgbe_driver.driver)
+			continue;
+		if (pci_domain_nr(dev->bus) > pci_domain_nr(pdev->bus))
+			continue;
+		if (pci_domain_nr(dev->bus) == pci_domain_nr(pdev->bus) &&
+		    (dev->bus->number > pdev->bus->number ||
+		     (dev->bus->number == pdev->bus->number &&
+		      dev->devfn > pdev->devfn)))
+			continue;
+		index++;
+	}
+
+	mutex_lock(&txgbe_boards_lock);
+	if (index >= TXGBE_MAX_BOARDS || test_bit(index, txgbe_boards))
+		index = find_first_zero_bit(txgbe_boards, TXGBE_MAX_BOARDS);
+	if (index < TXGBE_MAX_BOARDS)
+		set_bit(index, txgbe_boards);
+	mutex_unlock(&txgbe_boards_lock);
+
+	return index;
+}
+
+static void txgbe_board_release(int index)
+{
+	if (index >= TXGBE_MAX_BOARDS)
+		return;
+
+	mutex_lock(&txgbe_boards_lock);
+	clear_bit(index, txgbe_boards);
+	mutex_unlock(&txgbe_boards_lock);
+}
+
 /**
  * txgbe_probe - Device Initialization Routine
  * @pdev: PCI device information struct
@@ -12307,7 +14087,7 @@ static int __devinit txgbe_probe(struct pci_dev *pdev,
 	struct net_device *netdev;
 	struct txgbe_adapter *adapter = NULL;
 	struct txgbe_hw *hw = NULL;
-	static int cards_found;
+	u64 start_ns = ktime_get_ns();
 	int err, pci_using_dac, expected_gts;
 	u16 offset = 0;
 	u16 eeprom_verh = 0, eeprom_verl = 0;
@@ -12417,6 +14197,8 @@ static int __devinit txgbe_probe(struct pci_dev *pdev,
 	adapter->pdev = pdev;
 	hw = &adapter->hw;
 	hw->back = adapter;
+	txgbe_hic_init(&adapter->hic);
+	mutex_init(&adapter->flash_lock);
 	adapter->msg_enable = (1 << DEFAULT_DEBUG_LEVEL_SHIFT) - 1;
 
 	hw->hw_addr = ioremap(pci_resource_start(pdev, 0),
@@ -12431,12 +14213,19 @@ static int __devinit txgbe_probe(struct pci_dev *pdev,
 
 	strncpy(netdev->name, pci_name(pdev), sizeof(netdev->name) - 1);
 
-	adapter->bd_number = cards_found;
+	adapter->bd_number = txgbe_board_index(pdev);
+	adapter->bringup_start_ns = start_ns;
+	adapter->bringup_last_ns = start_ns;
+	txgbe_bringup_step(adapter, TXGBE_BRINGUP_PCI);
+
+	/* the SR-IOV teardown on the error path below cancels it */
+	INIT_DELAYED_WORK(&adapter->mbx_task, txgbe_msg_work);
 
 	/* setup the private structure */
 	err = txgbe_sw_init(adapter);
 	if (err)
 		goto err_sw_init;
+	txgbe_bringup_step(adapter, TXGBE_BRINGUP_SW_INIT);
 
 #if defined(HAVE_UDP_ENC_RX_OFFLOAD) && defined(HAVE_UDP_TUNNEL_NIC_INFO)
 	netdev->udp_tunnel_nic_info = &txgbe_udp_tunnels;
@@ -12474,6 +14263,7 @@ static int __devinit txgbe_probe(struct pci_dev *pdev,
 		e_dev_err("HW Init failed: %d\n", err);
 		goto err_sw_init;
 	}
+	txgbe_bringup_step(adapter, TXGBE_BRINGUP_RESET_HW);
 
 	if (txgbe_is_lldp(hw)) 
 		e_dev_err("Can not get lldp flags from flash\n");
@@ -12542,7 +14332,7 @@ static int __devinit txgbe_probe(struct pci_dev *pdev,
 
 	/* give us the option of enabling RSC/LRO later */
 	if (adapter->flags2 & TXGBE_FLAG2_RSC_CAPABLE) {
-		netdev->hw_features |= NETIF_F_LRO;
+		netdev->hw_features |= TXGBE_NETIF_F_RSC;
 		netdev->features |= NETIF_F_LRO;
 	}
 #else	/* NETIF_F_GSO_PARTIAL */
@@ -12590,6 +14380,10 @@ static int __devinit txgbe_probe(struct pci_dev *pdev,
 	if (adapter->flags2 & TXGBE_FLAG2_RSC_CAPABLE)
 #endif
 		hw_features |= NETIF_F_LRO;
+#ifdef NETIF_F_GRO_HW
+	if (adapter->flags2 & TXGBE_FLAG2_RSC_CAPABLE)
+		hw_features |= NETIF_F_GRO_HW;
+#endif
 
 #else /* !HAVE_NDO_SET_FEATURES */
 #ifdef NETIF_F_GRO
@@ -12734,6 +14528,7 @@ static int __devinit txgbe_probe(struct pci_dev *pdev,
 		err = -EIO;
 		goto err_sw_init;
 	}
+	txgbe_bringup_step(adapter, TXGBE_BRINGUP_NVM);
 
 	txgbe_mac_set_default_filter(adapter, hw->mac.perm_addr);
 	memset(&adapter->etype_filter_info, 0,
@@ -12751,12 +14546,15 @@ static int __devinit txgbe_probe(struct pci_dev *pdev,
 	}
 	INIT_WORK(&adapter->service_task, txgbe_service_task);
 	INIT_WORK(&adapter->sfp_sta_task, txgbe_sfp_phy_status_work);
+	txgbe_module_init(adapter);
+	spin_lock_init(&adapter->link_log.lock);
 	set_bit(__TXGBE_SERVICE_INITED, &adapter->state);
 	clear_bit(__TXGBE_SERVICE_SCHED, &adapter->state);
 
 	err = txgbe_init_interrupt_scheme(adapter);
 	if (err)
 		goto err_sw_init;
+	txgbe_bringup_step(adapter, TXGBE_BRINGUP_IRQ_SCHEME);
 
 	/* WOL not supported for all devices */
 	adapter->wol = 0;
@@ -12847,6 +14645,7 @@ static int __devinit txgbe_probe(struct pci_dev *pdev,
 	err = register_netdev(netdev);
 	if (err)
 		goto err_register;
+	txgbe_bringup_step(adapter, TXGBE_BRINGUP_REGISTER);
 
 	pci_set_drvdata(pdev, adapter);
 	adapter->netdev_registered = true;
@@ -12986,7 +14785,6 @@ no_info_string:
 
 #endif /* (HAVE_NETDEV_STORAGE_ADDRESS) && (NETDEV_HW_ADDR_T_SAN) */
 	e_info(probe, "WangXun(R) 10 Gigabit Network Connection\n");
-	cards_found++;
 #ifdef TXGBE_SYSFS
 	if (txgbe_sysfs_init(adapter))
 		e_err(probe, "failed to allocate sysfs resources\n");
@@ -12999,6 +14797,7 @@ no_info_string:
 #ifdef HAVE_TXGBE_DEBUG_FS
 	txgbe_dbg_adapter_init(adapter);
 #endif /* HAVE_TXGBE_DEBUG_FS */
+	txgbe_devlink_register(adapter);
 
 	/* setup link for SFP devices with MNG FW, else wait for TXGBE_UP */
 	if (txgbe_mng_present(hw) && txgbe_is_sfp(hw) &&
@@ -13019,6 +14818,7 @@ no_info_string:
 		e_info(probe, "disable completion timeout\n");
 	}
 
+	txgbe_bringup_step(adapter, TXGBE_BRINGUP_PROBE_DONE);
 	return 0;
 
 err_register:
@@ -13041,6 +14841,7 @@ err_sw_init:
 	adapter->flags2 &= ~TXGBE_FLAG2_SEARCH_FOR_SFP;
 	kfree(adapter->mac_table);
 	iounmap(adapter->io_addr);
+	txgbe_board_release(adapter->bd_number);
 
 #ifndef HAVE_NO_BITMAP
 	bitmap_free(adapter->af_xdp_zc_qps);
@@ -13082,6 +14883,7 @@ static void __devexit txgbe_remove(struct pci_dev *pdev)
 	txgbe_mac_set_default_filter(adapter, hw->mac.perm_addr);
 
 	netdev = adapter->netdev;
+	txgbe_devlink_unregister(adapter);
 #ifdef HAVE_TXGBE_DEBUG_FS
 	txgbe_dbg_adapter_exit(adapter);
 #endif
@@ -13116,6 +14918,10 @@ static void __devexit txgbe_remove(struct pci_dev *pdev)
 #ifdef CONFIG_PCI_IOV
 	txgbe_disable_sriov(adapter);
 #endif
+	/* txgbe_disable_sriov() leaves the mailbox work alone while VFs are
+	 * assigned, and __TXGBE_REMOVING keeps it from re-arming itself
+	 */
+	cancel_delayed_work_sync(&adapter->mbx_task);
 
 #if IS_ENABLED(CONFIG_FCOE)
 #ifndef HAVE_NETDEV_OPS_FCOE_ENABLE
@@ -13136,6 +14942,7 @@ static void __devexit txgbe_remove(struct pci_dev *pdev)
 				     pci_select_bars(pdev, IORESOURCE_MEM));
 
 	kfree(adapter->mac_table);
+	txgbe_board_release(adapter->bd_number);
 	
 #ifndef HAVE_NO_BITMAP
 	bitmap_free(adapter->af_xdp_zc_qps);
@@ -13297,24 +15104,34 @@ static pci_ers_result_t txgbe_io_error_detected(struct pci_dev *pdev,
 
 	skip_bad_vf_detection:
 #endif /* CONFIG_PCI_IOV */
+	txgbe_trace(reset_step, adapter, TXGBE_TRACE_AER_DETECTED, -1);
 
 	if (!test_bit(__TXGBE_SERVICE_INITED, &adapter->state))
 		return PCI_ERS_RESULT_DISCONNECT;
 
+	txgbe_recovery_mark(adapter, TXGBE_RECOVERY_DETECTED);
 	rtnl_lock();
 	netif_device_detach(netdev);
 
 	if (state == pci_channel_io_perm_failure) {
+		adapter->recovery_log.active = false;
 		rtnl_unlock();
 		return PCI_ERS_RESULT_DISCONNECT;
 	}
 
+	/*
+	 * Only stop the datapath: rings, interrupts and the software copy
+	 * of the filters (fdir_filter_list, mac_table, VLANs, RSS) are kept
+	 * and written back by txgbe_up() in txgbe_io_resume(), instead of
+	 * freeing and reallocating everything through close and open.
+	 */
 	if (netif_running(netdev))
-		txgbe_close(netdev);
+		txgbe_down(adapter);
 
 	if (!test_and_set_bit(__TXGBE_DISABLED, &adapter->state))
 		pci_disable_device(pdev);
 	rtnl_unlock();
+	txgbe_recovery_mark(adapter, TXGBE_RECOVERY_QUIESCED);
 	e_info(hw, "leave txgbe_io_error_detected.\n");
 
 	/* Request a slot reset. */
@@ -13334,6 +15151,7 @@ static pci_ers_result_t txgbe_io_slot_reset(struct pci_dev *pdev)
 	u16 value;
 
 	e_info(hw, "in txgbe_io_slot_reset\n");
+	txgbe_trace(reset_step, adapter, TXGBE_TRACE_AER_SLOT_RESET, -1);
 
 	if (adapter->cmplt_to_dis) {
 		pcie_capability_read_word(adapter->pdev, PCI_EXP_DEVCTL2, &value);
@@ -13360,6 +15178,7 @@ static pci_ers_result_t txgbe_io_slot_reset(struct pci_dev *pdev)
 		pci_wake_from_d3(pdev, false);
 
 		txgbe_reset(adapter);
+		txgbe_recovery_mark(adapter, TXGBE_RECOVERY_SLOT_RESET);
 
 		result = PCI_ERS_RESULT_RECOVERED;
 	}
@@ -13382,6 +15201,7 @@ static void txgbe_io_resume(struct pci_dev *pdev)
 	struct txgbe_adapter *adapter = pci_get_drvdata(pdev);
 	struct net_device *netdev = adapter->netdev;
 	e_info(hw, "in io_resume.\n");
+	txgbe_trace(reset_step, adapter, TXGBE_TRACE_AER_RESUME, -1);
 
 #ifdef CONFIG_PCI_IOV
 	if (adapter->vferr_refcount) {
@@ -13393,10 +15213,11 @@ static void txgbe_io_resume(struct pci_dev *pdev)
 #endif
 	rtnl_lock();
 	if (netif_running(netdev))
-		txgbe_open(netdev);
+		txgbe_up(adapter);
 
 	netif_device_attach(netdev);
 	rtnl_unlock();
+	txgbe_recovery_mark(adapter, TXGBE_RECOVERY_RESUMED);
 	e_info(hw, "exit io_resume.\n");
 }
 
@@ -13446,16 +15267,15 @@ static struct pci_driver txgbe_driver = {
 	.id_table = txgbe_pci_tbl,
 	.probe    = txgbe_probe,
 	.remove   = __devexit_p(txgbe_remove),
-#ifdef CONFIG_PM
-#ifndef USE_LEGACY_PM_SUPPORT
 	.driver = {
+#if defined(CONFIG_PM) && !defined(USE_LEGACY_PM_SUPPORT)
 		.pm = &txgbe_pm_ops,
+#endif
 	},
-#else
+#if defined(CONFIG_PM) && defined(USE_LEGACY_PM_SUPPORT)
 	.suspend  = txgbe_suspend,
 	.resume   = txgbe_resume,
 #endif /* USE_LEGACY_PM_SUPPORT */
-#endif
 #ifndef USE_REBOOT_NOTIFIER
 	.shutdown = txgbe_shutdown,
 #endif
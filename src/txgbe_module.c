@@ -0,0 +1,249 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (c) 2015 - 2022 Beijing WangXun Technology Co., Ltd. */
+
+#include "txgbe.h"
+#include "txgbe_phy.h"
+
+/*
+ * SFP module EEPROM cache.
+ *
+ * Pages A0 and A2 are read once, in sequential I2C chunks, when the
+ * service task detects a module.  ethtool is then served from memory.
+ * Only the A2 real-time diagnostics block (bytes 96-119) changes at
+ * runtime.  The service task refreshes it every txgbe_sfp_dom_interval
+ * ms.  With the interval set to 0, ethtool reads the block on demand.
+ *
+ * The service task and sfp_sta_task share the ordered txgbe_wq, so
+ * background reads never overlap the copper SFP PHY poll.  ethtool reads
+ * that have to touch I2C cancel sfp_sta_task first, as before.
+ *
+ * Module GPIO events are ignored while the port is down, so the cache is
+ * dropped by txgbe_down() and ethtool reads go to the module until the
+ * port is up again.
+ */
+
+/**
+ * txgbe_module_init - set up the SFP module EEPROM cache
+ * @adapter: board private structure
+ **/
+void txgbe_module_init(struct txgbe_adapter *adapter)
+{
+	struct txgbe_module_cache *mc = &adapter->module;
+
+	memset(mc, 0, sizeof(*mc));
+	mutex_init(&mc->lock);
+}
+
+/**
+ * txgbe_module_invalidate - drop the cached module contents
+ * @adapter: board private structure
+ *
+ * Called when the module is removed, a module event is pending or the
+ * port goes down.
+ **/
+void txgbe_module_invalidate(struct txgbe_adapter *adapter)
+{
+	struct txgbe_module_cache *mc = &adapter->module;
+
+	mutex_lock(&mc->lock);
+	mc->valid = false;
+	mc->has_a2 = false;
+	mutex_unlock(&mc->lock);
+}
+
+static bool txgbe_module_has_a2(const u8 *a0)
+{
+	u8 swap = a0[TXGBE_SFF_SFF_8472_SWAP];
+
+	return a0[TXGBE_SFF_SFF_8472_COMP] != TXGBE_SFF_SFF_8472_UNSUP &&
+	       !(swap & TXGBE_SFF_ADDRESSING_MODE) &&
+	       (swap & TXGBE_SFF_DDM_IMPLEMENTED);
+}
+
+static int txgbe_module_i2c(struct txgbe_adapter *adapter, u8 dev_addr,
+			    u8 offset, u16 len, u8 *data)
+{
+	struct txgbe_hw *hw = &adapter->hw;
+	u32 swfw_mask = hw->phy.phy_semaphore_mask;
+	s32 status;
+
+	if (TCALL(hw, mac.ops.acquire_swfw_sync, swfw_mask) != 0)
+		return -EBUSY;
+
+	status = TCALL(hw, phy.ops.read_i2c_block, offset, dev_addr, len,
+		       data);
+
+	TCALL(hw, mac.ops.release_swfw_sync, swfw_mask);
+
+	return status ? -EIO : 0;
+}
+
+/* called with mc->lock held */
+static int __txgbe_module_fill(struct txgbe_adapter *adapter)
+{
+	struct txgbe_module_cache *mc = &adapter->module;
+	u64 start = ktime_get_ns();
+	int err;
+
+	mc->valid = false;
+	mc->has_a2 = false;
+
+	err = txgbe_module_i2c(adapter, TXGBE_I2C_EEPROM_DEV_ADDR, 0,
+			       TXGBE_MODULE_PAGE_LEN, mc->a0);
+	if (!err && txgbe_module_has_a2(mc->a0))
+		err = txgbe_module_i2c(adapter, TXGBE_I2C_EEPROM_DEV_ADDR2, 0,
+				       TXGBE_MODULE_PAGE_LEN, mc->a2);
+
+	mc->last_fill_us = (u32)div_u64(ktime_get_ns() - start, NSEC_PER_USEC);
+	if (err) {
+		mc->fill_errors++;
+		return err;
+	}
+
+	mc->has_a2 = txgbe_module_has_a2(mc->a0);
+	mc->dom_updated = jiffies;
+	mc->valid = true;
+	mc->fills++;
+
+	return 0;
+}
+
+/* called with mc->lock held, mc->valid and mc->has_a2 set */
+static int __txgbe_module_dom_refresh(struct txgbe_adapter *adapter)
+{
+	struct txgbe_module_cache *mc = &adapter->module;
+	u8 dom[TXGBE_MODULE_DOM_LEN];
+	u64 start = ktime_get_ns();
+	int err;
+
+	err = txgbe_module_i2c(adapter, TXGBE_I2C_EEPROM_DEV_ADDR2,
+			       TXGBE_MODULE_DOM_OFFSET, sizeof(dom), dom);
+
+	/* a failed read is retried on the next interval, not sooner */
+	mc->dom_updated = jiffies;
+	mc->last_dom_us = (u32)div_u64(ktime_get_ns() - start, NSEC_PER_USEC);
+	if (err) {
+		mc->dom_errors++;
+		return err;
+	}
+
+	memcpy(&mc->a2[TXGBE_MODULE_DOM_OFFSET], dom, sizeof(dom));
+	mc->dom_refreshes++;
+
+	return 0;
+}
+
+/**
+ * txgbe_module_fill - read the static module pages into the cache
+ * @adapter: board private structure
+ *
+ * Called from the service task once a module has been identified.
+ **/
+int txgbe_module_fill(struct txgbe_adapter *adapter)
+{
+	struct txgbe_module_cache *mc = &adapter->module;
+	int err;
+
+	mutex_lock(&mc->lock);
+	err = __txgbe_module_fill(adapter);
+	mutex_unlock(&mc->lock);
+
+	return err;
+}
+
+/**
+ * txgbe_module_dom_subtask - refresh the cached DOM block
+ * @adapter: board private structure
+ **/
+void txgbe_module_dom_subtask(struct txgbe_adapter *adapter)
+{
+	struct txgbe_module_cache *mc = &adapter->module;
+	int interval = READ_ONCE(txgbe_sfp_dom_interval);
+
+	if (interval <= 0 || !READ_ONCE(mc->valid) || !READ_ONCE(mc->has_a2))
+		return;
+
+	if (time_before(jiffies,
+			mc->dom_updated + msecs_to_jiffies(interval)))
+		return;
+
+	if (test_bit(__TXGBE_IN_SFP_INIT, &adapter->state))
+		return;
+
+	mutex_lock(&mc->lock);
+	if (mc->valid && mc->has_a2)
+		__txgbe_module_dom_refresh(adapter);
+	mutex_unlock(&mc->lock);
+}
+
+/**
+ * txgbe_module_read - copy module EEPROM bytes for ethtool
+ * @adapter: board private structure
+ * @dev_addr: TXGBE_I2C_EEPROM_DEV_ADDR or TXGBE_I2C_EEPROM_DEV_ADDR2
+ * @offset: first byte within the 256 byte page
+ * @len: number of bytes
+ * @data: destination
+ *
+ * Served from the cache.  The cache is filled here if the service task
+ * has not done so yet, and the DOM block is read here when background
+ * refresh is disabled.  While the port is down the module may be swapped
+ * unnoticed, so the pages are read every time and not kept.
+ **/
+int txgbe_module_read(struct txgbe_adapter *adapter, u8 dev_addr,
+		      u32 offset, u32 len, u8 *data)
+{
+	struct txgbe_module_cache *mc = &adapter->module;
+	bool need_dom, down;
+	int err = 0;
+
+	if (offset >= TXGBE_MODULE_PAGE_LEN ||
+	    len > TXGBE_MODULE_PAGE_LEN - offset)
+		return -EINVAL;
+
+	mutex_lock(&mc->lock);
+
+	down = test_bit(__TXGBE_DOWN, &adapter->state);
+	if (down)
+		mc->valid = false;
+
+	need_dom = dev_addr == TXGBE_I2C_EEPROM_DEV_ADDR2 &&
+		   READ_ONCE(txgbe_sfp_dom_interval) <= 0 &&
+		   offset < TXGBE_MODULE_DOM_OFFSET + TXGBE_MODULE_DOM_LEN &&
+		   offset + len > TXGBE_MODULE_DOM_OFFSET;
+
+	if (!mc->valid || (need_dom && mc->has_a2)) {
+		/* I2C reads can take long time */
+		if (test_bit(__TXGBE_IN_SFP_INIT, &adapter->state)) {
+			err = -EBUSY;
+			goto out;
+		}
+
+		if (!down)
+			cancel_work_sync(&adapter->sfp_sta_task);
+
+		if (!mc->valid)
+			err = __txgbe_module_fill(adapter);
+		else
+			err = __txgbe_module_dom_refresh(adapter);
+		if (err)
+			goto out;
+	} else {
+		mc->hits++;
+	}
+
+	if (dev_addr == TXGBE_I2C_EEPROM_DEV_ADDR2) {
+		if (!mc->has_a2) {
+			err = -EINVAL;
+			goto out;
+		}
+		memcpy(data, &mc->a2[offset], len);
+	} else {
+		memcpy(data, &mc->a0[offset], len);
+	}
+
+out:
+	if (down)
+		mc->valid = false;
+	mutex_unlock(&mc->lock);
+	return err;
+}
@@ -410,6 +410,18 @@ TXGBE_PARAM(RxBufferMode, "0=(default)no header split\n"
 #define TXGBE_RXBUFMODE_HEADER_SPLIT                    1
 #define TXGBE_DEFAULT_RXBUFMODE   TXGBE_RXBUFMODE_NO_HEADER_SPLIT
 
+/* Rx ring pressure threshold
+ *
+ * Valid Range: 0-100  0 = off, 1-100 = Rx ring fill level in percent
+ * that counts as pressure, see txgbe_rx_pressure()
+ *
+ * Default Value: 75
+ */
+TXGBE_PARAM(RxPressure, "Rx ring fill level in percent reported as "
+			"pressure (0 = off), default 75");
+
+#define TXGBE_DEFAULT_RX_PRESSURE	75
+
 /* Cloud Switch mode
  *
  * Valid Range: 0-1 0 = disable Cloud Switch, 1 = enable Cloud Switch
@@ -1447,6 +1459,27 @@ void __devinit txgbe_check_options(struct txgbe_adapter *adapter)
 		}
 #endif
 
+	}
+	{ /* Rx ring pressure threshold */
+		static struct txgbe_option opt = {
+			.type = range_option,
+			.name = "Rx ring pressure threshold",
+			.err = "using default of "
+				__MODULE_STRING(TXGBE_DEFAULT_RX_PRESSURE),
+			.def = TXGBE_DEFAULT_RX_PRESSURE,
+			.arg = {.r = {.min = 0, .max = 100} }
+		};
+
+#ifdef module_param_array
+		if (num_RxPressure > bd) {
+#endif
+			adapter->rx_pressure_pct = RxPressure[bd];
+			txgbe_validate_option(&adapter->rx_pressure_pct, &opt);
+#ifdef module_param_array
+		} else {
+			adapter->rx_pressure_pct = opt.def;
+		}
+#endif
 	}
 	{ /* Cloud Switch */
 		struct txgbe_option opt = {
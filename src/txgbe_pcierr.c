@@ -146,6 +146,8 @@ static int txgbe_report_error_detected(struct pci_dev *dev,
 	const struct pci_error_handlers *err_handler;
 
 	device_lock(&dev->dev);
+	/* as the AER core does; keeps txgbe_down() off the frozen device */
+	dev->error_state = state;
 	if (
 		!dev->driver ||
 		!dev->driver->err_handler ||
@@ -232,16 +234,131 @@ out:
 	return 0;
 }
 
+static int txgbe_report_failed(struct pci_dev *dev, void *data)
+{
+	const struct pci_error_handlers *err_handler;
+
+	device_lock(&dev->dev);
+	/* as the AER core does when recovery fails */
+	dev->error_state = pci_channel_io_perm_failure;
+	if (
+		!dev->driver ||
+		!dev->driver->err_handler ||
+		!dev->driver->err_handler->error_detected)
+		goto out;
+
+	err_handler = dev->driver->err_handler;
+	err_handler->error_detected(dev, pci_channel_io_perm_failure);
+out:
+	device_unlock(&dev->dev);
+	return 0;
+}
+
+
+/**
+ * txgbe_recovery_mark - record a PCIe error recovery phase
+ * @adapter: board private structure
+ * @phase: phase that just completed
+ *
+ * TXGBE_RECOVERY_DETECTED starts a new timeline unless one is already
+ * running, as it is when txgbe_pcie_do_recovery() calls back into
+ * txgbe_io_error_detected().  The timeline is shown in debugfs
+ * <pci>/recovery.
+ **/
+void txgbe_recovery_mark(struct txgbe_adapter *adapter,
+			 enum txgbe_recovery_phase phase)
+{
+	struct txgbe_recovery_log *log = &adapter->recovery_log;
+	u64 now = ktime_get_ns();
+
+	if (phase == TXGBE_RECOVERY_DETECTED) {
+		if (log->active)
+			return;
+		memset(log->phase_ns, 0, sizeof(log->phase_ns));
+		log->start_ns = now;
+		log->active = true;
+		log->count++;
+	}
+	if (!log->active)
+		return;
+
+	/* 0 means not reached, so the first phase reads as 1ns */
+	log->phase_ns[phase] = max_t(u64, now - log->start_ns, 1);
+	if (phase == TXGBE_RECOVERY_RESUMED) {
+		log->active = false;
+		e_info(drv, "PCIe error recovery took %llu ms\n",
+		       div_u64(log->phase_ns[phase], NSEC_PER_MSEC));
+	}
+}
+
+/*
+ * Wait until @pdev answers config requests after a secondary bus reset of
+ * @bridge.  If the bridge reports Data Link Layer Link Active, wait for the
+ * link first, then the 100ms the PCIe spec requires before the first
+ * config request, then poll the vendor ID in short steps.  A function that
+ * is still initializing completes config reads with Configuration Request
+ * Retry Status, which reads as 0x0001 when CRS Software Visibility is
+ * enabled on the root port and as all ones otherwise.
+ */
+static int txgbe_pcie_wait_ready(struct txgbe_adapter *adapter,
+				 struct pci_dev *bridge, struct pci_dev *pdev)
+{
+	unsigned long timeout;
+	u32 lnkcap = 0;
+	u16 lnksta, vendor;
+	int waited;
+
+	pcie_capability_read_dword(bridge, PCI_EXP_LNKCAP, &lnkcap);
+	if (lnkcap & PCI_EXP_LNKCAP_DLLLARC) {
+		timeout = jiffies + msecs_to_jiffies(TXGBE_PCIE_LINK_TIMEOUT_MS);
+		for (;;) {
+			pcie_capability_read_word(bridge, PCI_EXP_LNKSTA,
+						  &lnksta);
+			if (lnksta & PCI_EXP_LNKSTA_DLLLA)
+				break;
+			if (time_after(jiffies, timeout)) {
+				pci_warn(bridge, "link not active after "
+					 "bus_reset\n");
+				break;
+			}
+			usleep_range(1000, 2000);
+		}
+		txgbe_recovery_mark(adapter, TXGBE_RECOVERY_LINK_UP);
+	}
+
+	msleep(100);
+
+	for (waited = 100; ; waited += TXGBE_PCIE_READY_POLL_MS) {
+		pci_read_config_word(pdev, PCI_VENDOR_ID, &vendor);
+		if (vendor != 0x0001 && vendor != 0xffff)
+			break;
+		if (waited > TXGBE_PCIE_READY_TIMEOUT_MS) {
+			pci_warn(pdev, "not ready %dms after %s; giving up\n",
+				 waited, "bus_reset");
+			return -ENOTTY;
+		}
+		if (waited > 1000 && !(waited % 1000))
+			pci_info(pdev, "not ready %dms after %s; waiting\n",
+				 waited, "bus_reset");
+		msleep(TXGBE_PCIE_READY_POLL_MS);
+	}
 
-void txgbe_pcie_do_recovery(struct pci_dev *dev)
+	txgbe_recovery_mark(adapter, TXGBE_RECOVERY_DEV_READY);
+	if (waited > 1000)
+		pci_info(pdev, "ready %dms after %s\n", waited, "bus_reset");
+	return 0;
+}
+
+void txgbe_pcie_do_recovery(struct txgbe_adapter *adapter)
 {
 	pci_ers_result_t status = PCI_ERS_RESULT_CAN_RECOVER;
+	struct pci_dev *dev = adapter->pdev;
 	struct pci_bus *bus;
 	u32 reg32;
 	int pos;
-	int delay = 1;
-	u32 id;
 	u16 ctrl;
+
+	txgbe_recovery_mark(adapter, TXGBE_RECOVERY_DETECTED);
 	/*
 	 * Error recovery runs on all subordinates of the first downstream port.
 	 * If the downstream port detected the error, it is cleared at the end.
@@ -272,36 +389,10 @@ void txgbe_pcie_do_recovery(struct pci_dev *dev)
 	msleep(2);
 	ctrl &= ~PCI_BRIDGE_CTL_BUS_RESET;
 	pci_write_config_word(dev, PCI_BRIDGE_CONTROL, ctrl);
+	txgbe_recovery_mark(adapter, TXGBE_RECOVERY_BUS_RESET);
 
-	/*
-	 * 	 * Trhfa for conventional PCI is 2^25 clock cycles.
-	 * 	 * Assuming a minimum 33MHz clock this results in a 1s
-	 * 	 * delay before we can consider subordinate devices to
-	 * 	 * be re-initialized.  PCIe has some ways to shorten this,
-	 * 	 * but we don't make use of them yet.
-	 * 	 */				
-	ssleep(1);
-
-	pci_read_config_dword(dev, PCI_COMMAND, &id);
-	while (id == ~0) {
-		if (delay > 60000) {
-			pci_warn(dev, "not ready %dms after %s; giving up\n",
-				 delay - 1, "bus_reset");
-		 		return;
-		}
-
-		if (delay > 1000)
-			pci_info(dev, "not ready %dms after %s; waiting\n",
-				 delay - 1, "bus_reset");
-							
-		msleep(delay);
-		delay *= 2;
-		pci_read_config_dword(dev, PCI_COMMAND, &id);
-	}
-
-	if (delay > 1000)
-		pci_info(dev, "ready %dms after %s\n", delay - 1,
-				 "bus_reset");
+	if (txgbe_pcie_wait_ready(adapter, dev, adapter->pdev))
+		goto failed;
 
 	pci_info(dev, "Root Port link has been reset\n");
 
@@ -339,8 +430,14 @@ void txgbe_pcie_do_recovery(struct pci_dev *dev)
 	pci_dbg(dev, "broadcast resume message\n");
 	pci_walk_bus(bus, txgbe_report_resume, &status);	
 	
+	/* resume closed the timeline */
+	adapter->recovery_log.active = false;
+	return;
+
 failed:
-	;
+	pci_warn(dev, "device recovery failed\n");
+	pci_walk_bus(bus, txgbe_report_failed, NULL);
+	adapter->recovery_log.active = false;
 }
 
 void txgbe_aer_print_error(struct txgbe_adapter *adapter, u32 severity, u32 status)
@@ -6,7 +6,14 @@
 #define TXGBE_AER_UNCORRECTABLE			1
 #define TXGBE_AER_CORRECTABLE			2
 
-void txgbe_pcie_do_recovery(struct pci_dev *dev);
+/* readiness polling after the secondary bus reset */
+#define TXGBE_PCIE_LINK_TIMEOUT_MS		1000
+#define TXGBE_PCIE_READY_POLL_MS		10
+#define TXGBE_PCIE_READY_TIMEOUT_MS		60000
+
+void txgbe_pcie_do_recovery(struct txgbe_adapter *adapter);
+void txgbe_recovery_mark(struct txgbe_adapter *adapter,
+			 enum txgbe_recovery_phase phase);
 void txgbe_aer_print_error(struct txgbe_adapter *adapter, u32 severity, u32 status);
 bool txgbe_check_recovery_capability(struct pci_dev *dev);
 
@@ -968,6 +968,55 @@ STATIC void txgbe_i2c_drain_rx_fifo(struct txgbe_hw *hw)
 	(void)rd32(hw, TXGBE_I2C_CLR_INTR);
 }
 
+/**
+ *  txgbe_read_i2c_seq_int - Reads a run of bytes over I2C
+ *  @hw: pointer to hardware structure
+ *  @byte_offset: first byte offset to read
+ *  @len: number of bytes, at most the Rx FIFO depth
+ *  @data: values read
+ *
+ *  Sets the EEPROM address once and queues @len read commands, only the
+ *  last one with STOP, so the module returns the bytes sequentially.
+ **/
+STATIC s32 txgbe_read_i2c_seq_int(struct txgbe_hw *hw, u8 byte_offset,
+				  u8 len, u8 *data)
+{
+	s32 status = 0;
+	u8 i;
+
+	/* wait tx empty */
+	status = po32m(hw, TXGBE_I2C_RAW_INTR_STAT,
+		TXGBE_I2C_INTR_STAT_TX_EMPTY, TXGBE_I2C_INTR_STAT_TX_EMPTY,
+		TXGBE_I2C_TIMEOUT, 10);
+	if (status != 0)
+		return status;
+
+	/* rx full only once every byte has arrived */
+	wr32(hw, TXGBE_I2C_RX_TL, len - 1);
+
+	wr32(hw, TXGBE_I2C_DATA_CMD,
+			byte_offset | TXGBE_I2C_DATA_CMD_STOP);
+	for (i = 0; i < len - 1; i++)
+		wr32(hw, TXGBE_I2C_DATA_CMD, TXGBE_I2C_DATA_CMD_READ_NOSTOP);
+	wr32(hw, TXGBE_I2C_DATA_CMD, TXGBE_I2C_DATA_CMD_READ);
+
+	/* wait for read complete */
+	status = po32m(hw, TXGBE_I2C_RAW_INTR_STAT,
+		TXGBE_I2C_INTR_STAT_RX_FULL, TXGBE_I2C_INTR_STAT_RX_FULL,
+		TXGBE_I2C_TIMEOUT * len, 100);
+	if (status == 0) {
+		for (i = 0; i < len; i++)
+			data[i] = 0xFF & rd32(hw, TXGBE_I2C_DATA_CMD);
+	} else {
+		/* don't leave a partial run for the next reader */
+		txgbe_i2c_drain_rx_fifo(hw);
+	}
+
+	wr32(hw, TXGBE_I2C_RX_TL, 0);
+
+	return status;
+}
+
 STATIC s32 txgbe_read_i2c_sfp_phy_byte_10g_cu(struct txgbe_hw *hw, u16 byte_offset, u8 *val)
 {
 	s32 status = 0;
@@ -1203,6 +1252,59 @@ s32 txgbe_read_i2c_word(struct txgbe_hw *hw, u16 byte_offset,
 }
 
 
+/**
+ *  txgbe_read_i2c_block - Reads a run of bytes over I2C
+ *  @hw: pointer to hardware structure
+ *  @byte_offset: first byte offset to read
+ *  @dev_addr: device address (0xA0 or 0xA2)
+ *  @len: number of bytes to read
+ *  @data: values read
+ *
+ *  Initializes the I2C master and selects @dev_addr once, then reads in
+ *  sequential chunks bounded by TXGBE_I2C_SEQ_READ_MAX and the controller
+ *  FIFO depth.  A chunk that fails is read again a byte at a time.  The
+ *  caller holds the PHY semaphore.
+ **/
+s32 txgbe_read_i2c_block(struct txgbe_hw *hw, u8 byte_offset,
+				 u8 dev_addr, u16 len, u8 *data)
+{
+	s32 status = 0;
+	u32 param, chunk;
+	u16 done, i;
+	u8 n;
+
+	if (byte_offset + len > TXGBE_I2C_EEPROM_BANK_LEN + 1)
+		return TXGBE_ERR_INVALID_ARGUMENT;
+
+	txgbe_init_i2c(hw);
+	txgbe_switch_i2c_slave_addr(hw, dev_addr);
+
+	param = rd32(hw, TXGBE_I2C_COMP_PARAM_1);
+	chunk = min_t(u32, TXGBE_I2C_SEQ_READ_MAX,
+		      TXGBE_I2C_COMP_PARAM_1_RX_DEPTH(param));
+	/* the address write shares the Tx FIFO with the read commands */
+	chunk = min_t(u32, chunk, TXGBE_I2C_COMP_PARAM_1_TX_DEPTH(param) - 1);
+
+	for (done = 0; done < len; done += n) {
+		n = (u8)min_t(u32, len - done, max_t(u32, chunk, 1));
+
+		if (n > 1 &&
+		    !txgbe_read_i2c_seq_int(hw, byte_offset + done, n,
+					    data + done))
+			continue;
+
+		for (i = done; i < done + n; i++) {
+			status = txgbe_read_i2c_byte_int(hw, byte_offset + i,
+							 dev_addr, &data[i],
+							 false);
+			if (status != 0)
+				return status;
+		}
+	}
+
+	return status;
+}
+
 /**
  *  txgbe_write_i2c_byte_int - Writes 8 bit word over I2C
  *  @hw: pointer to hardware structure
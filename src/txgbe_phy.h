@@ -29,6 +29,7 @@
 #define TXGBE_I2C_EEPROM_DEV_ADDR       0xA0
 #define TXGBE_I2C_EEPROM_DEV_ADDR2      0xA2
 #define TXGBE_I2C_EEPROM_BANK_LEN       0xFF
+#define TXGBE_I2C_SEQ_READ_MAX          8    /* bytes per sequential read */
 
 /*fiber to copper module inter reg i2c addr */
 #define TXGBE_I2C_EEPROM_DEV_ADDR3      0xAC
@@ -176,6 +177,8 @@ s32 txgbe_read_i2c_byte(struct txgbe_hw *hw, u8 byte_offset,
 				u8 dev_addr, u8 *data);
 s32 txgbe_read_i2c_word(struct txgbe_hw *hw, u16 byte_offset,
 				u8 dev_addr, u16 *data);
+s32 txgbe_read_i2c_block(struct txgbe_hw *hw, u8 byte_offset,
+				 u8 dev_addr, u16 len, u8 *data);
 
 
 s32 txgbe_write_i2c_byte(struct txgbe_hw *hw, u8 byte_offset,
@@ -80,6 +80,29 @@
 
 #define TXGBE_OVERFLOW_PERIOD    (HZ * 30)
 #define TXGBE_PTP_TX_TIMEOUT     (HZ)
+#define TXGBE_PTP_TX_POLL_US     200
+
+/**
+ * txgbe_ptp_read_systim - read the SYSTIME registers
+ * @adapter: private adapter structure
+ * @sts: system time taken around the SYSTIML read, may be NULL
+ *
+ * Reading SYSTIML latches SYSTIMH, so the SYSTIML read is the sampling
+ * point and the only one bracketed by the system timestamps.
+ **/
+static u64 txgbe_ptp_read_systim(struct txgbe_adapter *adapter,
+				 struct ptp_system_timestamp *sts)
+{
+	struct txgbe_hw *hw = &adapter->hw;
+	u64 stamp;
+
+	ptp_read_system_prets(sts);
+	stamp = (u64)rd32(hw, TXGBE_TSC_1588_SYSTIML);
+	ptp_read_system_postts(sts);
+	stamp |= (u64)rd32(hw, TXGBE_TSC_1588_SYSTIMH) << 32;
+
+	return stamp;
+}
 
 /**
  * txgbe_ptp_read - read raw cycle counter (to be used by time counter)
@@ -97,13 +120,49 @@ static u64 txgbe_ptp_read(struct cyclecounter *hw_cc)
 {
 	struct txgbe_adapter *adapter =
 		container_of(hw_cc, struct txgbe_adapter, hw_cc);
-	struct txgbe_hw *hw = &adapter->hw;
-	u64 stamp = 0;
 
-	stamp |= (u64)rd32(hw, TXGBE_TSC_1588_SYSTIML);
-	stamp |= (u64)rd32(hw, TXGBE_TSC_1588_SYSTIMH) << 32;
+	return txgbe_ptp_read_systim(adapter, NULL);
+}
 
-	return stamp;
+/* Timecounter writers serialize on tmreg_lock and bump tmreg_seq, so that
+ * txgbe_ptp_cyc2time() readers retry instead of taking the lock.
+ */
+#define txgbe_ptp_tc_lock(adapter, flags)				\
+	do {								\
+		spin_lock_irqsave(&(adapter)->tmreg_lock, flags);	\
+		write_seqcount_begin(&(adapter)->tmreg_seq);		\
+	} while (0)
+
+#define txgbe_ptp_tc_unlock(adapter, flags)				\
+	do {								\
+		write_seqcount_end(&(adapter)->tmreg_seq);		\
+		spin_unlock_irqrestore(&(adapter)->tmreg_lock, flags);	\
+	} while (0)
+
+/**
+ * txgbe_ptp_cyc2time - convert a SYSTIME value to ns without locking
+ * @adapter: private adapter structure
+ * @cycles: raw SYSTIME or timestamp register value
+ *
+ * Works on a consistent copy of the cyclecounter and timecounter taken
+ * under tmreg_seq.  The timecounter itself is not advanced; the overflow
+ * check does that periodically, and a 64 bit SYSTIME never wraps.
+ **/
+static u64 txgbe_ptp_cyc2time(struct txgbe_adapter *adapter, u64 cycles)
+{
+	struct cyclecounter cc;
+	struct timecounter tc;
+	unsigned int seq;
+
+	do {
+		seq = read_seqcount_begin(&adapter->tmreg_seq);
+		tc = adapter->hw_tc;
+		cc = adapter->hw_cc;
+	} while (read_seqcount_retry(&adapter->tmreg_seq, seq));
+
+	tc.cc = &cc;
+
+	return timecounter_cyc2time(&tc, cycles);
 }
 
 /**
@@ -115,10 +174,9 @@ static u64 txgbe_ptp_read(struct cyclecounter *hw_cc)
  * We need to convert the adapter's RX/TXSTMP registers into a hwtstamp value
  * which can be used by the stack's ptp functions.
  *
- * The lock is used to protect consistency of the cyclecounter and the SYSTIME
- * registers. However, it does not need to protect against the Rx or Tx
- * timestamp registers, as there can't be a new timestamp until the old one is
- * unlatched by reading.
+ * The conversion is lock-free, see txgbe_ptp_cyc2time().  The Rx and Tx
+ * timestamp registers need no protection, as there can't be a new timestamp
+ * until the old one is unlatched by reading.
  *
  * In addition to the timestamp in hardware, some controllers need a software
  * overflow cyclecounter, and this function takes this into account as well.
@@ -127,14 +185,11 @@ static void txgbe_ptp_convert_to_hwtstamp(struct txgbe_adapter *adapter,
 					  struct skb_shared_hwtstamps *hwtstamp,
 					  u64 timestamp)
 {
-	unsigned long flags;
 	u64 ns;
 
 	memset(hwtstamp, 0, sizeof(*hwtstamp));
 
-	spin_lock_irqsave(&adapter->tmreg_lock, flags);
-	ns = timecounter_cyc2time(&adapter->hw_tc, timestamp);
-	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
+	ns = txgbe_ptp_cyc2time(adapter, timestamp);
 
 	hwtstamp->hwtstamp = ns_to_ktime(ns);
 }
@@ -222,38 +277,50 @@ static int txgbe_ptp_adjtime(struct ptp_clock_info *ptp,
 		container_of(ptp, struct txgbe_adapter, ptp_caps);
 	unsigned long flags;
 
-	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	txgbe_ptp_tc_lock(adapter, flags);
 	timecounter_adjtime(&adapter->hw_tc, delta);
-	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
+	txgbe_ptp_tc_unlock(adapter, flags);
 
 	return 0;
 }
 
 /**
- * txgbe_ptp_gettime64
+ * txgbe_ptp_gettimex64
  * @ptp: the ptp clock structure
  * @ts: timespec64 structure to hold the current time value
+ * @sts: system time taken right before and after the SYSTIML read
  *
- * read the timecounter and return the correct value on ns,
+ * read the SYSTIME registers and return the correct value on ns,
  * after converting it into a struct timespec64.
  */
-static int txgbe_ptp_gettime64(struct ptp_clock_info *ptp,
-			       struct timespec64 *ts)
+static int txgbe_ptp_gettimex64(struct ptp_clock_info *ptp,
+				struct timespec64 *ts,
+				struct ptp_system_timestamp *sts)
 {
 	struct txgbe_adapter *adapter =
 		container_of(ptp, struct txgbe_adapter, ptp_caps);
-	unsigned long flags;
 	u64 ns;
 
-	spin_lock_irqsave(&adapter->tmreg_lock, flags);
-	ns = timecounter_read(&adapter->hw_tc);
-	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
+	ns = txgbe_ptp_cyc2time(adapter, txgbe_ptp_read_systim(adapter, sts));
 
 	*ts = ns_to_timespec64(ns);
 
 	return 0;
 }
 
+#ifndef HAVE_PTP_SYS_OFFSET_EXTENDED_IOCTL
+/**
+ * txgbe_ptp_gettime64
+ * @ptp: the ptp clock structure
+ * @ts: timespec64 structure to hold the current time value
+ */
+static int txgbe_ptp_gettime64(struct ptp_clock_info *ptp,
+			       struct timespec64 *ts)
+{
+	return txgbe_ptp_gettimex64(ptp, ts, NULL);
+}
+#endif /* HAVE_PTP_SYS_OFFSET_EXTENDED_IOCTL */
+
 /**
  * txgbe_ptp_settime64
  * @ptp: the ptp clock structure
@@ -273,9 +340,9 @@ static int txgbe_ptp_settime64(struct ptp_clock_info *ptp,
 	ns = timespec64_to_ns(ts);
 
 	/* reset the timecounter */
-	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	txgbe_ptp_tc_lock(adapter, flags);
 	timecounter_init(&adapter->hw_tc, &adapter->hw_cc, ns);
-	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
+	txgbe_ptp_tc_unlock(adapter, flags);
 
 	return 0;
 }
@@ -360,10 +427,13 @@ void txgbe_ptp_overflow_check(struct txgbe_adapter *adapter)
 {
 	bool timeout = time_is_before_jiffies(adapter->last_overflow_check +
 					      TXGBE_OVERFLOW_PERIOD);
-	struct timespec64 ts;
+	unsigned long flags;
 
 	if (timeout) {
-		txgbe_ptp_gettime64(&adapter->ptp_caps, &ts);
+		/* move cycle_last forward, clock reads no longer do */
+		txgbe_ptp_tc_lock(adapter, flags);
+		timecounter_read(&adapter->hw_tc);
+		txgbe_ptp_tc_unlock(adapter, flags);
 		adapter->last_overflow_check = jiffies;
 	}
 }
@@ -411,6 +481,40 @@ void txgbe_ptp_rx_hang(struct txgbe_adapter *adapter)
 	}
 }
 
+/* Tx timestamp hand-off
+ *
+ * Only one Tx timestamp can be outstanding (__TXGBE_PTP_TX_IN_PROGRESS).
+ * The skb is handed to whichever context first sees TSC_1588_CTL.VALID:
+ * the TIMESYNC misc interrupt, the Tx clean of the timestamped packet, or
+ * the PTP worker which polls as a fallback and enforces the timeout.  The
+ * winner is whoever xchg()s ptp_tx_skb to NULL, so the timestamp registers
+ * are read and the skb is completed exactly once.
+ */
+#ifdef HAVE_KTHREAD_DELAYED_API
+#define txgbe_ptp_tx_queue(adapter, delay) \
+	kthread_mod_delayed_work((adapter)->ptp_kworker, \
+				 &(adapter)->ptp_tx_work, delay)
+#define txgbe_ptp_tx_cancel(adapter) \
+	kthread_cancel_delayed_work_sync(&(adapter)->ptp_tx_work)
+#else
+#define txgbe_ptp_tx_queue(adapter, delay) \
+	mod_delayed_work(system_highpri_wq, &(adapter)->ptp_tx_work, delay)
+#define txgbe_ptp_tx_cancel(adapter) \
+	cancel_delayed_work_sync(&(adapter)->ptp_tx_work)
+#endif
+
+/* ptp_tx_hist buckets are log2 microseconds */
+static void txgbe_ptp_tx_hist_add(struct txgbe_adapter *adapter, u64 ns)
+{
+	u64 us = div_u64(ns, 1000);
+	unsigned int bucket = 0;
+
+	if (us > 1)
+		bucket = min_t(unsigned int, ilog2(us),
+			       TXGBE_PTP_TX_HIST_BUCKETS - 1);
+	adapter->ptp_tx_hist[bucket]++;
+}
+
 /**
  * txgbe_ptp_clear_tx_timestamp - utility function to clear Tx timestamp state
  * @adapter: the private adapter structure
@@ -422,36 +526,62 @@ void txgbe_ptp_rx_hang(struct txgbe_adapter *adapter)
 static void txgbe_ptp_clear_tx_timestamp(struct txgbe_adapter *adapter)
 {
 	struct txgbe_hw *hw = &adapter->hw;
+	struct sk_buff *skb = xchg(&adapter->ptp_tx_skb, NULL);
+
+	if (!skb)
+		return;
 
 	rd32(hw, TXGBE_TSC_1588_STMPH);
-	if (adapter->ptp_tx_skb) {
-		dev_kfree_skb_any(adapter->ptp_tx_skb);
-		adapter->ptp_tx_skb = NULL;
-	}
+	dev_kfree_skb_any(skb);
 	clear_bit_unlock(__TXGBE_PTP_TX_IN_PROGRESS, &adapter->state);
 }
 
 /**
  * txgbe_ptp_tx_hwtstamp - utility function which checks for TX time stamp
  * @adapter: the private adapter struct
+ * @counter: delivery path counter to bump
  *
- * if the timestamp is valid, we convert it into the timecounter ns
- * value, then store that result into the shhwtstamps structure which
- * is passed up the network stack
+ * If the Tx timestamp is valid and nobody else has claimed the skb, we
+ * convert it into the timecounter ns value, then store that result into
+ * the shhwtstamps structure which is passed up the network stack.
+ * Returns true once the pending timestamp has been completed, by us or by
+ * another context.  Safe to call from hard interrupt context.
  */
-static void txgbe_ptp_tx_hwtstamp(struct txgbe_adapter *adapter)
+static bool txgbe_ptp_tx_hwtstamp(struct txgbe_adapter *adapter, u32 *counter)
 {
 	struct txgbe_hw *hw = &adapter->hw;
 	struct skb_shared_hwtstamps shhwtstamps;
+	struct sk_buff *skb;
 	u64 regval = 0;
+	u64 done_ns;
+
+	if (!READ_ONCE(adapter->ptp_tx_skb))
+		return true;
+	if (!(rd32(hw, TXGBE_TSC_1588_CTL) & TXGBE_TSC_1588_CTL_VALID))
+		return false;
 
+	skb = xchg(&adapter->ptp_tx_skb, NULL);
+	if (!skb)
+		return true;
+
+	/* reading STMPH releases the timestamp latch */
 	regval |= (u64)rd32(hw, TXGBE_TSC_1588_STMPL);
 	regval |= (u64)rd32(hw, TXGBE_TSC_1588_STMPH) << 32;
+	done_ns = READ_ONCE(adapter->ptp_tx_done_ns);
 
 	txgbe_ptp_convert_to_hwtstamp(adapter, &shhwtstamps, regval);
-	skb_tstamp_tx(adapter->ptp_tx_skb, &shhwtstamps);
+	skb_tstamp_tx(skb, &shhwtstamps);
 
-	txgbe_ptp_clear_tx_timestamp(adapter);
+	/* descriptor write-back to skb_tstamp_tx(); a timestamp completed
+	 * ahead of the Tx clean lands in the first bucket
+	 */
+	txgbe_ptp_tx_hist_add(adapter, done_ns ? ktime_get_ns() - done_ns : 0);
+	(*counter)++;
+
+	dev_kfree_skb_any(skb);
+	clear_bit_unlock(__TXGBE_PTP_TX_IN_PROGRESS, &adapter->state);
+
+	return true;
 }
 
 /**
@@ -461,40 +591,112 @@ static void txgbe_ptp_tx_hwtstamp(struct txgbe_adapter *adapter)
  * This work item polls TSYNCTXCTL valid bit to determine when a Tx hardware
  * timestamp has been taken for the current skb. It is necesary, because the
  * descriptor's "done" bit does not correlate with the timestamp event.
+ *
+ * Normally the timestamp has already been delivered from the TIMESYNC
+ * interrupt or the Tx clean by the time this runs.  Once the descriptor
+ * has been written back the worker polls for TXGBE_PTP_TX_POLL_US before
+ * dropping to one check per jiffy until TXGBE_PTP_TX_TIMEOUT.
  */
+#ifdef HAVE_KTHREAD_DELAYED_API
+static void txgbe_ptp_tx_hwtstamp_work(struct kthread_work *work)
+#else
 static void txgbe_ptp_tx_hwtstamp_work(struct work_struct *work)
+#endif
 {
 	struct txgbe_adapter *adapter = container_of(work, struct txgbe_adapter,
-						     ptp_tx_work);
-	struct txgbe_hw *hw = &adapter->hw;
+						     ptp_tx_work.work);
 	bool timeout = time_is_before_jiffies(adapter->ptp_tx_start +
 					      TXGBE_PTP_TX_TIMEOUT);
-	u32 tsynctxctl;
+	u64 deadline;
 
-	/* we have to have a valid skb to poll for a timestamp */
-	if (!adapter->ptp_tx_skb) {
-		txgbe_ptp_clear_tx_timestamp(adapter);
+	if (txgbe_ptp_tx_hwtstamp(adapter, &adapter->tx_hwtstamp_polled))
 		return;
-	}
 
-	/* stop polling once we have a valid timestamp */
-	tsynctxctl = rd32(hw, TXGBE_TSC_1588_CTL);
-	if (tsynctxctl & TXGBE_TSC_1588_CTL_VALID) {
-		txgbe_ptp_tx_hwtstamp(adapter);
-		return;
+	if (READ_ONCE(adapter->ptp_tx_done_ns)) {
+		deadline = ktime_get_ns() + TXGBE_PTP_TX_POLL_US * NSEC_PER_USEC;
+		do {
+			usleep_range(10, 20);
+			if (txgbe_ptp_tx_hwtstamp(adapter,
+						  &adapter->tx_hwtstamp_polled))
+				return;
+		} while (ktime_get_ns() < deadline);
 	}
 
 	/* check timeout last in case timestamp event just occurred */
 	if (timeout) {
+		if (!READ_ONCE(adapter->ptp_tx_skb))
+			return;
 		txgbe_ptp_clear_tx_timestamp(adapter);
 		adapter->tx_hwtstamp_timeouts++;
 		e_warn(drv, "clearing Tx Timestamp hang");
 	} else {
 		/* reschedule to keep checking until we timeout */
-		schedule_work(&adapter->ptp_tx_work);
+		txgbe_ptp_tx_queue(adapter, 1);
 	}
 }
 
+/**
+ * txgbe_ptp_tx_queued - track a packet queued for Tx timestamping
+ * @adapter: the private adapter struct
+ * @skb: the packet, a reference is taken
+ *
+ * Called from the xmit path with __TXGBE_PTP_TX_IN_PROGRESS held.  The
+ * worker is armed one jiffy out as a backstop; the Tx clean pulls it in
+ * once the descriptor has been written back.
+ */
+void txgbe_ptp_tx_queued(struct txgbe_adapter *adapter, struct sk_buff *skb)
+{
+	adapter->ptp_tx_start = jiffies;
+	WRITE_ONCE(adapter->ptp_tx_done_ns, 0);
+	/* publish the skb last, it is what the other paths test */
+	smp_store_release(&adapter->ptp_tx_skb, skb_get(skb));
+	txgbe_ptp_tx_queue(adapter, 1);
+}
+
+/**
+ * txgbe_ptp_tx_done - the timestamped packet has been written back
+ * @adapter: the private adapter struct
+ *
+ * Called from the Tx clean when it reaps a descriptor that requested a
+ * timestamp.  The timestamp is usually latched by now, so try to deliver
+ * it right away and only fall back to the worker if it is not.
+ */
+void txgbe_ptp_tx_done(struct txgbe_adapter *adapter)
+{
+	if (!READ_ONCE(adapter->ptp_tx_skb))
+		return;
+
+	WRITE_ONCE(adapter->ptp_tx_done_ns, ktime_get_ns());
+	if (!txgbe_ptp_tx_hwtstamp(adapter, &adapter->tx_hwtstamp_clean))
+		txgbe_ptp_tx_queue(adapter, 0);
+}
+
+/**
+ * txgbe_ptp_tx_abort - drop a Tx timestamp request that was never sent
+ * @adapter: the private adapter struct
+ *
+ * Used by the xmit error path.  Does not sleep.
+ */
+void txgbe_ptp_tx_abort(struct txgbe_adapter *adapter)
+{
+	txgbe_ptp_clear_tx_timestamp(adapter);
+}
+
+/**
+ * txgbe_ptp_check_tx_event - TIMESYNC interrupt Tx timestamp check
+ * @adapter: the private adapter struct
+ *
+ * Called from the misc interrupt on a TIMESYNC cause.  Delivers a pending
+ * Tx timestamp straight from the interrupt when it is valid.
+ */
+void txgbe_ptp_check_tx_event(struct txgbe_adapter *adapter)
+{
+	if (!test_bit(__TXGBE_PTP_TX_IN_PROGRESS, &adapter->state))
+		return;
+
+	txgbe_ptp_tx_hwtstamp(adapter, &adapter->tx_hwtstamp_irq);
+}
+
 /**
  * txgbe_ptp_rx_rgtstamp - utility function which checks for RX time stamp
  * @q_vector: structure containing interrupt and ring information
@@ -630,6 +832,12 @@ int txgbe_ptp_set_timestamp_mode(struct txgbe_adapter *adapter,
 		 * therefore it is not possible to time stamp both V1 Sync and
 		 * Delay_Req messages unless hardware supports timestamping all
 		 * packets => return error
+		 *
+		 * It does not: the MAC latches one Rx timestamp at a time in
+		 * PSR_1588_STMPL/H and the write-back descriptor only flags
+		 * it with RXD_STAT_TS.  Nothing is written to the descriptor
+		 * or prepended to the packet, so there is no per-packet
+		 * timestamp to report for HWTSTAMP_FILTER_ALL.
 		 */
 		adapter->flags &= ~(TXGBE_FLAG_RX_HWTSTAMP_ENABLED |
 				    TXGBE_FLAG_RX_HWTSTAMP_IN_REGISTER);
@@ -812,9 +1020,9 @@ void txgbe_ptp_start_cyclecounter(struct txgbe_adapter *adapter)
 	smp_mb();
 
 	/* need lock to prevent incorrect read while modifying cyclecounter */
-	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	txgbe_ptp_tc_lock(adapter, flags);
 	memcpy(&adapter->hw_cc, &cc, sizeof(adapter->hw_cc));
-	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
+	txgbe_ptp_tc_unlock(adapter, flags);
 }
 
 /**
@@ -837,10 +1045,10 @@ void txgbe_ptp_reset(struct txgbe_adapter *adapter)
 	txgbe_ptp_set_timestamp_mode(adapter, &adapter->tstamp_config);
 	txgbe_ptp_start_cyclecounter(adapter);
 
-	spin_lock_irqsave(&adapter->tmreg_lock, flags);
+	txgbe_ptp_tc_lock(adapter, flags);
 	timecounter_init(&adapter->hw_tc, &adapter->hw_cc,
 			 ktime_to_ns(ktime_get_real()));
-	spin_unlock_irqrestore(&adapter->tmreg_lock, flags);
+	txgbe_ptp_tc_unlock(adapter, flags);
 
 	adapter->last_overflow_check = jiffies;
 }
@@ -880,7 +1088,11 @@ static long txgbe_ptp_create_clock(struct txgbe_adapter *adapter)
 #endif
 	adapter->ptp_caps.adjtime = txgbe_ptp_adjtime;
 #ifdef HAVE_PTP_CLOCK_INFO_GETTIME64
+#ifdef HAVE_PTP_SYS_OFFSET_EXTENDED_IOCTL
+	adapter->ptp_caps.gettimex64 = txgbe_ptp_gettimex64;
+#else
 	adapter->ptp_caps.gettime64 = txgbe_ptp_gettime64;
+#endif
 	adapter->ptp_caps.settime64 = txgbe_ptp_settime64;
 #else
 	adapter->ptp_caps.gettime = txgbe_ptp_gettime;
@@ -922,13 +1134,35 @@ void txgbe_ptp_init(struct txgbe_adapter *adapter)
 	 * functions any time after we've initialized the ptp clock device.
 	 */
 	spin_lock_init(&adapter->tmreg_lock);
+	seqcount_init(&adapter->tmreg_seq);
 
 	/* obtain a ptp clock device, or re-use an existing device */
 	if (txgbe_ptp_create_clock(adapter))
 		return;
 
 	/* we have a clock, so we can intialize work for timestamps now */
-	INIT_WORK(&adapter->ptp_tx_work, txgbe_ptp_tx_hwtstamp_work);
+#ifdef HAVE_KTHREAD_DELAYED_API
+	if (!adapter->ptp_kworker) {
+		struct kthread_worker *kworker;
+
+		kworker = kthread_create_worker(0, "txgbe_ptp/%s",
+						pci_name(adapter->pdev));
+		if (IS_ERR(kworker)) {
+			e_dev_err("failed to create PTP worker: %ld\n",
+				  PTR_ERR(kworker));
+			ptp_clock_unregister(adapter->ptp_clock);
+			adapter->ptp_clock = NULL;
+			return;
+		}
+		/* Tx timestamps are latency sensitive for ptp4l */
+		sched_set_fifo_low(kworker->task);
+		adapter->ptp_kworker = kworker;
+	}
+	kthread_init_delayed_work(&adapter->ptp_tx_work,
+				  txgbe_ptp_tx_hwtstamp_work);
+#else
+	INIT_DELAYED_WORK(&adapter->ptp_tx_work, txgbe_ptp_tx_hwtstamp_work);
+#endif
 
 	/* reset the ptp related hardware bits */
 	txgbe_ptp_reset(adapter);
@@ -954,7 +1188,7 @@ void txgbe_ptp_suspend(struct txgbe_adapter *adapter)
 
 	adapter->flags2 &= ~TXGBE_FLAG2_PTP_PPS_ENABLED;
 
-	cancel_work_sync(&adapter->ptp_tx_work);
+	txgbe_ptp_tx_cancel(adapter);
 	txgbe_ptp_clear_tx_timestamp(adapter);
 }
 
@@ -977,4 +1211,12 @@ void txgbe_ptp_stop(struct txgbe_adapter *adapter)
 		e_dev_info("removed PHC on %s\n",
 			   adapter->netdev->name);
 	}
+#ifdef HAVE_KTHREAD_DELAYED_API
+
+	/* the xmit path only queues Tx work while ptp_clock is set */
+	if (adapter->ptp_kworker) {
+		kthread_destroy_worker(adapter->ptp_kworker);
+		adapter->ptp_kworker = NULL;
+	}
+#endif
 }
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (c) 2015 - 2022 Beijing WangXun Technology Co., Ltd. */
+
+#include "txgbe_type.h"
+#include "txgbe_regtbl.h"
+
+/**
+ * txgbe_reg_table_init - set up an empty table
+ * @tbl: table
+ * @reg: register of entry 0
+ * @size: number of registers, at most TXGBE_REG_TABLE_MAX
+ **/
+void txgbe_reg_table_init(struct txgbe_reg_table *tbl, u32 reg, u32 size)
+{
+	memset(tbl, 0, sizeof(*tbl));
+	tbl->reg = reg;
+	tbl->size = min_t(u32, size, TXGBE_REG_TABLE_MAX);
+}
+
+/**
+ * txgbe_reg_table_forget - the hardware contents are no longer known
+ * @tbl: table
+ *
+ * The next write of every register goes to the hardware.
+ **/
+void txgbe_reg_table_forget(struct txgbe_reg_table *tbl)
+{
+	bitmap_zero(tbl->known, TXGBE_REG_TABLE_MAX);
+}
+
+/**
+ * txgbe_reg_table_set - write one register of a table if it changed
+ * @hw: pointer to hardware structure
+ * @tbl: table
+ * @idx: register index within the table
+ * @val: new value
+ *
+ * The write is not flushed, see txgbe_reg_table_flush().
+ *
+ * Returns true if the register was written.
+ **/
+bool txgbe_reg_table_set(struct txgbe_hw *hw, struct txgbe_reg_table *tbl,
+			 u32 idx, u32 val)
+{
+	if (idx >= tbl->size)
+		return false;
+
+	if (test_bit(idx, tbl->known) && tbl->val[idx] == val) {
+		tbl->skipped++;
+		return false;
+	}
+
+	wr32(hw, tbl->reg + (idx << 2), val);
+	tbl->val[idx] = val;
+	__set_bit(idx, tbl->known);
+	tbl->writes++;
+	tbl->pending++;
+	return true;
+}
+
+/**
+ * txgbe_reg_table_flush - flush the writes since the last flush
+ * @hw: pointer to hardware structure
+ * @tbl: table
+ *
+ * Costs one register read, and nothing if no register was written.
+ **/
+void txgbe_reg_table_flush(struct txgbe_hw *hw, struct txgbe_reg_table *tbl)
+{
+	if (!tbl->pending)
+		return;
+
+	TXGBE_WRITE_FLUSH(hw);
+	tbl->pending = 0;
+	tbl->flushes++;
+}
+
+/**
+ * txgbe_reg_table_sync - bring a table to the given contents
+ * @hw: pointer to hardware structure
+ * @tbl: table
+ * @vals: wanted value of registers 0 .. @count - 1
+ * @count: number of registers in @vals
+ *
+ * Returns the number of registers written.
+ **/
+u32 txgbe_reg_table_sync(struct txgbe_hw *hw, struct txgbe_reg_table *tbl,
+			 const u32 *vals, u32 count)
+{
+	u32 i, written = 0;
+
+	count = min(count, tbl->size);
+	for (i = 0; i < count; i++)
+		written += txgbe_reg_table_set(hw, tbl, i, vals[i]);
+	txgbe_reg_table_flush(hw, tbl);
+
+	return written;
+}
+
+/**
+ * txgbe_reg_table_fill - set every register of a table to one value
+ * @hw: pointer to hardware structure
+ * @tbl: table
+ * @val: value
+ *
+ * Returns the number of registers written.
+ **/
+u32 txgbe_reg_table_fill(struct txgbe_hw *hw, struct txgbe_reg_table *tbl,
+			 u32 val)
+{
+	u32 i, written = 0;
+
+	for (i = 0; i < tbl->size; i++)
+		written += txgbe_reg_table_set(hw, tbl, i, val);
+	txgbe_reg_table_flush(hw, tbl);
+
+	return written;
+}
@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (c) 2015 - 2022 Beijing WangXun Technology Co., Ltd. */
+#ifndef _TXGBE_REGTBL_H_
+#define _TXGBE_REGTBL_H_
+
+/*
+ * Shadowed register tables: RSS redirection table, VLAN filter table and
+ * multicast table.
+ *
+ * A table remembers the value last written to each of its registers.
+ * txgbe_reg_table_sync() takes the wanted contents of the whole table and
+ * txgbe_reg_table_set() changes a single register; either way only
+ * registers whose value differs, or is unknown since the last MAC reset,
+ * are written.  sync() and fill() end their batch with one flushing read
+ * instead of leaving every write to be posted on its own; set() leaves the
+ * flush to txgbe_reg_table_flush() so a caller changing many entries pays
+ * for it once.
+ *
+ * txgbe_reg_table_forget() must be called whenever the hardware may have
+ * cleared the registers behind the table's back, i.e. on every MAC reset,
+ * and nothing else may write the registers directly.
+ *
+ * txgbe_regtbl.c only uses wr32() and TXGBE_WRITE_FLUSH(), so tools/regsim
+ * can build it against a register file model.
+ */
+
+#define TXGBE_REG_TABLE_MAX             128
+
+struct txgbe_hw;
+
+struct txgbe_reg_table {
+	u32 reg;                        /* register of entry 0 */
+	u32 size;                       /* registers, 4 bytes apart */
+	u32 val[TXGBE_REG_TABLE_MAX];   /* last value written */
+	DECLARE_BITMAP(known, TXGBE_REG_TABLE_MAX); /* val[] is in hardware */
+	u32 pending;                    /* written since the last flush */
+
+	u64 writes;                     /* registers written */
+	u64 skipped;                    /* writes saved, value unchanged */
+	u64 flushes;
+};
+
+void txgbe_reg_table_init(struct txgbe_reg_table *tbl, u32 reg, u32 size);
+void txgbe_reg_table_forget(struct txgbe_reg_table *tbl);
+bool txgbe_reg_table_set(struct txgbe_hw *hw, struct txgbe_reg_table *tbl,
+			 u32 idx, u32 val);
+void txgbe_reg_table_flush(struct txgbe_hw *hw, struct txgbe_reg_table *tbl);
+u32 txgbe_reg_table_sync(struct txgbe_hw *hw, struct txgbe_reg_table *tbl,
+			 const u32 *vals, u32 count);
+u32 txgbe_reg_table_fill(struct txgbe_hw *hw, struct txgbe_reg_table *tbl,
+			 u32 val);
+
+#endif /* _TXGBE_REGTBL_H_ */
@@ -0,0 +1,20 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (c) 2015 - 2022 Beijing WangXun Technology Co., Ltd. */
+#ifndef _TXGBE_RING_H_
+#define _TXGBE_RING_H_
+
+/*
+ * Descriptor ring loops: Tx completion reclaim and Rx buffer refill.
+ *
+ * The NAPI poll in txgbe_main.c calls these for every ring.  txgbe_ring.c
+ * only depends on the ring structures, DMA mapping and page allocation,
+ * so tools/ringbench can build it against a simulated device.
+ */
+
+struct txgbe_ring;
+
+unsigned int txgbe_tx_reclaim(struct txgbe_ring *tx_ring, unsigned int budget,
+			      unsigned int *bytes, unsigned int *packets);
+void txgbe_alloc_rx_buffers(struct txgbe_ring *rx_ring, u16 cleaned_count);
+
+#endif /* _TXGBE_RING_H_ */
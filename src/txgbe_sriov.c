@@ -35,6 +35,7 @@
 
 #include "txgbe.h"
 #include "txgbe_type.h"
+#include "txgbe_hw.h"
 #include "txgbe_sriov.h"
 
 static void txgbe_set_vf_rx_tx(struct txgbe_adapter *adapter, int vf);
@@ -350,6 +351,10 @@ int txgbe_disable_sriov(struct txgbe_adapter *adapter)
 		pci_disable_sriov(adapter->pdev);
 #endif
 
+	/* no more mailbox interrupts can arrive, drain the dispatcher */
+	cancel_delayed_work_sync(&adapter->mbx_task);
+	adapter->vf_mbx_deferred = 0;
+
 	/* set num VFs to 0 to prevent access to vfinfo */
 	adapter->num_vfs = 0;
 
@@ -439,8 +444,9 @@ static int txgbe_set_vf_multicasts(struct txgbe_adapter *adapter,
 		mta_reg = hw->mac.mta_shadow[vector_reg];
 		mta_reg |= (1 << vector_bit);
 		hw->mac.mta_shadow[vector_reg] = mta_reg;
-		wr32(hw, TXGBE_PSR_MC_TBL(vector_reg), mta_reg);
+		txgbe_reg_table_set(hw, &hw->mac.mta_tbl, vector_reg, mta_reg);
 	}
+	txgbe_reg_table_flush(hw, &hw->mac.mta_tbl);
 	vmolr |= TXGBE_PSR_VM_L2CTL_ROMPE;
 	wr32(hw, TXGBE_PSR_VM_L2CTL(vf), vmolr);
 
@@ -462,10 +468,10 @@ void txgbe_restore_vf_multicasts(struct txgbe_adapter *adapter)
 			hw->addr_ctrl.mta_in_use++;
 			vector_reg = (vfinfo->vf_mc_hashes[j] >> 5) & 0x7F;
 			vector_bit = vfinfo->vf_mc_hashes[j] & 0x1F;
-			wr32m(hw, TXGBE_PSR_MC_TBL(vector_reg),
-				1 << vector_bit, 1 << vector_bit);
 			/* errata 5: maintain a copy of the reg table conf */
 			hw->mac.mta_shadow[vector_reg] |= (1 << vector_bit);
+			txgbe_reg_table_set(hw, &hw->mac.mta_tbl, vector_reg,
+					    hw->mac.mta_shadow[vector_reg]);
 		}
 		if (vfinfo->num_vf_mc_hashes)
 			vmolr |= TXGBE_PSR_VM_L2CTL_ROMPE;
@@ -473,6 +479,7 @@ void txgbe_restore_vf_multicasts(struct txgbe_adapter *adapter)
 			vmolr &= ~TXGBE_PSR_VM_L2CTL_ROMPE;
 		wr32(hw, TXGBE_PSR_VM_L2CTL(i), vmolr);
 	}
+	txgbe_reg_table_flush(hw, &hw->mac.mta_tbl);
 
 	/* Restore any VF macvlans */
 	txgbe_full_sync_mac_table(adapter);
@@ -901,32 +908,6 @@ static int txgbe_set_vf_mac_addr(struct txgbe_adapter *adapter,
 	return txgbe_set_vf_mac(adapter, vf, new_mac) < 0;
 }
 
-#ifdef CONFIG_PCI_IOV
-static int txgbe_find_vlvf_entry(struct txgbe_hw *hw, u32 vlan)
-{
-	u32 vlvf;
-	s32 regindex;
-
-	/* short cut the special case */
-	if (vlan == 0)
-		return 0;
-
-	/* Search for the vlan id in the VLVF entries */
-	for (regindex = 1; regindex < TXGBE_PSR_VLAN_SWC_ENTRIES; regindex++) {
-		wr32(hw, TXGBE_PSR_VLAN_SWC_IDX, regindex);
-		vlvf = rd32(hw, TXGBE_PSR_VLAN_SWC);
-		if ((vlvf & VLAN_VID_MASK) == vlan)
-			break;
-	}
-
-	/* Return a negative value if not found */
-	if (regindex >= TXGBE_PSR_VLAN_SWC_ENTRIES)
-		regindex = -1;
-
-	return regindex;
-}
-#endif /* CONFIG_PCI_IOV */
-
 static int txgbe_set_vf_vlan_msg(struct txgbe_adapter *adapter,
 				 u32 *msgbuf, u16 vf)
 {
@@ -965,28 +946,18 @@ static int txgbe_set_vf_vlan_msg(struct txgbe_adapter *adapter,
 	 * be wiped completely.
 	 */
 	if (!add && adapter->netdev->flags & IFF_PROMISC) {
-		u32 bits, vlvf;
+		u32 vlvf;
+		u64 bits;
 		s32 reg_ndx;
 
 		reg_ndx = txgbe_find_vlvf_entry(hw, vid);
 		if (reg_ndx < 0)
 			goto out;
-		wr32(hw, TXGBE_PSR_VLAN_SWC_IDX, reg_ndx);
-		vlvf = rd32(hw, TXGBE_PSR_VLAN_SWC);
+		vlvf = hw->mac.vlvf.vlvf[reg_ndx];
 		/* See if any other pools are set for this VLAN filter
 		 * entry other than the PF.
 		 */
-		if (VMDQ_P(0) < 32) {
-			bits = rd32(hw, TXGBE_PSR_VLAN_SWC_VM_L);
-			bits &= ~(1 << VMDQ_P(0));
-			bits |= rd32(hw,
-					       TXGBE_PSR_VLAN_SWC_VM_H);
-		} else {
-			bits = rd32(hw,
-					      TXGBE_PSR_VLAN_SWC_VM_H);
-			bits &= ~(1 << (VMDQ_P(0) - 32));
-			bits |= rd32(hw, TXGBE_PSR_VLAN_SWC_VM_L);
-		}
+		bits = hw->mac.vlvf.pools[reg_ndx] & ~(1ULL << VMDQ_P(0));
 
 		/* If the filter was removed then ensure PF pool bit
 		 * is cleared if the PF only added itself to the pool
@@ -1256,24 +1227,182 @@ static void txgbe_rcv_ack_from_vf(struct txgbe_adapter *adapter, u16 vf)
 		txgbe_write_mbx(hw, &msg, 1, vf);
 }
 
+/* mailbox latencies go into log2 buckets of microseconds */
+static void txgbe_mbx_hist_add(u32 *hist, u64 ns)
+{
+	u64 us = div_u64(ns, 1000);
+	unsigned int bucket = 0;
+
+	if (us > 1)
+		bucket = min_t(unsigned int, ilog2(us),
+			       TXGBE_MBX_HIST_BUCKETS - 1);
+	hist[bucket]++;
+}
+
+/**
+ * txgbe_vf_mbx_throttled - per-VF mailbox rate limit
+ * @adapter: board private structure
+ * @vf: VF index
+ *
+ * Allows txgbe_vf_mbx_rate messages per second per VF, counted in
+ * windows of TXGBE_VF_MBX_WINDOW.  Returns true if the message has to
+ * wait for the next window.
+ **/
+static bool txgbe_vf_mbx_throttled(struct txgbe_adapter *adapter, u16 vf)
+{
+	struct vf_data_storage *vfinfo = &adapter->vfinfo[vf];
+	u32 burst;
+
+	if (txgbe_vf_mbx_rate <= 0)
+		return false;
+
+	if (time_after_eq(jiffies, vfinfo->mbx_window + TXGBE_VF_MBX_WINDOW)) {
+		vfinfo->mbx_window = jiffies;
+		vfinfo->mbx_window_msgs = 0;
+	}
+
+	burst = DIV_ROUND_UP(txgbe_vf_mbx_rate * TXGBE_VF_MBX_WINDOW, HZ);
+	if (vfinfo->mbx_window_msgs >= burst) {
+		vfinfo->mbx_throttled++;
+		return true;
+	}
+
+	vfinfo->mbx_window_msgs++;
+	return false;
+}
+
+/**
+ * txgbe_msg_task - dispatch pending VF mailbox events
+ * @adapter: board private structure
+ *
+ * Reads each MBVFICR and VFLRE word once, acknowledges everything that
+ * was seen with a single write per word and then walks only the VFs that
+ * have something pending, in the same reset/message/ack order as a
+ * per-VF poll would.
+ **/
 void txgbe_msg_task(struct txgbe_adapter *adapter)
 {
 	struct txgbe_hw *hw = &adapter->hw;
-	u16 vf;
+	u64 rst = 0, req = 0, ack = 0, pending, deferred = 0;
+	u64 vf_mask, irq_ns;
+	unsigned int i;
+	u32 reg;
+
+	if (!adapter->num_vfs || !adapter->vfinfo)
+		return;
+
+	irq_ns = atomic64_xchg(&adapter->mbx_irq_ns, 0);
+	if (irq_ns)
+		txgbe_mbx_hist_add(adapter->mbx_queue_hist,
+				   ktime_get_ns() - irq_ns);
+
+	vf_mask = adapter->num_vfs >= 64 ? ~0ULL :
+		  BIT_ULL(adapter->num_vfs) - 1;
+
+	/* 16 VFs per MBVFICR word: requests low, acks high */
+	for (i = 0; i < DIV_ROUND_UP(adapter->num_vfs, 16); i++) {
+		u32 valid = (u32)(vf_mask >> (16 * i)) & 0xFFFF;
+
+		reg = rd32(hw, TXGBE_MBVFICR(i));
+		reg &= valid | (valid << 16);
+		if (!reg)
+			continue;
+		wr32(hw, TXGBE_MBVFICR(i), reg);
+		req |= (u64)(reg & TXGBE_MBVFICR_VFREQ_MASK) << (16 * i);
+		ack |= (u64)((reg & TXGBE_MBVFICR_VFACK_MASK) >> 16) << (16 * i);
+	}
+
+	/* 32 VFs per VFLRE word */
+	for (i = 0; i < DIV_ROUND_UP(adapter->num_vfs, 32); i++) {
+		reg = rd32(hw, TXGBE_VFLRE(i));
+		reg &= (u32)(vf_mask >> (32 * i));
+		if (!reg)
+			continue;
+		wr32(hw, TXGBE_VFLREC(i), reg);
+		rst |= (u64)reg << (32 * i);
+	}
+
+	req |= adapter->vf_mbx_deferred & vf_mask;
+	pending = rst | req | ack;
+
+	while (pending) {
+		u16 vf = __ffs64(pending);
+		u64 bit = BIT_ULL(vf);
+
+		pending &= ~bit;
 
-	for (vf = 0; vf < adapter->num_vfs; vf++) {
 		/* process any reset requests */
-		if (!txgbe_check_for_rst(hw, vf))
+		if (rst & bit) {
+			hw->mbx.stats.rsts++;
 			txgbe_vf_reset_event(adapter, vf);
+		}
 
 		/* process any messages pending */
-		if (!txgbe_check_for_msg(hw, vf))
-			txgbe_rcv_msg_from_vf(adapter, vf);
+		if (req & bit) {
+			if (txgbe_vf_mbx_throttled(adapter, vf)) {
+				deferred |= bit;
+			} else {
+				struct vf_data_storage *vfinfo =
+					&adapter->vfinfo[vf];
+				u64 start = ktime_get_ns();
+				u32 us;
+
+				hw->mbx.stats.reqs++;
+				vfinfo->mbx_msgs++;
+				txgbe_rcv_msg_from_vf(adapter, vf);
+
+				start = ktime_get_ns() - start;
+				txgbe_mbx_hist_add(adapter->mbx_service_hist,
+						   start);
+				us = (u32)min_t(u64, div_u64(start, 1000),
+						U32_MAX);
+				if (us > vfinfo->mbx_max_service_us)
+					vfinfo->mbx_max_service_us = us;
+			}
+		}
 
 		/* process any acks */
-		if (!txgbe_check_for_ack(hw, vf))
+		if (ack & bit) {
+			hw->mbx.stats.acks++;
 			txgbe_rcv_ack_from_vf(adapter, vf);
+		}
 	}
+
+	adapter->vf_mbx_deferred = deferred;
+}
+
+/**
+ * txgbe_msg_work - process context half of the VF mailbox interrupt
+ * @work: the mbx_task member of the adapter
+ **/
+void txgbe_msg_work(struct work_struct *work)
+{
+	struct txgbe_adapter *adapter = container_of(to_delayed_work(work),
+						     struct txgbe_adapter,
+						     mbx_task);
+
+	txgbe_msg_task(adapter);
+
+	/* come back for throttled requests once their window reopens, but
+	 * not once txgbe_remove() or a down is about to cancel us
+	 */
+	if (adapter->vf_mbx_deferred &&
+	    !test_bit(__TXGBE_REMOVING, &adapter->state) &&
+	    !test_bit(__TXGBE_DOWN, &adapter->state))
+		schedule_delayed_work(&adapter->mbx_task, TXGBE_VF_MBX_WINDOW);
+}
+
+/**
+ * txgbe_schedule_msg_task - hand a VF mailbox interrupt to process context
+ * @adapter: board private structure
+ *
+ * Called from the misc interrupt; remembers when the first unserviced
+ * interrupt arrived so the dispatch delay can be accounted.
+ **/
+void txgbe_schedule_msg_task(struct txgbe_adapter *adapter)
+{
+	atomic64_cmpxchg(&adapter->mbx_irq_ns, 0, ktime_get_ns());
+	mod_delayed_work(system_wq, &adapter->mbx_task, 0);
 }
 
 void txgbe_disable_tx_rx(struct txgbe_adapter *adapter)
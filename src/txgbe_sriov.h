@@ -28,6 +28,8 @@ void txgbe_restore_vf_multicasts(struct txgbe_adapter *adapter);
 int txgbe_set_vf_vlan(struct txgbe_adapter *adapter, int add, int vid, u16 vf);
 void txgbe_set_vmolr(struct txgbe_hw *hw, u16 vf, bool aupe);
 void txgbe_msg_task(struct txgbe_adapter *adapter);
+void txgbe_msg_work(struct work_struct *work);
+void txgbe_schedule_msg_task(struct txgbe_adapter *adapter);
 int txgbe_set_vf_mac(struct txgbe_adapter *adapter,
 		     u16 vf, unsigned char *mac_addr);
 void txgbe_disable_tx_rx(struct txgbe_adapter *adapter);
@@ -0,0 +1,439 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * WangXun 10 Gigabit PCI Express Linux driver
+ * Copyright (c) 2015 - 2017 Beijing WangXun Technology Co., Ltd.
+ *
+ * Tracepoints for the datapath and the reset/recovery paths.
+ *
+ * All events live in the "txgbe" trace system and carry the netdev name
+ * and a queue or vector index, so per-queue histograms can be built with
+ * e.g.
+ *
+ *   bpftrace -e 'tracepoint:txgbe:txgbe_clean_rx_irq
+ *                { @pkts[str(args->devname), args->queue] = hist(args->packets); }'
+ *
+ * Callers go through txgbe_trace(), which compiles away entirely when the
+ * kernel is built without CONFIG_TRACEPOINTS.
+ */
+
+/* reset/recovery steps reported by txgbe_reset_step */
+#ifndef _TXGBE_TRACE_STEPS_
+#define _TXGBE_TRACE_STEPS_
+#define TXGBE_TRACE_TX_HANG		0
+#define TXGBE_TRACE_TX_TIMEOUT		1
+#define TXGBE_TRACE_RESET_SUBTASK	2
+#define TXGBE_TRACE_REINIT_START	3
+#define TXGBE_TRACE_REINIT_DOWN		4
+#define TXGBE_TRACE_REINIT_DONE		5
+#define TXGBE_TRACE_PCIE_RECOVER	6
+#define TXGBE_TRACE_AER_DETECTED	7
+#define TXGBE_TRACE_AER_SLOT_RESET	8
+#define TXGBE_TRACE_AER_RESUME		9
+#define TXGBE_TRACE_TX_RESTART		10
+#define TXGBE_TRACE_TX_RESTART_FAIL	11
+
+/* probe and open steps reported by txgbe_bringup_step */
+#define TXGBE_BRINGUP_PCI		0
+#define TXGBE_BRINGUP_SW_INIT		1
+#define TXGBE_BRINGUP_RESET_HW		2
+#define TXGBE_BRINGUP_NVM		3
+#define TXGBE_BRINGUP_IRQ_SCHEME	4
+#define TXGBE_BRINGUP_REGISTER		5
+#define TXGBE_BRINGUP_PROBE_DONE	6
+#define TXGBE_BRINGUP_RESOURCES		7
+#define TXGBE_BRINGUP_CONFIGURE		8
+#define TXGBE_BRINGUP_REQUEST_IRQ	9
+#define TXGBE_BRINGUP_OPEN_DONE		10
+#endif /* _TXGBE_TRACE_STEPS_ */
+
+#ifndef CONFIG_TRACEPOINTS
+#if !defined(_TXGBE_TRACE_H_)
+#define _TXGBE_TRACE_H_
+#define txgbe_trace(trace_name, args...)
+#define txgbe_trace_enabled(trace_name) (0)
+#endif /* !_TXGBE_TRACE_H_ */
+#else /* CONFIG_TRACEPOINTS */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM txgbe
+
+#if !defined(_TXGBE_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _TXGBE_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+#define _TXGBE_TRACE_NAME(trace_name) (trace_##txgbe##_##trace_name)
+#define TXGBE_TRACE_NAME(trace_name) _TXGBE_TRACE_NAME(trace_name)
+
+#define txgbe_trace(trace_name, args...) TXGBE_TRACE_NAME(trace_name)(args)
+#define txgbe_trace_enabled(trace_name) TXGBE_TRACE_NAME(trace_name##_enabled)()
+
+/* NAPI poll entry and exit, per q_vector */
+TRACE_EVENT(txgbe_napi_poll_enter,
+	TP_PROTO(struct txgbe_q_vector *q_vector, int budget),
+
+	TP_ARGS(q_vector, budget),
+
+	TP_STRUCT__entry(
+		__array(char, devname, IFNAMSIZ)
+		__field(u16, v_idx)
+		__field(u8, tx_rings)
+		__field(u8, rx_rings)
+		__field(int, budget)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->devname, q_vector->adapter->netdev->name,
+		       IFNAMSIZ);
+		__entry->v_idx = q_vector->v_idx;
+		__entry->tx_rings = q_vector->tx.count;
+		__entry->rx_rings = q_vector->rx.count;
+		__entry->budget = budget;
+	),
+
+	TP_printk("%s vector %u tx_rings %u rx_rings %u budget %d",
+		  __entry->devname, __entry->v_idx, __entry->tx_rings,
+		  __entry->rx_rings, __entry->budget)
+);
+
+TRACE_EVENT(txgbe_napi_poll_exit,
+	TP_PROTO(struct txgbe_q_vector *q_vector, int budget, int work_done,
+		 bool clean_complete),
+
+	TP_ARGS(q_vector, budget, work_done, clean_complete),
+
+	TP_STRUCT__entry(
+		__array(char, devname, IFNAMSIZ)
+		__field(u16, v_idx)
+		__field(int, budget)
+		__field(int, work_done)
+		__field(bool, clean_complete)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->devname, q_vector->adapter->netdev->name,
+		       IFNAMSIZ);
+		__entry->v_idx = q_vector->v_idx;
+		__entry->budget = budget;
+		__entry->work_done = work_done;
+		__entry->clean_complete = clean_complete;
+	),
+
+	TP_printk("%s vector %u budget %d work_done %d%s",
+		  __entry->devname, __entry->v_idx, __entry->budget,
+		  __entry->work_done,
+		  __entry->clean_complete ? " complete" : " repoll")
+);
+
+/* per-ring work done by one clean pass */
+DECLARE_EVENT_CLASS(txgbe_ring_clean,
+	TP_PROTO(struct txgbe_ring *ring, unsigned int packets,
+		 unsigned int bytes, int budget),
+
+	TP_ARGS(ring, packets, bytes, budget),
+
+	TP_STRUCT__entry(
+		__array(char, devname, IFNAMSIZ)
+		__field(u16, queue)
+		__field(u16, next_to_use)
+		__field(u16, next_to_clean)
+		__field(unsigned int, packets)
+		__field(unsigned int, bytes)
+		__field(int, budget)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->devname, ring->netdev->name, IFNAMSIZ);
+		__entry->queue = ring->queue_index;
+		__entry->next_to_use = ring->next_to_use;
+		__entry->next_to_clean = ring->next_to_clean;
+		__entry->packets = packets;
+		__entry->bytes = bytes;
+		__entry->budget = budget;
+	),
+
+	TP_printk("%s queue %u ntu %u ntc %u packets %u bytes %u budget %d",
+		  __entry->devname, __entry->queue, __entry->next_to_use,
+		  __entry->next_to_clean, __entry->packets, __entry->bytes,
+		  __entry->budget)
+);
+
+DEFINE_EVENT(txgbe_ring_clean, txgbe_clean_rx_irq,
+	TP_PROTO(struct txgbe_ring *ring, unsigned int packets,
+		 unsigned int bytes, int budget),
+	TP_ARGS(ring, packets, bytes, budget)
+);
+
+DEFINE_EVENT(txgbe_ring_clean, txgbe_clean_tx_irq,
+	TP_PROTO(struct txgbe_ring *ring, unsigned int packets,
+		 unsigned int bytes, int budget),
+	TP_ARGS(ring, packets, bytes, budget)
+);
+
+/* Rx refill: how many buffers were asked for and how many were posted */
+TRACE_EVENT(txgbe_alloc_rx_buffers,
+	TP_PROTO(struct txgbe_ring *ring, u16 requested, u16 filled),
+
+	TP_ARGS(ring, requested, filled),
+
+	TP_STRUCT__entry(
+		__array(char, devname, IFNAMSIZ)
+		__field(u16, queue)
+		__field(u16, next_to_use)
+		__field(u16, requested)
+		__field(u16, filled)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->devname, ring->netdev->name, IFNAMSIZ);
+		__entry->queue = ring->queue_index;
+		__entry->next_to_use = ring->next_to_use;
+		__entry->requested = requested;
+		__entry->filled = filled;
+	),
+
+	TP_printk("%s queue %u ntu %u requested %u filled %u",
+		  __entry->devname, __entry->queue, __entry->next_to_use,
+		  __entry->requested, __entry->filled)
+);
+
+/*
+ * One packet placed on a Tx ring.  @first is the index of its first
+ * descriptor; the matching completion is the txgbe_clean_tx_irq event
+ * whose ntc moves past it.
+ */
+TRACE_EVENT(txgbe_tx_map,
+	TP_PROTO(struct txgbe_ring *ring, u16 first, unsigned int bytes,
+		 bool kick),
+
+	TP_ARGS(ring, first, bytes, kick),
+
+	TP_STRUCT__entry(
+		__array(char, devname, IFNAMSIZ)
+		__field(u16, queue)
+		__field(u16, first)
+		__field(u16, next_to_use)
+		__field(u16, descs)
+		__field(unsigned int, bytes)
+		__field(bool, kick)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->devname, ring->netdev->name, IFNAMSIZ);
+		__entry->queue = ring->queue_index;
+		__entry->first = first;
+		__entry->next_to_use = ring->next_to_use;
+		__entry->descs = (ring->next_to_use >= first ? 0 : ring->count) +
+				 ring->next_to_use - first;
+		__entry->bytes = bytes;
+		__entry->kick = kick;
+	),
+
+	TP_printk("%s queue %u first %u ntu %u descs %u bytes %u%s",
+		  __entry->devname, __entry->queue, __entry->first,
+		  __entry->next_to_use, __entry->descs, __entry->bytes,
+		  __entry->kick ? " tail" : "")
+);
+
+/* adaptive ITR moved to a new value */
+TRACE_EVENT(txgbe_set_itr,
+	TP_PROTO(struct txgbe_q_vector *q_vector, u16 old_itr, u16 new_itr),
+
+	TP_ARGS(q_vector, old_itr, new_itr),
+
+	TP_STRUCT__entry(
+		__array(char, devname, IFNAMSIZ)
+		__field(u16, v_idx)
+		__field(u16, old_itr)
+		__field(u16, new_itr)
+		__field(u8, rx_latency)
+		__field(u8, tx_latency)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->devname, q_vector->adapter->netdev->name,
+		       IFNAMSIZ);
+		__entry->v_idx = q_vector->v_idx;
+		__entry->old_itr = old_itr;
+		__entry->new_itr = new_itr;
+		__entry->rx_latency = q_vector->rx.itr;
+		__entry->tx_latency = q_vector->tx.itr;
+	),
+
+	TP_printk("%s vector %u itr %u -> %u rx_latency %u tx_latency %u",
+		  __entry->devname, __entry->v_idx, __entry->old_itr,
+		  __entry->new_itr, __entry->rx_latency, __entry->tx_latency)
+);
+
+/* Tx queue stopped for lack of descriptors, or woken again */
+DECLARE_EVENT_CLASS(txgbe_tx_queue,
+	TP_PROTO(struct txgbe_ring *ring, u16 needed),
+
+	TP_ARGS(ring, needed),
+
+	TP_STRUCT__entry(
+		__array(char, devname, IFNAMSIZ)
+		__field(u16, queue)
+		__field(u16, next_to_use)
+		__field(u16, next_to_clean)
+		__field(u16, unused)
+		__field(u16, needed)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->devname, ring->netdev->name, IFNAMSIZ);
+		__entry->queue = ring->queue_index;
+		__entry->next_to_use = ring->next_to_use;
+		__entry->next_to_clean = ring->next_to_clean;
+		__entry->unused = txgbe_desc_unused(ring);
+		__entry->needed = needed;
+	),
+
+	TP_printk("%s queue %u ntu %u ntc %u unused %u needed %u",
+		  __entry->devname, __entry->queue, __entry->next_to_use,
+		  __entry->next_to_clean, __entry->unused, __entry->needed)
+);
+
+DEFINE_EVENT(txgbe_tx_queue, txgbe_tx_queue_stop,
+	TP_PROTO(struct txgbe_ring *ring, u16 needed),
+	TP_ARGS(ring, needed)
+);
+
+DEFINE_EVENT(txgbe_tx_queue, txgbe_tx_queue_wake,
+	TP_PROTO(struct txgbe_ring *ring, u16 needed),
+	TP_ARGS(ring, needed)
+);
+
+/*
+ * Rx ring fill level crossed the pressure threshold (@over) or fell back
+ * below it, see txgbe_rx_pressure().  Frames are dropped once @fill
+ * reaches @count - 1.
+ */
+TRACE_EVENT(txgbe_rx_pressure,
+	TP_PROTO(struct txgbe_ring *ring, u16 fill, u16 thresh, bool over),
+
+	TP_ARGS(ring, fill, thresh, over),
+
+	TP_STRUCT__entry(
+		__array(char, devname, IFNAMSIZ)
+		__field(u16, queue)
+		__field(u16, count)
+		__field(u16, fill)
+		__field(u16, thresh)
+		__field(bool, over)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->devname, ring->netdev->name, IFNAMSIZ);
+		__entry->queue = ring->queue_index;
+		__entry->count = ring->count;
+		__entry->fill = fill;
+		__entry->thresh = thresh;
+		__entry->over = over;
+	),
+
+	TP_printk("%s queue %u fill %u/%u thresh %u%s",
+		  __entry->devname, __entry->queue, __entry->fill,
+		  __entry->count, __entry->thresh,
+		  __entry->over ? " over" : " clear")
+);
+
+/* a step of the reset/recovery machinery; @queue is -1 if not per-queue */
+TRACE_EVENT(txgbe_reset_step,
+	TP_PROTO(struct txgbe_adapter *adapter, int step, int queue),
+
+	TP_ARGS(adapter, step, queue),
+
+	TP_STRUCT__entry(
+		__array(char, devname, IFNAMSIZ)
+		__field(int, step)
+		__field(int, queue)
+		__field(unsigned long, state)
+		__field(u32, flags2)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->devname, adapter->netdev->name, IFNAMSIZ);
+		__entry->step = step;
+		__entry->queue = queue;
+		__entry->state = adapter->state;
+		__entry->flags2 = adapter->flags2;
+	),
+
+	TP_printk("%s %s queue %d state 0x%lx flags2 0x%08x",
+		  __entry->devname,
+		  __print_symbolic(__entry->step,
+				   { TXGBE_TRACE_TX_HANG, "tx_hang" },
+				   { TXGBE_TRACE_TX_TIMEOUT, "tx_timeout" },
+				   { TXGBE_TRACE_RESET_SUBTASK, "reset_subtask" },
+				   { TXGBE_TRACE_REINIT_START, "reinit_start" },
+				   { TXGBE_TRACE_REINIT_DOWN, "reinit_down" },
+				   { TXGBE_TRACE_REINIT_DONE, "reinit_done" },
+				   { TXGBE_TRACE_PCIE_RECOVER, "pcie_recover" },
+				   { TXGBE_TRACE_AER_DETECTED, "aer_detected" },
+				   { TXGBE_TRACE_AER_SLOT_RESET, "aer_slot_reset" },
+				   { TXGBE_TRACE_AER_RESUME, "aer_resume" },
+				   { TXGBE_TRACE_TX_RESTART, "tx_restart" },
+				   { TXGBE_TRACE_TX_RESTART_FAIL,
+				     "tx_restart_fail" }),
+		  __entry->queue, __entry->state, __entry->flags2)
+);
+
+/*
+ * end of a probe or open step: @delta_ns is the time the step took,
+ * @total_ns the time since probe or open started, e.g.
+ *
+ *   bpftrace -e 'tracepoint:txgbe:txgbe_bringup_step
+ *                { @[args->step] = hist(args->delta_ns / 1000); }'
+ */
+TRACE_EVENT(txgbe_bringup_step,
+	TP_PROTO(struct txgbe_adapter *adapter, int step, u64 delta_ns,
+		 u64 total_ns),
+
+	TP_ARGS(adapter, step, delta_ns, total_ns),
+
+	TP_STRUCT__entry(
+		__array(char, devname, IFNAMSIZ)
+		__field(int, step)
+		__field(u64, delta_ns)
+		__field(u64, total_ns)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->devname, adapter->netdev->name, IFNAMSIZ);
+		__entry->step = step;
+		__entry->delta_ns = delta_ns;
+		__entry->total_ns = total_ns;
+	),
+
+	TP_printk("%s %s took %llu ns, %llu ns since start",
+		  __entry->devname,
+		  __print_symbolic(__entry->step,
+				   { TXGBE_BRINGUP_PCI, "pci" },
+				   { TXGBE_BRINGUP_SW_INIT, "sw_init" },
+				   { TXGBE_BRINGUP_RESET_HW, "reset_hw" },
+				   { TXGBE_BRINGUP_NVM, "nvm" },
+				   { TXGBE_BRINGUP_IRQ_SCHEME, "irq_scheme" },
+				   { TXGBE_BRINGUP_REGISTER, "register" },
+				   { TXGBE_BRINGUP_PROBE_DONE, "probe_done" },
+				   { TXGBE_BRINGUP_RESOURCES, "resources" },
+				   { TXGBE_BRINGUP_CONFIGURE, "configure" },
+				   { TXGBE_BRINGUP_REQUEST_IRQ, "request_irq" },
+				   { TXGBE_BRINGUP_OPEN_DONE, "open_done" }),
+		  (unsigned long long)__entry->delta_ns,
+		  (unsigned long long)__entry->total_ns)
+);
+
+#endif /* _TXGBE_TRACE_H_ */
+/* This must be outside ifdef _TXGBE_TRACE_H_ */
+
+/* This trace include file is not located in the .../include/trace
+ * with the kernel tracepoint definitions, because we're a loadable
+ * module.
+ */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE txgbe_trace
+#include <trace/define_trace.h>
+#endif /* CONFIG_TRACEPOINTS */
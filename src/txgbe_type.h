@@ -65,6 +65,7 @@
 
 #include "txgbe_osdep.h"
 #include "txgbe_mtd.h"
+#include "txgbe_regtbl.h"
 
 /* Override this by setting IOMEM in your txgbe_osdep.h header */
 #ifndef IOMEM
@@ -482,6 +483,7 @@ struct txgbe_thermal_sensor_data {
 #define TXGBE_I2C_DATA_CMD_STOP         ((1 << 9))
 #define TXGBE_I2C_DATA_CMD_READ         ((1 << 8) | TXGBE_I2C_DATA_CMD_STOP)
 #define TXGBE_I2C_DATA_CMD_WRITE        ((0 << 8) | TXGBE_I2C_DATA_CMD_STOP)
+#define TXGBE_I2C_DATA_CMD_READ_NOSTOP  ((1 << 8))
 #define TXGBE_I2C_SS_SCL_HCNT           0x14914 /* Standard speed I2C Clock SCL
 												 * High Count */
 #define TXGBE_I2C_SS_SCL_LCNT           0x14918 /* Standard speed I2C Clock SCL
@@ -532,6 +534,8 @@ struct txgbe_thermal_sensor_data {
 												 * Interrupt */
 #define TXGBE_I2C_DEVICE_ID             0x149b8 /* I2C Device ID */
 #define TXGBE_I2C_COMP_PARAM_1          0x149f4 /* Component Parameter Reg */
+#define TXGBE_I2C_COMP_PARAM_1_RX_DEPTH(_v) ((((_v) >> 8) & 0xFF) + 1)
+#define TXGBE_I2C_COMP_PARAM_1_TX_DEPTH(_v) ((((_v) >> 16) & 0xFF) + 1)
 #define TXGBE_I2C_COMP_VERSION          0x149f8 /* Component Version ID */
 #define TXGBE_I2C_COMP_TYPE             0x149fc /* DesignWare Component Type
 												 * Reg */
@@ -782,9 +786,11 @@ struct txgbe_thermal_sensor_data {
 #define TXGBE_RDB_FDIR_FLEX_CFG(_i) (0x19580 + ((_i) * 4))
 /* Flow Director Stats registers */
 #define TXGBE_RDB_FDIR_FREE         0x19538
+#define TXGBE_RDB_FDIR_FREE_FREE_MASK   0x0000FFFFU /* free filters */
 #define TXGBE_RDB_FDIR_LEN          0x1954C
 #define TXGBE_RDB_FDIR_USE_ST       0x19550
 #define TXGBE_RDB_FDIR_FAIL_ST      0x19554
+#define TXGBE_RDB_FDIR_FAIL_ST_ADD_MASK 0x000000FFU /* failed adds */
 #define TXGBE_RDB_FDIR_MATCH        0x19558
 #define TXGBE_RDB_FDIR_MISS         0x1955C
 /* Flow Director Programming registers */
@@ -2931,6 +2937,7 @@ struct txgbe_phy_operations {
 	s32 (*check_link)(struct txgbe_hw *, u32 *, bool *);
 	s32 (*get_firmware_version)(struct txgbe_hw *, u16 *);
 	s32 (*read_i2c_byte)(struct txgbe_hw *, u8, u8, u8 *);
+	s32 (*read_i2c_block)(struct txgbe_hw *, u8, u8, u16, u8 *);
 	s32 (*write_i2c_byte)(struct txgbe_hw *, u8, u8, u8);
 	s32 (*read_i2c_sff8472)(struct txgbe_hw *, u8, u8 *);
 	s32 (*read_i2c_eeprom)(struct txgbe_hw *, u8, u8 *);
@@ -2958,6 +2965,18 @@ struct txgbe_flash_info {
 };
 
 
+/* software copy of the VLAN pool filter (VLVF/VLVFB), so that finding the
+ * entry of a VLAN does not read all of them back through the index register
+ */
+#define TXGBE_VLVF_VLANS                4096
+struct txgbe_vlvf_shadow {
+	u32 vlvf[TXGBE_PSR_VLAN_SWC_ENTRIES];   /* VIEN | vid, 0 = free */
+	u64 pools[TXGBE_PSR_VLAN_SWC_ENTRIES];  /* VM_H:VM_L */
+	u64 used;                               /* entries with vlvf != 0 */
+	u8 slot[TXGBE_VLVF_VLANS];              /* vid -> entry, 0 = none */
+	bool valid;                             /* matches the hardware */
+};
+
 #define TXGBE_FLAGS_DOUBLE_RESET_REQUIRED       0x01
 struct txgbe_mac_info {
 	struct txgbe_mac_operations ops;
@@ -2970,11 +2989,21 @@ struct txgbe_mac_info {
 	u16 wwpn_prefix;
 #define TXGBE_MAX_MTA                   128
 #define TXGBE_MAX_VFTA_ENTRIES          128
+#define TXGBE_MAX_UTA                   128
 	u32 mta_shadow[TXGBE_MAX_MTA];
+	u32 uta_shadow[TXGBE_MAX_UTA];
 	s32 mc_filter_type;
 	u32 mcft_size;
 	u32 vft_shadow[TXGBE_MAX_VFTA_ENTRIES];
 	u32 vft_size;
+	/* hardware copies of mta_shadow, uta_shadow, vft_shadow and the RSS
+	 * table
+	 */
+	struct txgbe_reg_table mta_tbl;
+	struct txgbe_reg_table uta_tbl;
+	struct txgbe_reg_table vft_tbl;
+	struct txgbe_reg_table reta_tbl;
+	struct txgbe_vlvf_shadow vlvf;
 	u32 num_rar_entries;
 	u32 rar_highwater;
 	u32 rx_pb_size;
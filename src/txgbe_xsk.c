@@ -1185,6 +1185,10 @@ int txgbe_xsk_async_xmit(struct net_device *dev, u32 qid)
 		return -ENXIO;
 
 	ring = adapter->xdp_ring[qid];
+#ifndef HAVE_DEV_SET_THREADED
+	if (txgbe_qv_thread_schedule(ring->q_vector))
+		return 0;
+#endif
 	if (!napi_if_scheduled_mark_missed(&ring->q_vector->napi)) {
 		if (likely(napi_schedule_prep(&ring->q_vector->napi)))
 			__napi_schedule(&ring->q_vector->napi);
@@ -0,0 +1,611 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * flashsim - user-space harness for the flash image update
+ *
+ * Builds src/txgbe_flash.c unmodified against a simulated SPI NOR part:
+ * 1MB of flash where an erase sets a 4K sector to 0xFF and a program can
+ * only clear bits, driven through the same SPI primitives txgbe_hw.c
+ * exports (read dword, program dword, erase sector).  Time is simulated:
+ * SPI commands and msleep() advance a virtual clock, so every run is
+ * deterministic.
+ *
+ * The real txgbe.h/txgbe_hw.h are kept out by pre-defining their include
+ * guards; everything txgbe_flash.c needs from them is declared below.
+ * When txgbe_flash.c starts using something new, add it here.
+ *
+ * Each scenario checks the return code, the sector counters and the
+ * final flash contents: image data everywhere except the board MAC
+ * addresses and serial number, which must survive, a VPD carrying that
+ * serial number with a valid checksum, and a first 4K that sums to the
+ * image checksum.  The exit status is non-zero if any check fails.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t s32;
+
+/* keep the real driver headers out */
+#define _TXGBE_H_
+#define _TXGBE_HW_H_
+
+#define U16_MAX			0xFFFFU
+#define U32_MAX			0xFFFFFFFFU
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
+#define __le32_to_cpu(x)	(x)
+#define GFP_KERNEL		0
+#define kzalloc(n, f)		calloc(1, (n))
+#define kcalloc(n, s, f)	calloc((n), (s))
+#define kfree(p)		free(p)
+
+static bool verbose;
+#define printk(fmt, ...) \
+	do { if (verbose) printf(fmt, ##__VA_ARGS__); } while (0)
+#define e_info(msglvl, fmt, ...) \
+	do { (void)adapter; printk(fmt, ##__VA_ARGS__); } while (0)
+#define e_err(msglvl, fmt, ...)	e_info(msglvl, fmt, ##__VA_ARGS__)
+
+/* from src/txgbe_hw.h and src/txgbe_type.h */
+#define SPI_SECTOR_SIZE			(4 * 1024)
+#define SPI_CMD_CFG1_ADDR		0x10118
+#define TXGBE_SPI_CMDCFG0		0x10114
+#define PRB_CTL				0X10200
+#define MAC_ADDR0_WORD0_OFFSET_1G	0x006000c
+#define MAC_ADDR0_WORD1_OFFSET_1G	0x0060014
+#define MAC_ADDR1_WORD0_OFFSET_1G	0x007000c
+#define MAC_ADDR1_WORD1_OFFSET_1G	0x0070014
+#define PRODUCT_SERIAL_NUM_OFFSET_1G	0x00f0000
+#define TXGBE_VPD_OFFSET		0x500
+#define TXGBE_VPD_END			0x600
+
+struct txgbe_adapter {
+	int unused;
+};
+
+struct txgbe_hw {
+	void *back;
+	u16 device_id;
+	u16 subsystem_device_id;
+};
+
+/* ---- simulated device ----------------------------------------------- */
+
+#define FLASH_SIZE		0x100000
+#define SIM_SUB_ID		0x0211
+#define SIM_DEV_ID		0x1001
+
+static u64 sim_now;                     /* virtual ns */
+static u64 sim_read_ns = 2000;          /* SPI read dword command */
+static u64 sim_prog_ns = 15000;         /* SPI program dword command */
+static u64 sim_cmd_ns = 2000;           /* any other SPI command */
+
+static u8 flash[FLASH_SIZE];
+static u32 prb_ctl;
+
+static struct {
+	u32 reads;
+	u32 programs;
+	u32 erases;
+	u32 sector_erases[FLASH_SIZE / SPI_SECTOR_SIZE];
+	/* fault injection: bits that will not program at this address */
+	u32 stuck_addr;
+	u32 stuck_mask;
+	u32 stuck_count;                /* programs that fail, 0 = forever */
+} spi;
+
+static void msleep(unsigned int ms)
+{
+	sim_now += (u64)ms * 1000000ULL;
+}
+
+static u32 rd32(struct txgbe_hw *hw, u32 reg)
+{
+	return reg == PRB_CTL ? prb_ctl : 0;
+}
+
+static void wr32(struct txgbe_hw *hw, u32 reg, u32 val)
+{
+	if (reg == PRB_CTL)
+		prb_ctl = val;
+}
+
+static u32 flash_get(u32 addr)
+{
+	u32 val = 0, i;
+
+	for (i = 0; i < 4; i++)
+		val |= (u32)flash[(addr + i) % FLASH_SIZE] << (8 * i);
+	return val;
+}
+
+int txgbe_flash_read_dword(struct txgbe_hw *hw, u32 addr, u32 *data)
+{
+	sim_now += sim_read_ns;
+	spi.reads++;
+	*data = flash_get(addr);
+	return 0;
+}
+
+int txgbe_flash_program_dword(struct txgbe_hw *hw, u32 addr, u32 dword)
+{
+	u32 i;
+
+	sim_now += sim_prog_ns;
+	spi.programs++;
+	if (spi.stuck_mask && addr == spi.stuck_addr) {
+		if (spi.stuck_count != 1)
+			dword |= spi.stuck_mask;
+		if (spi.stuck_count > 1)
+			spi.stuck_count--;
+		else if (spi.stuck_count == 1)
+			spi.stuck_mask = 0;
+	}
+	/* NOR: programming only clears bits, byte addressed */
+	for (i = 0; i < 4; i++)
+		flash[(addr + i) % FLASH_SIZE] &= dword >> (8 * i);
+	return 0;
+}
+
+int txgbe_flash_write_dword(struct txgbe_hw *hw, u32 addr, u32 dword)
+{
+	u32 data;
+
+	txgbe_flash_program_dword(hw, addr, dword);
+	txgbe_flash_read_dword(hw, addr, &data);
+	return dword == data ? 0 : -EIO;
+}
+
+int txgbe_flash_erase_sector(struct txgbe_hw *hw, u32 sec_addr)
+{
+	sim_now += sim_cmd_ns;
+	spi.erases++;
+	sec_addr &= ~(SPI_SECTOR_SIZE - 1);
+	spi.sector_erases[sec_addr / SPI_SECTOR_SIZE]++;
+	memset(&flash[sec_addr], 0xff, SPI_SECTOR_SIZE);
+	return 0;
+}
+
+int txgbe_flash_usr_cmd(struct txgbe_hw *hw, u32 usr_cmd)
+{
+	sim_now += sim_cmd_ns;
+	return 0;
+}
+
+int txgbe_flash_write_unlock(struct txgbe_hw *hw)
+{
+	return 0;
+}
+
+/* ---- the code under test -------------------------------------------- */
+
+#include "../../src/txgbe_flash.h"
+#include "../../src/txgbe_flash.c"
+
+/* ---- images --------------------------------------------------------- */
+
+static struct txgbe_adapter adapter;
+static struct txgbe_hw hw;
+
+static const char board_sn[] = "WX2024SIM000000000012345";   /* 24 chars */
+static const u32 board_mac0[2] = { 0x3344aabb, 0x8000d8c4 };
+static const u32 board_mac1[2] = { 0x3344aabc, 0x8000d8c4 };
+
+static u8 image[FLASH_SIZE];
+
+static u32 rng_state;
+
+static u32 rng(void)
+{
+	rng_state = rng_state * 1103515245 + 12345;
+	return rng_state >> 8;
+}
+
+static void put32(u8 *buf, u32 addr, u32 val)
+{
+	u32 i;
+
+	for (i = 0; i < 4; i++)
+		buf[addr + i] = val >> (8 * i);
+}
+
+/* VPD with ID, PN, SN and RV keywords, as the vendor images carry it */
+static void build_vpd(u8 *buf)
+{
+	static const char id[] = "WangXun(R) 10GbE Simulated Adapter";
+	static const char pn[] = "SIM-PN-0001";
+	u32 p = TXGBE_VPD_OFFSET;
+	u32 id_len = sizeof(id) - 1, pn_len = sizeof(pn) - 1;
+
+	memset(&buf[TXGBE_VPD_OFFSET], 0xff, TXGBE_VPD_END - TXGBE_VPD_OFFSET);
+	buf[p++] = 0x82;
+	buf[p++] = id_len;
+	buf[p++] = 0;
+	memcpy(&buf[p], id, id_len);
+	p += id_len;
+	buf[p++] = 0x90;
+	buf[p++] = 0;           /* read-only length, rebuilt by the driver */
+	buf[p++] = 0;
+	buf[p++] = 'P';
+	buf[p++] = 'N';
+	buf[p++] = pn_len;
+	memcpy(&buf[p], pn, pn_len);
+	p += pn_len;
+	buf[p++] = 'S';
+	buf[p++] = 'N';
+	buf[p++] = 0;           /* no serial number in the image */
+	buf[p++] = 'R';
+	buf[p++] = 'V';
+	buf[p++] = 4;
+	memset(&buf[p], 0, 4);
+	p += 4;
+	buf[p] = 0x78;
+}
+
+static void build_image(u8 *buf, u32 seed, u16 sub_id)
+{
+	u32 a, sector;
+
+	rng_state = seed;
+	for (a = 0; a < FLASH_SIZE; a += 4) {
+		sector = a / SPI_SECTOR_SIZE;
+		/* a quarter of a real image is still erased */
+		if (sector % 4 == 3)
+			put32(buf, a, U32_MAX);
+		else
+			put32(buf, a, rng());
+	}
+	put32(buf, 0x15c, U32_MAX);
+	build_vpd(buf);
+	/* the defaults of the image, never written to a board */
+	put32(buf, MAC_ADDR0_WORD0_OFFSET_1G, 0x00000001);
+	put32(buf, MAC_ADDR0_WORD1_OFFSET_1G, 0x00000002);
+	put32(buf, MAC_ADDR1_WORD0_OFFSET_1G, 0x00000003);
+	put32(buf, MAC_ADDR1_WORD1_OFFSET_1G, 0x00000004);
+	memset(&buf[PRODUCT_SERIAL_NUM_OFFSET_1G], 0xff,
+	       4 * TXGBE_FLASH_SN_DWORDS);
+
+	buf[TXGBE_FLASH_IMAGE_ID_OFFSET] = sub_id >> 8;
+	buf[TXGBE_FLASH_IMAGE_ID_OFFSET + 1] = sub_id & 0xff;
+	buf[TXGBE_FLASH_IMAGE_ID_OFFSET + 2] = SIM_DEV_ID >> 8;
+	buf[TXGBE_FLASH_IMAGE_ID_OFFSET + 3] = SIM_DEV_ID & 0xff;
+}
+
+/* a board with an older image, its own MAC addresses and serial number */
+static void build_board(u32 seed)
+{
+	u32 i;
+
+	build_image(flash, seed, SIM_SUB_ID);
+	put32(flash, MAC_ADDR0_WORD0_OFFSET_1G, board_mac0[0]);
+	put32(flash, MAC_ADDR0_WORD1_OFFSET_1G, board_mac0[1]);
+	put32(flash, MAC_ADDR1_WORD0_OFFSET_1G, board_mac1[0]);
+	put32(flash, MAC_ADDR1_WORD1_OFFSET_1G, board_mac1[1]);
+	for (i = 0; i < TXGBE_FLASH_SN_DWORDS; i++)
+		put32(flash, PRODUCT_SERIAL_NUM_OFFSET_1G + 4 * i,
+		      (u8)board_sn[TXGBE_FLASH_SN_DWORDS - 1 - i]);
+}
+
+/* ---- scenarios ------------------------------------------------------ */
+
+static int failures;
+
+#define CHECK(cond, name) do {						\
+	if (!(cond)) {							\
+		printf("FAIL %s: %s\n", name, #cond);			\
+		failures++;						\
+	}								\
+} while (0)
+
+static struct {
+	u32 calls;
+	u32 last_done;
+	u32 last_total;
+	bool backwards;
+} progress;
+
+static void sim_notify(struct txgbe_flash_update *fu, const char *msg,
+		       u32 done, u32 total)
+{
+	if (total && progress.last_total == total && done < progress.last_done)
+		progress.backwards = true;
+	progress.calls++;
+	progress.last_done = done;
+	progress.last_total = total;
+}
+
+static void sim_reset(void)
+{
+	memset(&spi, 0, sizeof(spi));
+	memset(&progress, 0, sizeof(progress));
+	sim_now = 0;
+	prb_ctl = 0;
+	hw.back = &adapter;
+	hw.device_id = SIM_DEV_ID;
+	hw.subsystem_device_id = SIM_SUB_ID;
+}
+
+static bool is_board_dword(u32 a)
+{
+	return a == MAC_ADDR0_WORD0_OFFSET_1G ||
+	       a == MAC_ADDR0_WORD1_OFFSET_1G ||
+	       a == MAC_ADDR1_WORD0_OFFSET_1G ||
+	       a == MAC_ADDR1_WORD1_OFFSET_1G ||
+	       (a >= PRODUCT_SERIAL_NUM_OFFSET_1G &&
+		a < PRODUCT_SERIAL_NUM_OFFSET_1G + 4 * TXGBE_FLASH_SN_DWORDS);
+}
+
+/* the flash after a successful update of image onto the board */
+static void check_contents(const char *name)
+{
+	u32 a, i, mismatch = 0, sum = 0;
+	u8 *vpd = &flash[TXGBE_VPD_OFFSET];
+	u8 *sn;
+	u8 csum = 0;
+
+	for (a = 0; a < FLASH_SIZE; a += 4) {
+		if (is_board_dword(a) || a == 0x15c ||
+		    (a >= TXGBE_VPD_OFFSET && a < TXGBE_VPD_END))
+			continue;
+		if (memcmp(&flash[a], &image[a], 4))
+			mismatch++;
+	}
+	CHECK(mismatch == 0, name);
+
+	CHECK(flash_get(MAC_ADDR0_WORD0_OFFSET_1G) == board_mac0[0], name);
+	CHECK(flash_get(MAC_ADDR0_WORD1_OFFSET_1G) ==
+	      ((board_mac0[1] & U16_MAX) | 0x80000000), name);
+	CHECK(flash_get(MAC_ADDR1_WORD0_OFFSET_1G) == board_mac1[0], name);
+	CHECK(flash_get(MAC_ADDR1_WORD1_OFFSET_1G) ==
+	      ((board_mac1[1] & U16_MAX) | 0x80000000), name);
+	for (i = 0; i < TXGBE_FLASH_SN_DWORDS; i++)
+		CHECK(flash_get(PRODUCT_SERIAL_NUM_OFFSET_1G + 4 * i) ==
+		      (u8)board_sn[TXGBE_FLASH_SN_DWORDS - 1 - i], name);
+
+	/* VPD: serial number filled in, checksum byte after RV */
+	sn = memmem(vpd, TXGBE_VPD_END - TXGBE_VPD_OFFSET, "SN", 2);
+	CHECK(sn && sn[2] == strlen(board_sn) &&
+	      !memcmp(&sn[3], board_sn, strlen(board_sn)), name);
+	if (sn) {
+		u8 *rv = &sn[3 + sn[2]];
+
+		CHECK(rv[0] == 'R' && rv[1] == 'V', name);
+		for (i = 0; &vpd[i] <= &rv[3]; i++)
+			csum += vpd[i];
+		CHECK(csum == 0, name);
+	}
+
+	/* first 4K sums to 0xbaba with the checksum in place */
+	CHECK(flash[0x15c] == 0xff && flash[0x15d] == 0xff, name);
+	for (i = 0; i < 0x1000; i += 2)
+		sum += flash[i] | flash[i + 1] << 8;
+	CHECK((sum & 0xffff) == 0xbaba, name);
+	CHECK(prb_ctl & 0x80000000, name);
+}
+
+/* previous code: erase every sector, program and read back every dword */
+static u64 legacy_ns(void)
+{
+	u64 t = 2000ULL * 1000000ULL;
+	u32 a;
+
+	t += (u64)(FLASH_SIZE / SPI_SECTOR_SIZE) * (sim_cmd_ns + 50000000ULL);
+	for (a = 0; a < FLASH_SIZE; a += 4)
+		if (flash_get(a) != U32_MAX)
+			t += sim_prog_ns + sim_read_ns;
+	return t;
+}
+
+static void report(const char *name, int err, struct txgbe_flash_update *fu,
+		   u64 legacy)
+{
+	printf("%-12s %6d %7u %7u %7u %7u %9u %8llu %9llu\n", name, err,
+	       fu->written, fu->skipped, fu->retries, spi.erases,
+	       spi.programs,
+	       (unsigned long long)(sim_now / 1000000ULL),
+	       (unsigned long long)(legacy / 1000000ULL));
+}
+
+static int run(const char *name, struct txgbe_flash_update *fu, u32 size)
+{
+	int err;
+
+	memset(fu, 0, sizeof(*fu));
+	fu->notify = sim_notify;
+	err = txgbe_upgrade_flash(&hw, 0, image, size, fu);
+	report(name, err, fu, err ? 0 : legacy_ns());
+	return err;
+}
+
+static void scenario_fresh(void)
+{
+	const char *name = "new_image";
+	struct txgbe_flash_update fu;
+	u32 sectors = FLASH_SIZE / SPI_SECTOR_SIZE;
+	int err;
+
+	sim_reset();
+	build_board(1);
+	build_image(image, 2, SIM_SUB_ID);
+	err = run(name, &fu, FLASH_SIZE);
+
+	CHECK(err == 0, name);
+	check_contents(name);
+	/* every fourth sector is erased in both images */
+	CHECK(fu.sectors == sectors && fu.written + fu.skipped == sectors,
+	      name);
+	CHECK(fu.skipped == sectors / 4, name);
+	CHECK(spi.erases == fu.written && fu.retries == 0, name);
+	CHECK(progress.calls >= sectors && !progress.backwards &&
+	      progress.last_done == sectors, name);
+}
+
+static void scenario_same(void)
+{
+	const char *name = "same_image";
+	struct txgbe_flash_update fu;
+	int err;
+
+	/* flash the image, reboot, flash it again */
+	sim_reset();
+	build_board(1);
+	build_image(image, 2, SIM_SUB_ID);
+	txgbe_upgrade_flash(&hw, 0, image, FLASH_SIZE, &fu);
+	sim_reset();
+	err = run(name, &fu, FLASH_SIZE);
+
+	CHECK(err == 0, name);
+	check_contents(name);
+	/* only sector 0, which holds the checksum */
+	CHECK(fu.written == 1 && spi.erases == 1 &&
+	      spi.sector_erases[0] == 1, name);
+}
+
+static void scenario_patch(void)
+{
+	const char *name = "patched";
+	static const u32 patched[] = { 0x20000, 0x60000, 0x81234, 0xf0400 };
+	struct txgbe_flash_update fu;
+	u32 i;
+	int err;
+
+	sim_reset();
+	build_board(1);
+	build_image(image, 2, SIM_SUB_ID);
+	txgbe_upgrade_flash(&hw, 0, image, FLASH_SIZE, &fu);
+	sim_reset();
+	for (i = 0; i < sizeof(patched) / sizeof(patched[0]); i++)
+		image[patched[i]] ^= 0x5a;
+	err = run(name, &fu, FLASH_SIZE);
+
+	CHECK(err == 0, name);
+	check_contents(name);
+	CHECK(fu.written == 1 + 4 && spi.erases == 5, name);
+	for (i = 0; i < sizeof(patched) / sizeof(patched[0]); i++)
+		CHECK(spi.sector_erases[patched[i] / SPI_SECTOR_SIZE] == 1,
+		      name);
+}
+
+static void scenario_transient(void)
+{
+	const char *name = "transient";
+	struct txgbe_flash_update fu;
+	int err;
+
+	sim_reset();
+	build_board(1);
+	build_image(image, 2, SIM_SUB_ID);
+	spi.stuck_addr = 0x30010;
+	spi.stuck_mask = 0x00010000;
+	spi.stuck_count = 2;    /* the first program of it fails */
+	put32(image, 0x30010, 0x12340000);
+	err = run(name, &fu, FLASH_SIZE);
+
+	CHECK(err == 0, name);
+	check_contents(name);
+	CHECK(fu.retries == 1 && spi.sector_erases[0x30] == 2, name);
+}
+
+static void scenario_stuck(void)
+{
+	const char *name = "stuck_bit";
+	struct txgbe_flash_update fu;
+	int err;
+
+	sim_reset();
+	build_board(1);
+	build_image(image, 2, SIM_SUB_ID);
+	spi.stuck_addr = 0x30010;
+	spi.stuck_mask = 0x00010000;
+	put32(image, 0x30010, 0x12340000);
+	err = run(name, &fu, FLASH_SIZE);
+
+	CHECK(err == -EBUSY, name);
+	CHECK(fu.retries == TXGBE_FLASH_SECTOR_RETRIES &&
+	      spi.sector_erases[0x30] == 1 + TXGBE_FLASH_SECTOR_RETRIES, name);
+	/* nothing past the bad sector, the update is not marked done */
+	CHECK(spi.sector_erases[0x31] == 0 && !(prb_ctl & 0x80000000), name);
+}
+
+static void scenario_refused(void)
+{
+	struct txgbe_flash_update fu;
+
+	sim_reset();
+	build_board(1);
+	build_image(image, 2, SIM_SUB_ID);
+	prb_ctl = 0x80000000;   /* already updated, waiting for a reboot */
+	CHECK(run("pending", &fu, FLASH_SIZE) == -EOPNOTSUPP, "pending");
+
+	sim_reset();
+	build_image(image, 2, SIM_SUB_ID + 1);
+	CHECK(run("wrong_id", &fu, FLASH_SIZE) == -EOPNOTSUPP, "wrong_id");
+
+	sim_reset();
+	build_image(image, 2, SIM_SUB_ID);
+	CHECK(run("short_image", &fu, 0x80000) == -EINVAL, "short_image");
+
+	CHECK(spi.erases == 0 && spi.programs == 0, "short_image");
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-r read_ns] [-p prog_ns] [-c cmd_ns] [-v]\n"
+		"  -r  SPI read dword command in ns (default 2000)\n"
+		"  -p  SPI program dword command in ns (default 15000)\n"
+		"  -c  any other SPI command in ns (default 2000)\n"
+		"  -v  print the driver's messages\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "r:p:c:vh")) != -1) {
+		switch (c) {
+		case 'r':
+			sim_read_ns = strtoull(optarg, NULL, 0);
+			break;
+		case 'p':
+			sim_prog_ns = strtoull(optarg, NULL, 0);
+			break;
+		case 'c':
+			sim_cmd_ns = strtoull(optarg, NULL, 0);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : 2;
+		}
+	}
+
+	printf("read=%lluns program=%lluns cmd=%lluns\n\n",
+	       (unsigned long long)sim_read_ns,
+	       (unsigned long long)sim_prog_ns,
+	       (unsigned long long)sim_cmd_ns);
+	printf("%-12s %6s %7s %7s %7s %7s %9s %8s %9s\n", "scenario", "status",
+	       "written", "skipped", "retries", "erases", "programs", "time_ms",
+	       "legacy_ms");
+
+	scenario_fresh();
+	scenario_same();
+	scenario_patch();
+	scenario_transient();
+	scenario_stuck();
+	scenario_refused();
+
+	printf("\n%s (%d failed checks)\n", failures ? "FAIL" : "PASS",
+	       failures);
+	return failures ? 1 : 0;
+}
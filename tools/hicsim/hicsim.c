@@ -0,0 +1,627 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * hicsim - user-space harness for the host interface command engine
+ *
+ * Builds src/txgbe_hic.c unmodified against a simulated device: a
+ * register file for the manageability mailbox (TXGBE_MNG_MBOX and
+ * TXGBE_MNG_MBOX_CTL) and a firmware model that picks up a command on
+ * SWRDY, answers after a configurable latency, sets FWRDY and optionally
+ * raises MNG_HOST_MBOX.  Time is simulated: sleeps, completion waits and
+ * MMIO reads advance a virtual clock, so every run is deterministic.
+ *
+ * The real txgbe.h/txgbe_hw.h are kept out by pre-defining their include
+ * guards; everything txgbe_hic.c needs from them is declared below.  When
+ * txgbe_hic.c starts using something new, add it here.
+ *
+ * Each scenario checks the return code, the reply and the engine
+ * counters, and prints how long the caller waited next to a model of the
+ * previous loop (one MBOX_CTL poll per msleep(1)).  The exit status is
+ * non-zero if any check fails.
+ */
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t s32;
+
+/* keep the real driver headers out */
+#define _TXGBE_H_
+#define _TXGBE_HW_H_
+
+#define NSEC_PER_USEC	1000ULL
+#define NSEC_PER_MSEC	1000000ULL
+#define min_t(t, a, b)	((t)(a) < (t)(b) ? (t)(a) : (t)(b))
+#define div_u64(a, b)	((u64)(a) / (u64)(b))
+
+static bool verbose;
+#define printk(fmt, ...) \
+	do { if (verbose) printf(fmt, ##__VA_ARGS__); } while (0)
+#define DEBUGOUT(S)		printk(S)
+#define DEBUGOUT1(S, A...)	printk(S, ## A)
+#define TXGBE_ERROR_CAUTION	2
+#define ERROR_REPORT1(level, fmt, ...)	printk(fmt, ##__VA_ARGS__)
+
+#define TXGBE_CPU_TO_LE32(x)	(x)
+#define TXGBE_LE32_TO_CPUS(x)	do { } while (0)
+
+/* from src/txgbe_type.h */
+#define TXGBE_MNG_MBOX			0x1E100
+#define TXGBE_MNG_MBOX_CTL		0x1E044
+#define TXGBE_MNG_MBOX_CTL_SWRDY	0x1
+#define TXGBE_MNG_MBOX_CTL_FWRDY	0x4
+#define TXGBE_MNG_SWFW_SYNC_SW_MB	0x0004
+#define TXGBE_HI_MAX_BLOCK_BYTE_LENGTH	256
+#define TXGBE_HI_COMMAND_TIMEOUT	5000
+#define FW_DEFAULT_CHECKSUM		0xFF
+#define FW_CEM_RESP_STATUS_SUCCESS	0x1
+#define TXGBE_ERR			100
+#define TXGBE_NOT_IMPLEMENTED		0x7FFFFFFF
+#define TXGBE_ERR_SWFW_SYNC		-(TXGBE_ERR+16)
+#define TXGBE_ERR_INVALID_ARGUMENT	-(TXGBE_ERR+32)
+#define TXGBE_ERR_HOST_INTERFACE_COMMAND -(TXGBE_ERR+33)
+#define TXGBE_ERR_MNG_ACCESS_FAILED	-(TXGBE_ERR+47)
+
+struct txgbe_hic_hdr {
+	u8 cmd;
+	u8 buf_len;
+	union {
+		u8 cmd_resv;
+		u8 ret_status;
+	} cmd_or_resp;
+	u8 checksum;
+};
+
+struct txgbe_hw;
+struct txgbe_mac_operations {
+	s32 (*acquire_swfw_sync)(struct txgbe_hw *hw, u32 mask);
+	void (*release_swfw_sync)(struct txgbe_hw *hw, u32 mask);
+};
+
+struct txgbe_hw {
+	void *back;
+	struct {
+		struct txgbe_mac_operations ops;
+	} mac;
+};
+
+#define TCALL(hw, func, args...) (((hw)->func != NULL) \
+		? (hw)->func((hw), ##args) : TXGBE_NOT_IMPLEMENTED)
+
+/* ---- simulated kernel services -------------------------------------- */
+
+static unsigned int sim_hz = 250;
+static u64 sim_now;                     /* virtual ns */
+static u64 sim_mmio_ns = 500;           /* cost of one register read */
+static u64 sim_irq_ns = 5000;           /* FWRDY to waiter running */
+
+struct mutex {
+	int held;
+};
+
+struct completion {
+	unsigned int done;
+};
+
+static void fw_tick(void);
+
+static void mutex_init(struct mutex *m)
+{
+	m->held = 0;
+}
+
+static void mutex_lock(struct mutex *m)
+{
+	if (m->held) {
+		fprintf(stderr, "hicsim: recursive mutex_lock\n");
+		exit(2);
+	}
+	m->held = 1;
+}
+
+static void mutex_unlock(struct mutex *m)
+{
+	m->held = 0;
+}
+
+static void init_completion(struct completion *c)
+{
+	c->done = 0;
+}
+
+static void reinit_completion(struct completion *c)
+{
+	c->done = 0;
+}
+
+static void complete(struct completion *c)
+{
+	c->done++;
+}
+
+static u64 jiffy_ns(void)
+{
+	return 1000000000ULL / sim_hz;
+}
+
+static unsigned long usecs_to_jiffies(unsigned int us)
+{
+	return ((u64)us * sim_hz + 999999) / 1000000;
+}
+
+static u64 ktime_get_ns(void)
+{
+	return sim_now;
+}
+
+static u64 sim_sleeps;
+
+static void usleep_range(unsigned long min, unsigned long max)
+{
+	/* hrtimer with slack: assume the middle of the range */
+	sim_now += (min + max) / 2 * NSEC_PER_USEC;
+	sim_sleeps++;
+	fw_tick();
+}
+
+static unsigned long wait_for_completion_timeout(struct completion *c,
+						 unsigned long timeout);
+
+#define BITS_PER_LONG		(8 * sizeof(long))
+#define DECLARE_BITMAP(name, bits) \
+	unsigned long name[((bits) + BITS_PER_LONG - 1) / BITS_PER_LONG]
+#define READ_ONCE(x)		(x)
+#define WRITE_ONCE(x, val)	((x) = (val))
+
+static void set_bit(unsigned int nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG);
+}
+
+static void clear_bit(unsigned int nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] &= ~(1UL << (nr % BITS_PER_LONG));
+}
+
+static bool test_bit(unsigned int nr, const unsigned long *addr)
+{
+	return addr[nr / BITS_PER_LONG] & (1UL << (nr % BITS_PER_LONG));
+}
+
+/* ---- the code under test -------------------------------------------- */
+
+#include "../../src/txgbe_hic.h"
+
+struct txgbe_adapter {
+	struct txgbe_hic hic;
+};
+
+static u32 mbox[TXGBE_HI_MAX_BLOCK_BYTE_LENGTH / 4];
+static u32 mbox_ctl;
+
+static u32 rd32(struct txgbe_hw *hw, u32 reg)
+{
+	sim_now += sim_mmio_ns;
+	fw_tick();
+	if (reg == TXGBE_MNG_MBOX_CTL)
+		return mbox_ctl;
+	if (reg >= TXGBE_MNG_MBOX && reg < TXGBE_MNG_MBOX + sizeof(mbox))
+		return mbox[(reg - TXGBE_MNG_MBOX) >> 2];
+	return 0;
+}
+
+static void fw_start(void);
+
+static void wr32(struct txgbe_hw *hw, u32 reg, u32 val)
+{
+	if (reg == TXGBE_MNG_MBOX_CTL) {
+		bool go = (val & TXGBE_MNG_MBOX_CTL_SWRDY) &&
+			  !(mbox_ctl & TXGBE_MNG_MBOX_CTL_SWRDY);
+
+		mbox_ctl = val;
+		if (go)
+			fw_start();
+		return;
+	}
+	if (reg >= TXGBE_MNG_MBOX && reg < TXGBE_MNG_MBOX + sizeof(mbox))
+		mbox[(reg - TXGBE_MNG_MBOX) >> 2] = val;
+}
+
+#define rd32a(a, reg, offset)		rd32((a), (reg) + ((offset) << 2))
+#define wr32a(a, reg, off, val)		wr32((a), (reg) + ((off) << 2), (val))
+
+static void wr32m(struct txgbe_hw *hw, u32 reg, u32 mask, u32 field)
+{
+	u32 val = rd32(hw, reg);
+
+	wr32(hw, reg, (val & ~mask) | (field & mask));
+}
+
+static bool txgbe_check_mng_access(struct txgbe_hw *hw)
+{
+	return true;
+}
+
+#include "../../src/txgbe_hic.c"
+
+/* ---- firmware model ------------------------------------------------- */
+
+static struct txgbe_adapter adapter;
+static struct txgbe_hw hw;
+
+static struct {
+	u64 latency_ns;         /* SWRDY to FWRDY */
+	bool never;             /* firmware hangs */
+	bool unknown;           /* reply "unknown command" */
+	bool raise_irq;         /* MNG_HOST_MBOX on completion */
+	u8 reply_len;           /* buf_len of the reply */
+
+	bool busy;
+	u64 done_at;
+	u32 cmds;
+	u32 sem_acquires;
+	bool sem_held;
+} fw;
+
+static void fw_start(void)
+{
+	mbox_ctl &= ~TXGBE_MNG_MBOX_CTL_FWRDY;
+	fw.busy = true;
+	fw.done_at = sim_now + fw.latency_ns;
+	fw.cmds++;
+}
+
+static void fw_tick(void)
+{
+	u32 i;
+
+	if (!fw.busy || fw.never || sim_now < fw.done_at)
+		return;
+
+	fw.busy = false;
+	mbox[0] = (mbox[0] & 0xFF) | ((u32)fw.reply_len << 8) |
+		  ((u32)(fw.unknown ? 0x80 : FW_CEM_RESP_STATUS_SUCCESS) << 16) |
+		  ((u32)FW_DEFAULT_CHECKSUM << 24);
+	for (i = 1; i < sizeof(mbox) / 4; i++)
+		mbox[i] = 0xA5000000 | i;
+	mbox_ctl = (mbox_ctl & ~TXGBE_MNG_MBOX_CTL_SWRDY) |
+		   TXGBE_MNG_MBOX_CTL_FWRDY;
+	if (fw.raise_irq)
+		txgbe_hic_event(&adapter.hic);
+}
+
+static unsigned long wait_for_completion_timeout(struct completion *c,
+						 unsigned long timeout)
+{
+	u64 wake = sim_now + timeout * jiffy_ns();
+
+	sim_sleeps++;
+	if (!c->done && fw.busy && !fw.never && fw.raise_irq &&
+	    fw.done_at + sim_irq_ns <= wake) {
+		sim_now = fw.done_at > sim_now ? fw.done_at : sim_now;
+		fw_tick();
+		sim_now += sim_irq_ns;
+	} else if (!c->done) {
+		sim_now = wake;
+		fw_tick();
+	}
+	if (c->done) {
+		c->done--;
+		return timeout ? timeout : 1;
+	}
+	return 0;
+}
+
+static s32 sim_acquire(struct txgbe_hw *h, u32 mask)
+{
+	if (fw.sem_held) {
+		fprintf(stderr, "hicsim: SW_MB semaphore taken twice\n");
+		exit(2);
+	}
+	fw.sem_held = true;
+	fw.sem_acquires++;
+	return 0;
+}
+
+static void sim_release(struct txgbe_hw *h, u32 mask)
+{
+	fw.sem_held = false;
+}
+
+/* one MBOX_CTL read per msleep(1), i.e. per 1-2 jiffies */
+static u64 legacy_wait_ns(u64 latency, u32 *wakeups)
+{
+	u64 t = sim_mmio_ns, step = jiffy_ns() * 3 / 2;
+
+	*wakeups = 0;
+	while (t < latency) {
+		t += step + sim_mmio_ns;
+		(*wakeups)++;
+	}
+	return t;
+}
+
+/* ---- scenarios ------------------------------------------------------ */
+
+static int failures;
+
+#define CHECK(cond, name) do {						\
+	if (!(cond)) {							\
+		printf("FAIL %s: %s\n", name, #cond);			\
+		failures++;						\
+	}								\
+} while (0)
+
+static void sim_reset(u64 latency_us)
+{
+	memset(&fw, 0, sizeof(fw));
+	memset(mbox, 0, sizeof(mbox));
+	mbox_ctl = 0;
+	sim_now = 0;
+	sim_sleeps = 0;
+	fw.latency_ns = latency_us * NSEC_PER_USEC;
+	txgbe_hic_init(&adapter.hic);
+	hw.back = &adapter;
+	hw.mac.ops.acquire_swfw_sync = sim_acquire;
+	hw.mac.ops.release_swfw_sync = sim_release;
+}
+
+static void build_cmd(u32 *cmd, u8 op, u8 len)
+{
+	struct txgbe_hic_hdr *hdr = (struct txgbe_hic_hdr *)cmd;
+
+	memset(cmd, 0, 64 * sizeof(u32));
+	hdr->cmd = op;
+	hdr->buf_len = len;
+	hdr->checksum = FW_DEFAULT_CHECKSUM;
+}
+
+static void report(const char *name, u64 latency_us, s32 status)
+{
+	u32 legacy_wakeups;
+	u64 legacy = legacy_wait_ns(latency_us * NSEC_PER_USEC,
+				    &legacy_wakeups);
+
+	printf("%-14s %10llu %7d %9llu %7llu %10llu %7u\n", name,
+	       (unsigned long long)latency_us, status,
+	       (unsigned long long)(sim_now / NSEC_PER_USEC),
+	       (unsigned long long)sim_sleeps,
+	       (unsigned long long)(legacy / NSEC_PER_USEC), legacy_wakeups);
+}
+
+static void scenario_latency(const char *name, u64 latency_us, bool irq)
+{
+	u32 cmd[64];
+	s32 status;
+
+	sim_reset(latency_us);
+	fw.raise_irq = irq;
+	fw.reply_len = 8;
+	if (irq)	/* an earlier 0x31 raised the interrupt */
+		set_bit(0x31, adapter.hic.irq_cmds);
+
+	build_cmd(cmd, 0x31, 8);
+	status = txgbe_host_interface_command(&hw, cmd, 16,
+					      TXGBE_HI_COMMAND_TIMEOUT, true);
+	report(name, latency_us, status);
+
+	CHECK(status == 0, name);
+	CHECK(fw.cmds == 1 && fw.sem_acquires == 1 && !fw.sem_held, name);
+	CHECK(adapter.hic.cmds == 1 && adapter.hic.timeouts == 0, name);
+	/* header is replaced by the reply, data follows it */
+	CHECK(((u8 *)cmd)[offsetof(struct txgbe_hic_hdr, cmd_or_resp)] ==
+	      FW_CEM_RESP_STATUS_SUCCESS, name);
+	CHECK(cmd[1] == 0xA5000001 && cmd[2] == 0xA5000002, name);
+	/* never more than one poll interval late */
+	CHECK(sim_now <= fw.latency_ns +
+	      (irq ? usecs_to_jiffies(TXGBE_HIC_POLL_MAX_US) * jiffy_ns() :
+		     2 * TXGBE_HIC_POLL_MAX_US * NSEC_PER_USEC) +
+	      64 * sim_mmio_ns + sim_irq_ns, name);
+	if (irq)
+		CHECK(adapter.hic.irq_wakeups == 1, name);
+}
+
+/*
+ * The first 0x31 that raises MNG_HOST_MBOX is polled and marks the
+ * opcode; the next one sleeps on the completion.  0x32, which never
+ * raises it, keeps polling, and a marked opcode that completes without
+ * the interrupt is unmarked again.
+ */
+static void scenario_irq_cmds(void)
+{
+	const char *name = "irq_cmds";
+	u64 start, late = 2 * TXGBE_HIC_POLL_MAX_US * NSEC_PER_USEC +
+			  64 * sim_mmio_ns + sim_irq_ns;
+	u32 cmd[64];
+	s32 status;
+
+	sim_reset(800);
+	fw.raise_irq = true;
+	build_cmd(cmd, 0x31, 0);
+	status = txgbe_host_interface_command(&hw, cmd, 8,
+					      TXGBE_HI_COMMAND_TIMEOUT, false);
+	CHECK(status == 0 && adapter.hic.irq_wakeups == 0, name);
+	CHECK(test_bit(0x31, adapter.hic.irq_cmds), name);
+
+	build_cmd(cmd, 0x31, 0);
+	status = txgbe_host_interface_command(&hw, cmd, 8,
+					      TXGBE_HI_COMMAND_TIMEOUT, false);
+	CHECK(status == 0 && adapter.hic.irq_wakeups == 1, name);
+
+	fw.raise_irq = false;
+	start = sim_now;
+	build_cmd(cmd, 0x32, 0);
+	status = txgbe_host_interface_command(&hw, cmd, 8,
+					      TXGBE_HI_COMMAND_TIMEOUT, false);
+	CHECK(status == 0 && adapter.hic.irq_wakeups == 1, name);
+	CHECK(!test_bit(0x32, adapter.hic.irq_cmds), name);
+	CHECK(sim_now - start <= fw.latency_ns + late, name);
+
+	build_cmd(cmd, 0x31, 0);
+	status = txgbe_host_interface_command(&hw, cmd, 8,
+					      TXGBE_HI_COMMAND_TIMEOUT, false);
+	CHECK(status == 0 && !test_bit(0x31, adapter.hic.irq_cmds), name);
+	report(name, 800, status);
+
+	CHECK(fw.cmds == 4 && adapter.hic.timeouts == 0 && !fw.sem_held, name);
+}
+
+static void scenario_timeout(void)
+{
+	const char *name = "fw_hang";
+	u32 cmd[64];
+	s32 status;
+
+	sim_reset(0);
+	fw.never = true;
+	build_cmd(cmd, 0x31, 0);
+	status = txgbe_host_interface_command(&hw, cmd, 8, 50, false);
+	report(name, 50000, status);
+
+	CHECK(status == TXGBE_ERR_HOST_INTERFACE_COMMAND, name);
+	CHECK(adapter.hic.timeouts == 1, name);
+	CHECK(sim_now >= 50 * NSEC_PER_MSEC &&
+	      sim_now < 52 * NSEC_PER_MSEC, name);
+	CHECK(!fw.sem_held, name);
+}
+
+static void scenario_unknown(void)
+{
+	const char *name = "unknown_cmd";
+	u32 cmd[64];
+	s32 status;
+
+	sim_reset(40);
+	fw.unknown = true;
+	build_cmd(cmd, 0x7E, 0);
+	status = txgbe_host_interface_command(&hw, cmd, 8,
+					      TXGBE_HI_COMMAND_TIMEOUT, true);
+	report(name, 40, status);
+
+	CHECK(status == TXGBE_ERR_MNG_ACCESS_FAILED, name);
+	CHECK(!fw.sem_held, name);
+}
+
+static void scenario_short_buffer(void)
+{
+	const char *name = "short_reply";
+	u32 cmd[64];
+	s32 status;
+
+	sim_reset(40);
+	fw.reply_len = 64;      /* more than the 16 byte buffer holds */
+	build_cmd(cmd, 0x31, 8);
+	status = txgbe_host_interface_command(&hw, cmd, 16,
+					      TXGBE_HI_COMMAND_TIMEOUT, true);
+	report(name, 40, status);
+
+	CHECK(status == TXGBE_ERR_HOST_INTERFACE_COMMAND, name);
+	CHECK(!fw.sem_held, name);
+}
+
+static void scenario_bad_length(void)
+{
+	const char *name = "bad_length";
+	u32 cmd[64];
+
+	sim_reset(40);
+	build_cmd(cmd, 0x31, 0);
+	CHECK(txgbe_host_interface_command(&hw, cmd, 6, 100, false) ==
+	      TXGBE_ERR_INVALID_ARGUMENT, name);
+	CHECK(txgbe_host_interface_command(&hw, cmd, 0, 100, false) ==
+	      TXGBE_ERR_HOST_INTERFACE_COMMAND, name);
+	CHECK(fw.cmds == 0 && !fw.sem_held, name);
+}
+
+static void scenario_batch(unsigned int chunks, u64 latency_us)
+{
+	const char *name = "batch";
+	u32 cmd[64];
+	s32 status = 0;
+	unsigned int i;
+
+	sim_reset(latency_us);
+	status = txgbe_hic_lock(&hw);
+	for (i = 0; !status && i < chunks; i++) {
+		build_cmd(cmd, 0x31, 0);
+		status = __txgbe_host_interface_command(&hw, cmd, 8,
+						TXGBE_HI_COMMAND_TIMEOUT,
+						false);
+	}
+	txgbe_hic_unlock(&hw);
+	report(name, latency_us * chunks, status);
+
+	CHECK(status == 0, name);
+	CHECK(fw.cmds == chunks && fw.sem_acquires == 1 && !fw.sem_held,
+	      name);
+	CHECK(adapter.hic.cmds == chunks && adapter.hic.batches == 1, name);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-H hz] [-m mmio_ns] [-i irq_ns] [-v]\n"
+		"  -H  simulated CONFIG_HZ (default 250)\n"
+		"  -m  cost of one register read in ns (default 500)\n"
+		"  -i  firmware event to waiter running in ns (default 5000)\n"
+		"  -v  print the driver's debug output\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "H:m:i:vh")) != -1) {
+		switch (c) {
+		case 'H':
+			sim_hz = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			sim_mmio_ns = strtoull(optarg, NULL, 0);
+			break;
+		case 'i':
+			sim_irq_ns = strtoull(optarg, NULL, 0);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : 2;
+		}
+	}
+	if (!sim_hz || sim_hz > 10000) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	printf("HZ=%u mmio=%lluns irq=%lluns\n\n", sim_hz,
+	       (unsigned long long)sim_mmio_ns,
+	       (unsigned long long)sim_irq_ns);
+	printf("%-14s %10s %7s %9s %7s %10s %7s\n", "scenario", "fw_us",
+	       "status", "wait_us", "sleeps", "legacy_us", "legacy");
+
+	scenario_latency("fast_poll", 30, false);
+	scenario_latency("medium_poll", 800, false);
+	scenario_latency("slow_poll", 150000, false);
+	scenario_latency("fast_irq", 30, true);
+	scenario_latency("slow_irq", 150000, true);
+	scenario_irq_cmds();
+	scenario_timeout();
+	scenario_unknown();
+	scenario_short_buffer();
+	scenario_bad_length();
+	scenario_batch(16, 60);
+
+	printf("\n%s (%d failed checks)\n", failures ? "FAIL" : "PASS",
+	       failures);
+	return failures ? 1 : 0;
+}
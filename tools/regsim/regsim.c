@@ -0,0 +1,360 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * regsim - user-space harness for the shadowed register tables
+ *
+ * Builds src/txgbe_regtbl.c unmodified against a register file model
+ * that counts every MMIO write and read.  A write is posted and cheap, a
+ * read is a full round trip to the device; both costs can be changed on
+ * the command line.  Nothing depends on the host clock, so every run is
+ * deterministic.
+ *
+ * The real txgbe_type.h is kept out by pre-defining its include guard;
+ * everything txgbe_regtbl.c needs from it is declared below.  When
+ * txgbe_regtbl.c starts using something new, add it here.
+ *
+ * Each scenario drives a table the way the driver does (multicast list
+ * update, VLAN add, VLAN promiscuous toggle, RSS table change, MAC reset)
+ * and checks the register traffic and that the register file ends up
+ * holding exactly what the driver asked for.  The exit status is non-zero
+ * if any check fails.
+ */
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t s32;
+
+/* keep the real driver headers out */
+#define _TXGBE_TYPE_H_
+
+#define BITS_PER_LONG		(sizeof(long) * CHAR_BIT)
+#define BITS_TO_LONGS(n)	(((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define DECLARE_BITMAP(name, bits) unsigned long name[BITS_TO_LONGS(bits)]
+#define min(a, b)		((a) < (b) ? (a) : (b))
+#define min_t(t, a, b)		min((t)(a), (t)(b))
+
+static bool test_bit(unsigned int nr, const unsigned long *map)
+{
+	return map[nr / BITS_PER_LONG] >> (nr % BITS_PER_LONG) & 1;
+}
+
+static void __set_bit(unsigned int nr, unsigned long *map)
+{
+	map[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG);
+}
+
+static void bitmap_zero(unsigned long *map, unsigned int bits)
+{
+	memset(map, 0, BITS_TO_LONGS(bits) * sizeof(long));
+}
+
+/* from src/txgbe_type.h */
+#define TXGBE_MIS_PWR			0x10000
+#define TXGBE_RDB_RSSTBL(_i)		(0x19400 + ((_i) * 4))
+#define TXGBE_PSR_MC_TBL(_i)		(0x15200 + ((_i) * 4))
+#define TXGBE_PSR_VLAN_TBL(_i)		(0x16000 + ((_i) * 4))
+
+struct txgbe_hw {
+	int unused;
+};
+
+/* ---- simulated device ----------------------------------------------- */
+
+#define SIM_REGS		0x20000
+
+static u64 sim_write_ns = 50;           /* posted write */
+static u64 sim_read_ns = 1000;          /* read round trip */
+
+static u32 regs[SIM_REGS / 4];
+
+static struct {
+	u64 writes;
+	u64 reads;
+} mmio;
+
+static u32 rd32(struct txgbe_hw *hw, u32 reg)
+{
+	mmio.reads++;
+	return reg < SIM_REGS ? regs[reg >> 2] : 0;
+}
+
+static void wr32(struct txgbe_hw *hw, u32 reg, u32 val)
+{
+	mmio.writes++;
+	if (reg < SIM_REGS)
+		regs[reg >> 2] = val;
+}
+
+#define TXGBE_WRITE_FLUSH(H)	rd32(H, TXGBE_MIS_PWR)
+
+#include "../../src/txgbe_regtbl.h"
+#include "../../src/txgbe_regtbl.c"
+
+static struct txgbe_hw hw;
+
+/* the MAC reset clears the filter tables */
+static void sim_mac_reset(void)
+{
+	u32 i;
+
+	for (i = 0; i < 128; i++) {
+		regs[TXGBE_PSR_MC_TBL(i) >> 2] = 0;
+		regs[TXGBE_PSR_VLAN_TBL(i) >> 2] = 0;
+	}
+	for (i = 0; i < 32; i++)
+		regs[TXGBE_RDB_RSSTBL(i) >> 2] = 0;
+}
+
+/* ---- scenarios ------------------------------------------------------ */
+
+static int failures;
+
+#define CHECK(cond, name) do {						\
+	if (!(cond)) {							\
+		printf("FAIL %s: %s\n", name, #cond);			\
+		failures++;						\
+	}								\
+} while (0)
+
+static void begin(void)
+{
+	memset(&mmio, 0, sizeof(mmio));
+}
+
+/* @legacy: register writes the previous code issued for the same step */
+static void report(const char *name, u32 legacy)
+{
+	u64 ns = mmio.writes * sim_write_ns + mmio.reads * sim_read_ns;
+
+	printf("%-14s %7llu %6llu %8llu %7u %9llu\n", name,
+	       (unsigned long long)mmio.writes,
+	       (unsigned long long)mmio.reads,
+	       (unsigned long long)ns, legacy,
+	       (unsigned long long)legacy * sim_write_ns);
+}
+
+static bool table_is(struct txgbe_reg_table *tbl, const u32 *vals, u32 count)
+{
+	u32 i;
+
+	for (i = 0; i < count; i++)
+		if (regs[(tbl->reg >> 2) + i] != vals[i])
+			return false;
+	return true;
+}
+
+/* multicast hash bit as computed by txgbe_mta_vector() */
+static void mta_add(u32 *mta, u32 vector)
+{
+	mta[(vector >> 5) & 0x7F] |= 1U << (vector & 0x1F);
+}
+
+static void scenario_mta(void)
+{
+	struct txgbe_reg_table tbl;
+	u32 mta[128] = { 0 };
+	u32 i, n;
+
+	txgbe_reg_table_init(&tbl, TXGBE_PSR_MC_TBL(0), 128);
+
+	/* txgbe_init_rx_addrs(): clear after reset */
+	sim_mac_reset();
+	begin();
+	n = txgbe_reg_table_fill(&hw, &tbl, 0);
+	report("mta_clear", 128);
+	CHECK(n == 128 && mmio.writes == 128 && mmio.reads == 1,
+	      "mta_clear");
+	CHECK(table_is(&tbl, mta, 128), "mta_clear");
+
+	/* 16 groups joined at once, every set_rx_mode rewrote all 128 */
+	for (i = 0; i < 16; i++)
+		mta_add(mta, 0x101 + i * 0x53);
+	begin();
+	n = txgbe_reg_table_sync(&hw, &tbl, mta, 128);
+	report("mta_join16", 128);
+	CHECK(n == mmio.writes && n > 0 && n <= 16 && mmio.reads == 1,
+	      "mta_join16");
+	CHECK(table_is(&tbl, mta, 128), "mta_join16");
+
+	/* set_rx_mode with an unchanged list */
+	begin();
+	n = txgbe_reg_table_sync(&hw, &tbl, mta, 128);
+	report("mta_same", 128);
+	CHECK(n == 0 && mmio.writes == 0 && mmio.reads == 0, "mta_same");
+
+	/* one more group */
+	mta_add(mta, 0xabc);
+	begin();
+	n = txgbe_reg_table_sync(&hw, &tbl, mta, 128);
+	report("mta_join1", 128);
+	CHECK(n == 1 && mmio.writes == 1 && mmio.reads == 1, "mta_join1");
+	CHECK(table_is(&tbl, mta, 128), "mta_join1");
+
+	/* a reset cleared the registers: everything is written again */
+	sim_mac_reset();
+	txgbe_reg_table_forget(&tbl);
+	begin();
+	n = txgbe_reg_table_sync(&hw, &tbl, mta, 128);
+	report("mta_reset", 128);
+	CHECK(n == 128 && mmio.writes == 128 && mmio.reads == 1,
+	      "mta_reset");
+	CHECK(table_is(&tbl, mta, 128), "mta_reset");
+}
+
+static void scenario_vfta(void)
+{
+	struct txgbe_reg_table tbl;
+	u32 vft[128] = { 0 };
+	u32 ones[128];
+	u32 vid, written;
+
+	memset(ones, 0xff, sizeof(ones));
+	txgbe_reg_table_init(&tbl, TXGBE_PSR_VLAN_TBL(0), 128);
+	sim_mac_reset();
+	txgbe_reg_table_fill(&hw, &tbl, 0);
+
+	/* txgbe_set_vfta() for 64 consecutive VLANs, not flushed, as before */
+	begin();
+	written = 0;
+	for (vid = 100; vid < 164; vid++) {
+		vft[vid >> 5] |= 1U << (vid & 0x1F);
+		written += txgbe_reg_table_set(&hw, &tbl, vid >> 5,
+					       vft[vid >> 5]);
+	}
+	report("vlan_add64", 64);
+	CHECK(written == 64 && mmio.writes == 64 && mmio.reads == 0,
+	      "vlan_add64");
+	CHECK(table_is(&tbl, vft, 128), "vlan_add64");
+
+	/* the same VLAN again writes nothing */
+	begin();
+	CHECK(!txgbe_reg_table_set(&hw, &tbl, 100 >> 5, vft[100 >> 5]),
+	      "vlan_again");
+	report("vlan_again", 0);
+	CHECK(mmio.writes == 0 && mmio.reads == 0, "vlan_again");
+
+	/* promiscuous on and off again; VLANs 128-159 fill a whole register,
+	 * which already holds ~0 and is left alone both ways
+	 */
+	begin();
+	txgbe_reg_table_fill(&hw, &tbl, ~0U);
+	report("vlan_promisc", 128);
+	CHECK(mmio.writes == 127 && mmio.reads == 1, "vlan_promisc");
+	CHECK(table_is(&tbl, ones, 128), "vlan_promisc");
+
+	begin();
+	txgbe_reg_table_fill(&hw, &tbl, ~0U);
+	report("vlan_promisc2", 128);
+	CHECK(mmio.writes == 0 && mmio.reads == 0, "vlan_promisc2");
+
+	begin();
+	txgbe_reg_table_sync(&hw, &tbl, vft, 128);
+	report("vlan_scrub", 128);
+	CHECK(mmio.writes == 127 && mmio.reads == 1, "vlan_scrub");
+	CHECK(table_is(&tbl, vft, 128), "vlan_scrub");
+
+	/* out of range index is ignored */
+	begin();
+	CHECK(!txgbe_reg_table_set(&hw, &tbl, 128, 1), "vlan_range");
+	txgbe_reg_table_flush(&hw, &tbl);
+	CHECK(mmio.writes == 0 && mmio.reads == 0, "vlan_range");
+}
+
+/* txgbe_store_reta(): 4 queue indices per register */
+static void build_reta(u32 *reta, u32 entries, u32 queues)
+{
+	u32 i;
+
+	memset(reta, 0, 32 * sizeof(*reta));
+	for (i = 0; i < entries; i++)
+		reta[i >> 2] |= (i % queues) << (i & 0x3) * 8;
+}
+
+static void scenario_reta(void)
+{
+	struct txgbe_reg_table tbl;
+	u32 reta[32];
+	u32 n;
+
+	txgbe_reg_table_init(&tbl, TXGBE_RDB_RSSTBL(0), 32);
+	sim_mac_reset();
+
+	build_reta(reta, 128, 8);
+	begin();
+	n = txgbe_reg_table_sync(&hw, &tbl, reta, 32);
+	report("reta_8q", 32);
+	CHECK(n == 32 && mmio.reads == 1, "reta_8q");
+	CHECK(table_is(&tbl, reta, 32), "reta_8q");
+
+	/* ethtool -X with the same spread, e.g. after a ring resize */
+	begin();
+	n = txgbe_reg_table_sync(&hw, &tbl, reta, 32);
+	report("reta_same", 32);
+	CHECK(n == 0 && mmio.reads == 0, "reta_same");
+
+	/* 8 -> 4 queues: entries 0-3 of every group of 8 do not move */
+	build_reta(reta, 128, 4);
+	begin();
+	n = txgbe_reg_table_sync(&hw, &tbl, reta, 32);
+	report("reta_4q", 32);
+	CHECK(n == 16 && mmio.reads == 1, "reta_4q");
+	CHECK(table_is(&tbl, reta, 32), "reta_4q");
+
+	/* SR-IOV: only the first 64 entries (16 registers) are used */
+	build_reta(reta, 64, 2);
+	begin();
+	n = txgbe_reg_table_sync(&hw, &tbl, reta, 16);
+	report("reta_sriov", 16);
+	CHECK(n <= 16 && mmio.writes == n, "reta_sriov");
+	CHECK(table_is(&tbl, reta, 16), "reta_sriov");
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-w write_ns] [-r read_ns]\n"
+		"  -w  posted register write in ns (default 50)\n"
+		"  -r  register read round trip in ns (default 1000)\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "w:r:h")) != -1) {
+		switch (c) {
+		case 'w':
+			sim_write_ns = strtoull(optarg, NULL, 0);
+			break;
+		case 'r':
+			sim_read_ns = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : 2;
+		}
+	}
+
+	printf("write=%lluns read=%lluns\n\n",
+	       (unsigned long long)sim_write_ns,
+	       (unsigned long long)sim_read_ns);
+	printf("%-14s %7s %6s %8s %7s %9s\n", "scenario", "writes", "reads",
+	       "mmio_ns", "legacy", "legacy_ns");
+
+	scenario_mta();
+	scenario_vfta();
+	scenario_reta();
+
+	printf("\n%s (%d failed checks)\n", failures ? "FAIL" : "PASS",
+	       failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,812 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * ringbench - user-space benchmark of the descriptor ring loops
+ *
+ * Builds src/txgbe_ring.c unmodified, i.e. txgbe_tx_reclaim() and
+ * txgbe_alloc_rx_buffers() as the NAPI poll runs them, against a
+ * simulated device that writes back descriptors.  Pages, skbs, DMA
+ * mapping and the tail register are replaced by a counting shim.  Only
+ * the calls into txgbe_ring.c are timed.
+ *
+ * The parts of the Rx clean that stay in txgbe_main.c are modelled here:
+ * the stack takes one page reference per buffer, and the buffer is
+ * handed back to the ring the way txgbe_put_rx_buffer() does, by page
+ * flip while the other half is free, otherwise unmapped and dropped.
+ * -H holds the skbs of that many packets before the stack frees them,
+ * which defeats page reuse the way a slow consumer does.
+ *
+ * The real txgbe.h is kept out by pre-defining its include guard;
+ * everything txgbe_ring.c needs from it is declared below.  When
+ * txgbe_ring.c starts using something new, add it here.
+ *
+ * Every run also checks the rings: descriptors point at their buffers,
+ * the tail matches next_to_use, nothing leaks, and Tx reclaim stops at
+ * the first descriptor without DD and at the budget.  The exit status is
+ * non-zero if any check fails.
+ */
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef uint16_t __be16;
+typedef uint16_t __le16;
+typedef uint32_t __le32;
+typedef uint64_t __le64;
+typedef uint64_t dma_addr_t;
+
+/* keep the real driver headers out */
+#define _TXGBE_H_
+#define _TXGBE_TRACE_H_
+#define txgbe_trace(...)	do { } while (0)
+
+#define likely(x)		__builtin_expect(!!(x), 1)
+#define unlikely(x)		__builtin_expect(!!(x), 0)
+#define __maybe_unused		__attribute__((unused))
+#define __iomem
+#define barrier()		__asm__ __volatile__("" : : : "memory")
+#define smp_rmb()		barrier()
+#define wmb()			barrier()
+#define prefetch(p)		__builtin_prefetch(p)
+#define cpu_to_le32(x)		((__le32)(x))
+#define cpu_to_le64(x)		((__le64)(x))
+#define USHRT_MAX		0xFFFF
+#define NUMA_NO_NODE		(-1)
+#define PAGE_SIZE		4096UL
+
+#define GFP_ATOMIC		0x1
+#define __GFP_NOWARN		0x2
+#define __GFP_COMP		0x4
+#define __GFP_MEMALLOC		0x8
+
+enum dma_data_direction { DMA_TO_DEVICE, DMA_FROM_DEVICE };
+
+#define DEFINE_DMA_UNMAP_ADDR(name)	dma_addr_t name
+#define DEFINE_DMA_UNMAP_LEN(name)	u32 name
+#define dma_unmap_addr(p, name)		((p)->name)
+#define dma_unmap_len(p, name)		((p)->name)
+#define dma_unmap_len_set(p, name, v)	((p)->name = (v))
+
+static bool test_bit(unsigned int nr, const unsigned long *addr)
+{
+	return *addr >> nr & 1;
+}
+
+/* the default build: packet split, bulk page references */
+#define HAVE_PAGE_COUNT_BULK_UPDATE
+
+/* ---- structures, from src/txgbe.h and src/txgbe_type.h --------------- */
+
+struct device { int unused; };
+struct net_device { int unused; };
+struct u64_stats_sync { int unused; };
+#define u64_stats_update_begin(s)	do { } while (0)
+#define u64_stats_update_end(s)		do { } while (0)
+
+struct page {
+	long refcount;
+	int order;
+};
+
+struct sk_buff {
+	unsigned char *data;
+};
+
+#define TXGBE_TXD_STAT_DD	0x00000001U
+#define TXGBE_RXD_STAT_DD	0x00000001U
+#define TXGBE_RXD_STAT_EOP	0x00000002U
+#define TXGBE_RXBUFFER_2K	2048
+
+union txgbe_tx_desc {
+	struct {
+		__le64 buffer_addr;
+		__le32 cmd_type_len;
+		__le32 olinfo_status;
+	} read;
+	struct {
+		__le64 rsvd;
+		__le32 nxtseq_seed;
+		__le32 status;
+	} wb;
+};
+
+union txgbe_rx_desc {
+	struct {
+		__le64 pkt_addr;
+		__le64 hdr_addr;
+	} read;
+	struct {
+		struct {
+			__le32 data;
+			__le32 rss;
+		} lower;
+		struct {
+			__le32 status_error;
+			__le16 length;
+			__le16 vlan;
+		} upper;
+	} wb;
+};
+
+struct txgbe_tx_buffer {
+	union txgbe_tx_desc *next_to_watch;
+	unsigned long time_stamp;
+	struct sk_buff *skb;
+	unsigned int bytecount;
+	unsigned short gso_segs;
+	__be16 protocol;
+	DEFINE_DMA_UNMAP_ADDR(dma);
+	DEFINE_DMA_UNMAP_LEN(len);
+	u32 tx_flags;
+};
+
+struct txgbe_rx_buffer {
+	struct sk_buff *skb;
+	dma_addr_t dma;
+	dma_addr_t page_dma;
+	struct page *page;
+	unsigned int page_offset;
+	u16 pagecnt_bias;
+};
+
+struct txgbe_queue_stats {
+	u64 packets;
+	u64 bytes;
+};
+
+struct txgbe_rx_queue_stats {
+	u64 alloc_rx_page_failed;
+	u64 alloc_rx_buff_failed;
+};
+
+struct txgbe_q_vector {
+	int numa_node;
+};
+
+enum txgbe_ring_state_t {
+	__TXGBE_RX_HS_ENABLED,
+};
+
+#define ring_is_hs_enabled(ring) \
+	test_bit(__TXGBE_RX_HS_ENABLED, &(ring)->state)
+
+struct txgbe_ring {
+	struct txgbe_q_vector *q_vector;
+	struct net_device *netdev;
+	struct device *dev;
+	void *desc;
+	union {
+		struct txgbe_tx_buffer *tx_buffer_info;
+		struct txgbe_rx_buffer *rx_buffer_info;
+	};
+	unsigned long state;
+	u8 __iomem *tail;
+	u16 count;
+	u16 next_to_use;
+	u16 next_to_clean;
+	u16 rx_buf_len;
+	u16 next_to_alloc;
+	struct txgbe_queue_stats stats;
+	struct u64_stats_sync syncp;
+	struct txgbe_rx_queue_stats rx_stats;
+};
+
+#define TXGBE_RX_DESC(R, i)	(&(((union txgbe_rx_desc *)((R)->desc))[i]))
+#define TXGBE_TX_DESC(R, i)	(&(((union txgbe_tx_desc *)((R)->desc))[i]))
+
+static inline unsigned int txgbe_rx_bufsz(struct txgbe_ring *ring)
+{
+	return TXGBE_RXBUFFER_2K;
+}
+
+static inline unsigned int txgbe_rx_pg_order(struct txgbe_ring *ring)
+{
+	return 0;
+}
+#define txgbe_rx_pg_size(_ring) (PAGE_SIZE << txgbe_rx_pg_order(_ring))
+
+static inline unsigned int txgbe_rx_offset(struct txgbe_ring *rx_ring)
+{
+	return 0;
+}
+
+/* ---- simulated kernel services -------------------------------------- */
+
+static struct {
+	u64 pages;              /* alive */
+	u64 page_allocs;
+	u64 skbs;               /* alive */
+	u64 skb_allocs;
+	u64 maps;
+	u64 unmaps;
+	u64 syncs;
+	u64 tails;
+	u32 tail;
+} sim;
+
+static bool sim_softirq;
+
+static int in_softirq(void)
+{
+	return sim_softirq;
+}
+
+static struct page *alloc_pages_node(int node, unsigned int gfp,
+				     unsigned int order)
+{
+	struct page *page = malloc(sizeof(*page));
+
+	if (!page)
+		return NULL;
+	page->refcount = 1;
+	page->order = order;
+	sim.pages++;
+	sim.page_allocs++;
+	return page;
+}
+
+static void __free_pages(struct page *page, unsigned int order)
+{
+	sim.pages--;
+	free(page);
+}
+
+static void page_ref_add(struct page *page, int nr)
+{
+	page->refcount += nr;
+}
+
+/* drop references, free the page with the last one */
+static void sim_page_put(struct page *page, long nr)
+{
+	page->refcount -= nr;
+	if (!page->refcount)
+		__free_pages(page, page->order);
+}
+
+static struct sk_buff *sim_skb_alloc(unsigned int len)
+{
+	struct sk_buff *skb = malloc(sizeof(*skb));
+
+	if (!skb)
+		return NULL;
+	skb->data = (unsigned char *)skb;
+	sim.skbs++;
+	sim.skb_allocs++;
+	return skb;
+}
+
+static void sim_skb_free(struct sk_buff *skb)
+{
+	if (!skb)
+		return;
+	sim.skbs--;
+	free(skb);
+}
+
+#define netdev_alloc_skb_ip_align(dev, len)	sim_skb_alloc(len)
+#define dev_consume_skb_any(skb)		sim_skb_free(skb)
+#define dev_kfree_skb_any(skb)			sim_skb_free(skb)
+
+/* the bus address is the CPU address, so checks can follow it back */
+static dma_addr_t dma_map_page(struct device *dev, struct page *page,
+			       size_t offset, size_t size,
+			       enum dma_data_direction dir)
+{
+	sim.maps++;
+	return (dma_addr_t)(uintptr_t)page + offset;
+}
+
+static dma_addr_t dma_map_single(struct device *dev, void *ptr, size_t size,
+				 enum dma_data_direction dir)
+{
+	sim.maps++;
+	return (dma_addr_t)(uintptr_t)ptr;
+}
+
+static int dma_mapping_error(struct device *dev, dma_addr_t dma)
+{
+	return 0;
+}
+
+static void dma_unmap_single(struct device *dev, dma_addr_t dma, size_t size,
+			     enum dma_data_direction dir)
+{
+	sim.unmaps++;
+}
+
+static void dma_unmap_page(struct device *dev, dma_addr_t dma, size_t size,
+			   enum dma_data_direction dir)
+{
+	sim.unmaps++;
+}
+
+static void dma_sync_single_range_for_device(struct device *dev,
+					     dma_addr_t dma, unsigned long off,
+					     size_t size,
+					     enum dma_data_direction dir)
+{
+	sim.syncs++;
+}
+
+static void writel(u32 val, volatile void __iomem *addr)
+{
+	sim.tails++;
+	sim.tail = val;
+}
+
+/* ---- the code under test -------------------------------------------- */
+
+#include "../../src/txgbe_ring.c"
+
+/* ---- checks ---------------------------------------------------------- */
+
+static int failures;
+
+#define CHECK(cond, name) do {						\
+	if (!(cond)) {							\
+		printf("FAIL %s: %s\n", name, #cond);			\
+		failures++;						\
+	}								\
+} while (0)
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned int ring_size = 512;
+static unsigned int budget = 64;
+static unsigned int hold;
+static u64 npkts = 1000000;
+
+static struct txgbe_q_vector q_vector;
+static struct device dev;
+static struct net_device netdev;
+
+static void ring_init(struct txgbe_ring *ring, size_t desc_size,
+		      size_t bi_size)
+{
+	memset(ring, 0, sizeof(*ring));
+	ring->q_vector = &q_vector;
+	ring->netdev = &netdev;
+	ring->dev = &dev;
+	ring->count = ring_size;
+	ring->rx_buf_len = TXGBE_RXBUFFER_2K;
+	ring->desc = aligned_alloc(4096, ring_size * desc_size);
+	ring->tx_buffer_info = calloc(ring_size, bi_size);
+	if (!ring->desc || !ring->tx_buffer_info) {
+		fprintf(stderr, "ringbench: out of memory\n");
+		exit(2);
+	}
+	memset(ring->desc, 0, ring_size * desc_size);
+}
+
+static void ring_free(struct txgbe_ring *ring)
+{
+	free(ring->desc);
+	free(ring->tx_buffer_info);
+}
+
+static u16 desc_unused(struct txgbe_ring *ring)
+{
+	u16 ntc = ring->next_to_clean;
+	u16 ntu = ring->next_to_use;
+
+	return ((ntc > ntu) ? 0 : ring->count) + ntc - ntu - 1;
+}
+
+struct result {
+	u64 pkts;
+	u64 ns;
+	u64 allocs;
+	u64 maps;
+	u64 tails;
+};
+
+static void report(const char *mode, unsigned int size, struct result *r)
+{
+	double p = r->pkts ? (double)r->pkts : 1;
+
+	printf("%-4s %6u %10llu %8.2f %8.2f %8.3f %8.3f %8.3f\n", mode, size,
+	       (unsigned long long)r->pkts, r->ns / p,
+	       r->ns ? 1000 * p / r->ns : 0, r->allocs / p, r->maps / p,
+	       r->tails / p);
+}
+
+/* ---- Tx ------------------------------------------------------------- */
+
+#define TX_HDR_LEN	128
+#define TX_FRAG_LEN	4096
+
+/* what the stack and txgbe_tx_map() leave on the ring for one packet */
+static bool tx_queue_packet(struct txgbe_ring *ring, unsigned int size)
+{
+	unsigned int frags = size > TX_HDR_LEN ?
+			     (size - TX_HDR_LEN + TX_FRAG_LEN - 1) / TX_FRAG_LEN :
+			     0;
+	unsigned int need = 2 + frags;  /* context, head, frags */
+	struct txgbe_tx_buffer *first;
+	u16 i = ring->next_to_use;
+	unsigned int f;
+
+	if (desc_unused(ring) < need)
+		return false;
+
+	/* the context descriptor takes the slot of first */
+	first = &ring->tx_buffer_info[i];
+	first->skb = sim_skb_alloc(size);
+	first->bytecount = size;
+	first->gso_segs = 1;
+	first->dma = (dma_addr_t)(uintptr_t)first->skb->data;
+	first->len = size < TX_HDR_LEN ? size : TX_HDR_LEN;
+	sim.maps++;
+	i = (i + 1) % ring->count;
+	ring->tx_buffer_info[i].len = 0;
+
+	for (f = 0; f < frags; f++) {
+		i = (i + 1) % ring->count;
+		ring->tx_buffer_info[i].dma = 0x1000;
+		ring->tx_buffer_info[i].len = TX_FRAG_LEN;
+		sim.maps++;
+	}
+
+	TXGBE_TX_DESC(ring, i)->wb.status = 0;
+	first->next_to_watch = TXGBE_TX_DESC(ring, i);
+	ring->next_to_use = (i + 1) % ring->count;
+	return true;
+}
+
+/* the device completes the oldest @n packets not yet done */
+static unsigned int tx_complete(struct txgbe_ring *ring, unsigned int n)
+{
+	u16 i = ring->next_to_clean;
+	unsigned int done = 0;
+
+	while (done < n && i != ring->next_to_use) {
+		union txgbe_tx_desc *eop = ring->tx_buffer_info[i].next_to_watch;
+
+		if (!eop)
+			break;
+		if (!(eop->wb.status & TXGBE_TXD_STAT_DD)) {
+			eop->wb.status = TXGBE_TXD_STAT_DD;
+			done++;
+		}
+		i = (u16)((eop - TXGBE_TX_DESC(ring, 0)) + 1) % ring->count;
+	}
+	return done;
+}
+
+static void bench_tx(unsigned int size, struct result *r)
+{
+	const char *name = "tx";
+	struct txgbe_ring ring;
+	u64 sent = 0, bytes = 0, maps0;
+
+	ring_init(&ring, sizeof(union txgbe_tx_desc),
+		  sizeof(struct txgbe_tx_buffer));
+	memset(&sim, 0, sizeof(sim));
+	memset(r, 0, sizeof(*r));
+
+	while (r->pkts < npkts) {
+		unsigned int n, tx_bytes, tx_pkts, left;
+		u64 t;
+
+		for (n = 0; n < budget && tx_queue_packet(&ring, size); n++)
+			;
+		sent += n;
+		bytes += (u64)n * size;
+		tx_complete(&ring, n);
+
+		maps0 = sim.unmaps;
+		t = now_ns();
+		left = txgbe_tx_reclaim(&ring, budget, &tx_bytes, &tx_pkts);
+		r->ns += now_ns() - t;
+		r->maps += sim.unmaps - maps0;
+		r->pkts += tx_pkts;
+
+		CHECK(tx_pkts == n && tx_bytes == n * size, name);
+		CHECK(left == budget - n || (!left && n == budget), name);
+		CHECK(ring.next_to_clean == ring.next_to_use, name);
+		if (failures)
+			break;
+	}
+
+	CHECK(ring.stats.packets == sent && ring.stats.bytes == bytes, name);
+	CHECK(sim.skbs == 0 && sim.maps == sim.unmaps, name);
+	ring_free(&ring);
+}
+
+/* reclaim stops at the first packet without DD and at the budget */
+static void check_tx_partial(void)
+{
+	const char *name = "tx_partial";
+	unsigned int bytes, pkts, left;
+	struct txgbe_ring ring;
+	u16 third;
+	int i;
+
+	ring_init(&ring, sizeof(union txgbe_tx_desc),
+		  sizeof(struct txgbe_tx_buffer));
+	memset(&sim, 0, sizeof(sim));
+
+	for (i = 0; i < 8; i++)
+		tx_queue_packet(&ring, 1518);
+	tx_complete(&ring, 3);
+	left = txgbe_tx_reclaim(&ring, 64, &bytes, &pkts);
+	CHECK(pkts == 3 && bytes == 3 * 1518 && left == 61, name);
+	third = ring.next_to_clean;
+	CHECK(ring.tx_buffer_info[third].next_to_watch != NULL, name);
+
+	tx_complete(&ring, 5);
+	left = txgbe_tx_reclaim(&ring, 2, &bytes, &pkts);
+	CHECK(pkts == 2 && left == 0, name);
+	left = txgbe_tx_reclaim(&ring, 64, &bytes, &pkts);
+	CHECK(pkts == 3 && ring.next_to_clean == ring.next_to_use, name);
+	left = txgbe_tx_reclaim(&ring, 64, &bytes, &pkts);
+	CHECK(pkts == 0 && left == 64, name);
+	CHECK(sim.skbs == 0 && sim.maps == sim.unmaps, name);
+	ring_free(&ring);
+}
+
+/* ---- Rx ------------------------------------------------------------- */
+
+/* pages of received buffers the stack still holds a reference to */
+static struct page **held;
+static unsigned int held_head, held_len;
+
+static void stack_take(struct page *page)
+{
+	if (!hold) {
+		sim_page_put(page, 1);
+		return;
+	}
+	if (held_len == hold) {
+		sim_page_put(held[held_head], 1);
+		held_head = (held_head + 1) % hold;
+		held_len--;
+	}
+	held[(held_head + held_len++) % hold] = page;
+}
+
+static void stack_drain(void)
+{
+	while (held_len) {
+		sim_page_put(held[held_head], 1);
+		held_head = (held_head + 1) % hold;
+		held_len--;
+	}
+	held_head = 0;
+}
+
+/* txgbe_put_rx_buffer() with its reuse test and page flip */
+static void rx_put_buffer(struct txgbe_ring *ring, struct txgbe_rx_buffer *bi)
+{
+	struct page *page = bi->page;
+
+	bi->page_offset ^= txgbe_rx_bufsz(ring);
+	if (page->refcount - bi->pagecnt_bias <= 1) {
+		struct txgbe_rx_buffer *nb;
+		u16 nta = ring->next_to_alloc;
+
+		nb = &ring->rx_buffer_info[nta];
+		nta++;
+		ring->next_to_alloc = nta < ring->count ? nta : 0;
+		nb->page_dma = bi->page_dma;
+		nb->page = bi->page;
+		nb->page_offset = bi->page_offset;
+		nb->pagecnt_bias = bi->pagecnt_bias;
+		sim.syncs++;
+	} else {
+		sim.unmaps++;
+		sim_page_put(page, bi->pagecnt_bias);
+	}
+	bi->page_dma = 0;
+	bi->page = NULL;
+	bi->skb = NULL;
+}
+
+/*
+ * The device writes @n frames of @size from next_to_clean and the clean
+ * loop hands every buffer to the stack and back to the ring.  Returns
+ * the number of buffers cleaned.
+ */
+static u16 rx_receive(struct txgbe_ring *ring, unsigned int n,
+		      unsigned int size)
+{
+	unsigned int bufs = (size + TXGBE_RXBUFFER_2K - 1) / TXGBE_RXBUFFER_2K;
+	u16 i = ring->next_to_clean;
+	u16 cleaned = 0;
+	unsigned int p, b;
+
+	for (p = 0; p < n; p++) {
+		if (desc_unused(ring) + cleaned + bufs > ring->count - 1u)
+			break;
+		for (b = 0; b < bufs; b++) {
+			union txgbe_rx_desc *desc = TXGBE_RX_DESC(ring, i);
+			struct txgbe_rx_buffer *bi = &ring->rx_buffer_info[i];
+
+			CHECK(bi->page &&
+			      desc->read.pkt_addr == bi->page_dma +
+						     bi->page_offset, "rx");
+			if (!bi->page)
+				return cleaned;
+			desc->wb.upper.status_error = TXGBE_RXD_STAT_DD |
+				(b == bufs - 1 ? TXGBE_RXD_STAT_EOP : 0);
+			desc->wb.upper.length = b == bufs - 1 ?
+				size - b * TXGBE_RXBUFFER_2K :
+				TXGBE_RXBUFFER_2K;
+
+			bi->pagecnt_bias--;
+			stack_take(bi->page);
+			rx_put_buffer(ring, bi);
+
+			i = (i + 1) % ring->count;
+			cleaned++;
+		}
+	}
+	ring->next_to_clean = i;
+	return cleaned;
+}
+
+static void bench_rx(unsigned int size, struct result *r)
+{
+	const char *name = "rx";
+	unsigned int bufs = (size + TXGBE_RXBUFFER_2K - 1) / TXGBE_RXBUFFER_2K;
+	struct txgbe_ring ring;
+	u16 i;
+
+	ring_init(&ring, sizeof(union txgbe_rx_desc),
+		  sizeof(struct txgbe_rx_buffer));
+	memset(&sim, 0, sizeof(sim));
+	memset(r, 0, sizeof(*r));
+
+	/* ifup: the initial fill runs in process context */
+	sim_softirq = false;
+	txgbe_alloc_rx_buffers(&ring, desc_unused(&ring));
+	CHECK(sim.pages == ring.count - 1u && sim.tail == ring.next_to_use,
+	      name);
+	sim_softirq = true;
+
+	while (r->pkts < npkts) {
+		u64 allocs0, maps0, tails0, t;
+		u16 cleaned;
+
+		cleaned = rx_receive(&ring, budget, size);
+		if (failures || !cleaned)
+			break;
+		r->pkts += cleaned / bufs;
+
+		allocs0 = sim.page_allocs;
+		maps0 = sim.maps;
+		tails0 = sim.tails;
+		t = now_ns();
+		txgbe_alloc_rx_buffers(&ring, cleaned);
+		r->ns += now_ns() - t;
+		r->allocs += sim.page_allocs - allocs0;
+		r->maps += sim.maps - maps0;
+		r->tails += sim.tails - tails0;
+
+		CHECK(desc_unused(&ring) == 0 &&
+		      sim.tail == ring.next_to_use &&
+		      ring.next_to_alloc == ring.next_to_use, name);
+	}
+	CHECK(r->pkts >= npkts || failures, name);
+
+	/* ifdown */
+	for (i = 0; i < ring.count; i++) {
+		struct txgbe_rx_buffer *bi = &ring.rx_buffer_info[i];
+
+		if (!bi->page)
+			continue;
+		sim.unmaps++;
+		sim_page_put(bi->page, bi->pagecnt_bias);
+	}
+	stack_drain();
+	CHECK(sim.pages == 0 && sim.maps == sim.unmaps, name);
+	ring_free(&ring);
+}
+
+/* ---- main ------------------------------------------------------------ */
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-m rx|tx|both] [-s sizes] [-n pkts] [-r ring] [-b budget] [-H hold]\n"
+		"  -m  loops to run (default both)\n"
+		"  -s  comma-separated frame sizes, 60..9000 (default 64,512,1518,9000)\n"
+		"  -n  packets per size (default 1000000)\n"
+		"  -r  descriptors per ring, a power of 2 (default 512)\n"
+		"  -b  NAPI budget and Tx burst (default 64)\n"
+		"  -H  Rx packets the stack holds before freeing them (default 0)\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	const char *sizes = "64,512,1518,9000";
+	bool do_rx = true, do_tx = true;
+	struct result r;
+	char *list, *tok;
+	int c;
+
+	while ((c = getopt(argc, argv, "m:s:n:r:b:H:h")) != -1) {
+		switch (c) {
+		case 'm':
+			do_rx = strcmp(optarg, "tx") != 0;
+			do_tx = strcmp(optarg, "rx") != 0;
+			break;
+		case 's':
+			sizes = optarg;
+			break;
+		case 'n':
+			npkts = strtoull(optarg, NULL, 0);
+			break;
+		case 'r':
+			ring_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			budget = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			hold = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : 2;
+		}
+	}
+	if (ring_size < 64 || ring_size > 8192 ||
+	    (ring_size & (ring_size - 1)) || !budget || budget > 256 ||
+	    !npkts) {
+		usage(argv[0]);
+		return 2;
+	}
+	if (hold) {
+		held = calloc(hold, sizeof(*held));
+		if (!held)
+			return 2;
+	}
+
+	printf("ring=%u budget=%u hold=%u\n\n", ring_size, budget, hold);
+	printf("%-4s %6s %10s %8s %8s %8s %8s %8s\n", "loop", "size", "pkts",
+	       "ns/pkt", "Mpps", "alloc", "dma", "tails");
+
+	check_tx_partial();
+
+	list = strdup(sizes);
+	for (tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+		unsigned int size = strtoul(tok, NULL, 0);
+
+		if (size < 60 || size > 9000) {
+			usage(argv[0]);
+			return 2;
+		}
+		if (do_rx) {
+			bench_rx(size, &r);
+			report("rx", size, &r);
+		}
+		if (do_tx) {
+			bench_tx(size, &r);
+			report("tx", size, &r);
+		}
+	}
+	free(list);
+	free(held);
+
+	printf("\n%s (%d failed checks)\n", failures ? "FAIL" : "PASS",
+	       failures);
+	return failures ? 1 : 0;
+}